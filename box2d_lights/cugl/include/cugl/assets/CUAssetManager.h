@@ -176,9 +176,11 @@ protected:
      * Synchronizes the asset manager to wait until all assets have finished.
      *
      * This method is necessary for assets whose construction depends on
-     * previously loaded assets (e.g. scene graphs).  In the current architecture,
-     * this method is only correct if the asset manager loads assets in a
-     * single thread.
+     * previously loaded assets (e.g. scene graphs).  Loaders may finish assets
+     * on their own threads (e.g. texture decoding), so this method blocks the
+     * asset manager thread until no attached loader is finishing an asset
+     * on another thread. In the current architecture, this method is only
+     * correct if the asset manager reads assets in a single thread.
      */
     void sync();
     
@@ -191,6 +193,21 @@ protected:
      */
     void block();
 
+    /**
+     * Blocks the asset manager until all attached loaders are complete.
+     *
+     * Any assets queued after a drain will not be added to thread pool until
+     * no attached loader has an asset being finished on another thread (see
+     * {@link BaseLoader#offthreadCount}). The check is performed in the main
+     * thread once each animation frame. The manager then blocks for one more
+     * complete frame, so that main thread callbacks can finish. This method
+     * is used to implement the {@link sync()} method.
+     *
+     * This method cannot wait on {@link complete()}, as assets queued after
+     * the drain are waiting behind it on the same thread.
+     */
+    void drain();
+
     /**
      * Resumes a previously blocked the asset manager.
      *
@@ -227,11 +244,14 @@ public:
     void dispose();
 
     /**
-     * Initializes a new asset manager with two auxiliary threads.
-     *
-     * The asset manager will have a thread pool of size 2, giving it two 
-     * threads to load assets asynchronously.  These threads have no effect on 
-     * synchronous loading and will sleep when no assets are being loaded.
+     * Initializes a new asset manager with a single auxiliary thread.
+     *
+     * The asset manager thread reads asset directories and dispatches each
+     * asset to its loader. A single thread keeps this dispatch ordered, which
+     * {@link sync} relies upon.  Loaders may do the heavy work on threads of
+     * their own (e.g. {@link TextureLoader} decodes images in parallel). This
+     * thread has no effect on synchronous loading and will sleep when no assets
+     * are being loaded.
      *
      * This initializer does not attach any loaders.  It simply creates an 
      * object that is ready to accept loader objects.
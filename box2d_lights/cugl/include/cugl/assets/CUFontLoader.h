@@ -80,6 +80,8 @@ protected:
     int _fontsize;
     /** The default atlas character set ("" for ASCII) */
     std::string _charset;
+    /** Whether fonts use a dynamic atlas by default */
+    bool _dynamic;
     
 #pragma mark Asset Loading
     /**
@@ -93,10 +95,12 @@ protected:
      * @param source    The pathname to the asset
      * @param charset   The atlas character set
      * @param size      The font size
+     * @param dynamic   Whether to use a dynamic atlas (ignoring charset)
      *
      * @return the font asset with no generated atlas
      */
-    std::shared_ptr<Font> preload(const std::string& source, const std::string& charset, int size);
+    std::shared_ptr<Font> preload(const std::string& source, const std::string& charset,
+                                  int size, bool dynamic);
     
     /**
      * Creates an atlas for the font asset, and assigns it the given key.
@@ -179,6 +183,7 @@ protected:
      *      "file":         The path to the asset
      *      "size":         This font size (int)
      *      "charset":      The set of characters for the font atlas (string)
+     *      "dynamic":      Whether to rasterize glyphs on demand (bool)
      *
      * @param json      The directory entry for the asset
      * @param callback  An optional callback for asynchronous loading
@@ -487,6 +492,32 @@ public:
      * @param charset   The default atlas character set
      */
     void setCharacterSet(const std::string& charset) { _charset = charset; }
+    
+    /**
+     * Returns true if fonts use a dynamic atlas by default
+     *
+     * A dynamic atlas ignores the character set. It starts empty and
+     * rasterizes glyphs the first time that they are rendered. This is
+     * useful for fonts that display arbitrary text, such as player names.
+     * Once set, any font processed by this loader will use a dynamic atlas
+     * unless otherwise specified. The default is false.
+     *
+     * @return true if fonts use a dynamic atlas by default
+     */
+    bool isDynamicAtlas() const { return _dynamic; }
+    
+    /**
+     * Sets whether fonts use a dynamic atlas by default
+     *
+     * A dynamic atlas ignores the character set. It starts empty and
+     * rasterizes glyphs the first time that they are rendered. This is
+     * useful for fonts that display arbitrary text, such as player names.
+     * Once set, any font processed by this loader will use a dynamic atlas
+     * unless otherwise specified. The default is false.
+     *
+     * @param dynamic   Whether fonts use a dynamic atlas by default
+     */
+    void setDynamicAtlas(bool dynamic) { _dynamic = dynamic; }
 };
 
 }
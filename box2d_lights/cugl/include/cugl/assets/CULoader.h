@@ -695,6 +695,19 @@ public:
      * @return the number of assets waiting to load.
      */
     virtual size_t waitCount() const { return 0; }
+
+    /**
+     * Returns the number of assets being finished outside of the loader thread.
+     *
+     * Some loaders hand an asset off to another thread (such as a decoding
+     * pool or the main thread) once the loader thread has read it. This is
+     * the number of such assets that are not yet finished. Unlike
+     * {@link waitCount}, it does not include assets still waiting for the
+     * loader thread, so it is safe to wait on from that thread.
+     *
+     * @return the number of assets being finished outside of the loader thread.
+     */
+    virtual size_t offthreadCount() const { return 0; }
     
     /**
      * Returns true if the loader has finished loading all assets.
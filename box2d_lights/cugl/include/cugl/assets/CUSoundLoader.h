@@ -47,8 +47,13 @@
 #define __CU_SOUND_LOADER_H__
 #include <cugl/assets/CULoader.h>
 #include <cugl/audio/CUSound.h>
+#include <unordered_map>
+#include <mutex>
 
 namespace cugl {
+
+/** Forward reference to an audio sample */
+class AudioSample;
     
 /**
  * This class is a implementation of Loader<Sound>
@@ -63,6 +68,13 @@ namespace cugl {
  * off the remainder of asset loading using {@link Application#schedule}.  This
  * is a good template for asset loaders in general.
  *
+ * Audio samples no longer than {@link getStreamLimit} seconds are decoded
+ * once, in full, at load time. The decoded PCM data is immutable and cached
+ * by file, so loading the same file under several keys shares a single
+ * buffer. If {@link getSampleRate} is nonzero, these samples are also
+ * resampled to that rate at load time, so that no conversion is necessary
+ * on the audio thread. Longer samples (e.g. music) are streamed from disk.
+ *
  * As with all of our loaders, this loader is designed to be attached to an
  * asset manager. Use the method {@link getHook()} to get the appropriate
  * pointer for attaching the loader.
@@ -75,8 +87,36 @@ private:
 protected:
     /** The default volume for all music assets */
     float _volume;
+    /** The maximum duration (in seconds) of a sample decoded into memory */
+    double _streamLimit;
+    /** The sample rate to convert in-memory samples to (0 for no conversion) */
+    Uint32 _sampleRate;
+    /** The decoded samples, shared by file so that PCM data is read once */
+    std::unordered_map<std::string,std::weak_ptr<AudioSample>> _pcmcache;
+    /** A mutex to guard the sample cache between loader threads */
+    std::mutex _pcmmutex;
     
 #pragma mark Asset Loading
+    /**
+     * Returns a newly allocated audio sample for the given file.
+     *
+     * If stream is false and force is true, the sample is decoded into
+     * memory. If force is false, the sample is only decoded into memory if
+     * its duration is no more than the stream limit. Decoded samples are
+     * cached by file, and share their PCM data with any earlier sample for
+     * the same file that is still in use. If there is a sample rate for this
+     * loader, decoded samples are resampled to that rate.
+     *
+     * This method is safe to call from a loader thread.
+     *
+     * @param path      The path to the audio file
+     * @param stream    Whether to stream the sample (if force is true)
+     * @param force     Whether to ignore the stream limit
+     *
+     * @return a newly allocated audio sample for the given file.
+     */
+    std::shared_ptr<AudioSample> allocSample(const std::string& path, bool stream, bool force);
+    
     /**
      * Finishes loading the sound file, setting its default volume.
      *
@@ -132,6 +172,10 @@ protected:
      *
      *      "file":         The path to the asset
      *      "volume":       This default sound volume (float)
+     *      "stream":       Whether to stream the sample (bool)
+     *
+     * If "stream" is not specified, a sample is streamed only if it is
+     * longer than the stream limit.
      *
      * @param json      The directory entry for the asset
      * @param callback  An optional callback for asynchronous loading
@@ -168,6 +212,8 @@ public:
     void dispose() override {
         _assets.clear();
         _loader = nullptr;
+        std::lock_guard<std::mutex> lock(_pcmmutex);
+        _pcmcache.clear();
     }
     
     /**
@@ -228,6 +274,57 @@ public:
      */
     void setVolume(float volume) { _volume = volume; }
     
+    /**
+     * Returns the maximum duration (in seconds) of an in-memory sample
+     *
+     * Any sample no longer than this is decoded into memory when loaded.
+     * Any sample longer than this is streamed from disk. This limit is
+     * ignored for JSON entries that specify the "stream" attribute. The
+     * default is 10 seconds.
+     *
+     * @return the maximum duration (in seconds) of an in-memory sample
+     */
+    double getStreamLimit() const { return _streamLimit; }
+    
+    /**
+     * Sets the maximum duration (in seconds) of an in-memory sample
+     *
+     * Any sample no longer than this is decoded into memory when loaded.
+     * Any sample longer than this is streamed from disk. This limit is
+     * ignored for JSON entries that specify the "stream" attribute. The
+     * default is 10 seconds.
+     *
+     * @param limit The maximum duration (in seconds) of an in-memory sample
+     */
+    void setStreamLimit(double limit) { _streamLimit = limit; }
+    
+    /**
+     * Returns the sample rate for in-memory samples
+     *
+     * If this value is nonzero, any sample decoded into memory is converted
+     * to this rate when loaded. This should be the rate of the output device,
+     * so that these samples need no conversion during playback. Streamed
+     * samples are never converted. The default is 0 (no conversion).
+     *
+     * @return the sample rate for in-memory samples
+     */
+    Uint32 getSampleRate() const { return _sampleRate; }
+    
+    /**
+     * Sets the sample rate for in-memory samples
+     *
+     * If this value is nonzero, any sample decoded into memory is converted
+     * to this rate when loaded. This should be the rate of the output device,
+     * so that these samples need no conversion during playback. Streamed
+     * samples are never converted. The default is 0 (no conversion).
+     *
+     * Changing this value clears the cache of decoded samples. It does not
+     * affect samples that are already loaded.
+     *
+     * @param rate  The sample rate for in-memory samples
+     */
+    void setSampleRate(Uint32 rate);
+    
 };
     
 }
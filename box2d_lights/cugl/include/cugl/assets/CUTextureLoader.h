@@ -47,6 +47,21 @@
 #define __CU_TEXTURE_LOADER_H__
 #include <cugl/assets/CULoader.h>
 #include <cugl/render/CUTexture.h>
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include <vector>
+
+/** The default size of a runtime atlas page */
+#define ATLAS_PAGE_SIZE     2048
+/** The default maximum dimension of a texture packed into an atlas page */
+#define ATLAS_PACK_LIMIT    256
+/** The default border (in pixels) around each packed texture */
+#define ATLAS_PACK_BORDER   1
+/** The default time budget (in milliseconds) for texture uploads each frame */
+#define TEXTURE_UPLOAD_BUDGET   4
+/** The maximum number of bytes kept in the staging arena */
+#define TEXTURE_ARENA_LIMIT     (32*1024*1024)
 
 namespace cugl {
 
@@ -66,6 +81,25 @@ namespace cugl {
  * remainder of asset loading using {@link Application#schedule}.  This is a
  * good template for asset loaders in general.
  *
+ * This loader can optionally pack small textures into shared atlas pages as
+ * they are loaded (see {@link setAtlasPacking}). Packing happens on the
+ * loader thread, and each page is uploaded to OpenGL as a single texture.
+ * The loader then hands out subtextures of the page, so the packing is
+ * transparent to the rest of the application. Since {@link SpriteBatch}
+ * only switches textures when the underlying buffer changes, sprites that
+ * share a page can be drawn in the same batch.
+ *
+ * In addition to the image formats of SDL_image, this loader accepts KTX and
+ * KTX2 files with ETC2 or ASTC data.  These are uploaded directly to the GPU
+ * (with their mipmaps) when the driver supports the format. Otherwise, ETC
+ * data is decompressed to RGBA in software.
+ *
+ * Asynchronous loads decode images in parallel on a dedicated pool of decode
+ * threads (see {@link setDecodeThreads}). The decoded pixels are placed in
+ * a pooled staging arena, and the main thread uploads the staged textures
+ * under a per-frame time budget (see {@link setUploadBudget}).  That way a
+ * burst of completed decodes does not stall a single animation frame.
+ *
  * As with all of our loaders, this loader is designed to be attached to an
  * asset manager. Use the method {@link getHook()} to get the appropriate
  * pointer for attaching the loader.
@@ -86,7 +120,285 @@ protected:
     GLuint _wrapt;
     /** The default support for mipmaps */
     bool _mipmaps;
+
+#pragma mark Atlas Packing
+    /**
+     * An integer rectangle in an atlas page
+     *
+     * The origin is the start of the page data (the first row).
+     */
+    struct AtlasRect {
+        /** The x-coordinate of the rectangle */
+        int x;
+        /** The y-coordinate of the rectangle */
+        int y;
+        /** The width of the rectangle */
+        int width;
+        /** The height of the rectangle */
+        int height;
+    };
+
+    /**
+     * A single page of the runtime atlas
+     *
+     * The page keeps a CPU copy of its pixels so that textures packed after
+     * the initial upload can be copied to the GPU. The loader drops the page
+     * (and so this copy) once the load batch is finished.  The free space is managed
+     * with the MaxRects algorithm, which tracks the maximal empty rectangles
+     * of the page (which may overlap).
+     *
+     * All access to a page must be guarded by the loader page mutex.
+     */
+    class AtlasPage {
+    public:
+        /** The CPU copy of the page pixels */
+        SDL_Surface* surface;
+        /** The OpenGL texture (nullptr until the first upload) */
+        std::shared_ptr<Texture> texture;
+        /** The min filter of this page */
+        GLuint minfilter;
+        /** The mag filter of this page */
+        GLuint magfilter;
+        /** The border (in pixels) around each packed texture */
+        int border;
+        /** The maximal free rectangles of this page */
+        std::vector<AtlasRect> empty;
+        /** The location of each texture packed into this page */
+        std::unordered_map<std::string, AtlasRect> placed;
+        /** The textures packed after the page was uploaded */
+        std::unordered_set<std::string> pending;
+
+        /** Creates an empty page */
+        AtlasPage() : surface(nullptr), minfilter(GL_LINEAR), magfilter(GL_LINEAR), border(0) {}
+
+        /** Deletes this page, releasing the pixel data */
+        ~AtlasPage() {
+            if (surface != nullptr) { SDL_FreeSurface(surface); }
+        }
+    };
+
+    /** Whether to pack small textures into atlas pages */
+    bool _packing;
+    /** The size (width and height) of an atlas page */
+    int _pageSize;
+    /** The maximum dimension of a texture to pack */
+    int _packLimit;
+    /** The active atlas pages */
+    std::vector<std::shared_ptr<AtlasPage>> _pages;
+    /** Mutex guarding the atlas pages (packing happens on the loader thread) */
+    mutable std::mutex _pagemutex;
+    /** Whether the page release callback is currently scheduled */
+    bool _releasing;
+    /** The identifier of the scheduled page release callback */
+    Uint32 _releaseid;
+
+    /**
+     * Returns true if a texture with the given settings may be packed
+     *
+     * Packed textures share the settings of their page.  So textures with
+     * mipmaps or a wrap other than GL_CLAMP_TO_EDGE are never packed.
+     *
+     * @param wrapS     The s-coordinate wrap rule
+     * @param wrapT     The t-coordinate wrap rule
+     * @param mipmaps   Whether the texture has mipmaps
+     *
+     * @return true if a texture with the given settings may be packed
+     */
+    bool isPackable(GLuint wrapS, GLuint wrapT, bool mipmaps) const {
+        return _packing && !mipmaps && wrapS == GL_CLAMP_TO_EDGE && wrapT == GL_CLAMP_TO_EDGE;
+    }
+
+    /**
+     * Returns true if there is room for a rectangle of the given size
+     *
+     * This method uses the best short side fit heuristic of MaxRects.  It
+     * chooses the free rectangle that leaves the smallest leftover along
+     * its shorter side. If there is room, the position is stored in result.
+     *
+     * @param empty     The maximal free rectangles of a page
+     * @param width     The rectangle width
+     * @param height    The rectangle height
+     * @param result    The rectangle to store the position
+     *
+     * @return true if there is room for a rectangle of the given size
+     */
+    static bool findSpace(const std::vector<AtlasRect>& empty, int width, int height, AtlasRect& result);
+
+    /**
+     * Removes the used rectangle from the free rectangles of a page
+     *
+     * Every free rectangle overlapping the used rectangle is split into
+     * (up to four) maximal rectangles around it.  Any free rectangle
+     * contained in another is then pruned.
+     *
+     * @param empty     The maximal free rectangles of a page
+     * @param used      The newly used rectangle
+     */
+    static void claimSpace(std::vector<AtlasRect>& empty, const AtlasRect& used);
+
+    /**
+     * Returns the atlas page after packing the surface into it
+     *
+     * This method is safe to call outside of the main thread. It finds room
+     * for the surface in an existing page with the same filters, creating a
+     * new page if necessary, and copies the pixels into the page.  If the
+     * surface is too large to pack, this method returns nullptr.
+     *
+     * @param key       The key to access the asset after loading
+     * @param surface   The surface to pack
+     * @param minflt    The texture min filter
+     * @param magflt    The texture mag filter
+     *
+     * @return the atlas page after packing the surface into it
+     */
+    std::shared_ptr<AtlasPage> pack(const std::string& key, SDL_Surface* surface,
+                                    GLuint minflt, GLuint magflt);
+
+    /**
+     * Assigns the given key a subtexture of the atlas page
+     *
+     * This method finishes the asset loading started in {@link pack}.  This
+     * step is not safe to be done in a separate thread.  Instead, it takes
+     * place in the main CUGL thread via {@link Application#schedule}.
+     *
+     * If the page has not been uploaded yet, this method uploads the entire
+     * page, including any textures packed since.  Otherwise it only copies
+     * the region for this texture (if it was packed after the upload).
+     *
+     * This method supports an optional callback function which reports whether
+     * the asset was successfully materialized.
+     *
+     * @param key       The key to access the asset after loading
+     * @param page      The page containing the texture
+     * @param surface   The original SDL_Surface (to be released)
+     * @param callback  An optional callback for asynchronous loading
+     */
+    void materialize(const std::string& key, const std::shared_ptr<AtlasPage>& page,
+                     SDL_Surface* surface, LoaderCallback callback);
+    
+    /**
+     * Schedules the release of the CPU pixels of the atlas pages
+     *
+     * Each page keeps a CPU copy of its pixels (4 bytes per pixel of the
+     * page size) so that textures packed after the upload can be copied to
+     * the GPU. Once a load batch is finished, this copy is no longer needed.
+     * This method schedules a callback in the main thread that waits until
+     * no texture loads are pending, and then releases the active pages.
+     * Textures loaded later are packed into new pages.
+     *
+     * The page textures are not affected. They remain in use until all of
+     * their subtextures are released.
+     */
+    void scheduleRelease();
     
+    /**
+     * Releases the CPU pixels of the atlas pages if no loads are pending
+     *
+     * This method is executed in the main thread via {@link Application#schedule}.
+     * It returns true if texture loads are still pending, so that the
+     * callback repeats on the next animation frame.
+     *
+     * @return true if texture loads are still pending
+     */
+    bool releasePages();
+
+#pragma mark Staged Uploads
+    /**
+     * A decoded texture waiting for upload in the main thread
+     */
+    struct StagedTexture {
+        /** The key to access the asset after loading */
+        std::string key;
+        /** The asset directory entry (nullptr if loaded by key) */
+        std::shared_ptr<JsonValue> json;
+        /** The decoded pixels (nullptr if decoding failed) */
+        SDL_Surface* surface;
+        /** The atlas page, if the texture was packed */
+        std::shared_ptr<AtlasPage> page;
+        /** The compressed image, if supported by the GPU */
+        std::shared_ptr<CompressedImage> image;
+        /** An optional callback for asynchronous loading */
+        LoaderCallback callback;
+    };
+
+    /** The threads for decoding images */
+    std::shared_ptr<ThreadPool> _decoders;
+    /** The number of decode threads (0 to pick from the CPU count) */
+    int _decodeThreads;
+    /** The time budget (in milliseconds) for uploads each frame */
+    Uint32 _budget;
+    /** The decoded textures waiting for upload */
+    std::deque<StagedTexture> _staged;
+    /** Whether the upload callback is currently scheduled */
+    bool _uploading;
+    /** The identifier of the scheduled upload callback */
+    Uint32 _uploadid;
+    /** The number of textures handed to the decoders but not yet uploaded */
+    std::atomic<size_t> _offthread;
+    /** The pixel buffers available for reuse */
+    std::vector<std::vector<Uint8>*> _arena;
+    /** The number of bytes held in the staging arena */
+    size_t _arenaSize;
+    /** Mutex guarding the staging queue and arena */
+    std::mutex _stagemutex;
+
+    /**
+     * Returns the thread pool for decoding images
+     *
+     * The pool is allocated the first time it is needed.  If it cannot be
+     * allocated, this method returns the thread pool of the loader.
+     *
+     * @return the thread pool for decoding images
+     */
+    std::shared_ptr<ThreadPool> getDecoders();
+
+    /**
+     * Returns a surface whose pixels belong to the staging arena
+     *
+     * The surface reuses the smallest free buffer of the arena that is large
+     * enough, allocating a new buffer if necessary.  The surface must be
+     * released with {@link releaseSurface}.  This method is safe to call
+     * outside of the main thread.
+     *
+     * @param width     The surface width
+     * @param height    The surface height
+     * @param format    The SDL pixel format (must be 32 bits)
+     *
+     * @return a surface whose pixels belong to the staging arena
+     */
+    SDL_Surface* acquireSurface(int width, int height, Uint32 format);
+
+    /**
+     * Releases a surface, returning its pixels to the staging arena
+     *
+     * If the surface did not come from {@link acquireSurface}, or the arena
+     * is already full, the pixels are simply deleted.
+     *
+     * @param surface   The surface to release
+     */
+    void releaseSurface(SDL_Surface* surface);
+
+    /**
+     * Adds a decoded texture to the upload queue
+     *
+     * This method is safe to call outside of the main thread. It schedules
+     * the upload callback if it is not already active.
+     *
+     * @param item      The decoded texture
+     */
+    void stage(const StagedTexture& item);
+
+    /**
+     * Uploads staged textures until the time budget is exhausted
+     *
+     * This method is executed in the main thread via {@link Application#schedule}.
+     * It returns true if there are still staged textures, so that the
+     * callback repeats on the next animation frame.
+     *
+     * @return true if there are still staged textures
+     */
+    bool upload();
+
 #pragma mark Asset Loading
     /**
      * Extracts any subtextures specified in an atlas
@@ -114,6 +426,45 @@ protected:
      * @return the SDL_Surface with the texture information
      */
     SDL_Surface* preload(const std::string& source);
+
+    /**
+     * Loads the portion of this asset that is safe to load outside the main thread.
+     *
+     * This version of preload also supports KTX and KTX2 files (identified by
+     * their suffix).  If the GPU supports the compression format of the file,
+     * this method stores the compressed image in image and returns nullptr.
+     * Otherwise, it decompresses the image (if possible) and returns the
+     * result as an SDL_Surface.  All other files are loaded as with
+     * {@link preload(const std::string&)}.
+     *
+     * @param source    The pathname to the asset
+     * @param image     Reference to store a GPU compressed image
+     *
+     * @return the SDL_Surface with the texture information
+     */
+    SDL_Surface* preload(const std::string& source, std::shared_ptr<CompressedImage>& image);
+
+    /**
+     * Creates an OpenGL texture from the compressed image.
+     *
+     * This method finishes the asset loading started in {@link preload}.  This
+     * step is not safe to be done in a separate thread.  Instead, it takes
+     * place in the main CUGL thread via {@link Application#schedule}.
+     *
+     * The texture settings come from the directory entry, if it is not null,
+     * and the loader defaults otherwise. Compressed textures cannot build
+     * mipmaps, so mipmaps are only used if the image contains them.
+     *
+     * This method supports an optional callback function which reports whether
+     * the asset was successfully materialized.
+     *
+     * @param key       The key to access the asset after loading
+     * @param json      The asset directory entry (may be nullptr)
+     * @param image     The compressed image
+     * @param callback  An optional callback for asynchronous loading
+     */
+    void materialize(const std::string& key, const std::shared_ptr<JsonValue>& json,
+                     const std::shared_ptr<CompressedImage>& image, LoaderCallback callback);
     
     /**
      * Creates an OpenGL texture from the SDL_Surface, and assigns it the given key.
@@ -134,6 +485,30 @@ protected:
      */
     void materialize(const std::string& key, SDL_Surface* surface, LoaderCallback callback);
     
+    /**
+     * Returns an OpenGL texture for the SDL_Surface with the given settings.
+     *
+     * This is the shared step of the surface materializers. The texture is
+     * assigned to the given key, but the surface is not released. It is also
+     * used when a texture could not be packed, so that the texture keeps the
+     * per-asset settings that were used to decide whether to pack it.
+     *
+     * This method is not safe to call outside of the main thread.
+     *
+     * @param key       The key to access the asset after loading
+     * @param surface   The SDL_Surface to convert
+     * @param minflt    The texture min filter
+     * @param magflt    The texture mag filter
+     * @param wrapS     The s-coordinate wrap rule
+     * @param wrapT     The t-coordinate wrap rule
+     * @param mipmaps   Whether to build mipmaps
+     *
+     * @return an OpenGL texture for the SDL_Surface (nullptr on failure)
+     */
+    std::shared_ptr<Texture> allocTexture(const std::string& key, SDL_Surface* surface,
+                                          GLuint minflt, GLuint magflt,
+                                          GLuint wrapS, GLuint wrapT, bool mipmaps);
+    
     /**
      * Creates an OpenGL texture from the SDL_Surface accoring to the directory entry.
      *
@@ -208,6 +583,7 @@ protected:
      *      "magfilter":    The name of the min filter ("nearest" or "linear")
      *      "wrapS":        The s-coord wrap rule ("clamp", "repeat", or "mirrored")
      *      "wrapT":        The t-coord wrap rule ("clamp", "repeat", or "mirrored")
+     *      "packed":       Whether to allow atlas packing (bool, default true)
      *
      * @param json      The directory entry for the asset
      * @param callback  An optional callback for asynchronous loading
@@ -246,6 +622,43 @@ public:
      * the heap, use one of the static constructors instead.
      */
     TextureLoader();
+
+    /**
+     * Deletes this loader, disposing all resources
+     */
+    ~TextureLoader() { dispose(); }
+
+    /**
+     * Initializes a new texture loader.
+     *
+     * This method bootstraps the loader with any initial resources that it
+     * needs to load assets. In particular, the OpenGL context must be active,
+     * as this method queries the compressed formats supported by the GPU.
+     *
+     * This loader will have no associated threads. That means any asynchronous
+     * loading will fail until a thread is provided via {@link setThreadPool}.
+     *
+     * @return true if the asset loader was initialized successfully
+     */
+    bool init() override {
+        return init(nullptr);
+    }
+
+    /**
+     * Initializes a new texture loader.
+     *
+     * This method bootstraps the loader with any initial resources that it
+     * needs to load assets. In particular, the OpenGL context must be active,
+     * as this method queries the compressed formats supported by the GPU.
+     *
+     * @param threads   The thread pool for asynchronous loading
+     *
+     * @return true if the asset loader was initialized successfully
+     */
+    bool init(const std::shared_ptr<ThreadPool>& threads) override {
+        CompressedImage::queryFormats();
+        return Loader<Texture>::init(threads);
+    }
     
     /**
      * Disposes all resources and assets of this loader
@@ -258,9 +671,22 @@ public:
      * Once the loader is disposed, any attempts to load a new asset will
      * fail.  You must reinitialize the loader to begin loading assets again.
      */
-    void dispose() override {
+    void dispose() override;
+
+    /**
+     * Unloads all assets present in this loader.
+     *
+     * An asset may still be available if it is referenced by a smart pointer.
+     * See the description of the specific implementation for how assets
+     * are released.
+     *
+     * This method also discards all runtime atlas pages.  Any page is only
+     * released once all of its subtextures are released.
+     */
+    void unloadAll() override {
         _assets.clear();
-        _loader = nullptr;
+        std::lock_guard<std::mutex> lock(_pagemutex);
+        _pages.clear();
     }
     
     /**
@@ -405,6 +831,145 @@ public:
      */
     void setMipMaps(bool flag) { _mipmaps = flag; }
 
+    /**
+     * Returns true if this loader packs small textures into atlas pages.
+     *
+     * The default is false.  If this value is true, any texture no larger
+     * than {@link getAtlasLimit} in either dimension is packed into a shared
+     * atlas page, and the asset is a subtexture of that page.  Textures with
+     * mipmaps or a wrap other than GL_CLAMP_TO_EDGE are never packed. A JSON
+     * directory entry can also opt out with the value "packed": false.
+     *
+     * Pages are never repacked, so unloading a single packed texture does
+     * not free its space in the page.  Use {@link unloadAll} to discard
+     * all pages.
+     *
+     * @return true if this loader packs small textures into atlas pages.
+     */
+    bool isAtlasPacking() const { return _packing; }
+
+    /**
+     * Sets whether this loader packs small textures into atlas pages.
+     *
+     * The default is false.  If this value is true, any texture no larger
+     * than {@link getAtlasLimit} in either dimension is packed into a shared
+     * atlas page, and the asset is a subtexture of that page.  Textures with
+     * mipmaps or a wrap other than GL_CLAMP_TO_EDGE are never packed. A JSON
+     * directory entry can also opt out with the value "packed": false.
+     *
+     * Changing this value only affects textures loaded in the future.
+     *
+     * @param flag  Whether this loader packs small textures into atlas pages.
+     */
+    void setAtlasPacking(bool flag) { _packing = flag; }
+
+    /**
+     * Returns the size (width and height) of an atlas page.
+     *
+     * The default is 2048.  This value should not exceed the maximum texture
+     * size of the device.
+     *
+     * @return the size (width and height) of an atlas page.
+     */
+    int getAtlasPageSize() const { return _pageSize; }
+
+    /**
+     * Sets the size (width and height) of an atlas page.
+     *
+     * The default is 2048.  This value should not exceed the maximum texture
+     * size of the device. Changing this value only affects new pages.
+     *
+     * @param size  The size (width and height) of an atlas page.
+     */
+    void setAtlasPageSize(int size) { _pageSize = size; }
+
+    /**
+     * Returns the maximum dimension of a texture packed into an atlas page.
+     *
+     * The default is 256.  Any texture wider or taller than this value is
+     * loaded as a separate texture.
+     *
+     * @return the maximum dimension of a texture packed into an atlas page.
+     */
+    int getAtlasLimit() const { return _packLimit; }
+
+    /**
+     * Sets the maximum dimension of a texture packed into an atlas page.
+     *
+     * The default is 256.  Any texture wider or taller than this value is
+     * loaded as a separate texture.
+     *
+     * @param size  The maximum dimension of a texture packed into an atlas page.
+     */
+    void setAtlasLimit(int size) { _packLimit = size; }
+
+    /**
+     * Returns the number of runtime atlas pages.
+     *
+     * @return the number of runtime atlas pages.
+     */
+    size_t getAtlasPageCount() const {
+        std::lock_guard<std::mutex> lock(_pagemutex);
+        return _pages.size();
+    }
+
+    /**
+     * Returns the number of threads for decoding images.
+     *
+     * A value of 0 (the default) means the loader picks the number of threads
+     * from the CPU count (leaving a core for the main thread). The threads are
+     * only used for asynchronous loading.
+     *
+     * @return the number of threads for decoding images.
+     */
+    int getDecodeThreads() const { return _decodeThreads; }
+
+    /**
+     * Sets the number of threads for decoding images.
+     *
+     * A value of 0 (the default) means the loader picks the number of threads
+     * from the CPU count (leaving a core for the main thread). The threads are
+     * only used for asynchronous loading.
+     *
+     * The decode threads are created on the first asynchronous load.  Hence
+     * this value has no effect once asynchronous loading has begun.
+     *
+     * @param threads   The number of threads for decoding images.
+     */
+    void setDecodeThreads(int threads) { _decodeThreads = threads; }
+
+    /**
+     * Returns the time budget (in milliseconds) for texture uploads each frame.
+     *
+     * Asynchronously loaded textures are uploaded in the main thread.  Once
+     * the budget is exceeded, the remaining textures wait for the next frame.
+     * At least one texture is uploaded each frame. The default is 4 ms.
+     *
+     * @return the time budget (in milliseconds) for texture uploads each frame.
+     */
+    Uint32 getUploadBudget() const { return _budget; }
+
+    /**
+     * Sets the time budget (in milliseconds) for texture uploads each frame.
+     *
+     * Asynchronously loaded textures are uploaded in the main thread.  Once
+     * the budget is exceeded, the remaining textures wait for the next frame.
+     * At least one texture is uploaded each frame. The default is 4 ms.
+     *
+     * @param millis    The time budget (in milliseconds) for texture uploads each frame.
+     */
+    void setUploadBudget(Uint32 millis) { _budget = millis; }
+
+    /**
+     * Returns the number of textures being decoded or waiting for upload.
+     *
+     * These textures have left the loader thread, and are finished by the
+     * decoding threads and the main thread.
+     *
+     * @return the number of textures being decoded or waiting for upload.
+     */
+    size_t offthreadCount() const override { return _offthread.load(); }
+
 };
 
 }
@@ -383,6 +383,17 @@ public:
      * responds to the user's actions.
      */
     std::shared_ptr<AudioQueue> getMusicQueue() const;
+    
+    /**
+     * Returns the sample rate of the output device for this audio engine
+     *
+     * Sounds at any other rate are resampled during playback. Loaders can
+     * use this value to convert in-memory samples once, at load time (see
+     * {@link SoundLoader#setSampleRate}).
+     *
+     * @return the sample rate of the output device for this audio engine
+     */
+    Uint32 getSampleRate() const;
 
     /**
      * Allocates a new queue for managing audio.
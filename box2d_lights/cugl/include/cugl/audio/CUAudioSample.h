@@ -39,6 +39,7 @@
 #define __CU_AUDIO_SAMPLE_H__
 #include <SDL/SDL.h>
 #include <cugl/assets/CUJsonValue.h>
+#include <cugl/util/CUAligned.h>
 #include "CUSound.h"
 #include <string>
 #include <atomic>
@@ -72,6 +73,10 @@ namespace  cugl {
  * interleaved.  We support up to 32 channels, though it is unlikely for that
  * many channels to be encoded in a sound file.  SDL itself only supports 8
  * channels for (7.1 surround) playback.
+ *
+ * The PCM data of an in-memory sample is an aligned buffer that may be shared
+ * between several samples (see {@link #init(const std::shared_ptr<AudioSample>&)}).
+ * Decoded data should be treated as immutable once it is shared.
  */
 class AudioSample : public Sound {
 public:
@@ -110,6 +115,8 @@ protected:
 
     /** The in-memory sound buffer for this sound source (OPTIONAL) */
     float* _buffer;
+    /** The (possibly shared) storage for the in-memory sound buffer */
+    std::shared_ptr<cugl::Aligned<float>> _pcmdata;
     
 public:
 #pragma mark Constructors
@@ -171,6 +178,19 @@ public:
      */
     bool init(Uint8 channels, Uint32 rate, Uint32 frames);
     
+    /**
+     * Initializes an audio sample that shares the data of another sample.
+     *
+     * If the source is in-memory, this sample shares its PCM buffer rather
+     * than decoding the file again. Otherwise, this sample streams from the
+     * same file. Only the volume and other sound attributes are distinct.
+     *
+     * @param source    The audio sample to share
+     *
+     * @return true if the audio sample was initialized successfully
+     */
+    bool init(const std::shared_ptr<AudioSample>& source);
+    
     /**
      * Deletes the sample resources and resets all attributes.
      *
@@ -257,6 +277,22 @@ public:
         return (result->init(channels,rate,frames) ? result : nullptr);
     }
     
+    /**
+     * Returns a newly allocated audio sample that shares the data of another.
+     *
+     * If the source is in-memory, this sample shares its PCM buffer rather
+     * than decoding the file again. Otherwise, this sample streams from the
+     * same file. Only the volume and other sound attributes are distinct.
+     *
+     * @param source    The audio sample to share
+     *
+     * @return a newly allocated audio sample that shares the data of another.
+     */
+    static std::shared_ptr<AudioSample> alloc(const std::shared_ptr<AudioSample>& source) {
+        std::shared_ptr<AudioSample> result = std::make_shared<AudioSample>();
+        return (result->init(source) ? result : nullptr);
+    }
+    
     /**
      * Returns a newly allocated audio sample with the given JSON specificaton.
      *
@@ -327,6 +363,21 @@ public:
      * @return the underlying PCM data buffer.
      */
     float* getBuffer() { return _buffer; }
+    
+    /**
+     * Converts the in-memory PCM data to the given sample rate.
+     *
+     * This is intended to be called once at load time, so that playback
+     * at the device rate does not need an {@link audio::AudioResampler}.
+     * It has no effect on streamed samples, or if the rate is unchanged.
+     * The sample must not be playing, and its buffer must not be shared,
+     * when this method is called.
+     *
+     * @param rate  The new sample rate
+     *
+     * @return true if the sample was converted
+     */
+    bool resample(Uint32 rate);
         
     /**
      * Returns a new decoder for this audio sample
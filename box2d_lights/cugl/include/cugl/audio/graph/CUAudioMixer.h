@@ -36,7 +36,7 @@
 #ifndef __CU_AUDIO_MIXER_H__
 #define __CU_AUDIO_MIXER_H__
 #include "CUAudioNode.h"
-#include <mutex>
+#include <vector>
 
 namespace cugl {
 
@@ -62,6 +62,15 @@ namespace cugl {
  * effected, but values outside of this range will asymptotically bend to
  * the range [-1,1].
  *
+ * Only occupied slots are visited when mixing, so a wide mixer with only a
+ * few active inputs costs no more than a narrow one. Each input is scaled
+ * and accumulated into the output in a single pass.
+ *
+ * Attaching and detaching inputs never blocks the audio thread. Changes are
+ * staged by the main thread and picked up at the start of the next buffer.
+ * A detached input is not released until the audio thread has finished any
+ * buffer that might still be reading from it.
+ *
  * The audio graph should only be accessed in the main thread.  In addition,
  * no methods marked as AUDIO THREAD ONLY should ever be accessed by the user.
  *
@@ -69,8 +78,12 @@ namespace cugl {
  */
 class AudioMixer : public AudioNode {
 private:
-    /** The input nodes to be mixed */
+    /** The input nodes to be mixed (MAIN THREAD ONLY) */
     std::shared_ptr<AudioNode>* _inputs;
+    /** The input nodes as seen by the audio thread (not owned) */
+    std::atomic<AudioNode*>* _staged;
+    /** A bitmask of the occupied slots, so empty slots are never visited */
+    std::atomic<Uint64>* _occupied;
     /** The number of input nodes supported by this mixer */
     Uint8 _width;
 
@@ -82,8 +95,10 @@ private:
     /** The knee value for clamping */
     std::atomic<float>  _knee;
 
-    /** This class needs a proper lock guard; too many race conditions */
-    std::mutex _mutex;
+    /** The number of buffers completed by the audio thread */
+    std::atomic<Uint64> _cycle;
+    /** Detached inputs, with the cycle at which they were detached */
+    std::vector<std::pair<Uint64,std::shared_ptr<AudioNode>>> _retired;
     /** The current read position */
     std::atomic<Uint64> _offset;
     /** The last marked position (starts at 0) */
@@ -290,6 +305,27 @@ public:
      */
     bool setWidth(Uint8 width);
 
+private:
+    /**
+     * Retires an input node detached from this mixer.
+     *
+     * The audio thread never owns its inputs, so it may still be reading
+     * from a detached node in the current buffer. This method holds on to
+     * the node until the audio thread has finished that buffer, so that
+     * the node is never deallocated in the audio thread.
+     *
+     * @param node  The detached input node
+     */
+    void retire(const std::shared_ptr<AudioNode>& node);
+    
+    /**
+     * Releases any retired input nodes no longer used by the audio thread.
+     *
+     * This method is called by the main thread whenever the graph changes.
+     */
+    void collect();
+
+public:
 #pragma mark -
 #pragma mark Anticlipping Methods
     /**
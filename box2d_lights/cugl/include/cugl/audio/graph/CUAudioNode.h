@@ -199,6 +199,9 @@ protected:
      */
     void notify(const std::shared_ptr<AudioNode>& node, Action action);
     
+    /** The read size for nodes allocated without an audio device manager */
+    static Uint32 _readsize;
+    
 #pragma mark -
 #pragma mark Static Attributes
 public:
@@ -208,6 +211,32 @@ public:
     /** The default sampling frequency for an audio node */
     const static Uint32 DEFAULT_SAMPLING;
     
+    /**
+     * Returns the read size used to allocate the buffers of new nodes.
+     *
+     * This is the number of frames that a node expects to be asked for in a
+     * single {@link read}. If there is an active {@link AudioDevices} manager,
+     * this is the read size of its output devices. Otherwise, it is the value
+     * set by {@link setDefaultReadSize}. This allows an audio graph to be built
+     * and rendered without any device (such as with an {@link AudioRenderer}).
+     *
+     * Nodes only consult this value when they are initialized.
+     *
+     * @return the read size used to allocate the buffers of new nodes.
+     */
+    static Uint32 getDefaultReadSize();
+    
+    /**
+     * Sets the read size for nodes allocated without an audio device manager.
+     *
+     * This value is ignored while there is an active {@link AudioDevices}
+     * manager, as nodes must then match the read size of the devices. It only
+     * affects nodes initialized after it is set. The default is 512 frames.
+     *
+     * @param frames    The read size for nodes allocated without a device
+     */
+    static void setDefaultReadSize(Uint32 frames) { _readsize = frames; }
+    
 #pragma mark -
 #pragma mark Constructors
     /**
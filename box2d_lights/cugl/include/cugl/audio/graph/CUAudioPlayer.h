@@ -44,6 +44,10 @@
 #include <functional>
 #include <string>
 #include <atomic>
+#include <vector>
+
+/** The default read-ahead (in seconds) for streamed players */
+#define DEFAULT_STREAM_READAHEAD 0.5
 
 // TODO: Move fade-in/fade-out support to new class
 namespace  cugl {
@@ -56,6 +60,9 @@ namespace  cugl {
      * scene graph collections in {@link scene2}.
      */
     namespace audio {
+
+/** The stream decoding state of a player, shared with the decoder thread (opaque) */
+class AudioStream;
  
 #pragma mark -
 #pragma mark Base Player
@@ -81,6 +88,14 @@ namespace  cugl {
  * to this rule is by another (custom) audio graph node in its audio thread
  * methods.
  *
+ * Streamed samples are never decoded in the audio thread. Instead, a shared
+ * decoder thread decodes pages ahead of the read position into a lock-free
+ * ring (with one producer and one consumer) for each player. The audio
+ * thread only copies from this ring. The first page of the stream is decoded
+ * when the player is initialized, so resetting the player to the start (as
+ * is done when looping) is seamless. Any other seek may produce a short
+ * silence while the decoder thread catches up.
+ *
  * This class does not support any actions for the {@link AudioNode#setCallback}.
  * Fade in/out and scheduling have been refactored into other nodes to provide
  * proper audio patch support.
@@ -89,9 +104,6 @@ class AudioPlayer : public AudioNode {
 protected:
     /** The original source for this instance */
     std::shared_ptr<AudioSample> _source;
-    /** The decoder for the current asset */
-    std::shared_ptr<AudioDecoder> _decoder;
-
     /** The current read position */
     std::atomic<Uint64> _offset;
     /** The last marked position (starts at 0) */
@@ -100,18 +112,14 @@ protected:
     /** A reference to the underlying data buffer (IN-MEMORY ACCESS) */
     float* _buffer;
     
-    // Streaming support
-    /** A buffer for storing each chunk as we need it */
-    float* _chunker;
-    /** The size of a single chunk in frames */
-    Uint32 _chksize;
-    /** The pointer to the last available frame in the chunk */
-    Uint32 _chklimt;
-    /** The number of the last read frame in the chunk */
-    Uint32 _chklast;
+    /** The stream decoding state (or null for in-memory samples) */
+    AudioStream* _stream;
         
     /** Whether or not we need to reposition (STREAMING ACCESS) */
     std::atomic<bool> _dirty;
+    
+    /** The read-ahead in seconds for newly initialized players */
+    static double _readahead;
 
 public:
 #pragma mark Constructors
@@ -169,6 +177,31 @@ public:
      * @return the source for this instance
      */
     std::shared_ptr<AudioSample> getSource() { return _source; }
+    
+    /**
+     * Returns the read-ahead for streamed players in seconds.
+     *
+     * This is the amount of audio that the decoder thread decodes ahead of
+     * the read position. It is rounded up to a whole number of decoder
+     * pages (and at least two pages).
+     *
+     * @return the read-ahead for streamed players in seconds.
+     */
+    static double getReadAhead() { return _readahead; }
+    
+    /**
+     * Sets the read-ahead for streamed players in seconds.
+     *
+     * This is the amount of audio that the decoder thread decodes ahead of
+     * the read position. It is rounded up to a whole number of decoder
+     * pages (and at least two pages). Larger values protect against slow
+     * decoding at the cost of memory.
+     *
+     * This value only affects players initialized after it is set.
+     *
+     * @param time  The read-ahead for streamed players in seconds.
+     */
+    static void setReadAhead(double time) { _readahead = time; }
 
 #pragma mark Overriden Methods
     /**
@@ -311,20 +344,23 @@ public:
     virtual double setRemaining(double time) override;
     
 private:
-#pragma mark Stream Decoding
     /**
-     * Decodes the audio stream up to the given position.
+     * Copies the streamed audio at the given position into the buffer
      *
      * AUDIO THREAD ONLY: Users should never access this method directly.
-     * The only exception is when the user needs to create a custom subclass
-     * of this AudioNode.
      *
-     * If the frame is longer than the stream length, it goes to the end of
-     * the stream.
+     * This method never decodes. It copies from the first page and from the
+     * ring filled by the decoder thread. If the decoder thread has fallen
+     * behind, it reads fewer frames than requested.
+     *
+     * @param buffer    The read buffer to store the results
+     * @param frames    The maximum number of frames to read
+     * @param offset    The absolute frame position to read from
+     * @param eof       Set to true if the end of the stream was reached
      *
-     * @param frame    The absolute frame to skip to
+     * @return the number of frames copied
      */
-    void scan(Uint64 frame);
+    Uint32 drain(float* buffer, Uint32 frames, Uint64 offset, bool& eof);
 };
 
     }
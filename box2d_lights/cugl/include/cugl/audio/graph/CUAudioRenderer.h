@@ -0,0 +1,400 @@
+//
+//  CUAudioRenderer.h
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides an offline terminal node for an audio graph. It is
+//  an alternative to AudioOutput that is not attached to any device. Instead,
+//  the graph is pulled on demand, as fast as possible, into memory. This makes
+//  it possible to render or profile an audio graph headless (such as on a
+//  build server), where there is no audio device.
+//
+//  The renderer also times every block that it pulls. These statistics can
+//  be compared against the real-time budget of a block to detect throughput
+//  regressions in the audio graph or its DSP filters.
+//
+//  CUGL MIT License:
+//
+//     This software is provided 'as-is', without any express or implied
+//     warranty.  In no event will the authors be held liable for any damages
+//     arising from the use of this software.
+//
+//     Permission is granted to anyone to use this software for any purpose,
+//     including commercial applications, and to alter it and redistribute it
+//     freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not
+//     be misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Walker White
+//  Version: 5/12/21
+//
+#ifndef __CU_AUDIO_RENDERER_H__
+#define __CU_AUDIO_RENDERER_H__
+#include <SDL/SDL.h>
+#include "CUAudioNode.h"
+
+namespace cugl {
+
+    /** Forward reference to an audio sample */
+    class AudioSample;
+
+    /**
+     * The audio graph classes.
+     *
+     * This internal namespace is for the audio graph clases.  It was chosen
+     * to distinguish this graph from other graph class collections, such as the
+     * scene graph collections in {@link scene2}.
+     */
+    namespace audio {
+/**
+ * This class provides an offline terminal node for an audio graph.
+ *
+ * Like {@link AudioOutput}, you attach the single terminal node of an audio
+ * graph to this node. However, this node has no device and no audio thread.
+ * Instead, the graph is pulled by {@link render}, on the calling thread, as
+ * fast as the graph allows. The result is either written to a buffer or
+ * returned as an in-memory {@link AudioSample}.
+ *
+ * The graph is pulled in blocks of {@link getBlockSize} frames, exactly as
+ * an output device would pull it. This node times each block. A block that
+ * takes longer to process than the audio it produces is an overrun, as it
+ * would have caused an audible glitch on a real device. These statistics
+ * can be used to benchmark a graph, or any node or filter in it.
+ *
+ * This node does not require an {@link AudioDevices} manager, and neither
+ * does any graph attached to it. Without a manager, nodes size their buffers
+ * with {@link AudioNode#getDefaultReadSize}. Initializing a renderer sets
+ * this value to its block size, so the renderer should be allocated before
+ * the graph. The exceptions are {@link AudioInput} and {@link AudioOutput},
+ * which are attached to devices, and {@link AudioSynchronizer}, which needs
+ * a running application.
+ *
+ * Rendering is faster than real time, so streamed sources (which decode in
+ * the background) may not keep up with this node. Use in-memory samples when
+ * rendering offline. In addition, callback functions are executed through
+ * {@link Application#schedule}, and so they require a running application.
+ *
+ * Since this node replaces the audio thread, the methods of the attached
+ * graph marked AUDIO THREAD ONLY are called by the thread that calls
+ * {@link render}. Only one thread should render at a time. The statistics
+ * are not thread safe, and should be read by the rendering thread.
+ *
+ * This class does not support any actions for the {@link AudioNode#setCallback}.
+ */
+class AudioRenderer : public AudioNode {
+private:
+    /** The terminal node of the audio graph. This pulls data from the sources */
+    std::shared_ptr<AudioNode> _input;
+    /** The number of frames pulled from the graph at a time */
+    Uint32 _blocksize;
+
+    /** The number of blocks rendered */
+    Uint64 _blocks;
+    /** The number of frames rendered */
+    Uint64 _frames;
+    /** The total time spent rendering, in nanoseconds */
+    Uint64 _elapsed;
+    /** The longest time spent rendering a single block, in nanoseconds */
+    Uint64 _maxtime;
+    /** The number of blocks that took longer than real time */
+    Uint64 _overruns;
+
+public:
+    /** The default number of frames pulled from the graph at a time */
+    const static Uint32 DEFAULT_BLOCK;
+
+#pragma mark Constructors
+    /**
+     * Creates a degenerate offline renderer.
+     *
+     * The node has not been initialized, so it cannot be used.
+     *
+     * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate a node on
+     * the heap, use one of the static constructors instead.
+     */
+    AudioRenderer();
+
+    /**
+     * Deletes this renderer, disposing of all resources.
+     */
+    ~AudioRenderer() { dispose(); }
+
+    /**
+     * Initializes the renderer with default stereo settings
+     *
+     * The number of channels is two, for stereo output.  The sample rate is
+     * the modern standard of 48000 HZ.  The block size is {@link DEFAULT_BLOCK}.
+     *
+     * These values determine the buffer the structure for all {@link read}
+     * operations.  Any attached graph must agree with these settings.
+     *
+     * @return true if initialization was successful
+     */
+    virtual bool init() override;
+
+    /**
+     * Initializes the renderer with the given number of channels and sample rate
+     *
+     * The block size is {@link DEFAULT_BLOCK}. These values determine the
+     * buffer the structure for all {@link read} operations.  Any attached
+     * graph must agree with these settings.
+     *
+     * @param channels  The number of audio channels
+     * @param rate      The sample rate (frequency) in HZ
+     *
+     * @return true if initialization was successful
+     */
+    virtual bool init(Uint8 channels, Uint32 rate) override;
+
+    /**
+     * Initializes the renderer with the given channels, sample rate, and block size
+     *
+     * The block size is the number of frames pulled from the graph at a time,
+     * and should match the read size of the output device being simulated.
+     * Any attached graph must agree with the channels and sample rate.
+     *
+     * If there is no active {@link AudioDevices} manager, this method also sets
+     * {@link AudioNode#setDefaultReadSize} to the block size. Hence any graph
+     * nodes allocated after this renderer will be sized to match it.
+     *
+     * @param channels  The number of audio channels
+     * @param rate      The sample rate (frequency) in HZ
+     * @param block     The number of frames pulled from the graph at a time
+     *
+     * @return true if initialization was successful
+     */
+    bool init(Uint8 channels, Uint32 rate, Uint32 block);
+
+    /**
+     * Disposes any resources allocated for this renderer
+     *
+     * The state of the node is reset to that of an uninitialized constructor.
+     * Unlike the destructor, this method allows the node to be reinitialized.
+     */
+    virtual void dispose() override;
+
+#pragma mark -
+#pragma mark Static Constructors
+    /**
+     * Returns a newly allocated renderer with the default stereo settings
+     *
+     * The number of channels is two, for stereo output.  The sample rate is
+     * the modern standard of 48000 HZ.  The block size is {@link DEFAULT_BLOCK}.
+     * Any attached graph must agree with these settings.
+     *
+     * @return a newly allocated renderer with the default stereo settings
+     */
+    static std::shared_ptr<AudioRenderer> alloc() {
+        std::shared_ptr<AudioRenderer> result = std::make_shared<AudioRenderer>();
+        return (result->init() ? result : nullptr);
+    }
+
+    /**
+     * Returns a newly allocated renderer with the given number of channels and sample rate
+     *
+     * The block size is {@link DEFAULT_BLOCK}. Any attached graph must agree
+     * with these settings.
+     *
+     * @param channels  The number of audio channels
+     * @param rate      The sample rate (frequency) in HZ
+     *
+     * @return a newly allocated renderer with the given number of channels and sample rate
+     */
+    static std::shared_ptr<AudioRenderer> alloc(Uint8 channels, Uint32 rate) {
+        std::shared_ptr<AudioRenderer> result = std::make_shared<AudioRenderer>();
+        return (result->init(channels,rate) ? result : nullptr);
+    }
+
+    /**
+     * Returns a newly allocated renderer with the given channels, sample rate, and block size
+     *
+     * The block size is the number of frames pulled from the graph at a time,
+     * and should match the read size of the output device being simulated.
+     * Any attached graph must agree with the channels and sample rate.
+     *
+     * @param channels  The number of audio channels
+     * @param rate      The sample rate (frequency) in HZ
+     * @param block     The number of frames pulled from the graph at a time
+     *
+     * @return a newly allocated renderer with the given channels, sample rate, and block size
+     */
+    static std::shared_ptr<AudioRenderer> alloc(Uint8 channels, Uint32 rate, Uint32 block) {
+        std::shared_ptr<AudioRenderer> result = std::make_shared<AudioRenderer>();
+        return (result->init(channels,rate,block) ? result : nullptr);
+    }
+
+#pragma mark -
+#pragma mark Audio Graph
+    /**
+     * Attaches an audio graph to this renderer.
+     *
+     * This method will fail if the channels or sample rate of the audio graph
+     * do not agree with this node.
+     *
+     * @param node  The terminal node of the audio graph
+     *
+     * @return true if the attachment was successful
+     */
+    bool attach(const std::shared_ptr<AudioNode>& node);
+
+    /**
+     * Detaches an audio graph from this renderer.
+     *
+     * If the method succeeds, it returns the terminal node of the audio graph.
+     *
+     * @return  the terminal node of the audio graph (or null if failed)
+     */
+    std::shared_ptr<AudioNode> detach();
+
+    /**
+     * Returns the terminal node of the audio graph
+     *
+     * @return the terminal node of the audio graph
+     */
+    std::shared_ptr<AudioNode> getInput() { return _input; }
+
+    /**
+     * Returns the number of frames pulled from the graph at a time
+     *
+     * @return the number of frames pulled from the graph at a time
+     */
+    Uint32 getBlockSize() const { return _blocksize; }
+
+#pragma mark -
+#pragma mark Rendering
+    /**
+     * Renders the given number of frames into the buffer.
+     *
+     * The buffer should have enough room to store frames * channels elements.
+     * The graph is pulled in blocks of {@link getBlockSize} frames. If the
+     * graph completes or is paused, the remainder of the buffer is silent.
+     * Hence this method always renders all of the frames, unless the renderer
+     * is not initialized. In that case it renders nothing.
+     *
+     * @param buffer    The buffer to store the results
+     * @param frames    The number of frames to render
+     *
+     * @return the number of frames rendered
+     */
+    Uint64 render(float* buffer, Uint64 frames);
+
+    /**
+     * Returns an in-memory sample with the given duration of the graph
+     *
+     * The sample has the channels and sample rate of this node. The graph
+     * is pulled in blocks of {@link getBlockSize} frames. If the graph
+     * completes or is paused, the remainder of the sample is silent.
+     *
+     * @param seconds   The duration to render
+     *
+     * @return an in-memory sample with the given duration of the graph (or null if uninitialized)
+     */
+    std::shared_ptr<AudioSample> render(double seconds);
+
+    /**
+     * Returns true if this audio node has no more data.
+     *
+     * This renderer is completed if there is no attached graph, or if the
+     * attached graph is completed.
+     *
+     * @return true if this audio node has no more data.
+     */
+    virtual bool completed() override;
+
+    /**
+     * Reads up to the specified number of frames into the given buffer
+     *
+     * This method pulls a single block from the attached graph, and records
+     * the time required. It is called by {@link render}, and should only be
+     * called directly to drive the graph one block at a time.
+     *
+     * The buffer should have enough room to store frames * channels elements.
+     * The channels are interleaved into the output buffer. If the graph does
+     * not produce enough frames, the remainder of the buffer is silent.
+     *
+     * This method will always forward the read position.
+     *
+     * @param buffer    The read buffer to store the results
+     * @param frames    The maximum number of frames to read
+     *
+     * @return the actual number of frames read
+     */
+    virtual Uint32 read(float* buffer, Uint32 frames) override;
+
+#pragma mark -
+#pragma mark Statistics
+    /**
+     * Returns the number of blocks rendered since the last reset
+     *
+     * @return the number of blocks rendered since the last reset
+     */
+    Uint64 getBlocks() const { return _blocks; }
+
+    /**
+     * Returns the number of frames rendered since the last reset
+     *
+     * @return the number of frames rendered since the last reset
+     */
+    Uint64 getFrames() const { return _frames; }
+
+    /**
+     * Returns the total time spent rendering since the last reset
+     *
+     * This value is measured in microseconds, and only includes the time
+     * spent pulling from the graph.
+     *
+     * @return the total time spent rendering since the last reset
+     */
+    Uint64 getElapsedMicros() const { return _elapsed/1000; }
+
+    /**
+     * Returns the longest time spent on a single block since the last reset
+     *
+     * This value is measured in microseconds. It should be compared against
+     * the real-time duration of a block, which is the block size divided by
+     * the sample rate.
+     *
+     * @return the longest time spent on a single block since the last reset
+     */
+    Uint64 getMaxBlockMicros() const { return _maxtime/1000; }
+
+    /**
+     * Returns the number of blocks that took longer than real time
+     *
+     * A block is an overrun if it took longer to render than the duration of
+     * the audio it produced. On a real device, every overrun is an audible
+     * glitch. This value is since the last reset.
+     *
+     * @return the number of blocks that took longer than real time
+     */
+    Uint64 getOverruns() const { return _overruns; }
+
+    /**
+     * Returns the ratio of audio rendered to time spent rendering
+     *
+     * This is the duration of the audio rendered, divided by the wall time
+     * required to render it. A graph can only play in real time if this
+     * value is more than 1. This value is since the last reset.
+     *
+     * @return the ratio of audio rendered to time spent rendering
+     */
+    double getRealtimeFactor() const;
+
+    /**
+     * Resets all of the rendering statistics
+     *
+     * This does not affect the attached graph.
+     */
+    void resetStatistics();
+};
+    }
+}
+
+#endif /* __CU_AUDIO_RENDERER_H__ */
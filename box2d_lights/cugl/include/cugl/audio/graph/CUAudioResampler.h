@@ -3,7 +3,7 @@
 //  Cornell University Game Library (CUGL)
 //
 //  This module provides a graph node for converting from one sample rate to
-//  another.  It uses SDL_AudioStream to perform continuous resampling on a
+//  another.  It uses a polyphase filter to perform continuous resampling on a
 //  potentially infinite audio stream.  This is is necessary for cross-platform
 //  reasons as iPhones are very stubborn about delivering any requested sampling
 //  rates other than 48000.
@@ -34,8 +34,7 @@
 #ifndef __CU_AUDIO_RESAMPLER_H__
 #define __CU_AUDIO_RESAMPLER_H__
 #include <cugl/audio/graph/CUAudioNode.h>
-#include <SDL/SDL.h>
-#include <mutex>
+#include <cugl/math/dsp/CUPolyphaseFilter.h>
 #include <atomic>
 
 namespace cugl {
@@ -51,15 +50,23 @@ namespace cugl {
 /**
  * This class provides a graph node for converting from one sample rate to another.
  *
- * The node uses SDL_AudioStream to perform continuous resampling on a
- * potentially infinite audio stream.  This is is necessary for cross-platform
- * reasons as iPhones are very stubborn about delivering any requested sampling
- * rates other than 48000.
+ * The node uses a {@link dsp::PolyphaseFilter} to perform continuous resampling
+ * on a potentially infinite audio stream.  This is is necessary for
+ * cross-platform reasons as iPhones are very stubborn about delivering any
+ * requested sampling rates other than 48000. The input node reads directly
+ * into the filter history, and each read produces exactly the number of
+ * frames requested (unless the input node runs out of data).
  *
  * This is a dynamic resampler.  While the output sampling rate is fixed, the
  * input is not.  It will readjust the conversion filter to match the sampling
  * rate of the input node whenever the input node changes.
  *
+ * A new input is picked up by the audio thread at the start of the next
+ * buffer. The delegated methods (such as {@link completed} or
+ * {@link getPosition}) forward to the input in use by the audio thread, as
+ * the audio thread calls them too. Use {@link getInput} for the input most
+ * recently attached in the main thread.
+ *
  * The audio graph should only be accessed in the main thread.  In addition,
  * no methods marked as AUDIO THREAD ONLY should ever be accessed by the
  * user.
@@ -68,23 +75,70 @@ namespace cugl {
  */
 class AudioResampler : public AudioNode {
 private:
-    /** Mutex to protect more sophisticated synchronization */
-    mutable std::mutex _buffmtex;
-
-    /** The input node to resample from */
-    std::shared_ptr<AudioNode> _input;
+    /**
+     * The conversion state for a single input node.
+     *
+     * Changing the input may require a new filter. This is built on the
+     * main thread and handed off to the audio thread as a single unit. The
+     * filter bank itself is shared with every filter of the same conversion,
+     * so only the input history is allocated for each new input.
+     * That way the audio thread never has to lock, allocate, or free memory.
+     */
+    class Conversion {
+    public:
+        /** The input node to resample from (may be null) */
+        std::shared_ptr<AudioNode> input;
+        /** The sample rate converter (if needed) */
+        dsp::PolyphaseFilter* filter;
+        /** The conversion ratio */
+        float ratio;
+        /** The next retired conversion */
+        Conversion* next;
+        
+        /** Creates an empty conversion with no input */
+        Conversion() : filter(nullptr), ratio(1.0f), next(nullptr) {}
+        
+        /** Deletes this conversion, releasing the filter */
+        ~Conversion();
+    };
     
-    /** Conversion resampler (if needed) */
-    SDL_AudioStream* _resampler;
+    /** The input node to resample from (MAIN THREAD ONLY) */
+    std::shared_ptr<AudioNode> _input;
     /** The currently support input sample rate */
     Uint32 _inputrate;
-    /** The intermediate sampling buffer */
-    float* _cvtbuffer;
-    /** The capacity of the sampling buffer */
-    size_t _capacity;
     /** The conversion ratio */
     std::atomic<float>  _cvtratio;
+
+    /** The conversion in use by the audio thread (only the audio thread writes this) */
+    std::atomic<Conversion*> _current;
+    /** The next conversion for the audio thread to pick up */
+    std::atomic<Conversion*> _pending;
+    /** The conversions released by the audio thread, to be deleted */
+    std::atomic<Conversion*> _retired;
     
+    /**
+     * Hands off the given conversion to the audio thread.
+     *
+     * The audio thread picks up the conversion at the start of the next
+     * buffer. Any conversions released by the audio thread are deleted.
+     *
+     * @param state The new conversion state
+     */
+    void publish(Conversion* state);
+
+    /**
+     * Returns the input node as seen by the audio thread.
+     *
+     * This is the input of the conversion currently in use by the audio
+     * thread. It is kept alive by that conversion, which is only deleted
+     * in the main thread after the audio thread has released it. Hence
+     * this method never locks and never releases a reference, so it is
+     * safe to call in either thread.
+     *
+     * @return the input node as seen by the audio thread.
+     */
+    AudioNode* staged() const;
+
 public:
 #pragma mark -
 #pragma mark Constructors
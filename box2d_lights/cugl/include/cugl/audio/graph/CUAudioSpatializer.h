@@ -0,0 +1,488 @@
+//
+//  CUAudioSpatializer.h
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides a mixer that places each of its inputs in 2d space.
+//  Every input slot is an emitter with a world-space position, and the node
+//  has a single listener. Once per audio buffer, the audio thread computes
+//  the distance attenuation and the stereo pan of each emitter relative to
+//  the listener, ramping from the previous values so that moving emitters
+//  do not click.
+//
+//  Positions are stored in a lock-free table. The main thread only writes
+//  positions; it never computes gains or touches the audio graph. This makes
+//  it cheap to move many emitters every animation frame.
+//
+//  CUGL MIT License:
+//
+//     This software is provided 'as-is', without any express or implied
+//     warranty.  In no event will the authors be held liable for any damages
+//     arising from the use of this software.
+//
+//     Permission is granted to anyone to use this software for any purpose,
+//     including commercial applications, and to alter it and redistribute it
+//     freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not
+//     be misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Walker White
+//  Version: 5/12/21
+//
+#ifndef __CU_AUDIO_SPATIALIZER_H__
+#define __CU_AUDIO_SPATIALIZER_H__
+#include "CUAudioNode.h"
+#include <cugl/math/CUVec2.h>
+#include <atomic>
+#include <vector>
+
+namespace cugl {
+
+    /**
+     * The audio graph classes.
+     *
+     * This internal namespace is for the audio graph clases.  It was chosen
+     * to distinguish this graph from other graph class collections, such as the
+     * scene graph collections in {@link scene2}.
+     */
+    namespace audio {
+/**
+ * This class represents a mixer that spatializes its inputs.
+ *
+ * Like {@link AudioMixer}, this node takes a fixed number of input slots and
+ * adds them together into a single output stream. Each slot is also an
+ * emitter with a position in 2d world space. This node has a single listener,
+ * and each emitter is attenuated and panned according to its offset from
+ * the listener.
+ *
+ * Attenuation uses the inverse distance model. An emitter within the
+ * {@link getReference} distance plays at full gain. Beyond that distance,
+ * the gain is ref/(ref+rolloff*(dist-ref)), so the default rolloff of 1
+ * halves the gain every time the distance doubles. The pan is the horizontal
+ * offset of the emitter divided by the larger of the distance and the
+ * reference distance, so emitters near the listener are centered. The pan
+ * follows the equal-power law, normalized so that a centered emitter plays
+ * at full gain in both channels. Panning only applies to stereo output.
+ *
+ * Positions are read once per buffer, and the gains ramp linearly across
+ * the buffer from their previous values. Hence emitters (and the listener)
+ * may be moved every frame without any audible discontinuity. The positions
+ * are stored in a lock-free table, so setting a position never blocks and
+ * never allocates. An input attached to a slot starts at its target gain
+ * rather than ramping from the previous occupant of that slot.
+ *
+ * Each input must agree with the sample rate of this node. An input may
+ * either have one channel, in which case it is upmixed, or have the same
+ * number of channels as this node.
+ *
+ * As with {@link AudioMixer}, attaching and detaching inputs never blocks
+ * the audio thread, and a detached input is not released until the audio
+ * thread has finished any buffer that might still be reading from it. This
+ * node is never completed, even when all of its inputs are completed.
+ *
+ * The audio graph should only be accessed in the main thread.  In addition,
+ * no methods marked as AUDIO THREAD ONLY should ever be accessed by the user.
+ *
+ * This class does not support any actions for the {@link AudioNode#setCallback}.
+ */
+class AudioSpatializer : public AudioNode {
+private:
+    /** The input nodes to be spatialized (MAIN THREAD ONLY) */
+    std::shared_ptr<AudioNode>* _inputs;
+    /** The input nodes as seen by the audio thread (not owned) */
+    std::atomic<AudioNode*>* _staged;
+    /** The number of input nodes supported by this spatializer */
+    Uint8 _width;
+
+    /** The emitter position of each slot, packed as two floats */
+    std::atomic<Uint64>* _emitters;
+    /** Whether each emitter position is relative to the listener */
+    std::atomic<bool>* _relative;
+    /** Whether each slot should jump to its target gains (new input) */
+    std::atomic<bool>* _snapped;
+    /** The listener position, packed as two floats */
+    std::atomic<Uint64> _listener;
+
+    /** The distance at which attenuation begins */
+    std::atomic<float> _reference;
+    /** The rate of attenuation beyond the reference distance */
+    std::atomic<float> _rolloff;
+
+    /** The left and right gain of each slot from the last buffer (AUDIO THREAD ONLY) */
+    float* _current;
+    /** The intermediate buffer for each input */
+    float* _buffer;
+    /** The capacity of the intermediate buffer */
+    Uint32 _capacity;
+
+    /** The number of buffers completed by the audio thread */
+    std::atomic<Uint64> _cycle;
+    /** Detached inputs, with the cycle at which they were detached */
+    std::vector<std::pair<Uint64,std::shared_ptr<AudioNode>>> _retired;
+
+    /**
+     * Retires an input node detached from this spatializer.
+     *
+     * The node is held until the audio thread has finished any buffer that
+     * might still be reading from it.
+     *
+     * @param node  The detached input node
+     */
+    void retire(const std::shared_ptr<AudioNode>& node);
+
+    /**
+     * Releases any retired input nodes no longer used by the audio thread.
+     *
+     * This method is called by the main thread whenever the graph changes.
+     */
+    void collect();
+
+    /**
+     * Computes the target left and right gains for the given slot.
+     *
+     * AUDIO THREAD ONLY: This method reads the position table, and is called
+     * once per slot at the start of each buffer.
+     *
+     * @param slot      The emitter slot
+     * @param listener  The current listener position
+     * @param left      The left (or only) gain to store the result
+     * @param right     The right gain to store the result
+     */
+    void target(Uint8 slot, const Vec2& listener, float& left, float& right) const;
+
+    /**
+     * Accumulates an input buffer into the output, ramping the gains
+     *
+     * AUDIO THREAD ONLY: The intermediate buffer is added to the output,
+     * with the gains ramping linearly from (left0,right0) to (left1,right1)
+     * over the given number of frames.
+     *
+     * @param output    The output buffer
+     * @param field     The number of channels in the intermediate buffer
+     * @param frames    The number of frames to accumulate
+     * @param left0     The left gain at the start of the buffer
+     * @param right0    The right gain at the start of the buffer
+     * @param left1     The left gain at the end of the buffer
+     * @param right1    The right gain at the end of the buffer
+     */
+    void accumulate(float* output, Uint8 field, Uint32 frames,
+                    float left0, float right0, float left1, float right1);
+
+public:
+#pragma mark Constructors
+    /** The default number of inputs supported (typically 8) */
+    static const Uint8 DEFAULT_WIDTH;
+    /** The default distance at which attenuation begins */
+    static const float DEFAULT_REFERENCE;
+
+    /**
+     * Creates a degenerate spatializer that takes no inputs
+     *
+     * The spatializer has no width and therefore cannot accept any inputs.
+     * The spatializer must be initialized to be used.
+     *
+     * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate a graph node on
+     * the heap, use one of the static constructors instead.
+     */
+    AudioSpatializer();
+
+    /**
+     * Deletes this spatializer, disposing of all resources.
+     */
+    ~AudioSpatializer() { dispose(); }
+
+    /**
+     * Initializes the spatializer with default stereo settings
+     *
+     * The number of channels is two, for stereo output.  The sample rate is
+     * the modern standard of 48000 HZ. The spatializer has
+     * {@link DEFAULT_WIDTH} slots.
+     *
+     * @return true if initialization was successful
+     */
+    virtual bool init() override;
+
+    /**
+     * Initializes the spatializer with default stereo settings
+     *
+     * The number of channels is two, for stereo output.  The sample rate is
+     * the modern standard of 48000 HZ.
+     *
+     * @param width     The number of emitters that may be attached
+     *
+     * @return true if initialization was successful
+     */
+    bool init(Uint8 width);
+
+    /**
+     * Initializes the spatializer with the given number of channels and sample rate
+     *
+     * The spatializer has {@link DEFAULT_WIDTH} slots. Only stereo output
+     * supports panning; other channel counts are only attenuated.
+     *
+     * @param channels  The number of audio channels
+     * @param rate      The sample rate (frequency) in HZ
+     *
+     * @return true if initialization was successful
+     */
+    virtual bool init(Uint8 channels, Uint32 rate) override;
+
+    /**
+     * Initializes the spatializer with the given number of channels and sample rate
+     *
+     * Only stereo output supports panning; other channel counts are only
+     * attenuated.
+     *
+     * @param width     The number of emitters that may be attached
+     * @param channels  The number of audio channels
+     * @param rate      The sample rate (frequency) in HZ
+     *
+     * @return true if initialization was successful
+     */
+    bool init(Uint8 width, Uint8 channels, Uint32 rate);
+
+    /**
+     * Disposes any resources allocated for this spatializer
+     *
+     * The state of the node is reset to that of an uninitialized constructor.
+     * Unlike the destructor, this method allows the node to be reinitialized.
+     */
+    virtual void dispose() override;
+
+#pragma mark -
+#pragma mark Static Constructors
+    /**
+     * Returns a newly allocated spatializer with default stereo settings
+     *
+     * The number of channels is two, for stereo output.  The sample rate is
+     * the modern standard of 48000 HZ. The spatializer has
+     * {@link DEFAULT_WIDTH} slots.
+     *
+     * @return a newly allocated spatializer with default stereo settings
+     */
+    static std::shared_ptr<AudioSpatializer> alloc() {
+        std::shared_ptr<AudioSpatializer> result = std::make_shared<AudioSpatializer>();
+        return (result->init() ? result : nullptr);
+    }
+
+    /**
+     * Returns a newly allocated spatializer with default stereo settings
+     *
+     * The number of channels is two, for stereo output.  The sample rate is
+     * the modern standard of 48000 HZ.
+     *
+     * @param width     The number of emitters that may be attached
+     *
+     * @return a newly allocated spatializer with default stereo settings
+     */
+    static std::shared_ptr<AudioSpatializer> alloc(Uint8 width) {
+        std::shared_ptr<AudioSpatializer> result = std::make_shared<AudioSpatializer>();
+        return (result->init(width) ? result : nullptr);
+    }
+
+    /**
+     * Returns a newly allocated spatializer with the given number of channels and sample rate
+     *
+     * Only stereo output supports panning; other channel counts are only
+     * attenuated.
+     *
+     * @param width     The number of emitters that may be attached
+     * @param channels  The number of audio channels
+     * @param rate      The sample rate (frequency) in HZ
+     *
+     * @return a newly allocated spatializer with the given number of channels and sample rate
+     */
+    static std::shared_ptr<AudioSpatializer> alloc(Uint8 width, Uint8 channels, Uint32 rate) {
+        std::shared_ptr<AudioSpatializer> result = std::make_shared<AudioSpatializer>();
+        return (result->init(width,channels,rate) ? result : nullptr);
+    }
+
+#pragma mark -
+#pragma mark Audio Graph Methods
+    /**
+     * Attaches an input node to this spatializer.
+     *
+     * The input is attached at the given slot. Any input node previously at
+     * that slot is removed (use {@link getInput} to access it first). The
+     * input must either have one channel or the same number of channels as
+     * this node. It must also have the same sample rate, as the spatializer
+     * does not resample. Wrap the input in an {@link AudioResampler} if the
+     * rates differ. An input that fails these checks is not attached, and
+     * the error is logged.
+     *
+     * The new input starts at the gains for the current emitter position
+     * of this slot. Hence the emitter position should be set before the
+     * input is attached.
+     *
+     * @param slot  The slot for the input node
+     * @param input The input node to attach
+     *
+     * @return true if the input was attached
+     */
+    bool attach(Uint8 slot, const std::shared_ptr<AudioNode>& input);
+
+    /**
+     * Detaches the input node at the given slot.
+     *
+     * The input node detached is returned by this method.
+     *
+     * @param slot  The slot for the input node
+     *
+     * @return the input node detached from the slot
+     */
+    std::shared_ptr<AudioNode> detach(Uint8 slot);
+
+    /**
+     * Returns the input node at the given slot.
+     *
+     * @param slot  The slot for the input node
+     *
+     * @return the input node at the given slot.
+     */
+    std::shared_ptr<AudioNode> getInput(Uint8 slot) const;
+
+    /**
+     * Returns true if the given slot has an input that is not completed.
+     *
+     * A slot is free to reuse if this method is false.
+     *
+     * @param slot  The slot for the input node
+     *
+     * @return true if the given slot has an input that is not completed.
+     */
+    bool isActive(Uint8 slot) const;
+
+    /**
+     * Returns the number of input slots of this spatializer.
+     *
+     * @return the number of input slots of this spatializer.
+     */
+    Uint8 getWidth() const { return _width; }
+
+#pragma mark -
+#pragma mark Spatial Attributes
+    /**
+     * Returns the position of the listener.
+     *
+     * @return the position of the listener.
+     */
+    Vec2 getListener() const;
+
+    /**
+     * Sets the position of the listener.
+     *
+     * This method may be called every animation frame. The change takes
+     * effect at the start of the next buffer, and is smoothed across it.
+     *
+     * @param position  The position of the listener
+     */
+    void setListener(const Vec2& position);
+
+    /**
+     * Returns the position of the emitter at the given slot.
+     *
+     * If the emitter is relative, this position is an offset from the
+     * listener. Otherwise it is in world space.
+     *
+     * @param slot  The emitter slot
+     *
+     * @return the position of the emitter at the given slot.
+     */
+    Vec2 getEmitter(Uint8 slot) const;
+
+    /**
+     * Sets the position of the emitter at the given slot.
+     *
+     * If relative is true, the position is an offset from the listener, and
+     * moves with it. This is useful for sounds, such as interface sounds,
+     * that should not be spatialized. Such sounds should use the position
+     * (0,0). Otherwise, the position is in world space.
+     *
+     * This method may be called every animation frame. The change takes
+     * effect at the start of the next buffer, and is smoothed across it.
+     * This method may be called whether or not an input is attached.
+     *
+     * @param slot      The emitter slot
+     * @param position  The position of the emitter
+     * @param relative  Whether the position is relative to the listener
+     */
+    void setEmitter(Uint8 slot, const Vec2& position, bool relative=false);
+
+    /**
+     * Returns true if the emitter position is relative to the listener.
+     *
+     * @param slot  The emitter slot
+     *
+     * @return true if the emitter position is relative to the listener.
+     */
+    bool isRelative(Uint8 slot) const;
+
+    /**
+     * Returns the distance at which attenuation begins.
+     *
+     * Emitters within this distance of the listener play at full gain.
+     *
+     * @return the distance at which attenuation begins.
+     */
+    float getReference() const;
+
+    /**
+     * Sets the distance at which attenuation begins.
+     *
+     * Emitters within this distance of the listener play at full gain. This
+     * value must be positive.
+     *
+     * @param distance  The distance at which attenuation begins.
+     */
+    void setReference(float distance);
+
+    /**
+     * Returns the rate of attenuation beyond the reference distance.
+     *
+     * A rolloff of 1 halves the gain every time the distance doubles. A
+     * rolloff of 0 disables attenuation.
+     *
+     * @return the rate of attenuation beyond the reference distance.
+     */
+    float getRolloff() const;
+
+    /**
+     * Sets the rate of attenuation beyond the reference distance.
+     *
+     * A rolloff of 1 halves the gain every time the distance doubles. A
+     * rolloff of 0 disables attenuation. This value cannot be negative.
+     *
+     * @param rolloff   The rate of attenuation beyond the reference distance.
+     */
+    void setRolloff(float rolloff);
+
+#pragma mark -
+#pragma mark Playback Control
+    /**
+     * Reads up to the specified number of frames into the given buffer
+     *
+     * AUDIO THREAD ONLY: Users should never access this method directly, unless
+     * part of a custom audio graph node.
+     *
+     * The buffer should have enough room to store frames * channels elements.
+     * The channels are interleaved into the output buffer.
+     *
+     * This method will always forward the read position.
+     *
+     * @param buffer    The read buffer to store the results
+     * @param frames    The maximum number of frames to read
+     *
+     * @return the actual number of frames read
+     */
+    virtual Uint32 read(float* buffer, Uint32 frames) override;
+};
+    }
+}
+#endif /* __CU_AUDIO_SPATIALIZER_H__ */
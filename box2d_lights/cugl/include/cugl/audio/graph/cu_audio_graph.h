@@ -32,6 +32,7 @@
 
 #include "CUAudioNode.h"
 #include "CUAudioOutput.h"
+#include "CUAudioRenderer.h"
 #include "CUAudioInput.h"
 #include "CUAudioResampler.h"
 #include "CUAudioPlayer.h"
@@ -41,5 +42,6 @@
 #include "CUAudioPanner.h"
 #include "CUAudioSpinner.h"
 #include "CUAudioSynchronizer.h"
+#include "CUAudioSpatializer.h"
 
 #endif /* __CU_AUDIO_GRAPH_PKG_H__ */
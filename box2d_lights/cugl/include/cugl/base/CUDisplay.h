@@ -657,6 +657,11 @@ public:
      *
      * This method will swap the OpenGL framebuffers, drawing the screen.
      *
+     * If the {@link RenderThread} is active, the swap is recorded with the
+     * rest of the frame, and the frame is submitted to the GL thread. The
+     * GL thread will then draw this frame while the application updates
+     * the next one.
+     *
      * It will also reassess the orientation state and call the listener as
      * necessary
      */
@@ -51,7 +51,7 @@
 // Define the vectorization support
 // By experimentation, there are only two vectorizations worth supporting.
 // And even Neon64 is questionable on -Os (autovectoization is better).
-#if defined (CU_VECTORIZE) && defined (__arm64__)
+#if defined (CU_VECTORIZE) && (defined (__arm64__) || defined (__aarch64__))
     #define CU_MATH_VECTOR_NEON64
     #include <arm_neon.h>
 #elif defined (CU_VECTORIZE) && defined (__SSE__)
@@ -0,0 +1,309 @@
+//
+//  CUBiquadBank.h
+//  Cornell University Game Library (CUGL)
+//
+//  This class is a bank of independent biquad filters that are processed in
+//  parallel. Each filter is a "lane", with its own coefficients and state.
+//  A typical use is a per-voice lowpass (e.g. for distance or occlusion),
+//  where every active voice has its own filter. Lanes are stored in SoA
+//  (structure of arrays) layout, so that four lanes fit in a single vector
+//  register and advance together, one frame at a time.
+//
+//  This class supports vector optimizations for SSE and Neon 64.  On hosts
+//  that support AVX2, interleaved lanes are processed eight at a time.
+//
+//  This class is NOT THREAD SAFE.  This is by design, for performance reasons.
+//  External locking may be required when the filter is shared between multiple
+//  threads (such as between an audio thread and the main thread).
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Walker White
+//  Version: 5/12/21
+//
+#ifndef __CU_BIQUAD_BANK_H__
+#define __CU_BIQUAD_BANK_H__
+
+#include <cugl/math/dsp/CUBiquadIIR.h>
+#include <cugl/math/CUMathBase.h>
+#include <cugl/util/CUAligned.h>
+#include <cstring>
+#include <vector>
+
+namespace cugl {
+    namespace dsp {
+
+/**
+ * This class implements a bank of biquad filters processed in parallel.
+ *
+ * A {@link BiquadIIR} applies one set of coefficients to all channels of a
+ * single buffer. Filtering many voices with that class requires one filter
+ * object (and one pass over memory) per voice. This class instead filters
+ * N independent "lanes", each with its own coefficients and state. The
+ * coefficients and state are stored in SoA layout, so each group of four
+ * lanes is processed as a single vector, one frame at a time. A lane is a
+ * single channel of audio, so a stereo voice uses two lanes.
+ *
+ * There are two ways to provide lane data. The first is a single buffer of
+ * interleaved lanes, exactly like interleaved audio with one channel per
+ * lane. The second is an array of buffers, one per lane. The latter is
+ * typically more convenient for voices, as each voice can be read into its
+ * own buffer.
+ *
+ * Each lane uses the transposed direct form II of the biquad difference
+ * equation. Unlike {@link BiquadIIR}, the output is not delayed, and so
+ * there is nothing to flush.
+ *
+ * This class supports vector optimizations for SSE and Neon 64, with four
+ * lanes per vector. If {@link DSPMath#useAVX2} is true, interleaved lanes
+ * are processed eight at a time instead. Lanes beyond the last multiple of
+ * four use the scalar algorithm.
+ *
+ * This class is not thread safe.  External locking may be required when
+ * the filter is shared between multiple threads (such as between an audio
+ * thread and the main thread).
+ */
+class BiquadBank {
+private:
+    /** The number of lanes (independent filters) */
+    unsigned _lanes;
+    /** The number of lanes rounded up to a multiple of 4 */
+    unsigned _padded;
+
+    /** The (upper) coefficients for each lane */
+    cugl::Aligned<float> _b0, _b1, _b2;
+    /** The (lower) coefficients for each lane */
+    cugl::Aligned<float> _a1, _a2;
+    /** The delay state for each lane */
+    cugl::Aligned<float> _z1, _z2;
+
+    /**
+     * Allocates the coefficient and state buffers for the given lanes.
+     *
+     * All lanes are reset to pass-through filters with no state.
+     *
+     * @param lanes The number of lanes
+     */
+    void allocate(unsigned lanes);
+
+#pragma mark SPECIALIZED FILTERS
+    /**
+     * Performs a filter of a single lane with the scalar algorithm.
+     *
+     * The input and output strides are the distance (in samples) between
+     * consecutive frames of this lane.
+     *
+     * @param lane      The lane to process
+     * @param gain      The input gain factor
+     * @param input     The array of input samples
+     * @param istride   The input stride
+     * @param output    The array to write the sample output
+     * @param ostride   The output stride
+     * @param size      The input size in frames
+     */
+    void lane(unsigned lane, float gain, const float* input, size_t istride,
+              float* output, size_t ostride, size_t size);
+
+    /**
+     * Performs a filter of interleaved lane data.
+     *
+     * This method uses the vectorized algorithm, if available.
+     *
+     * @param gain      The input gain factor
+     * @param input     The array of input samples
+     * @param output    The array to write the sample output
+     * @param size      The input size in frames
+     */
+    void interleaved(float gain, const float* input, float* output, size_t size);
+
+    /**
+     * Performs a filter of lane data stored in separate buffers.
+     *
+     * This method uses the vectorized algorithm, if available.
+     *
+     * @param gain      The input gain factor
+     * @param input     The input buffers, one per lane
+     * @param output    The output buffers, one per lane
+     * @param size      The input size in frames
+     */
+    void separate(float gain, const float* const* input, float* const* output, size_t size);
+
+public:
+    /** Whether to use a vectorization algorithm (Access not thread safe) */
+    static bool VECTORIZE;
+
+#pragma mark Constructors
+    /**
+     * Creates a bank with a single pass-through lane.
+     */
+    BiquadBank();
+
+    /**
+     * Creates a bank with the given number of pass-through lanes.
+     *
+     * @param lanes The number of lanes
+     */
+    BiquadBank(unsigned lanes);
+
+    /**
+     * Destroys the filter bank, releasing all resources.
+     */
+    ~BiquadBank() {}
+
+#pragma mark Attributes
+    /**
+     * Returns the number of lanes in this bank
+     *
+     * @return the number of lanes in this bank
+     */
+    unsigned getLanes() const { return _lanes; }
+
+    /**
+     * Sets the number of lanes in this bank
+     *
+     * The coefficient and state buffers depend on the number of lanes.
+     * Changing this value resets every lane to a pass-through filter.
+     *
+     * @param lanes The number of lanes in this bank
+     */
+    void setLanes(unsigned lanes);
+
+    /**
+     * Sets the coefficients for the given lane.
+     *
+     * Each lane implements the standard difference equation:
+     *
+     *   y[n] = b0*x[n] + b1*x[n-1] + b2*x[n-2] - a1*y[n-1] - a2*y[n-2]
+     *
+     * where y is the output and x in the input. The state of the lane is
+     * unchanged, so coefficients may be updated smoothly while filtering.
+     *
+     * @param lane  The lane to modify
+     * @param b0    The upper zero-order coefficient
+     * @param b1    The upper first-order coefficient
+     * @param b2    The upper second-order coefficient
+     * @param a1    The lower first-order coefficient
+     * @param a2    The lower second-order coefficient
+     */
+    void setCoeff(unsigned lane, float b0, float b1, float b2, float a1, float a2);
+
+    /**
+     * Sets the coefficients of the given lane to match a biquad filter.
+     *
+     * The state of the lane is unchanged.
+     *
+     * @param lane      The lane to modify
+     * @param filter    The filter to copy
+     */
+    void setCoeff(unsigned lane, const BiquadIIR& filter);
+
+    /**
+     * Sets the given lane to the special purpose filter of the given type
+     *
+     * This method uses the same filter design as {@link BiquadIIR#setType}.
+     * As with that class, frequencies are specified in "normalized" format
+     * and the gain is in decibels. The state of the lane is unchanged.
+     *
+     * This method computes the coefficients from scratch and is not intended
+     * to be called on the audio thread.
+     *
+     * @param lane      The lane to modify
+     * @param type      The filter type
+     * @param frequency The (normalized) target frequency
+     * @param gainDB    The gain at the target frequency in decibels
+     * @param qVal      The special Q factor
+     */
+    void setType(unsigned lane, BiquadIIR::Type type, float frequency,
+                 float gainDB, float qVal=INV_SQRT2);
+
+    /**
+     * Returns the upper coefficients for the given lane.
+     *
+     * @param lane  The lane to query
+     *
+     * @return The upper coefficients for the given lane.
+     */
+    const std::vector<float> getBCoeff(unsigned lane) const;
+
+    /**
+     * Returns the lower coefficients for the given lane.
+     *
+     * The first coefficient is always 1 (the coefficients are normalized).
+     *
+     * @param lane  The lane to query
+     *
+     * @return The lower coefficients for the given lane.
+     */
+    const std::vector<float> getACoeff(unsigned lane) const;
+
+#pragma mark Filter Methods
+    /**
+     * Performs a filter of interleaved lane data.
+     *
+     * The data is laid out like interleaved audio with one channel per lane.
+     * The output is written to the given output array, which should be the
+     * same size as the input array. The size is the number of frames, not
+     * samples.  Hence the arrays must be size times the number of lanes in
+     * size. The input and output may be the same array.
+     *
+     * The gain parameter is applied at the filter input, but does not affect
+     * the filter coefficients.
+     *
+     * @param gain      The input gain factor
+     * @param input     The array of input samples
+     * @param output    The array to write the sample output
+     * @param size      The input size in frames
+     */
+    void calculate(float gain, const float* input, float* output, size_t size);
+
+    /**
+     * Performs a filter of lane data stored in separate buffers.
+     *
+     * There should be one input buffer and one output buffer per lane,
+     * each with size samples. An output buffer may be the same as the
+     * matching input buffer.
+     *
+     * The gain parameter is applied at the filter input, but does not affect
+     * the filter coefficients.
+     *
+     * @param gain      The input gain factor
+     * @param input     The input buffers, one per lane
+     * @param output    The output buffers, one per lane
+     * @param size      The input size in frames
+     */
+    void calculate(float gain, const float* const* input, float* const* output, size_t size);
+
+    /**
+     * Clears the state of every lane, leaving the coefficients unchanged
+     */
+    void clear();
+
+    /**
+     * Clears the state of the given lane, leaving the coefficients unchanged
+     *
+     * This should be called when a lane is reassigned to a new voice.
+     *
+     * @param lane  The lane to clear
+     */
+    void clear(unsigned lane);
+};
+    }
+}
+#endif /* __CU_BIQUAD_BANK_H__ */
@@ -42,9 +42,11 @@ namespace cugl {
  * This class is a collection of static methods for basic DSP calculations
  *
  * As with the DSP filters, this class supports vector optimizations for SSE
- * and Neon 64. Our implementation is limited to 128-bit words.  While 256-bit
- * (e.g. AVX) are more performant, they are not better for DSP filters and so
- * we keep the optimizations at the same level.
+ * and Neon 64. In addition, the SSE build has 256-bit (AVX2) kernels for the
+ * arithmetic methods. As AVX2 is not available on every desktop CPU, these
+ * kernels are selected at runtime, using CPU feature detection at startup.
+ * Setting {@link VECTORIZE} to false always selects the scalar reference
+ * algorithm, which is useful for verification.
  *
  * This class is not thread safe.  External locking may be required when
  * the filter is shared between multiple threads (such as between an audio
@@ -66,6 +68,32 @@ private:
 public:
     /** Whether to use a vectorization algorithm (Access not thread safe) */
     static bool VECTORIZE;
+    /** Whether to use 256-bit kernels when supported (Access not thread safe) */
+    static bool VECTORIZE_AVX2;
+    
+#pragma mark Vectorization
+    /**
+     * Returns true if this CPU supports the 256-bit (AVX2) kernels
+     *
+     * The kernels require both AVX2 and FMA. This value is detected once, at
+     * startup. It is false on any platform other than x86 (with SSE enabled).
+     *
+     * @return true if this CPU supports the 256-bit (AVX2) kernels
+     */
+    static bool hasAVX2();
+    
+    /**
+     * Returns true if the DSP kernels should use 256-bit (AVX2) vectors
+     *
+     * This is true if the CPU supports AVX2 and {@link VECTORIZE_AVX2} is
+     * true. It applies to the filters as well as the methods of this class,
+     * so setting {@link VECTORIZE_AVX2} to false restricts all of the DSP
+     * kernels to 128-bit vectors. Each filter must still be vectorized
+     * for this value to have any effect.
+     *
+     * @return true if the DSP kernels should use 256-bit (AVX2) vectors
+     */
+    static bool useAVX2() { return VECTORIZE_AVX2 && hasAVX2(); }
     
 #pragma mark Arithmetic Methods
     /**
@@ -0,0 +1,355 @@
+//
+//  CUPolyphaseFilter.h
+//  Cornell University Game Library (CUGL)
+//
+//  This class is a polyphase, windowed-sinc sample rate converter. It converts
+//  a (potentially infinite) stream of interleaved audio from one sample rate
+//  to another, using a filter bank that is precomputed once per conversion
+//  ratio. The streaming state is kept in a single history buffer, so input
+//  may be written directly into the filter with no intermediate copies.
+//
+//  This class supports vector optimizations for SSE and Neon 64.  On hosts
+//  that support AVX2, mono and stereo conversion use 256-bit words.
+//
+//  This class is NOT THREAD SAFE.  This is by design, for performance reasons.
+//  External locking may be required when the filter is shared between multiple
+//  threads (such as between an audio thread and the main thread).
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Walker White
+//  Version: 5/12/21
+//
+#ifndef __CU_POLYPHASE_FILTER_H__
+#define __CU_POLYPHASE_FILTER_H__
+
+#include <cugl/math/CUMathBase.h>
+#include <cugl/util/CUAligned.h>
+#include <SDL/SDL.h>
+#include <cstring>
+#include <memory>
+
+namespace cugl {
+    namespace dsp {
+
+/**
+ * This class implements a polyphase, windowed-sinc sample rate converter.
+ *
+ * The conversion ratio is reduced to a rational value L/M, where L is the
+ * number of filter phases and M is the number of input frames advanced per
+ * L output frames. A bank of Blackman-windowed sinc filters is computed for
+ * each phase when the rates are set. Each output frame is then a single dot
+ * product between one phase of the bank and a window of the input history.
+ * If L is very large (e.g. the rates share no common factors), the bank is
+ * limited to {@link #MAX_PHASES} phases, and each output uses the nearest
+ * phase. The stream position remains exact in either case.
+ *
+ * Unlike the other filters, input and output are decoupled. Input frames are
+ * written directly to the history buffer, using {@link #getInputBuffer} and
+ * {@link #appendInput}. The method {@link #getInputNeeded} returns exactly
+ * how many input frames are required to produce a given number of output
+ * frames. The history buffer is sized at construction, so streaming never
+ * allocates memory.
+ *
+ * Computing a filter bank is expensive. Hence banks are immutable, and are
+ * cached for each combination of sample rates, taps, and channels. Filters
+ * with the same conversion share the same bank, so constructing a filter
+ * for a previously seen conversion only allocates the input history.
+ *
+ * This class supports vector optimizations for SSE and Neon 64. These are
+ * specialized for mono, stereo, and multiples of four channels. All other
+ * channel layouts use the scalar algorithm. If {@link DSPMath#useAVX2} is
+ * true, mono and stereo conversion use 256-bit words.
+ *
+ * This class is not thread safe.  External locking may be required when
+ * the filter is shared between multiple threads (such as between an audio
+ * thread and the main thread).
+ */
+class PolyphaseFilter {
+private:
+    /**
+     * An immutable filter bank for a single conversion.
+     *
+     * Banks are shared by every filter with the same conversion, and are
+     * never modified once they are cached.
+     */
+    class Bank {
+    public:
+        /** The output frames per conversion cycle (the exact phase count) */
+        Uint32 upsample;
+        /** The input frames per conversion cycle */
+        Uint32 dnsample;
+        /** The number of phases in the filter bank */
+        Uint32 phases;
+        /** The number of taps per filter phase (a multiple of 4) */
+        Uint32 taps;
+        /** The coefficients, with each coefficient repeated for every channel */
+        cugl::Aligned<float> coeffs;
+    };
+
+    /** The number of channels to support */
+    unsigned _channels;
+    /** The input sample rate */
+    Uint32 _inrate;
+    /** The output sample rate */
+    Uint32 _outrate;
+    /** The output frames per conversion cycle (the exact phase count) */
+    Uint32 _upsample;
+    /** The input frames per conversion cycle */
+    Uint32 _dnsample;
+    /** The number of phases in the filter bank */
+    Uint32 _phases;
+    /** The number of taps per filter phase (a multiple of 4) */
+    Uint32 _taps;
+
+    /** The (shared) filter bank */
+    std::shared_ptr<const Bank> _bank;
+    /** The filter bank coefficients, cached from the shared bank */
+    const float* _coeffs;
+    /** The interleaved input history */
+    cugl::Aligned<float> _inns;
+    /** The capacity of the input history in frames */
+    size_t _capacity;
+    /** The number of frames currently in the input history */
+    size_t _count;
+    /** The history frame at (or just before) the next output */
+    size_t _index;
+    /** The fractional position of the next output, in units of 1/_upsample */
+    Uint32 _phase;
+
+    /**
+     * Returns the filter bank for the given conversion.
+     *
+     * The bank is computed the first time a conversion is requested, and
+     * is cached afterwards. This method is thread safe, but it should not
+     * be called in the audio thread, as it may lock or allocate memory.
+     *
+     * @param channels  The number of channels
+     * @param inrate    The input sample rate
+     * @param outrate   The output sample rate
+     *
+     * @return the filter bank for the given conversion.
+     */
+    static std::shared_ptr<const Bank> acquire(unsigned channels, Uint32 inrate, Uint32 outrate);
+
+    /**
+     * Acquires the filter bank for the current rates and channels.
+     *
+     * This method also allocates the input history large enough to produce
+     * the given number of output frames in a single call.
+     *
+     * @param frames    The maximum number of output frames per calculation
+     */
+    void setup(size_t frames);
+
+#pragma mark SPECIALIZED FILTERS
+    /**
+     * Converts single channel input data from the input history.
+     *
+     * This method uses the vectorized algorithm, if available.
+     *
+     * @param output    The array to write the sample output
+     * @param size      The output size in frames
+     */
+    void single(float* output, size_t size);
+
+    /**
+     * Converts interleaved, dual channel input data from the input history.
+     *
+     * This method uses the vectorized algorithm, if available.
+     *
+     * @param output    The array to write the sample output
+     * @param size      The output size in frames
+     */
+    void dual(float* output, size_t size);
+
+    /**
+     * Converts interleaved input data whose channels are a multiple of 4.
+     *
+     * This method uses the vectorized algorithm, if available.
+     *
+     * @param output    The array to write the sample output
+     * @param size      The output size in frames
+     */
+    void quad(float* output, size_t size);
+
+    /**
+     * Converts interleaved input data with an arbitrary number of channels.
+     *
+     * This method is not vectorized.
+     *
+     * @param output    The array to write the sample output
+     * @param size      The output size in frames
+     */
+    void stride(float* output, size_t size);
+
+    /**
+     * Returns the filter phase for the next output frame.
+     *
+     * @return the filter phase for the next output frame.
+     */
+    const float* coeff() const {
+        return _coeffs+(size_t)(((Uint64)_phase*_phases+_upsample/2)/_upsample)*_taps*_channels;
+    }
+
+    /**
+     * Advances the stream position by one output frame.
+     */
+    void step() {
+        _phase += _dnsample;
+        _index += _phase/_upsample;
+        _phase %= _upsample;
+    }
+
+public:
+    /** Whether to use a vectorization algorithm (Access not thread safe) */
+    static bool VECTORIZE;
+    /** The maximum number of phases in a filter bank */
+    static const Uint32 MAX_PHASES;
+    /** The number of sinc zero crossings on each side of the filter */
+    static const Uint32 ZERO_CROSSINGS;
+
+#pragma mark Constructors
+    /**
+     * Creates a single channel pass-through converter at 48000 Hz.
+     */
+    PolyphaseFilter();
+
+    /**
+     * Creates a converter for the given channels and sample rates.
+     *
+     * The value frames is the maximum number of output frames requested
+     * in a single call to {@link #calculate}. It determines the size of
+     * the input history.
+     *
+     * @param channels  The number of channels
+     * @param inrate    The input sample rate
+     * @param outrate   The output sample rate
+     * @param frames    The maximum number of output frames per calculation
+     */
+    PolyphaseFilter(unsigned channels, Uint32 inrate, Uint32 outrate, size_t frames);
+
+    /**
+     * Destroys the converter, releasing all resources.
+     */
+    ~PolyphaseFilter() {}
+
+#pragma mark Attributes
+    /**
+     * Resets the converter to the given channels and sample rates.
+     *
+     * This acquires a new filter bank and clears the input history. The
+     * value frames is the maximum number of output frames requested in a
+     * single call to {@link #calculate}.
+     *
+     * @param channels  The number of channels
+     * @param inrate    The input sample rate
+     * @param outrate   The output sample rate
+     * @param frames    The maximum number of output frames per calculation
+     */
+    void reset(unsigned channels, Uint32 inrate, Uint32 outrate, size_t frames);
+
+    /**
+     * Returns the number of channels for this converter
+     *
+     * @return the number of channels for this converter
+     */
+    unsigned getChannels() const { return _channels; }
+
+    /**
+     * Returns the input sample rate of this converter
+     *
+     * @return the input sample rate of this converter
+     */
+    Uint32 getInputRate() const { return _inrate; }
+
+    /**
+     * Returns the output sample rate of this converter
+     *
+     * @return the output sample rate of this converter
+     */
+    Uint32 getOutputRate() const { return _outrate; }
+
+    /**
+     * Returns the number of taps in each filter phase
+     *
+     * @return the number of taps in each filter phase
+     */
+    Uint32 getTaps() const { return _taps; }
+
+#pragma mark Filter Methods
+    /**
+     * Returns the number of input frames needed for the given output frames.
+     *
+     * This value is exact. Appending this many frames guarantees that the
+     * next call to {@link #calculate} produces all of the requested frames.
+     * It is limited by the free space in the input history.
+     *
+     * @param frames    The number of output frames
+     *
+     * @return the number of input frames needed for the given output frames.
+     */
+    size_t getInputNeeded(size_t frames) const;
+
+    /**
+     * Returns the write position for new input frames.
+     *
+     * Input data should be written (interleaved) directly to this buffer.
+     * Up to {@link #getInputNeeded} frames may be written. Any frames
+     * written do not become part of the stream until {@link #appendInput}
+     * is called.
+     *
+     * @return the write position for new input frames.
+     */
+    float* getInputBuffer() { return _inns+_count*_channels; }
+
+    /**
+     * Appends the given number of frames written to the input buffer.
+     *
+     * @param frames    The number of frames written
+     */
+    void appendInput(size_t frames);
+
+    /**
+     * Converts the input history, writing up to size frames to output.
+     *
+     * The output is interleaved, and has the same number of channels as
+     * the input. This method returns fewer than size frames only if not
+     * enough input has been appended. Input no longer needed by future
+     * frames is discarded from the history.
+     *
+     * @param output    The array to write the sample output
+     * @param size      The maximum number of output frames
+     *
+     * @return the number of frames written to output
+     */
+    size_t calculate(float* output, size_t size);
+
+    /**
+     * Clears the input history, resetting the stream position.
+     *
+     * The history is padded with enough silence that the first output frame
+     * is aligned with the first input frame.
+     */
+    void clear();
+};
+    }
+}
+#endif /* __CU_POLYPHASE_FILTER_H__ */
@@ -30,6 +30,7 @@
 
 #include "CUDSPMath.h"
 #include "CUFIRFilter.h"
+#include "CUPolyphaseFilter.h"
 #include "CUIIRFilter.h"
 #include "CUOneZeroFIR.h"
 #include "CUTwoZeroFIR.h"
@@ -37,6 +38,7 @@
 #include "CUTwoPoleIIR.h"
 #include "CUPoleZeroIIR.h"
 #include "CUBiquadIIR.h"
+#include "CUBiquadBank.h"
 
 #endif /* __CU_DSP_PKG_H__ */
 
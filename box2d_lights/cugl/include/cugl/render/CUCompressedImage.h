@@ -0,0 +1,337 @@
+//
+//  CUCompressedImage.h
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides support for GPU compressed images stored in KTX
+//  (version 1 or 2) containers.  These images are uploaded directly to the
+//  GPU with their mipmaps, using a fraction of the memory of an RGBA texture.
+//  This class only stores the image data; it is the Texture class that
+//  uploads it.  Hence it is safe to load these images outside the main thread.
+//
+//  We support the ETC2/EAC formats (which are mandatory in OpenGLES 3) and
+//  the LDR ASTC formats. As not every desktop driver supports ETC2, the ETC2
+//  formats (and ETC1) can be decompressed to RGBA in software as a fallback.
+//  There is no such fallback for ASTC.
+//
+//  This class uses our standard shared-pointer architecture.
+//
+//  1. The constructor does not perform any initialization; it just sets all
+//     attributes to their defaults.
+//
+//  2. All initialization takes place via init methods, which can fail if an
+//     object is initialized more than once.
+//
+//  3. All allocation takes place via static constructors which return a shared
+//     pointer.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Walker White
+//  Version: 5/12/21
+#ifndef __CU_COMPRESSED_IMAGE_H__
+#define __CU_COMPRESSED_IMAGE_H__
+#include <cugl/base/CUBase.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// These formats are not in every OpenGL header
+#ifndef GL_ETC1_RGB8_OES
+#define GL_ETC1_RGB8_OES                            0x8D64
+#endif
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#define GL_COMPRESSED_RGB8_ETC2                     0x9274
+#define GL_COMPRESSED_SRGB8_ETC2                    0x9275
+#define GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2 0x9276
+#define GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2 0x9277
+#define GL_COMPRESSED_RGBA8_ETC2_EAC                0x9278
+#define GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC         0x9279
+#endif
+#ifndef GL_COMPRESSED_RGBA_ASTC_4x4_KHR
+#define GL_COMPRESSED_RGBA_ASTC_4x4_KHR             0x93B0
+#define GL_COMPRESSED_RGBA_ASTC_12x12_KHR           0x93BD
+#define GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR     0x93D0
+#define GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x12_KHR   0x93DD
+#endif
+
+namespace cugl {
+
+/**
+ * This class represents a GPU compressed image loaded from a KTX file.
+ *
+ * The image stores the compressed data for each mipmap level, with level 0
+ * being the full size image.  Only 2D images are supported; KTX files with
+ * array layers, cube faces, depth, or supercompression are rejected.  The
+ * image is not a texture.  Use {@link Texture#initWithCompressed} to upload
+ * it to the GPU.  As this class makes no OpenGL calls (other than
+ * {@link queryFormats}), it is safe to load outside of the main thread.
+ *
+ * If the driver does not support the compression format, the ETC formats
+ * can be decompressed into an RGBA buffer with {@link decompress}.
+ */
+class CompressedImage {
+public:
+    /**
+     * A single mipmap level of a compressed image
+     */
+    struct Level {
+        /** The level width in pixels */
+        int width;
+        /** The level height in pixels */
+        int height;
+        /** The compressed level data */
+        std::vector<Uint8> data;
+    };
+
+private:
+    /** The OpenGL internal format of the compressed data */
+    GLenum _format;
+    /** The mipmap levels, starting with the full size image */
+    std::vector<Level> _levels;
+    /** The compressed formats supported by the OpenGL driver */
+    static std::vector<GLenum> _supported;
+    /** Whether the supported formats have been queried */
+    static bool _queried;
+
+#pragma mark -
+#pragma mark File Parsing
+    /**
+     * Returns true if the data is successfully parsed as a KTX 1 file.
+     *
+     * @param data  The file contents
+     * @param size  The file size in bytes
+     *
+     * @return true if the data is successfully parsed as a KTX 1 file.
+     */
+    bool parseKTX1(const Uint8* data, size_t size);
+
+    /**
+     * Returns true if the data is successfully parsed as a KTX 2 file.
+     *
+     * @param data  The file contents
+     * @param size  The file size in bytes
+     *
+     * @return true if the data is successfully parsed as a KTX 2 file.
+     */
+    bool parseKTX2(const Uint8* data, size_t size);
+
+public:
+#pragma mark -
+#pragma mark Constructors
+    /**
+     * Creates a new empty compressed image.
+     *
+     * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate an image on
+     * the heap, use one of the static constructors instead.
+     */
+    CompressedImage() : _format(0) {}
+
+    /**
+     * Deletes this image, disposing all resources
+     */
+    ~CompressedImage() { dispose(); }
+
+    /**
+     * Deletes the image data, freeing all resources.
+     *
+     * You must reinitialize the image to use it.
+     */
+    void dispose();
+
+    /**
+     * Initializes a compressed image with the contents of a KTX file.
+     *
+     * Both KTX 1 and KTX 2 files are supported. The file must store a 2D
+     * image with a supported compression format (see {@link isCompressed}).
+     *
+     * IMPORTANT: In CUGL, relative path names always refer to the asset
+     * directory. If you wish to load an image from somewhere else, you must
+     * use an absolute pathname.
+     *
+     * @param filename  The KTX file
+     *
+     * @return true if initialization was successful.
+     */
+    bool initWithFile(const std::string& filename);
+
+    /**
+     * Initializes a compressed image with the contents of a KTX file in memory.
+     *
+     * Both KTX 1 and KTX 2 files are supported. The file must store a 2D
+     * image with a supported compression format (see {@link isCompressed}).
+     *
+     * @param data  The file contents
+     * @param size  The file size in bytes
+     *
+     * @return true if initialization was successful.
+     */
+    bool initWithData(const Uint8* data, size_t size);
+
+    /**
+     * Returns a newly allocated compressed image with the contents of a KTX file.
+     *
+     * Both KTX 1 and KTX 2 files are supported. The file must store a 2D
+     * image with a supported compression format (see {@link isCompressed}).
+     *
+     * IMPORTANT: In CUGL, relative path names always refer to the asset
+     * directory. If you wish to load an image from somewhere else, you must
+     * use an absolute pathname.
+     *
+     * @param filename  The KTX file
+     *
+     * @return a newly allocated compressed image with the contents of a KTX file.
+     */
+    static std::shared_ptr<CompressedImage> allocWithFile(const std::string& filename) {
+        std::shared_ptr<CompressedImage> result = std::make_shared<CompressedImage>();
+        return (result->initWithFile(filename) ? result : nullptr);
+    }
+
+    /**
+     * Returns a newly allocated compressed image with a KTX file in memory.
+     *
+     * Both KTX 1 and KTX 2 files are supported. The file must store a 2D
+     * image with a supported compression format (see {@link isCompressed}).
+     *
+     * @param data  The file contents
+     * @param size  The file size in bytes
+     *
+     * @return a newly allocated compressed image with a KTX file in memory.
+     */
+    static std::shared_ptr<CompressedImage> allocWithData(const Uint8* data, size_t size) {
+        std::shared_ptr<CompressedImage> result = std::make_shared<CompressedImage>();
+        return (result->initWithData(data, size) ? result : nullptr);
+    }
+
+#pragma mark -
+#pragma mark Attributes
+    /**
+     * Returns the OpenGL internal format of the compressed data
+     *
+     * @return the OpenGL internal format of the compressed data
+     */
+    GLenum getFormat() const { return _format; }
+
+    /**
+     * Returns the width of the full size image in pixels
+     *
+     * @return the width of the full size image in pixels
+     */
+    int getWidth() const { return _levels.empty() ? 0 : _levels[0].width; }
+
+    /**
+     * Returns the height of the full size image in pixels
+     *
+     * @return the height of the full size image in pixels
+     */
+    int getHeight() const { return _levels.empty() ? 0 : _levels[0].height; }
+
+    /**
+     * Returns the mipmap levels of this image
+     *
+     * Level 0 is the full size image.  Each successive level halves the
+     * size of the previous one.
+     *
+     * @return the mipmap levels of this image
+     */
+    const std::vector<Level>& getLevels() const { return _levels; }
+
+    /**
+     * Returns true if this image has the full chain of mipmaps.
+     *
+     * Mipmap filtering is only valid if the chain reaches a 1x1 image.
+     *
+     * @return true if this image has the full chain of mipmaps.
+     */
+    bool hasMipMaps() const;
+
+    /**
+     * Returns the total size of the compressed data in bytes
+     *
+     * @return the total size of the compressed data in bytes
+     */
+    size_t getByteSize() const;
+
+#pragma mark -
+#pragma mark Format Support
+    /**
+     * Queries the compressed formats supported by the OpenGL driver.
+     *
+     * This method must be called in the main thread (with an active OpenGL
+     * context) before {@link isSupported} is used in any other thread. It
+     * is safe to call this method more than once.
+     */
+    static void queryFormats();
+
+    /**
+     * Returns true if the OpenGL driver supports the given compressed format.
+     *
+     * This method uses the results of {@link queryFormats}.  If the formats
+     * have not been queried, this method returns false.
+     *
+     * @param format    The OpenGL internal format
+     *
+     * @return true if the OpenGL driver supports the given compressed format.
+     */
+    static bool isSupported(GLenum format);
+
+    /**
+     * Returns true if this class can read the given compressed format.
+     *
+     * This is true for the ETC1, ETC2/EAC and LDR ASTC formats.
+     *
+     * @param format    The OpenGL internal format
+     *
+     * @return true if this class can read the given compressed format.
+     */
+    static bool isCompressed(GLenum format);
+
+    /**
+     * Returns true if the given format can be decompressed in software.
+     *
+     * This is true for the ETC1 and ETC2/EAC RGB and RGBA formats.
+     *
+     * @param format    The OpenGL internal format
+     *
+     * @return true if the given format can be decompressed in software.
+     */
+    static bool isDecompressible(GLenum format);
+
+    /**
+     * Decompresses the full size image into an RGBA buffer.
+     *
+     * The buffer must hold width*height*4 bytes, with rows separated by the
+     * given pitch. The pixels are written in byte order R, G, B, A, which
+     * matches a texture with PixelFormat::RGBA.  This method is safe to
+     * call outside of the main thread.
+     *
+     * This method fails if {@link isDecompressible} is false for the format.
+     *
+     * @param buffer    The buffer to store the pixels
+     * @param pitch     The number of bytes in each row of the buffer
+     *
+     * @return true if the image was successfully decompressed
+     */
+    bool decompress(Uint8* buffer, int pitch) const;
+
+};
+
+}
+
+#endif /* __CU_COMPRESSED_IMAGE_H__ */
@@ -57,6 +57,9 @@
 #include <cugl/render/CUMesh.h>
 #include <SDL/SDL_ttf.h>
 
+/** The default maximum width and height of a dynamic font atlas */
+#define DYNAMIC_ATLAS_MAX   2048
+
 namespace cugl {
     
 /**
@@ -96,6 +99,12 @@ namespace cugl {
  * that you explicitly specify a character set for the atlas.  Indeed, a 
  * character set is the only way to get unicode support; the basic atlas only 
  * includes ASCII characters.
+ *
+ * Alternatively, {@link buildDynamicAtlas()} creates an atlas that starts
+ * empty and rasterizes glyphs the first time they are rendered. Such an
+ * atlas supports every glyph in the font, grows as necessary, and evicts
+ * the least recently used glyphs when it reaches its maximum size. This is
+ * the preferred atlas for text that is not known in advance, like user names.
  */
 class Font {
 #pragma mark Inner Classes
@@ -264,12 +273,52 @@ protected:
     std::unordered_map<Uint32, Rect> _glyphmap;
     /** The cached metrics for each font glyph */
     std::unordered_map<Uint32, Metrics> _glyphsize;
-    /** The kerning for each pair of characters */
+    /** The kerning for each pair of characters (filled on rasterization if dynamic) */
     std::unordered_map<Uint32, std::unordered_map<Uint32, Uint32> > _kernmap;
     /** The OpenGL texture representing this atlas */
     std::shared_ptr<Texture> _texture;
     /** A (temporary) SDL surface for computing the atlas texture */
     SDL_Surface* _surface;
+    
+    // Dynamic atlas support
+    /**
+     * A single row (shelf) of glyphs in a dynamic atlas.
+     *
+     * Glyphs are packed left to right in a shelf. Shelves are the unit of
+     * eviction, so that the atlas never fragments.
+     */
+    struct Shelf {
+        /** The top edge of this shelf in the atlas */
+        int y;
+        /** The height of this shelf */
+        int height;
+        /** The width used by glyphs in this shelf */
+        int used;
+        /** The last atlas clock tick that this shelf was used */
+        Uint64 stamp;
+        /** The last frame stamp at which this shelf was used */
+        Uint64 frame;
+        /** The glyphs stored in this shelf */
+        std::vector<Uint32> glyphs;
+    };
+    /** Whether this atlas rasterizes glyphs on demand */
+    bool _dynamic;
+    /** The maximum width and height of the dynamic atlas */
+    int _atlasMax;
+    /** The current width of the dynamic atlas */
+    int _atlasWidth;
+    /** The current height of the dynamic atlas */
+    int _atlasHeight;
+    /** The shelves of the dynamic atlas, from top to bottom */
+    std::vector<Shelf> _shelves;
+    /** The shelf containing each glyph of the dynamic atlas */
+    std::unordered_map<Uint32, size_t> _glyphshelf;
+    /** The usage clock for least recently used eviction */
+    Uint64 _atlasClock;
+    /** The number of times that atlas texture coordinates were invalidated */
+    Uint32 _atlasVersion;
+    /** The frame stamp of the drawing pass that is using the atlas (0 if unknown) */
+    Uint64 _frameStamp;
 
     
 public:
@@ -781,6 +830,44 @@ public:
      * @return true if the atlas was successfully created.
      */
     bool buildAtlasAsync(const std::string charset);
+    
+    /**
+     * Creates a dynamic atlas for this font.
+     *
+     * A dynamic atlas starts empty. Glyphs are rasterized and added to the
+     * atlas the first time they are rendered, and are uploaded to the atlas
+     * texture one glyph at a time. Hence the atlas supports every glyph in
+     * the font, while only paying for those that are actually used.
+     *
+     * The atlas grows as necessary, up to maxsize in each dimension. Once
+     * it reaches that size, it evicts the glyph rows that were used least
+     * recently. Growth and eviction change the texture coordinates of the
+     * glyphs, which is reported by {@link getAtlasVersion()}.
+     *
+     * This method does not generate the OpenGL texture. That happens the
+     * first time that {@link getAtlas()} is called. As a result, this method
+     * is thread safe. However, rendering with a dynamic atlas may only take
+     * place in the main thread.
+     *
+     * @param maxsize   The maximum width and height of the atlas texture
+     *
+     * @return true if the atlas was successfully created.
+     */
+    bool buildDynamicAtlas(int maxsize=DYNAMIC_ATLAS_MAX);
+    
+    /**
+     * Rasterizes the given glyphs in the atlas, marking them as used.
+     *
+     * This method only matters for a dynamic atlas. Once it is called,
+     * generating quads for these glyphs (e.g. with {@link getQuad}) will
+     * not grow the atlas or evict glyphs. Any change to the atlas made by
+     * this method is reported by {@link getAtlasVersion()}.
+     *
+     * This method may only be called in the main thread.
+     *
+     * @param glyphs    The (Unicode) glyphs to rasterize
+     */
+    void reserveGlyphs(const std::vector<Uint32>& glyphs);
 
     /**
      * Returns the OpenGL texture for the associated atlas.
@@ -803,6 +890,51 @@ public:
      */
     bool hasAtlas() const { return _hasAtlas; }
     
+    /**
+     * Returns true if this font has a dynamic atlas.
+     *
+     * A dynamic atlas rasterizes glyphs when they are first rendered. See
+     * {@link buildDynamicAtlas()} for more information.
+     *
+     * @return true if this font has a dynamic atlas.
+     */
+    bool hasDynamicAtlas() const { return _dynamic; }
+    
+    /**
+     * Returns the current version of the atlas texture coordinates.
+     *
+     * This value changes whenever a mesh previously generated by this font
+     * is no longer valid. That happens when a dynamic atlas grows or evicts
+     * glyphs, or when the atlas is cleared. Any class that caches a mesh
+     * from this font should regenerate it when this value changes.
+     *
+     * @return the current version of the atlas texture coordinates.
+     */
+    Uint32 getAtlasVersion() const { return _atlasVersion; }
+    
+    /**
+     * Returns the frame stamp of the drawing pass that is using the atlas.
+     *
+     * See {@link setFrameStamp} for more information.
+     *
+     * @return the frame stamp of the drawing pass that is using the atlas.
+     */
+    Uint64 getFrameStamp() const { return _frameStamp; }
+    
+    /**
+     * Sets the frame stamp of the drawing pass that is using the atlas.
+     *
+     * This value only matters for a dynamic atlas. Glyphs are uploaded to
+     * the texture as soon as they are rasterized, so evicting a glyph could
+     * corrupt quads that were batched earlier but not yet drawn. Glyphs used
+     * under the current stamp are never evicted. The stamp should come from
+     * the batch that draws the quads, such as {@link SpriteBatch#getFrameStamp}.
+     * A stamp of 0 (the default) disables this protection.
+     *
+     * @param stamp The frame stamp of the drawing pass that is using the atlas.
+     */
+    void setFrameStamp(Uint64 stamp) { _frameStamp = stamp; }
+    
 #pragma mark -
 #pragma mark Rendering
     /**
@@ -1384,6 +1516,17 @@ protected:
      * Gathers the kerning information for the atlas.
      */
     void prepareAtlasKerning();
+    
+    /**
+     * Gathers the kerning information for a glyph in the dynamic atlas.
+     *
+     * The kerning is computed against every glyph currently in the atlas
+     * (in both orders), so that laying out resident glyphs never has to
+     * query the font. Pairs that are already known are skipped.
+     *
+     * @param thechar   The newly rasterized glyph
+     */
+    void prepareGlyphKerning(Uint32 thechar);
 
     /**
      * Returns the metrics for the given character if available.
@@ -1462,6 +1605,97 @@ protected:
      * @return a blank surface of the given size.
      */
     SDL_Surface* allocSurface(int width, int height);
+    
+#pragma mark -
+#pragma mark Dynamic Atlas
+    /**
+     * Returns the metrics for the given glyph, using the atlas if possible.
+     *
+     * If the metrics are not cached, they are computed directly.
+     *
+     * @param thechar   The character to measure
+     *
+     * @return the metrics for the given glyph, using the atlas if possible.
+     */
+    Metrics glyphMetrics(Uint32 thechar) const;
+    
+    /**
+     * Returns the kerning between two glyphs, using the atlas if possible.
+     *
+     * If the kerning is not cached, it is computed directly.
+     *
+     * @param a     The first character in the pair
+     * @param b     The second character in the pair
+     *
+     * @return the kerning between two glyphs, using the atlas if possible.
+     */
+    int glyphKerning(Uint32 a, Uint32 b) const;
+    
+    /**
+     * Returns true if the glyph is available in the atlas.
+     *
+     * If the atlas is dynamic, this method will rasterize the glyph if it is
+     * not already present, growing the atlas or evicting old glyphs to make
+     * room. It also marks the glyph as recently used. This method returns
+     * false if the glyph is not in the font or there is no room for it.
+     *
+     * @param thechar   The character to cache
+     *
+     * @return true if the glyph is available in the atlas.
+     */
+    bool cacheGlyph(Uint32 thechar);
+    
+    /**
+     * Returns the index of a shelf with room for a glyph of the given size.
+     *
+     * This method will start a new shelf if there is room in the atlas.
+     * It returns -1 if there is no room.
+     *
+     * @param width     The glyph width (including border)
+     * @param height    The glyph height (including border)
+     *
+     * @return the index of a shelf with room for a glyph of the given size.
+     */
+    int findShelf(int width, int height);
+    
+    /**
+     * Returns the index of an emptied shelf that can fit the given glyph.
+     *
+     * This method empties the least recently used shelf, provided that it
+     * was not used by the current string. It returns -1 if no shelf may
+     * be evicted.
+     *
+     * @param width     The glyph width (including border)
+     * @param height    The glyph height (including border)
+     *
+     * @return the index of an emptied shelf that can fit the given glyph.
+     */
+    int evictShelf(int width, int height);
+    
+    /**
+     * Returns true if the dynamic atlas was able to grow.
+     *
+     * The atlas doubles its smaller dimension (provided that it does not
+     * exceed the maximum size). All glyphs keep their pixel positions, but
+     * their texture coordinates change.
+     *
+     * @return true if the dynamic atlas was able to grow.
+     */
+    bool growAtlas();
+    
+    /**
+     * Recreates the dynamic atlas texture, uploading all cached glyphs.
+     */
+    void refreshAtlas();
+    
+    /**
+     * Rasterizes the given glyph and uploads it to the dynamic atlas texture.
+     *
+     * Only the region for this glyph is uploaded to the texture.
+     *
+     * @param thechar   The character to upload
+     */
+    void uploadGlyph(Uint32 thechar);
 };
     
 #pragma mark -
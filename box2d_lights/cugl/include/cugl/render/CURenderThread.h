@@ -0,0 +1,315 @@
+//
+//  CURenderThread.h
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides a singleton for a dedicated OpenGL thread. When it is
+//  active, the OpenGL context belongs to this thread and not the main thread.
+//  The rendering classes (SpriteBatch, VertexBuffer, Shader, Texture, and so
+//  on) record their OpenGL calls into a command list instead of executing
+//  them. At the end of each frame, the display submits this list to the GL
+//  thread, which replays it while the main thread updates the next frame.
+//
+//  The command lists are double buffered. The main thread records into one
+//  list while the GL thread replays the other. Submitting a frame only blocks
+//  if the GL thread has not yet finished the previous frame.
+//
+//  Because this class is a singleton, there are no publicly accessible
+//  constructors or intializers.  Use the static methods instead. If the
+//  singleton is never started, all commands execute immediately on the
+//  calling thread, exactly as they did without this class.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Walker White
+//  Version: 5/12/21
+//
+#ifndef __CU_RENDER_THREAD_H__
+#define __CU_RENDER_THREAD_H__
+#include <cugl/base/CUBase.h>
+#include <SDL/SDL.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace cugl {
+
+/**
+ * This class is a singleton representing a dedicated OpenGL thread.
+ *
+ * By default, CUGL makes all OpenGL calls on the main thread, from inside of
+ * the draw method of the application. Starting this singleton moves the
+ * OpenGL context to a new thread. From then on, OpenGL calls in the rendering
+ * classes are recorded into a command list with {@link post}, and the method
+ * {@link Display#refresh} submits that list to the GL thread. The GL thread
+ * replays frame N while the main thread updates and records frame N+1.
+ *
+ * There are two command lists. The main thread records into the back list,
+ * while the GL thread replays the front list. The method {@link submit} waits
+ * for the front list to finish, and then swaps the two. So the main thread is
+ * never more than one frame ahead of the GL thread.
+ *
+ * Any OpenGL call that returns a value (such as creating a texture or getting
+ * the location of a uniform) cannot be deferred. These calls should use the
+ * method {@link call} instead. This submits everything recorded so far and
+ * blocks until the command is complete. Hence every OpenGL call happens in
+ * the same order as it would on the main thread. But these calls stall the
+ * pipeline and should be kept out of the draw loop.
+ *
+ * A recorded command must not read any state that the main thread might
+ * change before the command is replayed. Commands should capture the values
+ * (such as the OpenGL ids) that they need, and must copy any data that the
+ * caller is free to reuse.
+ *
+ * Only the main thread may record commands. If the singleton has not been
+ * started, {@link post} and {@link call} simply execute their command. The
+ * same is true when they are called on the GL thread itself.
+ *
+ * Not all platforms allow the OpenGL context to move off of the main thread.
+ * If the GL thread cannot acquire the context, {@link start} returns false
+ * and rendering continues on the main thread.
+ */
+class RenderThread {
+#pragma mark Values
+private:
+    /** The render thread singleton */
+    static RenderThread* _thethread;
+
+    /** The thread that replays the commands */
+    SDL_Thread* _thread;
+    /** The identifier of the GL thread */
+    SDL_threadID _threadid;
+    /** The window of the OpenGL context */
+    SDL_Window* _window;
+    /** The OpenGL context transferred to the GL thread */
+    SDL_GLContext _context;
+
+    /** The command list recorded by the main thread */
+    std::vector<std::function<void()>> _record;
+    /** The command list replayed by the GL thread */
+    std::vector<std::function<void()>> _replay;
+
+    /** A mutex lock for the replay list */
+    std::mutex _mutex;
+    /** A condition variable to signal the state of the replay list */
+    std::condition_variable _condition;
+
+    /** Whether the replay list has been submitted, but not yet replayed */
+    bool _pending;
+    /** Whether the GL thread has been marked for shutdown */
+    bool _stop;
+    /** The startup status of the GL thread (0 = waiting, 1 = ok, -1 = failed) */
+    int _status;
+
+#pragma mark -
+#pragma mark Constructors
+    /**
+     * Creates a render thread without an active thread.
+     *
+     * WARNING: This class is a singleton.  You should never access this
+     * constructor directly.  Use the {@link start()} method instead.
+     */
+    RenderThread();
+
+    /**
+     * Deletes this render thread, disposing all resources.
+     */
+    ~RenderThread() { dispose(); }
+
+    /**
+     * Initializes the GL thread, moving the current OpenGL context to it.
+     *
+     * This method must be called on the main thread while it owns the
+     * OpenGL context. If the GL thread cannot acquire the context, the
+     * context is restored to the main thread and this method returns false.
+     *
+     * WARNING: This class is a singleton.  You should never access this
+     * initializer directly.  Use the {@link start()} method instead.
+     *
+     * @return true if the GL thread acquired the OpenGL context
+     */
+    bool init();
+
+    /**
+     * Stops the GL thread, returning the OpenGL context to the main thread.
+     *
+     * Any commands recorded are replayed before the thread stops.
+     *
+     * WARNING: This class is a singleton.  You should never access this
+     * method directly.  Use the {@link stop()} method instead.
+     */
+    void dispose();
+
+    /**
+     * The body function of the GL thread.
+     *
+     * This function acquires the OpenGL context and replays each command
+     * list as it is submitted.
+     *
+     * @param ptr   The render thread singleton
+     *
+     * @return the thread exit status
+     */
+    static int sdlThreadFunc(void* ptr);
+
+public:
+#pragma mark Static Accessors
+    /**
+     * Starts the render thread singleton, moving OpenGL to a new thread.
+     *
+     * This method must be called on the main thread after the {@link Display}
+     * has started. Once this method is called, the {@link get()} method will
+     * no longer return nullptr, and all rendering classes will record their
+     * OpenGL calls instead of executing them.
+     *
+     * If the platform does not allow the OpenGL context to change threads,
+     * this method returns false and all OpenGL calls stay on the main thread.
+     *
+     * @return true if the GL thread was successfully started
+     */
+    static bool start();
+
+    /**
+     * Stops the render thread singleton, returning OpenGL to the main thread.
+     *
+     * Any commands recorded are replayed before the thread stops. This method
+     * must be called before the {@link Display} is stopped.
+     *
+     * Once this method is called, the {@link get()} method will return nullptr.
+     */
+    static void stop();
+
+    /**
+     * Returns the render thread singleton.
+     *
+     * If the render thread has not been started, then this method will
+     * return nullptr.
+     *
+     * @return the render thread singleton.
+     */
+    static RenderThread* get() { return _thethread; }
+
+    /**
+     * Records an OpenGL command to replay on the GL thread.
+     *
+     * If the render thread is not active, or if this method is called on the
+     * GL thread, the command is executed immediately. Otherwise it will be
+     * executed after the next call to {@link submit}.
+     *
+     * The command must capture every value that it uses by copy. It must not
+     * refer to any state that may change before the frame is replayed.
+     *
+     * @param cmd   The OpenGL command to execute
+     */
+    template <typename F>
+    static void post(F&& cmd) {
+        if (_thethread == nullptr || _thethread->isRenderThread()) {
+            cmd();
+        } else {
+            _thethread->record(std::function<void()>(std::forward<F>(cmd)));
+        }
+    }
+
+    /**
+     * Executes an OpenGL command on the GL thread, waiting for it to finish.
+     *
+     * If the render thread is not active, or if this method is called on the
+     * GL thread, the command is executed immediately. Otherwise this method
+     * submits all of the commands recorded so far, together with this one,
+     * and blocks until they are complete.
+     *
+     * This method is for OpenGL calls that return a value, such as resource
+     * creation or state queries. As the command is complete when this method
+     * returns, it may capture local variables by reference. But this method
+     * stalls the pipeline and should not be used in the draw loop.
+     *
+     * @param cmd   The OpenGL command to execute
+     */
+    template <typename F>
+    static void call(F&& cmd) {
+        if (_thethread == nullptr || _thethread->isRenderThread()) {
+            cmd();
+        } else {
+            _thethread->invoke(std::function<void()>(std::forward<F>(cmd)));
+        }
+    }
+
+#pragma mark -
+#pragma mark Command Lists
+    /**
+     * Returns true if the caller is the GL thread.
+     *
+     * @return true if the caller is the GL thread.
+     */
+    bool isRenderThread() const { return SDL_ThreadID() == _threadid; }
+
+    /**
+     * Appends a command to the list currently being recorded.
+     *
+     * This method may only be called on the main thread. The command is
+     * not executed until the next call to {@link submit}.
+     *
+     * @param cmd   The OpenGL command to record
+     */
+    void record(std::function<void()>&& cmd);
+
+    /**
+     * Submits the recorded commands to the GL thread.
+     *
+     * This method waits for the GL thread to finish the previously submitted
+     * list, and then swaps the two command lists. It returns as soon as the
+     * GL thread has been signaled, so the main thread may immediately start
+     * recording the next frame. This method is called by {@link Display#refresh}.
+     */
+    void submit();
+
+    /**
+     * Blocks until the GL thread has replayed every submitted command.
+     *
+     * This does not submit any commands that have been recorded, but not
+     * yet submitted.
+     */
+    void finish();
+
+    /**
+     * Executes a command on the GL thread, waiting for it to finish.
+     *
+     * This method submits all of the commands recorded so far, together with
+     * this one, and blocks until they are complete.
+     *
+     * @param cmd   The OpenGL command to execute
+     */
+    void invoke(std::function<void()>&& cmd);
+
+    /**
+     * Returns the number of commands recorded since the last submission.
+     *
+     * @return the number of commands recorded since the last submission.
+     */
+    size_t getRecorded() const { return _record.size(); }
+
+private:
+    /** This class is a singleton and may not be copied */
+    CU_DISALLOW_COPY_AND_ASSIGN(RenderThread);
+};
+
+}
+
+#endif /* __CU_RENDER_THREAD_H__ */
@@ -51,6 +51,7 @@
 #include <cugl/math/cu_math.h>
 #include <cugl/render/CUTexture.h>
 #include <cugl/render/CUUniformBuffer.h>
+#include <cugl/render/CURenderThread.h>
 
 // We use raw string literals for shaders, but we need to prefix by system.
 #if CU_GL_PLATFORM == CU_GL_OPENGLES
@@ -63,6 +64,120 @@
 #pragma mark -
 namespace cugl {
 
+/**
+ * This class is a typed handle to a uniform variable in a {@link Shader}.
+ *
+ * Looking up a uniform by name requires a string lookup every time. A handle
+ * stores the location of the uniform, so render code can acquire it once
+ * (with {@link Shader#getUniformHandle}) and keep it. The handle also keeps
+ * the last value that it uploaded, and skips any upload of an identical value.
+ *
+ * This cache assumes that the handle is the only way the uniform is set. If
+ * the uniform is set by another means (such as the setters in {@link Shader}),
+ * call {@link #invalidate} to force the next upload.
+ *
+ * The supported types are GLint, GLuint, GLfloat, {@link Vec2}, {@link Vec3},
+ * {@link Vec4}, {@link Color4f}, and {@link Mat4}.
+ */
+template <typename T>
+class UniformHandle {
+private:
+    /** The location of the uniform in the shader program (-1 if invalid) */
+    GLint _location;
+    /** The last value uploaded */
+    T _value;
+    /** Whether _value agrees with the shader program */
+    bool _cached;
+    
+    /** Uploads an int value to the given location */
+    static void upload(GLint pos, GLint value) {
+        RenderThread::post([=] { glUniform1i(pos, value); });
+    }
+    /** Uploads an unsigned int value to the given location */
+    static void upload(GLint pos, GLuint value) {
+        RenderThread::post([=] { glUniform1ui(pos, value); });
+    }
+    /** Uploads a float value to the given location */
+    static void upload(GLint pos, GLfloat value) {
+        RenderThread::post([=] { glUniform1f(pos, value); });
+    }
+    /** Uploads a vec2 value to the given location */
+    static void upload(GLint pos, const Vec2& value) {
+        RenderThread::post([=] { glUniform2f(pos, value.x, value.y); });
+    }
+    /** Uploads a vec3 value to the given location */
+    static void upload(GLint pos, const Vec3& value) {
+        RenderThread::post([=] { glUniform3f(pos, value.x, value.y, value.z); });
+    }
+    /** Uploads a vec4 value to the given location */
+    static void upload(GLint pos, const Vec4& value) {
+        RenderThread::post([=] { glUniform4f(pos, value.x, value.y, value.z, value.w); });
+    }
+    /** Uploads a color value to the given location */
+    static void upload(GLint pos, const Color4f& value) {
+        RenderThread::post([=] { glUniform4f(pos, value.r, value.g, value.b, value.a); });
+    }
+    /** Uploads a matrix value to the given location */
+    static void upload(GLint pos, const Mat4& value) {
+        RenderThread::post([=] { glUniformMatrix4fv(pos, 1, false, value.m); });
+    }
+    
+public:
+    /**
+     * Creates an invalid uniform handle.
+     *
+     * Setting the value of an invalid handle has no effect.
+     */
+    UniformHandle() : _location(-1), _value(), _cached(false) {}
+    
+    /**
+     * Creates a uniform handle for the given location.
+     *
+     * @param location  The location of the uniform in the shader program
+     */
+    UniformHandle(GLint location) : _location(location), _value(), _cached(false) {}
+    
+    /**
+     * Returns true if this handle refers to an active uniform.
+     *
+     * @return true if this handle refers to an active uniform.
+     */
+    bool isValid() const { return _location >= 0; }
+    
+    /**
+     * Returns the location of the uniform in the shader program.
+     *
+     * @return the location of the uniform in the shader program.
+     */
+    GLint getLocation() const { return _location; }
+    
+    /**
+     * Forces the next call to {@link #set} to upload its value.
+     */
+    void invalidate() { _cached = false; }
+    
+    /**
+     * Sets the uniform to the given value.
+     *
+     * The value is only uploaded if it differs from the last value set by
+     * this handle. This method will only succeed if the shader is actively
+     * bound.
+     *
+     * @param value The value to set
+     *
+     * @return true if the value was uploaded to the shader
+     */
+    bool set(const T& value) {
+        if (_location < 0 || (_cached && _value == value)) {
+            return false;
+        }
+        _value  = value;
+        _cached = true;
+        upload(_location, value);
+        return true;
+    }
+};
+
 /**
  * This class defines a GLSL shader.
  *
@@ -142,12 +257,19 @@ protected:
     std::unordered_map<GLint,std::string>   _uniformnames;
     /** The uniform locations of this shader (includes samplers) */
     std::unordered_map<std::string, GLint>  _uniformsizes;
+    /** The cached uniform locations, by name (arrays also by their base name) */
+    std::unordered_map<std::string, GLint>  _uniformlocs;
     /** The uniform block variable names for this shader */
     std::unordered_map<GLint,std::string>   _uniblocknames;
     /** The uniform block locations of this shader */
     std::unordered_map<std::string, GLint>  _uniblocksizes;
     /** Mappings of uniforms to a uniform block */
     std::unordered_map<GLint, GLint>        _uniblockfields;
+    
+    /** The directory for cached program binaries (empty if disabled) */
+    static std::string _binarydir;
+    /** The program most recently bound by this class (tracked on the main thread) */
+    static GLuint _bound;
 
     
 #pragma mark -
@@ -196,6 +318,37 @@ private:
      */
     static void logProgramError(GLuint shader);
     
+    /**
+     * Returns the file storing the program binary for this shader.
+     *
+     * The file name is a hash of the shader sources and the OpenGL driver
+     * (vendor, renderer, and version). Hence a driver update invalidates
+     * all previously cached binaries. This method returns the empty string
+     * if the binary cache is disabled.
+     *
+     * @return the file storing the program binary for this shader.
+     */
+    std::string getBinaryFile() const;
+    
+    /**
+     * Returns true if this shader was loaded from a cached program binary.
+     *
+     * This method creates the shader program on success. If the binary is
+     * missing or is rejected by the driver, this method returns false and
+     * leaves the shader uncompiled.
+     *
+     * @return true if this shader was loaded from a cached program binary.
+     */
+    bool loadBinary();
+    
+    /**
+     * Saves the linked shader program to the binary cache.
+     *
+     * If the binary cache is disabled, or the driver does not support
+     * program binaries, this method does nothing.
+     */
+    void saveBinary();
+    
     /**
      * Querys all of the shader attributes and caches them for fast look-ups
      */
@@ -262,6 +415,35 @@ public:
         return (result->init(vsource, fsource) ? result : nullptr);
     }
 
+    
+#pragma mark -
+#pragma mark Binary Cache
+    /**
+     * Sets the directory for caching linked program binaries.
+     *
+     * When this directory is set, every shader first looks for a program
+     * binary matching its sources and the current OpenGL driver. If one
+     * exists and the driver accepts it, the shader skips compilation.
+     * Otherwise, the shader compiles from source and saves the linked
+     * binary for the next launch.
+     *
+     * The directory is created if it does not exist. Setting the directory
+     * to the empty string disables the cache. By default, {@link Application}
+     * sets this to a subdirectory of the save directory.
+     *
+     * @param dir   The directory for caching linked program binaries
+     */
+    static void setBinaryCache(const std::string dir);
+    
+    /**
+     * Returns the directory for caching linked program binaries.
+     *
+     * If this value is the empty string, the binary cache is disabled.
+     *
+     * @return the directory for caching linked program binaries.
+     */
+    static const std::string& getBinaryCache() { return _binarydir; }
+
 
 #pragma mark -
 #pragma mark Binding
@@ -292,6 +474,10 @@ public:
      *
      * Any OpenGL calls will be sent to this shader only if it is bound.
      *
+     * If the {@link RenderThread} is active, the OpenGL state may be a frame
+     * behind the main thread. In that case, this method answers for the
+     * commands recorded so far instead of querying OpenGL.
+     *
      * @return true if this shader is currently bound.
      */
     bool isBound() const;
@@ -411,11 +597,33 @@ public:
      *
      * If name is not a valid uniform, this method returns -1.
      *
+     * The uniform locations are cached when the shader is compiled, so this
+     * method does not query OpenGL (except for array elements other than
+     * the first).
+     *
      * @param name  The uniform variable name
      *
      * @return the program offset of the given uniform
      */
-    GLint getUniformLocation(const std::string name) const;
+    GLint getUniformLocation(const std::string& name) const;
+    
+    /**
+     * Returns a typed handle for the given uniform
+     *
+     * The handle should be acquired once and kept by the render code, as
+     * it caches both the location and the last value set. The handle is
+     * only valid until the shader is recompiled or disposed.
+     *
+     * If name is not a valid uniform, the handle returned is invalid.
+     *
+     * @param name  The uniform variable name
+     *
+     * @return a typed handle for the given uniform
+     */
+    template <typename T>
+    UniformHandle<T> getUniformHandle(const std::string& name) const {
+        return UniformHandle<T>(getUniformLocation(name));
+    }
 
     /**
      * Returns the size (in bytes) of the given uniform
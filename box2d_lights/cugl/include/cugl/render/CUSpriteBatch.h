@@ -50,23 +50,29 @@
 #include <vector>
 #include "CUSpriteVertex.h"
 #include "CUMesh.h"
+#include "CUScissor.h"
+#include "CUShader.h"
 #include <cugl/math/CUMathBase.h>
 #include <cugl/math/CUMat4.h>
 #include <cugl/math/CUColor4.h>
 
 // Default memory sizes
 #define DEFAULT_CAPACITY  8192
+// Number of full batches held by the vertex streaming ring
+#define DEFAULT_STREAM_RING  3
+// Number of textures bound at once for multitexture batching (see SpriteShader.frag)
+#define DEFAULT_TEXTURE_UNITS  8
+// Default scissor stack depth
+#define DEFAULT_SCISSOR_DEPTH  8
 
 namespace cugl {
 
 /** Forward references */
 class VertexBuffer;
 class UniformBuffer;
-class Shader;
 class Affine2;
 class Texture;
 class Gradient;
-class Scissor;
 class Rect;
 class Poly2;
     
@@ -142,6 +148,16 @@ private:
          */
         ~Context();
         
+        /**
+         * Sets this context to be a copy of the given uniforms
+         *
+         * This method allows a context to be reused without reallocation.
+         * Like the copy constructor, it clears the dirty bits.
+         *
+         * @param copy  The uniforms to copy
+         */
+        void set(const Context* copy);
+        
         /** The first vertex index position for this set of uniforms */
         GLuint first;
         /** The last vertex index position for this set of uniforms */
@@ -162,6 +178,8 @@ private:
         std::shared_ptr<Mat4> perspective;
         /** The stored texture */
         std::shared_ptr<Texture> texture;
+        /** The texture unit of the stored texture (multitexture batching only) */
+        GLint texslot;
         /** The stored block offset for gradient and scissor */
         GLsizei blockptr;
         /** The pixel step for our blur function */
@@ -174,6 +192,8 @@ private:
     bool _initialized;
     /** Whether this sprite batch is currently active */
     bool _active;
+    /** The number of drawing passes started by this sprite batch */
+    Uint64 _passes;
     
     /** The shader for this sprite batch */
     std::shared_ptr<Shader> _shader;
@@ -200,8 +220,32 @@ private:
     Context* _context;
     /** Whether the current context has been used. */
     bool _inflight;
-    /** The drawing context history */
+    /**
+     * The drawing context history
+     *
+     * This is a command list that is replayed on each flush. The contexts
+     * are reused from flush to flush, so only the first {@link _histSize}
+     * entries are recorded. The rest are spares.
+     */
     std::vector<Context*> _history;
+    /** The number of recorded contexts in the history */
+    size_t _histSize;
+    /** The first vertex of the active drawing context */
+    unsigned int _vertMark;
+    
+    /** The number of texture units for batching (1 if the shader does not support it) */
+    GLuint _texUnits;
+    /** The textures assigned to each texture unit in the current batch */
+    std::vector<std::shared_ptr<Texture>> _texSlots;
+    /** The number of texture units in use in the current batch */
+    GLuint _texCount;
+    
+    /** The handle for the shader draw type */
+    UniformHandle<GLint> _uType;
+    /** The handle for the shader perspective matrix */
+    UniformHandle<Mat4>  _uPerspective;
+    /** The handle for the shader blur offsets */
+    UniformHandle<Vec2>  _uBlur;
     
     /** The active color */
     Color4f _color;
@@ -210,8 +254,24 @@ private:
     
     /** The active gradient */
     std::shared_ptr<Gradient> _gradient;
-    /** The active scissor mask */
-    std::shared_ptr<Scissor>  _scissor;
+    /** The active scissor mask (if _hasScissor is true) */
+    Scissor _scissor;
+    /** Whether there is an active scissor mask */
+    bool _hasScissor;
+    
+    /**
+     * A saved scissor state for {@link #pushScissor}.
+     */
+    struct ScissorFrame {
+        /** The saved scissor mask */
+        Scissor mask;
+        /** Whether the saved scissor mask was active */
+        bool active;
+    };
+    /** The scissor stack (preallocated, and never shrunk) */
+    std::vector<ScissorFrame> _scissorStack;
+    /** The number of saved states in the scissor stack */
+    size_t _scissorDepth;
 
     // Monitoring values
     /** The number of vertices drawn in this pass (so far) */
@@ -464,6 +524,18 @@ public:
      */
     bool isDrawing() const { return _active; }
 
+    /**
+     * Returns a stamp identifying the current (or most recent) drawing pass.
+     *
+     * This value increments whenever begin() is called, and is never 0.
+     * Shared resources that are updated in place, such as a dynamic
+     * {@link Font} atlas, can use it to tell which data may still be
+     * referenced by vertices that have not yet been flushed.
+     *
+     * @return a stamp identifying the current (or most recent) drawing pass.
+     */
+    Uint64 getFrameStamp() const { return _passes; }
+
     /**
      * Returns the number of vertices drawn in the latest pass (so far).
      *
@@ -644,9 +716,70 @@ public:
      * This method returns a copy of the internal scissor. Changes to this
      * object have no effect on the sprite batch.
      *
+     * This method allocates a new scissor mask on every call. Code that runs
+     * every frame should use {@link #hasScissor} and {@link #getActiveScissor}
+     * instead.
+     *
      * @return The active scissor mask for this sprite batch
      */
     std::shared_ptr<Scissor> getScissor() const;
+
+    /**
+     * Returns true if this sprite batch has an active scissor mask
+     *
+     * @return true if this sprite batch has an active scissor mask
+     */
+    bool hasScissor() const { return _hasScissor; }
+
+    /**
+     * Returns a reference to the active scissor mask of this sprite batch
+     *
+     * This method does not allocate any memory. The value is only meaningful
+     * if {@link #hasScissor} is true. The reference is invalidated by any
+     * change to the scissor state of this sprite batch.
+     *
+     * @return a reference to the active scissor mask of this sprite batch
+     */
+    const Scissor& getActiveScissor() const { return _scissor; }
+    
+    /**
+     * Pushes a scissor mask on to the scissor stack of this sprite batch
+     *
+     * The scissor mask is first transformed by the given matrix. If there
+     * is an active scissor mask, the result is intersected with it (in the
+     * coordinate space of the active mask). Otherwise, the transformed mask
+     * is used as is. The result becomes the new active scissor mask, and the
+     * previous state is restored with {@link #popScissor}.
+     *
+     * Unlike {@link #setScissor}, this method does not allocate any memory
+     * once the stack has reached its working depth. Hence it is the preferred
+     * way to nest scissor masks, such as in a scene graph.
+     *
+     * @param scissor   The scissor mask to push
+     * @param transform The transform to apply to the scissor mask
+     */
+    void pushScissor(const Scissor& scissor, const Mat4& transform);
+
+    /**
+     * Pushes a scissor mask on to the scissor stack of this sprite batch
+     *
+     * This version uses the scissor mask as is, with its current transform.
+     * Otherwise it is the same as {@link #pushScissor(const Scissor&,const Mat4&)}.
+     * If there is an active scissor mask, the result is intersected with it.
+     * The previous state is restored with {@link #popScissor}.
+     *
+     * @param scissor   The scissor mask to push
+     */
+    void pushScissor(const Scissor& scissor);
+    
+    /**
+     * Restores the scissor mask active before the last call to {@link #pushScissor}
+     *
+     * Any changes made with {@link #setScissor} since the last push are
+     * discarded as well. It is an error to call this method when the
+     * scissor stack is empty.
+     */
+    void popScissor();
     
     /**
      * Sets the blending function for this sprite batch
@@ -1106,6 +1239,27 @@ public:
      */
     void fill(const Mesh<SpriteVertex3>& mesh, const Mat4& transform, bool tint = true);
 
+    /**
+     * Fills the given mesh with the current texture and/or gradient.
+     *
+     * The mesh vertices must already be in world space (e.g. the mesh was
+     * transformed ahead of time). They are copied into the buffer as is,
+     * which makes this the fastest way to draw a mesh that does not change
+     * from frame to frame. This method will use the depth of each vertex
+     * and ignore the sprite batch depth.
+     *
+     * The triangulation will be determined by the mesh indices. If necessary,
+     * these can be generated via one of the triangulation factories
+     * {@link SimpleTriangulator} or {@link ComplexTriangulator}.
+     *
+     * The mesh vertices use their own color values.  However, if tint is true,
+     * these values will be tinted (i.e. multiplied) by the current active color.
+     *
+     * @param mesh      The sprite mesh in world space
+     * @param tint      Whether to tint with the active color
+     */
+    void fill(const Mesh<SpriteVertex3>& mesh, bool tint = true);
+
 
 #pragma mark -
 #pragma mark Outlines
@@ -1364,6 +1518,23 @@ public:
      */
     void outline(const Mesh<SpriteVertex3>& mesh, const Mat4& transform, bool tint = true);
 
+    /**
+     * Outlines the given mesh with the current texture and/or gradient.
+     *
+     * The mesh vertices must already be in world space (e.g. the mesh was
+     * transformed ahead of time). They are copied into the buffer as is,
+     * which makes this the fastest way to draw a mesh that does not change
+     * from frame to frame. This method will use the depth of each vertex
+     * and ignore the sprite batch depth.
+     *
+     * The mesh vertices use their own color values.  However, if tint is true,
+     * these values will be tinted (i.e. multiplied) by the current active color.
+     *
+     * @param mesh      The sprite mesh in world space
+     * @param tint      Whether to tint with the active color
+     */
+    void outline(const Mesh<SpriteVertex3>& mesh, bool tint = true);
+
 
 #pragma mark -
 #pragma mark Convenience Methods
@@ -1894,12 +2065,44 @@ private:
     void record();
     
     /**
-     * Deletes the recorded uniforms.
+     * Clears the recorded uniforms.
      *
-     * This method is called upon flushing or cleanup.
+     * This method is called upon flushing. The contexts are kept for reuse
+     * by the next call to {@link record}, but release their textures.
      */
     void unwind();
     
+    /**
+     * Returns the texture unit for the given texture in the current batch.
+     *
+     * This method is only used for multitexture batching. If the texture
+     * (or its parent) is not yet assigned to a texture unit, it is assigned
+     * to the next free one. If there are no free units, the sprite batch
+     * flushes before assigning it.
+     *
+     * @param texture   The texture to assign
+     *
+     * @return the texture unit for the given texture in the current batch.
+     */
+    GLint acquireTextureSlot(const std::shared_ptr<Texture>& texture);
+    
+    /**
+     * Configures multitexture batching for the active shader.
+     *
+     * Multitexture batching is enabled if the shader has the sampler array
+     * uTextures and the vertex attribute aTexSlot. Otherwise, the sprite
+     * batch binds a single texture at a time.
+     */
+    void setupTextureUnits();
+    
+    /**
+     * Acquires the uniform handles for the active shader.
+     *
+     * The handles skip any upload of a value the shader already has.
+     * They must be reacquired whenever the shader changes.
+     */
+    void setupUniforms();
+    
     /**
      * Sets the active uniform block to agree with the gradient and stroke.
      *
@@ -2107,6 +2310,23 @@ private:
      */
     unsigned int chunkify(const Mesh<SpriteVertex3>& mesh, const Mat4& mat, bool tint = true);
 
+    /**
+     * Returns the number of vertices added to the drawing buffer.
+     *
+     * This method adds the given mesh (both vertices and indices) to the
+     * vertex buffer, but does not draw it.  The vertices are already in
+     * world space, so they are copied without a transform. You must call
+     * {@link #flush} or {@link #end} to draw the complete mesh. This method
+     * will automatically flush if the maximum number of vertices (or uniform
+     * blocks) is reached.
+     *
+     * @param mesh  The mesh to add to the buffer
+     * @param tint  Whether to tint with the active color
+     *
+     * @return the number of vertices added to the drawing buffer.
+     */
+    unsigned int prepare(const Mesh<SpriteVertex3>& mesh, bool tint);
+
 };
 
 }
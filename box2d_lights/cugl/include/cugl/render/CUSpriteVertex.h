@@ -88,6 +88,8 @@ public:
     cugl::Vec4 color;
     /** The vertex texture coordinate */
     cugl::Vec2 texcoord;
+    /** The vertex texture unit (assigned by the {@link SpriteBatch}) */
+    GLfloat texslot;
 
     /** The memory offset of the vertex position */
     static const GLvoid* positionOffset()   { return (GLvoid*)offsetof(SpriteVertex2, position);  }
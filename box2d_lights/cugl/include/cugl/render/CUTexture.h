@@ -46,6 +46,7 @@
 #define _CU_TEXTURE_H__
 #include <cugl/math/CUMathBase.h>
 #include <cugl/math/CUSize.h>
+#include <cugl/render/CUCompressedImage.h>
 
 namespace cugl {
 
@@ -199,6 +200,22 @@ private:
     
     /** Whether the algorithm or wrap-style has changed. */
     bool _dirty;
+
+    /** The compressed internal format (0 if the texture is not compressed) */
+    GLenum _compressed;
+    
+    /**
+     * Applies the given texture parameter if this texture is active.
+     *
+     * Whether or not the texture is active is only known to the thread that
+     * owns the OpenGL context (see {@link RenderThread}). Therefore, this
+     * method also marks the texture as dirty, so that the parameter is
+     * applied the next time the texture is bound.
+     *
+     * @param pname The texture parameter
+     * @param value The parameter value
+     */
+    void setParameter(GLenum pname, GLint value);
     
 #pragma mark -
 #pragma mark Constructors
@@ -270,6 +287,9 @@ public:
      *
      * This method can load any file format supported by SDL_Image. This
      * includes (but is not limited to) PNG, JPEG, GIF, TIFF, BMP and PCX.
+     * It also loads KTX and KTX2 files with GPU compressed data.  If the driver
+     * does not support the compression format, ETC data is decompressed
+     * to RGBA in software.
      *
      * The texture will be stored in RGBA format, even if it is a file format
      * that does not support transparency (e.g. JPEG).
@@ -284,6 +304,24 @@ public:
      */
     bool initWithFile(const std::string filename);
 
+    /**
+     * Initializes a texture with the given compressed image.
+     *
+     * Initializing a texture requires the use of the binding point at 0. Any 
+     * texture bound to that point will be unbound. In addition, once 
+     * initialization is done, this texture will not longer be bound as well.
+     *
+     * The compressed data is uploaded directly to the GPU, together with
+     * any mipmaps in the image.  The driver must support the compression
+     * format (see {@link CompressedImage#isSupported}). A compressed texture
+     * cannot be modified with the set() methods, and it cannot build mipmaps.
+     *
+     * @param image     The compressed image
+     *
+     * @return true if initialization was successful.
+     */
+    bool initWithCompressed(const std::shared_ptr<CompressedImage>& image);
+
     
 #pragma mark -
 #pragma mark Static Constructors
@@ -340,6 +378,9 @@ public:
      *
      * This method can load any file format supported by SDL_Image.  This
      * includes (but is not limited to) PNG, JPEG, GIF, TIFF, BMP and PCX.
+     * It also loads KTX and KTX2 files with GPU compressed data.  If the driver
+     * does not support the compression format, ETC data is decompressed
+     * to RGBA in software.
      *
      * The texture will be stored in RGBA format, even if it is a file format
      * that does not support transparency (e.g. JPEG).
@@ -352,6 +393,27 @@ public:
         std::shared_ptr<Texture> result = std::make_shared<Texture>();
         return (result->initWithFile(filename) ? result : nullptr);
     }
+
+    /**
+     * Returns a new texture with the given compressed image.
+     *
+     * Allocating a texture requires the use of the binding point at 0. Any 
+     * texture bound to that point will be unbound. In addition, once 
+     * allocation is done, this texture will not longer be bound as well.
+     *
+     * The compressed data is uploaded directly to the GPU, together with
+     * any mipmaps in the image.  The driver must support the compression
+     * format (see {@link CompressedImage#isSupported}). A compressed texture
+     * cannot be modified with the set() methods, and it cannot build mipmaps.
+     *
+     * @param image     The compressed image
+     *
+     * @return a new texture with the given compressed image
+     */
+    static std::shared_ptr<Texture> allocWithCompressed(const std::shared_ptr<CompressedImage>& image) {
+        std::shared_ptr<Texture> result = std::make_shared<Texture>();
+        return (result->initWithCompressed(image) ? result : nullptr);
+    }
     
     /**
      * Returns a blank texture that can be used to make solid shapes.
@@ -405,6 +467,26 @@ public:
      * @return a reference to this (modified) texture for chaining.
      */
     const Texture& set(const void *data);
+    
+    /**
+     * Sets a rectangular region of this texture to the contents of the buffer.
+     *
+     * The buffer must have the correct data format. In addition, the buffer
+     * must be size width*height*bytesize, with no padding between rows. The
+     * region is specified in pixels, with the origin at the start of the
+     * texture data (the first row).
+     *
+     * This method is only successful if the texture is currently active.
+     *
+     * @param data      The buffer to read into the texture
+     * @param x         The x-coordinate of the region
+     * @param y         The y-coordinate of the region
+     * @param width     The width of the region
+     * @param height    The height of the region
+     *
+     * @return a reference to this (modified) texture for chaining.
+     */
+    const Texture& set(const void *data, int x, int y, int width, int height);
 
     
 #pragma mark -
@@ -644,6 +726,25 @@ public:
      */
     bool isSubTexture() const { return _parent != nullptr; }
 
+    /**
+     * Returns true if this texture stores GPU compressed data.
+     *
+     * A compressed texture cannot be modified with the set() methods, and
+     * it cannot build mipmaps.
+     *
+     * @return true if this texture stores GPU compressed data.
+     */
+    bool isCompressed() const { return _compressed != 0; }
+
+    /**
+     * Returns the compressed internal format of this texture.
+     *
+     * If this texture is not compressed, this method returns 0.
+     *
+     * @return the compressed internal format of this texture.
+     */
+    GLenum getCompressedFormat() const { return _compressed; }
+
     /**
      * Returns the minimum S texture coordinate for this texture.
      *
@@ -751,6 +852,19 @@ public:
      */
     void bind();
     
+    /**
+     * Binds this texture to the given texture unit, making it active.
+     *
+     * This method is the same as {@link #bind}, except that it ignores the
+     * bind point of this texture. It allows a {@link SpriteBatch} to bind
+     * several textures at once without reassigning their bind points.
+     *
+     * This call is reentrant. If can be safely called multiple times.
+     *
+     * @param unit  The texture unit to bind to
+     */
+    void bindToUnit(GLuint unit);
+    
     /**
      * Unbinds this texture, making it neither bound nor active.
      *
@@ -106,6 +106,21 @@ private:
     std::unordered_map<std::string, GLsizei> _offsets;
     /** The decriptive buffer name */
     std::string _name;
+    
+    /** The uniform buffer most recently activated by this class (tracked on the main thread) */
+    static GLuint _active;
+    
+    /**
+     * Writes the given data to the active uniform buffer.
+     *
+     * The data is copied, as the write may be deferred to the {@link RenderThread}.
+     * This method assumes that this uniform buffer is active.
+     *
+     * @param position  The byte position in the buffer
+     * @param data      The data to write
+     * @param size      The number of bytes to write
+     */
+    void upload(GLsizei position, const void* data, GLsizei size);
 
 public:
 #pragma mark Constructors
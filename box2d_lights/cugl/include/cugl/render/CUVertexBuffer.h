@@ -109,6 +109,15 @@ private:
     /** The index buffer for drawing a shape */
     GLuint _indxBuffer;
     
+    /** The vertex capacity of the streaming ring (0 if there is no ring) */
+    GLsizei _ringVerts;
+    /** The index capacity of the streaming ring (0 if there is no ring) */
+    GLsizei _ringIndxs;
+    /** The next free vertex position in the streaming ring */
+    GLsizei _vertHead;
+    /** The next free index position in the streaming ring */
+    GLsizei _indxHead;
+    
     /** The shader currently attached to this vertex buffer */
     std::shared_ptr<Shader> _shader;
     
@@ -117,6 +126,9 @@ private:
     /** The settings for each attribute */
     std::unordered_map<std::string, AttribData> _attributes;
     
+    /** The vertex array most recently bound by this class (tracked on the main thread) */
+    static GLuint _bound;
+    
 public:
 #pragma mark Constructors
     /**
@@ -235,6 +247,10 @@ public:
     /**
      * Returns true if this vertex is currently bound.
      *
+     * If the {@link RenderThread} is active, the OpenGL state may be a frame
+     * behind the main thread. In that case, this method answers for the
+     * commands recorded so far instead of querying OpenGL.
+     *
      * @return true if this vertex is currently bound.
      */
     bool isBound() const;
@@ -307,6 +323,59 @@ public:
      */
     void loadIndexData(const void * data, GLsizei size, GLenum usage=GL_STREAM_DRAW);
     
+    /**
+     * Allocates a streaming ring of the given capacity for this buffer.
+     *
+     * A streaming ring is an alternative to {@link #loadVertexData} and
+     * {@link #loadIndexData} for data that changes every frame. Instead of
+     * reallocating the buffers on every load, {@link #streamData} writes
+     * each load after the previous one, using unsynchronized buffer maps.
+     * When the ring is full, the buffers are orphaned (so the driver can
+     * give us fresh memory without waiting on pending draws) and the ring
+     * starts again from the beginning.
+     *
+     * The capacity should be a small multiple (typically 3) of the largest
+     * expected load, so that orphaning happens infrequently. Calling either
+     * {@link #loadVertexData} or {@link #loadIndexData} replaces the buffer
+     * memory and so releases the ring.
+     *
+     * This method will only succeed if this buffer is actively bound.
+     *
+     * @param vertices  The vertex capacity of the ring
+     * @param indices   The index capacity of the ring
+     */
+    void setStreamCapacity(GLsizei vertices, GLsizei indices);
+    
+    /**
+     * Returns true if this buffer has a streaming ring
+     *
+     * @return true if this buffer has a streaming ring
+     */
+    bool isStreaming() const { return _ringVerts > 0; }
+    
+    /**
+     * Streams the given vertices and indices into the ring of this buffer.
+     *
+     * The data is written to the next free region of the streaming ring.
+     * The indices are expected to refer to the given vertices (starting at
+     * 0), and are rebased as they are written. The value returned is the
+     * index offset of this data, which must be added to the offset of any
+     * call to {@link #draw} using it.
+     *
+     * If this buffer has no streaming ring, or the ring is too small for this
+     * data, the ring will be (re)allocated to fit it.
+     *
+     * This method will only succeed if this buffer is actively bound.
+     *
+     * @param vdata     The vertices to load
+     * @param vsize     The number of vertices to load
+     * @param idata     The indices to load
+     * @param isize     The number of indices to load
+     *
+     * @return the index offset of the data loaded
+     */
+    GLsizei streamData(const void* vdata, GLsizei vsize, const GLuint* idata, GLsizei isize);
+    
     /**
      * Draws to the active framebuffer using this vertex buffer
      *
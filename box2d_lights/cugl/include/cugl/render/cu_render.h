@@ -29,6 +29,7 @@
 #define __CU_RENDER_PKG_H__
 
 #include "CUSpriteVertex.h"
+#include "CUCompressedImage.h"
 #include "CUTexture.h"
 #include "CUFont.h"
 #include "CUMesh.h"
@@ -36,6 +37,7 @@
 #include "CUGradient.h"
 #include "CUShader.h"
 #include "CUUniformBuffer.h"
+#include "CURenderThread.h"
 #include "CURenderTarget.h"
 #include "CUSpriteBatch.h"
 #include "CUCamera.h"
@@ -0,0 +1,468 @@
+//
+//  CUCullingNode.h
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides a scene graph node that only renders the children
+//  that are visible in the current viewport. It maintains a uniform grid
+//  of its children, so that the cost of rendering is proportional to what
+//  is on screen and not the size of the level. This is the preferred root
+//  node for large, scrolling worlds.
+//
+//  Visibility is determined by the culling bounds of each child (which
+//  default to the content bounds). See SceneNode for more information.
+//
+//  This class uses our standard shared-pointer architecture.
+//
+//  1. The constructor does not perform any initialization; it just sets all
+//     attributes to their defaults.
+//
+//  2. All initialization takes place via init methods, which can fail if an
+//     object is initialized more than once.
+//
+//  3. All allocation takes place via static constructors which return a shared
+//     pointer.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Walker White
+//  Version: 5/12/21
+#ifndef __CU_CULLING_NODE_H__
+#define __CU_CULLING_NODE_H__
+#include <cugl/scene2/graph/CUSceneNode.h>
+#include <unordered_map>
+#include <vector>
+
+/** The default size of a grid cell (in node coordinates) */
+#define CU_CULLING_CELL_SIZE    256.0f
+/** The maximum number of cells a child may span before it is tested directly */
+#define CU_CULLING_CELL_LIMIT   64
+
+namespace cugl {
+    namespace scene2 {
+/**
+ * This is a scene graph node that culls children outside of the viewport.
+ *
+ * A normal {@link SceneNode} renders every one of its children, even if those
+ * children are nowhere near the screen. That is fine for UI elements, but it
+ * is a problem for the world node of a large level. This node keeps a uniform
+ * grid (a spatial hash) of the culling box of each child, and only renders
+ * those children whose boxes intersect the viewport of the {@link SpriteBatch}.
+ *
+ * The grid is maintained incrementally. Whenever a child is moved, scaled,
+ * rotated or resized, it notifies this node, and the child is reinserted
+ * into the grid at the start of the next render pass. Hence static children
+ * cost nothing per frame, and the render pass only visits the grid cells
+ * that are on screen.
+ *
+ * Only the immediate children of this node are culled. Each child is culled
+ * by its culling bounds {@see SceneNode#getCullingBounds}, which default to
+ * the content bounds. A child without culling bounds and with no content
+ * size is assumed to be unbounded, and is always rendered. If a child has
+ * descendants that draw outside of its content bounds, you should give it
+ * explicit culling bounds.
+ *
+ * Culled children are rendered in the same order as they would be by
+ * {@link SceneNode}, so z-ordering is unaffected.
+ */
+class CullingNode : public SceneNode {
+protected:
+    /**
+     * A class storing the grid location of a single child.
+     *
+     * This class is essentially a struct. The cell range is inclusive.
+     */
+    class Entry {
+    public:
+        /** The child for this entry */
+        SceneNode* node;
+        /** The culling box of the child in node space */
+        Rect bounds;
+        /** The minimum x-cell of the culling box */
+        int minx;
+        /** The minimum y-cell of the culling box */
+        int miny;
+        /** The maximum x-cell of the culling box */
+        int maxx;
+        /** The maximum y-cell of the culling box */
+        int maxy;
+        /** Whether this child is stored outside of the grid */
+        bool global;
+        /** Whether this child is never culled */
+        bool unbounded;
+        /** Whether this child is currently stored in the index */
+        bool placed;
+        /** Whether this child is waiting to be reinserted */
+        bool dirty;
+        /** The last query to visit this entry */
+        Uint32 stamp;
+    };
+
+    /** The size of a (square) grid cell */
+    float _cellSize;
+    /** Whether culling is active */
+    bool _culling;
+    /** The index entry for each child */
+    std::unordered_map<SceneNode*,Entry> _entries;
+    /** The grid cells, keyed by packed cell coordinates */
+    std::unordered_map<Uint64,std::vector<Entry*>> _cells;
+    /** The children too large (or unbounded) to store in the grid */
+    std::vector<Entry*> _globals;
+    /** The children waiting to be reinserted into the grid */
+    std::vector<SceneNode*> _pending;
+    /** The visible children for the current render pass (reused) */
+    std::vector<SceneNode*> _visible;
+    /** The current query stamp */
+    Uint32 _stamp;
+
+    /**
+     * Returns the key for the given grid cell.
+     *
+     * @param x     The x-coordinate of the cell
+     * @param y     The y-coordinate of the cell
+     *
+     * @return the key for the given grid cell.
+     */
+    static Uint64 cellKey(int x, int y) {
+        return ((Uint64)(Uint32)x << 32) | (Uint64)(Uint32)y;
+    }
+
+    /**
+     * Inserts the given entry into the grid.
+     *
+     * This method recomputes the culling box of the child.
+     *
+     * @param entry The entry to insert
+     */
+    void place(Entry* entry);
+
+    /**
+     * Removes the given entry from the grid.
+     *
+     * @param entry The entry to remove
+     */
+    void unplace(Entry* entry);
+
+    /**
+     * Removes the given child from the index.
+     *
+     * @param child The child to remove
+     */
+    void forget(SceneNode* child);
+
+    /**
+     * Reinserts all of the children that have changed since the last pass.
+     */
+    void refresh();
+
+    /**
+     * Stores the visible children in the scratch buffer _visible.
+     *
+     * The children are stored in rendering order.
+     *
+     * @param transform     The global transform of this node
+     * @param perspective   The combined camera matrix
+     */
+    void query(const Mat4& transform, const Mat4& perspective);
+
+    /**
+     * Notifies this node that the bounds of the given child may have changed.
+     *
+     * This marks the child to be reinserted into the grid at the next render
+     * pass. If the given node is no longer a child, it is removed from the
+     * index instead.
+     *
+     * @param child The child whose bounds may have changed
+     */
+    virtual void invalidateChild(SceneNode* child) override;
+
+#pragma mark -
+#pragma mark Constructors
+public:
+    /**
+     * Creates an uninitialized culling node.
+     *
+     * You must initialize this CullingNode before use.
+     *
+     * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate a CullingNode
+     * on the heap, use one of the static constructors instead.
+     */
+    CullingNode();
+
+    /**
+     * Deletes this node, disposing all resources
+     */
+    ~CullingNode() { dispose(); }
+
+    /**
+     * Disposes all of the resources used by this node.
+     *
+     * A disposed CullingNode can be safely reinitialized. Any children owned by
+     * this node will be released. They will be deleted if no other object owns them.
+     *
+     * It is unsafe to call this on a CullingNode that is still currently inside
+     * of a scene graph.
+     */
+    virtual void dispose() override;
+
+    /**
+     * Initializes a culling node at the world origin with the given cell size.
+     *
+     * The node has both position and size (0,0).
+     *
+     * @param size  The size of a grid cell in node coordinates
+     *
+     * @return true if initialization was successful.
+     */
+    bool initWithCellSize(float size);
+
+    /**
+     * Initializes a culling node with the given bounds and cell size.
+     *
+     * The rectangle origin is the bottom left corner of the node in parent
+     * space, and corresponds to the origin of the Node space. The size defines
+     * its content width and height. The node is anchored in the center and has
+     * position origin-(width/2,height/2) in parent space.
+     *
+     * @param size  The size of a grid cell in node coordinates
+     * @param rect  The bounds of the node in parent space
+     *
+     * @return true if initialization was successful.
+     */
+    bool initWithCellSize(float size, const Rect rect);
+
+    /**
+     * Initializes a node with the given JSON specificaton.
+     *
+     * This initializer is designed to receive the "data" object from the
+     * JSON passed to {@link Scene2Loader}. This JSON format supports all
+     * of the attribute values of its parent class. In addition, it supports
+     * the following additional attributes:
+     *
+     *      "cell size":    A number for the size of a grid cell
+     *      "culling":      A boolean indicating whether culling is active
+     *
+     * All attributes are optional. There are no required attributes.
+     *
+     * @param loader    The scene loader passing this JSON file
+     * @param data      The JSON object specifying the node
+     *
+     * @return true if initialization was successful.
+     */
+    virtual bool initWithData(const Scene2Loader* loader, const std::shared_ptr<JsonValue>& data) override;
+
+#pragma mark -
+#pragma mark Static Constructors
+    /**
+     * Returns a newly allocated culling node at the world origin.
+     *
+     * The node has both position and size (0,0). It uses the default
+     * cell size {@link CU_CULLING_CELL_SIZE}.
+     *
+     * @return a newly allocated culling node at the world origin.
+     */
+    static std::shared_ptr<CullingNode> alloc() {
+        std::shared_ptr<CullingNode> result = std::make_shared<CullingNode>();
+        return (result->init() ? result : nullptr);
+    }
+
+    /**
+     * Returns a newly allocated culling node at the world origin.
+     *
+     * The node has both position and size (0,0).
+     *
+     * @param size  The size of a grid cell in node coordinates
+     *
+     * @return a newly allocated culling node at the world origin.
+     */
+    static std::shared_ptr<CullingNode> allocWithCellSize(float size) {
+        std::shared_ptr<CullingNode> result = std::make_shared<CullingNode>();
+        return (result->initWithCellSize(size) ? result : nullptr);
+    }
+
+    /**
+     * Returns a newly allocated culling node with the given bounds.
+     *
+     * The rectangle origin is the bottom left corner of the node in parent
+     * space, and corresponds to the origin of the Node space. The size defines
+     * its content width and height. The node is anchored in the center and has
+     * position origin-(width/2,height/2) in parent space.
+     *
+     * @param size  The size of a grid cell in node coordinates
+     * @param rect  The bounds of the node in parent space
+     *
+     * @return a newly allocated culling node with the given bounds.
+     */
+    static std::shared_ptr<CullingNode> allocWithCellSize(float size, const Rect rect) {
+        std::shared_ptr<CullingNode> result = std::make_shared<CullingNode>();
+        return (result->initWithCellSize(size,rect) ? result : nullptr);
+    }
+
+    /**
+     * Returns a newly allocated culling node with the given JSON specificaton.
+     *
+     * This initializer is designed to receive the "data" object from the
+     * JSON passed to {@link Scene2Loader}. This JSON format supports all
+     * of the attribute values of its parent class. In addition, it supports
+     * the following additional attributes:
+     *
+     *      "cell size":    A number for the size of a grid cell
+     *      "culling":      A boolean indicating whether culling is active
+     *
+     * All attributes are optional. There are no required attributes.
+     *
+     * @param loader    The scene loader passing this JSON file
+     * @param data      The JSON object specifying the node
+     *
+     * @return a newly allocated culling node with the given JSON specificaton.
+     */
+    static std::shared_ptr<CullingNode> allocWithData(const Scene2Loader* loader, const std::shared_ptr<JsonValue>& data) {
+        std::shared_ptr<CullingNode> result = std::make_shared<CullingNode>();
+        return (result->initWithData(loader,data) ? result : nullptr);
+    }
+
+#pragma mark -
+#pragma mark Attributes
+    /**
+     * Returns the size of a grid cell in node coordinates.
+     *
+     * Cells should be on the order of the size of a typical child. Cells that
+     * are too small force large children to be stored in many cells, while
+     * cells that are too large test too many off-screen children.
+     *
+     * @return the size of a grid cell in node coordinates.
+     */
+    float getCellSize() const { return _cellSize; }
+
+    /**
+     * Sets the size of a grid cell in node coordinates.
+     *
+     * Cells should be on the order of the size of a typical child. Cells that
+     * are too small force large children to be stored in many cells, while
+     * cells that are too large test too many off-screen children.
+     *
+     * Changing the cell size rebuilds the grid at the next render pass.
+     *
+     * @param size  The size of a grid cell in node coordinates.
+     */
+    void setCellSize(float size);
+
+    /**
+     * Returns true if this node culls its children.
+     *
+     * If this value is false, this node renders exactly like a {@link SceneNode}.
+     *
+     * @return true if this node culls its children.
+     */
+    bool isCulling() const { return _culling; }
+
+    /**
+     * Sets whether this node culls its children.
+     *
+     * If this value is false, this node renders exactly like a {@link SceneNode}.
+     *
+     * @param value Whether this node culls its children.
+     */
+    void setCulling(bool value) { _culling = value; }
+
+    /**
+     * Returns the class name of this node.
+     *
+     * This method is to help us speed up subclass-based polymorphism on the scene
+     * graphs.
+     *
+     * @return the class name of this node.
+     */
+    virtual const std::string getClassName() const override { return "CullingNode"; }
+
+#pragma mark -
+#pragma mark Scene Graph
+    // Keep the overloads that are not overridden below
+    using SceneNode::addChild;
+    using SceneNode::removeChild;
+
+    /**
+     * Adds a child to this node with the given z-order.
+     *
+     * The child is inserted into the grid at the next render pass.
+     *
+     * @param child A child node.
+     * @param zval  The (new) child z-order.
+     */
+    virtual void addChild(const std::shared_ptr<SceneNode>& child, int zval) override;
+
+    /**
+     * Removes the child at the given position from this node.
+     *
+     * Removing a child alters the position of every child after it. Hence
+     * it is unsafe to cache child positions.
+     *
+     * @param pos   The position of the child node which will be removed.
+     */
+    virtual void removeChild(unsigned int pos) override;
+
+    /**
+     * Removes all children from this node.
+     */
+    virtual void removeAllChildren() override;
+
+    /**
+     * Returns the number of children drawn in the last render pass.
+     *
+     * This value is useful for profiling and for tuning the cell size.
+     *
+     * @return the number of children drawn in the last render pass.
+     */
+    size_t getVisibleCount() const { return _visible.size(); }
+
+#pragma mark -
+#pragma mark Rendering
+    /**
+     * Draws this node and all of its visible children with the given SpriteBatch.
+     *
+     * The viewport is determined by the perspective matrix of the sprite batch.
+     * Children whose culling boxes are outside of that viewport are skipped
+     * (together with all of their descendants).
+     *
+     * @param batch     The SpriteBatch to draw with.
+     * @param transform The global transformation matrix.
+     * @param tint      The tint to blend with the node color.
+     */
+    virtual void render(const std::shared_ptr<SpriteBatch>& batch, const Mat4& transform, Color4 tint) override;
+
+    /**
+     * Draws this node and all of its visible children with the given SpriteBatch.
+     *
+     * The viewport is determined by the perspective matrix of the sprite batch.
+     * Children whose culling boxes are outside of that viewport are skipped
+     * (together with all of their descendants).
+     *
+     * @param batch     The SpriteBatch to draw with.
+     */
+    virtual void render(const std::shared_ptr<SpriteBatch>& batch) override {
+        render(batch,Mat4::IDENTITY,Color4::WHITE);
+    }
+
+    /** This macro disables the copy constructor (not allowed on scene graphs) */
+    CU_DISALLOW_COPY_AND_ASSIGN(CullingNode);
+};
+    }
+
+}
+#endif /* __CU_CULLING_NODE_H__ */
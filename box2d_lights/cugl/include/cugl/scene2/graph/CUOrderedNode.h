@@ -46,6 +46,8 @@
 #ifndef __CU_ORDERED_NODE_H__
 #define __CU_ORDERED_NODE_H__
 #include <cugl/scene2/graph/CUSceneNode.h>
+#include <cugl/render/CUScissor.h>
+#include <vector>
 
 namespace cugl {
     namespace scene2 {
@@ -67,10 +69,12 @@ namespace cugl {
  * Any order other than a pre-order traversal comes as a cost, as we must
  * cache the scene graph transform and color context of each node (these
  * values are computed naturally from the recursive calls of a pre-order
- * traversal). In addition, we must call std::sort (currently IntroSort)
- * on all of the descendants every single render pass. However, as long
- * as the number of children of this node is reasonably sized, this should
- * not be an issue.
+ * traversal). In addition, we must sort all of the descendants every
+ * single render pass. The orders {@link Order#ASCEND}, {@link Order#DESCEND}
+ * and {@link Order#TOP_DOWN} use a radix sort on 32-bit keys, which is
+ * linear time. The render queue and the sort buffers are reused from
+ * frame to frame, so a render pass does not allocate memory once the
+ * queue has reached its working size.
  *
  * An OrderedNode is a render barrier. This means that if one OrderedNode
  * (the first node) is a descendant of another OrderedNode (the second node),
@@ -165,7 +169,17 @@ public:
          * first and then the parent. However, children are sorted with respect
          * to their priority.  Children with the highest priority are drawn first.
          */
-        POST_DESCEND
+        POST_DESCEND,
+
+        /**
+         * Render the nodes in descending order by their y-coordinate
+         *
+         * This is the standard depth order for a top-down view. The coordinate
+         * is the anchor of each node in world space. Nodes higher on the screen
+         * appear at the back of the scene. Ties are broken by the pre-order
+         * traversal value.
+         */
+        TOP_DOWN
     };
     
 protected:
@@ -185,14 +199,16 @@ protected:
         OrderedNode* parent;
         /** The node to be drawn at this step */
         std::shared_ptr<SceneNode> node;
-        /** The scissor value (possibly nullptr) */
-        std::shared_ptr<Scissor> scissor;
+        /** The index of the scissor mask in {@link _masks} (or -1 for none) */
+        Sint32 scissor;
         /** The drawing transform */
         Mat4 transform;
         /** The tint color */
         Color4 tint;
         /** The canonical order (for pre-order and post-order traversals) */
         Uint32 canonical;
+        /** The radix sort key (for ascending, descending and top-down orders) */
+        Uint32 key;
         
         /**
          * Creates a drawing context with the given parent object
@@ -222,10 +238,30 @@ protected:
         static bool sortCompare(Context* a, Context* b);
     };
 
-    /** The render queue (always use a deque for this functionality) */
-    std::deque<Context*> _entries;
-    /** The global scissor context (necessary as sprite batches manage this normally) */
-    std::shared_ptr<Scissor> _viewport;
+    /**
+     * The render queue
+     *
+     * The contexts are reused between render passes, so only the first
+     * {@link _entryCount} entries are in the queue. The rest are spares.
+     */
+    std::vector<Context*> _entries;
+    /** The number of contexts in the render queue */
+    size_t _entryCount;
+    /** The scratch buffer for the radix sort */
+    std::vector<Context*> _scratch;
+    /**
+     * The scissor masks captured by the render queue
+     *
+     * The masks are in world space, and include every scissor between this
+     * node and the drawn node (but not any scissor active in the sprite
+     * batch). They are reused between render passes, so only the first
+     * {@link _maskCount} masks are in use.
+     */
+    std::vector<Scissor> _masks;
+    /** The number of scissor masks in use */
+    size_t _maskCount;
+    /** The index of the current scissor mask during traversal (or -1 for none) */
+    Sint32 _viewport;
     /** The current render order */
     Order _order;
     
@@ -243,6 +279,16 @@ protected:
      */
     void visit(const std::shared_ptr<SceneNode>& node, const Mat4& transform, Color4 tint);
     
+    /**
+     * Sorts the render queue by the key of each context.
+     *
+     * This is a least significant digit radix sort on the 32-bit keys, using
+     * 8 bits per pass. Passes where every key has the same digit are skipped.
+     * As the sort is stable, and the queue is built in canonical order, all
+     * ties are broken by the canonical order.
+     */
+    void radixSort();
+    
 #pragma mark -
 #pragma mark Constructors
 public:
@@ -66,6 +66,7 @@ class Scene2Loader;
     namespace scene2 {
     
 class Layout;
+class CullingNode;
     
     
 /**
@@ -137,6 +138,11 @@ protected:
     /** An optional scissor value */
     std::shared_ptr<Scissor> _scissor;
     
+    /** The (optional) culling bounds of this node in node space */
+    Rect _cullBounds;
+    /** Whether this node has explicit culling bounds */
+    bool _hasCullBounds;
+    
     /**
      * The scale of this node.
      *
@@ -176,6 +182,29 @@ protected:
      * alternate transform.
      */
     Mat4  _combined;
+    /** Whether the local transform is a 2d affine transform */
+    bool  _local2D;
+
+    /**
+     * The cached node-to-world transform.
+     *
+     * This matrix is the transform computed in the last call to
+     * {@link #render}. It is only recomputed when this node, or one of
+     * its ancestors, has changed its transform since that call.
+     */
+    Mat4  _world;
+    /** The 2d affine form of the world transform (valid if _world2D is true) */
+    Affine2 _worldAffine;
+    /** The parent transform of the cached world transform (for root nodes) */
+    Mat4  _worldBase;
+    /** Whether the world transform is a 2d affine transform */
+    bool  _world2D;
+    /** Whether the local transform has changed since the world was cached */
+    bool  _worldDirty;
+    /** The number of times the world transform has been recomputed */
+    Uint32 _worldVersion;
+    /** The parent world version used for the cached world transform */
+    Uint32 _parentVersion;
     
     /** The array of children nodes */
     std::vector<std::shared_ptr<SceneNode>> _children;
@@ -1117,6 +1146,71 @@ public:
      */
     void setScissor() { _scissor = Scissor::alloc(getContentSize());}
 
+    /**
+     * Returns true if this node has explicit culling bounds.
+     *
+     * A node with culling bounds is skipped (together with all of its
+     * descendants) whenever those bounds fall outside of the viewport
+     * of the active {@link SpriteBatch}. Nodes without culling bounds
+     * are always rendered by {@link #render}. However, they may still be
+     * culled by a {@link CullingNode} parent, which uses the content
+     * bounds in that case.
+     *
+     * @return true if this node has explicit culling bounds.
+     */
+    bool hasCullingBounds() const { return _hasCullBounds; }
+    
+    /**
+     * Returns the culling bounds of this node.
+     *
+     * These bounds are specified in node space. They should contain
+     * everything drawn by this node and its descendants. If the node
+     * does not have explicit culling bounds, this method returns the
+     * content bounds (0,0,width,height).
+     *
+     * @return the culling bounds of this node.
+     */
+    Rect getCullingBounds() const {
+        return _hasCullBounds ? _cullBounds : Rect(Vec2::ZERO, _contentSize);
+    }
+    
+    /**
+     * Sets the culling bounds of this node.
+     *
+     * These bounds are specified in node space. They should contain
+     * everything drawn by this node and its descendants. When these
+     * bounds are outside of the viewport of the active {@link SpriteBatch},
+     * neither this node nor its descendants are drawn.
+     *
+     * Culling bounds are a promise by the programmer. If a descendant
+     * draws outside of these bounds, it may disappear prematurely as
+     * it approaches the edge of the screen.
+     *
+     * @param bounds    The culling bounds of this node.
+     */
+    void setCullingBounds(const Rect& bounds);
+    
+    /**
+     * Removes any explicit culling bounds from this node.
+     *
+     * Once removed, this node will always be rendered by {@link #render},
+     * unless it is culled by a {@link CullingNode} parent.
+     */
+    void clearCullingBounds();
+    
+    /**
+     * Returns an AABB of the culling bounds in the parent's coordinates.
+     *
+     * This method is the equivalent of {@link #getBoundingBox} for
+     * the culling bounds. It is the minimal axis-aligned bounding box
+     * that contains the transformed culling bounds.
+     *
+     * @return an AABB of the culling bounds in the parent's coordinates.
+     */
+    Rect getCullingBox() const {
+        return getNodeToParentTransform().transform(getCullingBounds());
+    }
+
     
 #pragma mark -
 #pragma mark Transforms
@@ -1529,6 +1623,12 @@ public:
      * Sorting does not happen automatically (except within a {@link Scene2}).
      * It is the responsibility of a user to call this method before rendering.
      * Otherwise, render order will be in the unsorted order.
+     *
+     * Children usually move only a few places between sorts (such as when
+     * moving characters change their z-value). So this method uses an
+     * insertion sort, which is linear time when the children are almost
+     * sorted. If the children are badly out of order, it finishes with
+     * std::sort instead.
      */
     void sortZOrder();
     
@@ -2024,6 +2124,61 @@ public:
      */
     virtual void doLayout();
 
+protected:
+#pragma mark -
+#pragma mark Culling Support
+    /**
+     * Notifies this node that the bounds of the given child may have changed.
+     *
+     * This method is called whenever a child is moved, transformed, resized,
+     * or swapped out of this node. The default implementation does nothing.
+     * It exists so that nodes with a spatial index of their children (such
+     * as {@link CullingNode}) can update that index incrementally.
+     *
+     * When a child is swapped out, its parent is no longer this node at
+     * the time of the call.
+     *
+     * @param child The child whose bounds may have changed
+     */
+    virtual void invalidateChild(SceneNode* child) {}
+    
+    /**
+     * Returns true if the given bounds are outside of the viewport.
+     *
+     * The bounds are specified in the coordinate space defined by the
+     * given transform. The perspective is the combined camera matrix of
+     * the {@link SpriteBatch}. The test is conservative: rotated bounds
+     * are tested by their axis-aligned box in clip space.
+     *
+     * @param bounds        The bounds to test
+     * @param transform     The global transform of the bounds
+     * @param perspective   The combined camera matrix
+     *
+     * @return true if the given bounds are outside of the viewport.
+     */
+    static bool isCulled(const Rect& bounds, const Mat4& transform, const Mat4& perspective);
+
+#pragma mark -
+#pragma mark Transform Caching
+    /**
+     * Returns the node-to-world transform for the given parent transform.
+     *
+     * The result is cached. If transform is the cached world transform of
+     * the parent, this method only checks whether this node or its parent
+     * changed since the last call, making static subtrees free to traverse.
+     * Otherwise, the transform is compared against the one used in the
+     * last call. The transforms are composed as {@link Affine2} objects
+     * whenever both of them are 2d.
+     *
+     * The value returned is a reference to the cache, and may be passed
+     * to the children of this node as their parent transform.
+     *
+     * @param transform The parent-to-world transform
+     *
+     * @return the node-to-world transform for the given parent transform.
+     */
+    const Mat4& updateWorldTransform(const Mat4& transform);
+
 private:
 #pragma mark -
 #pragma mark Internal Helpers
@@ -2054,7 +2209,7 @@ private:
      *
      * @param parent    A pointer to the parent node.
      */
-    void setParent(SceneNode* parent) { _parent = parent; }
+    void setParent(SceneNode* parent) { _parent = parent; _worldDirty = true; }
 
     /**
      * Sets the scene graph.
@@ -2100,6 +2255,7 @@ private:
     CU_DISALLOW_COPY_AND_ASSIGN(SceneNode);
     
     friend class cugl::Scene2;
+    friend class CullingNode;
 };
     }
 
@@ -113,6 +113,17 @@ protected:
     /** The render data for this node */
     Mesh<SpriteVertex2> _mesh;
     
+    /** Whether the world space render data agrees with the render data */
+    bool _cached;
+    /** The render data transformed into world space */
+    Mesh<SpriteVertex3> _cacheMesh;
+    /** The world transform of the last draw */
+    Mat4 _cacheBase;
+    /** The sprite batch depth of the last draw */
+    float _cacheDepth;
+    /** The world transform version of the last draw (0 if not inherited) */
+    Uint32 _cacheVersion;
+    
     /** The blending equation for this texture */
     GLenum _blendEquation;
     /** The source factor for the blend function */
@@ -733,6 +744,39 @@ protected:
      * Clears the render data, releasing all vertices and indices.
      */
     void clearRenderData();
+    
+    /**
+     * Returns true if the world space render data is ready for this transform.
+     *
+     * Most nodes do not move from frame to frame. So once a node has been
+     * drawn with the same transform and depth twice in a row, this method
+     * transforms the render data into world space and caches it. From that
+     * point on, the node can be drawn with the cached mesh, which the sprite
+     * batch copies without any per-vertex transform. The cache is rebuilt
+     * whenever the render data changes.
+     *
+     * If this method returns false, the node is moving, and it should be
+     * drawn with the node space render data instead.
+     *
+     * @param transform The global transformation matrix.
+     * @param depth     The sprite batch depth
+     *
+     * @return true if the world space render data is ready for this transform.
+     */
+    bool cacheRenderData(const Mat4& transform, float depth);
+    
+    /**
+     * Draws the render data with the given SpriteBatch.
+     *
+     * This method uses the world space render data whenever it is ready (see
+     * {@link #cacheRenderData}). All other sprite batch state must be set
+     * before calling this method.
+     *
+     * @param batch     The SpriteBatch to draw with.
+     * @param transform The global transformation matrix.
+     * @param outline   Whether to outline the mesh instead of filling it
+     */
+    void drawRenderData(const std::shared_ptr<SpriteBatch>& batch, const Mat4& transform, bool outline);
 
     /**
      * Updates the texture coordinates for this polygon
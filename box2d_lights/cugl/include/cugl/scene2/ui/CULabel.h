@@ -205,6 +205,26 @@ protected:
     /** The true bounds of this rendered text, ignoring any natural spacing */
     Rect _truebounds;
     
+    /**
+     * The cached layout of a single glyph in the text
+     *
+     * Layouts are preserved when the text changes, up to the first glyph
+     * that differs. Hence counters and timers only lay out the suffix
+     * that changed.
+     */
+    struct GlyphLayout {
+        /** The glyph metrics */
+        Font::Metrics metrics;
+        /** The pen position of this glyph (after kerning) relative to the text origin */
+        float pen;
+        /** The first vertex of this glyph in the mesh */
+        GLuint vertex;
+    };
+    /** The (Unicode) glyphs of the text that are supported by the font */
+    std::vector<Uint32> _glyphs;
+    /** The layout of each glyph in _glyphs */
+    std::vector<GlyphLayout> _layout;
+    
     /** The padding offset */
     Vec2 _padding;
     /** The horizontal alignment of the text in this label */
@@ -232,6 +252,12 @@ protected:
     Rect _bounds;
     /** The underlying atlas texture */
     std::shared_ptr<Texture> _texture;
+    /** The font atlas version when the glyphs were rendered */
+    Uint32 _atlasVersion;
+    /** The number of leading glyphs with valid quads in the mesh */
+    size_t _validGlyphs;
+    /** The text origin of the quads in the mesh */
+    Vec2 _meshOrigin;
 
 public:
 #pragma mark -
@@ -478,7 +504,9 @@ public:
      * may be different than those displayed.
      *
      * Changing this value will regenerate the render data, and is potentially
-     * expensive, particularly if the font does not have an atlas.
+     * expensive, particularly if the font does not have an atlas. If the font
+     * has an atlas, only the glyphs after the first change are regenerated.
+     * So it is cheap to update counters and timers that change at the end.
      *
      * @param text      The text for this label.
      * @param resize    Whether to resize the label to fit the new text.
@@ -914,9 +942,22 @@ private:
      * done manually.
      */
     void computeSize();
+    
+    /**
+     * Lays out the glyphs of the current text, reusing the previous layout.
+     *
+     * The layout of every glyph before the first change is preserved, as
+     * are the quads for those glyphs. The quads for all other glyphs are
+     * removed from the mesh.
+     */
+    void layoutText();
 
     /**
      * Allocate the render data necessary to render this node.
+     *
+     * If the font has an atlas, this method only generates quads for the
+     * glyphs that have changed. The quads of the other glyphs are shifted
+     * if the text origin has changed.
      */
     void generateRenderData();
     
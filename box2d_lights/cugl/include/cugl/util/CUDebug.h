@@ -239,4 +239,26 @@ std::string gl_type_name(GLenum error);
 
 }
 
+/**
+ * @def CUAssertGLError(prefix)
+ *
+ * Asserts that there is no pending OpenGL error, logging it otherwise.
+ *
+ * Querying OpenGL for errors can stall the driver pipeline. Therefore, this
+ * check is only compiled at the normal and paranoid assert levels. On the
+ * disabled and release settings, it does not call glGetError at all. The
+ * error message is prefixed by the given string.
+ *
+ * @param prefix    The prefix for the error message
+ */
+#if SDL_ASSERT_LEVEL >= 2
+#   define CUAssertGLError(prefix)  do {                            \
+        GLenum __cu_error__ = glGetError();                         \
+        CUAssertLog(__cu_error__ == GL_NO_ERROR, "%s: %s", prefix,  \
+                    cugl::gl_error_name(__cu_error__).c_str());     \
+    } while (0)
+#else
+#   define CUAssertGLError(prefix)  do { } while (0)
+#endif
+
 #endif /* __CU_DEBUG_H__ */
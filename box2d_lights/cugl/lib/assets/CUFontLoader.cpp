@@ -67,7 +67,8 @@ using namespace cugl;
  */
 FontLoader::FontLoader() : Loader<Font>(),
 _fontsize(UNKNOWN_SIZE),
-_charset(UNKNOWN_CHARS) {
+_charset(UNKNOWN_CHARS),
+_dynamic(false) {
 }
 
 
@@ -84,10 +85,12 @@ _charset(UNKNOWN_CHARS) {
  * @param source    The pathname to the asset
  * @param charset   The atlas character set
  * @param charset   The font size
+ * @param dynamic   Whether to use a dynamic atlas (ignoring charset)
  *
  * @return the font asset with no generated atlas
  */
-std::shared_ptr<Font> FontLoader::preload(const std::string& source, const std::string& charset, int size) {
+std::shared_ptr<Font> FontLoader::preload(const std::string& source, const std::string& charset,
+                                          int size, bool dynamic) {
     // Make sure we reference the asset directory
 #if defined (__WINDOWS__)
     bool absolute = (bool)strstr(source.c_str(),":") || source[0] == '\\';
@@ -103,7 +106,9 @@ std::shared_ptr<Font> FontLoader::preload(const std::string& source, const std::
         return result;
     }
     
-    if (charset.empty()) {
+    if (dynamic) {
+        result->buildDynamicAtlas();
+    } else if (charset.empty()) {
         result->buildAtlasAsync();
     } else {
         result->buildAtlasAsync(charset);
@@ -172,7 +177,7 @@ bool FontLoader::read(const std::string& key, const std::string& source, int siz
     
     bool success = false;
     if (_loader == nullptr || !async) {
-        std::shared_ptr<Font> font = preload(source,_charset,size);
+        std::shared_ptr<Font> font = preload(source,_charset,size,_dynamic);
         if (font != nullptr) {
             success = true;
             materialize(key,font,callback);
@@ -181,7 +186,7 @@ bool FontLoader::read(const std::string& key, const std::string& source, int siz
         }
     } else {
         _loader->addTask([=](void) {
-            std::shared_ptr<Font> font = this->preload(source,_charset,size);
+            std::shared_ptr<Font> font = this->preload(source,_charset,size,_dynamic);
             Application::get()->schedule([=](void){
                 this->materialize(key,font,callback);
                 return false;
@@ -209,6 +214,7 @@ bool FontLoader::read(const std::string& key, const std::string& source, int siz
  *      "file":         The path to the asset
  *      "size":         This font size (int)
  *      "charset":      The set of characters for the font atlas (string)
+ *      "dynamic":      Whether to rasterize glyphs on demand (bool)
  *
  * @param json      The directory entry for the asset
  * @param callback  An optional callback for asynchronous loading
@@ -226,10 +232,11 @@ bool FontLoader::read(const std::shared_ptr<JsonValue>& json, LoaderCallback cal
     std::string source  = json->getString("file",UNKNOWN_SOURCE);
     std::string charset = json->getString("charset",UNKNOWN_CHARS);
     int size = json->getInt("size",UNKNOWN_SIZE);
+    bool dynamic = json->getBool("dynamic",_dynamic);
     
     bool success = false;
     if (_loader == nullptr || !async) {
-        std::shared_ptr<Font> font = preload(source,charset,size);
+        std::shared_ptr<Font> font = preload(source,charset,size,dynamic);
         if (font != nullptr) {
             success = true;
             materialize(key,font,callback);
@@ -238,7 +245,7 @@ bool FontLoader::read(const std::shared_ptr<JsonValue>& json, LoaderCallback cal
         }
     } else {
         _loader->addTask([=](void) {
-            std::shared_ptr<Font> font = this->preload(source,charset,size);
+            std::shared_ptr<Font> font = this->preload(source,charset,size,dynamic);
             Application::get()->schedule([=](void){
                 this->materialize(key,font,callback);
                 return false;
@@ -58,6 +58,8 @@ using namespace cugl;
 #define UNKNOWN_VOLUME  1.0f
 /** If the type is unknown */
 #define UNKNOWN_TYPE    "<unknown>"
+/** The default maximum duration of an in-memory sample */
+#define DEFAULT_STREAM_LIMIT    10.0
 
 #pragma mark -
 #pragma mark Constructor
@@ -69,12 +71,98 @@ using namespace cugl;
  * the heap, use one of the static constructors instead.
  */
 SoundLoader::SoundLoader() : Loader<Sound>(),
-_volume(UNKNOWN_VOLUME) {
+_volume(UNKNOWN_VOLUME),
+_streamLimit(DEFAULT_STREAM_LIMIT),
+_sampleRate(0) {
+}
+
+#pragma mark -
+#pragma mark Properties
+/**
+ * Sets the sample rate for in-memory samples
+ *
+ * If this value is nonzero, any sample decoded into memory is converted
+ * to this rate when loaded. This should be the rate of the output device,
+ * so that these samples need no conversion during playback. Streamed
+ * samples are never converted. The default is 0 (no conversion).
+ *
+ * Changing this value clears the cache of decoded samples. It does not
+ * affect samples that are already loaded.
+ *
+ * @param rate  The sample rate for in-memory samples
+ */
+void SoundLoader::setSampleRate(Uint32 rate) {
+    std::lock_guard<std::mutex> lock(_pcmmutex);
+    if (_sampleRate != rate) {
+        _sampleRate = rate;
+        _pcmcache.clear();
+    }
 }
 
 
 #pragma mark -
 #pragma mark Asset Loading
+/**
+ * Returns a newly allocated audio sample for the given file.
+ *
+ * If stream is false and force is true, the sample is decoded into
+ * memory. If force is false, the sample is only decoded into memory if
+ * its duration is no more than the stream limit. Decoded samples are
+ * cached by file, and share their PCM data with any earlier sample for
+ * the same file that is still in use. If there is a sample rate for this
+ * loader, decoded samples are resampled to that rate.
+ *
+ * This method is safe to call from a loader thread.
+ *
+ * @param path      The path to the audio file
+ * @param stream    Whether to stream the sample (if force is true)
+ * @param force     Whether to ignore the stream limit
+ *
+ * @return a newly allocated audio sample for the given file.
+ */
+std::shared_ptr<AudioSample> SoundLoader::allocSample(const std::string& path, bool stream, bool force) {
+    if (!force || !stream) {
+        std::lock_guard<std::mutex> lock(_pcmmutex);
+        auto it = _pcmcache.find(path);
+        if (it != _pcmcache.end()) {
+            std::shared_ptr<AudioSample> cached = it->second.lock();
+            if (cached != nullptr) {
+                return AudioSample::alloc(cached);
+            }
+            _pcmcache.erase(it);
+        }
+    }
+
+    std::shared_ptr<AudioSample> sample = nullptr;
+    if (force) {
+        sample = AudioSample::alloc(path,stream);
+    } else {
+        // Only the header is read when streaming
+        sample = AudioSample::alloc(path,true);
+        if (sample != nullptr && sample->getDuration() <= _streamLimit) {
+            sample = AudioSample::alloc(path,false);
+        }
+    }
+    if (sample == nullptr || sample->isStreamed()) {
+        return sample;
+    }
+    
+    Uint32 rate = 0;
+    {
+        std::lock_guard<std::mutex> lock(_pcmmutex);
+        rate = _sampleRate;
+    }
+    if (rate != 0 && sample->getRate() != rate) {
+        sample->resample(rate);
+    }
+    
+    std::lock_guard<std::mutex> lock(_pcmmutex);
+    if (rate == _sampleRate) {
+        _pcmcache[path] = sample;
+    }
+    return sample;
+}
+
 /**
  * Finishes loading the sound file, setting its default volume.
  *
@@ -145,7 +233,7 @@ bool SoundLoader::read(const std::string& key, const std::string& source, Loader
     if (_loader == nullptr || !async) {
         std::shared_ptr<Sound> sound = nullptr;
         if (AudioSample::guessType(path) != AudioSample::Type::UNKNOWN) {
-            sound = AudioSample::alloc(path);
+            sound = allocSample(path,false,false);
         }
         success = (sound != nullptr);
         if (success) {
@@ -156,7 +244,7 @@ bool SoundLoader::read(const std::string& key, const std::string& source, Loader
         _loader->addTask([=](void) {
             std::shared_ptr<Sound> sound = nullptr;
             if (AudioSample::guessType(path) != AudioSample::Type::UNKNOWN) {
-                sound = AudioSample::alloc(path);
+                sound = allocSample(path,false,false);
             }
             if (sound != nullptr) {
                 sound->setVolume(_volume);
@@ -187,6 +275,10 @@ bool SoundLoader::read(const std::string& key, const std::string& source, Loader
  *
  *      "file":         The path to the asset
  *      "volume":       This default sound volume (float)
+ *      "stream":       Whether to stream the sample (bool)
+ *
+ * If "stream" is not specified, a sample is streamed only if it is
+ * longer than the stream limit.
  *
  * @param json      The directory entry for the asset
  * @param callback  An optional callback for asynchronous loading
@@ -199,6 +291,16 @@ bool SoundLoader::read(const std::shared_ptr<JsonValue>& json, LoaderCallback ca
     std::string type = json->getString("type",UNKNOWN_TYPE);
     float volume = json->getFloat("volume",_volume);
     type = cugl::strtool::tolower(type);
+    std::string file = json->getString("file","");
+    bool stream = json->getBool("stream",false);
+
+    // Make sure we reference the asset directory
+#if defined (__WINDOWS__)
+    bool absolute = (bool)strstr(file.c_str(),":") || file[0] == '\\';
+#else
+    bool absolute = file[0] == '/';
+#endif
+    CUAssertLog(!absolute, "The asset directory should not referece absolute paths.");
     
     if (_assets.find(key) != _assets.end() || _queue.find(key) != _queue.end()) {
         return false;
@@ -208,7 +310,7 @@ bool SoundLoader::read(const std::shared_ptr<JsonValue>& json, LoaderCallback ca
     if (_loader == nullptr || !async) {
         std::shared_ptr<Sound> sound = nullptr;
         if (type == "sample") {
-            sound = AudioSample::allocWithData(json);
+            sound = allocSample(file,stream,json->has("stream"));
         } else if (type == "waveform") {
             sound = AudioWaveform::allocWithData(json);
         }
@@ -221,7 +323,7 @@ bool SoundLoader::read(const std::shared_ptr<JsonValue>& json, LoaderCallback ca
         _loader->addTask([=](void) {
             std::shared_ptr<Sound> sound = nullptr;
             if (type == "sample") {
-                sound = AudioSample::allocWithData(json);
+                sound = allocSample(file,stream,json->has("stream"));
             } else if (type == "waveform") {
                 sound = AudioWaveform::allocWithData(json);
             }
@@ -46,6 +46,8 @@
 #include <cugl/assets/CUTextureLoader.h>
 #include <cugl/base/CUApplication.h>
 #include <SDL/SDL_image.h>
+#include <algorithm>
+#include <climits>
 
 using namespace cugl;
 
@@ -138,7 +140,65 @@ _minfilter(GL_LINEAR),
 _magfilter(GL_LINEAR),
 _wraps(GL_CLAMP_TO_EDGE),
 _wrapt(GL_CLAMP_TO_EDGE),
-_mipmaps(false) {
+_mipmaps(false),
+_packing(false),
+_pageSize(ATLAS_PAGE_SIZE),
+_packLimit(ATLAS_PACK_LIMIT),
+_releasing(false),
+_releaseid(0),
+_decodeThreads(0),
+_budget(TEXTURE_UPLOAD_BUDGET),
+_uploading(false),
+_uploadid(0),
+_offthread(0),
+_arenaSize(0) {
+}
+
+/**
+ * Disposes all resources and assets of this loader
+ *
+ * Any assets loaded by this object will be immediately released by the
+ * loader.  However, a texture may still be available if it is referenced
+ * by another smart pointer.  OpenGL will only release a texture asset
+ * once all smart pointer attached to the asset are null.
+ *
+ * Once the loader is disposed, any attempts to load a new asset will
+ * fail.  You must reinitialize the loader to begin loading assets again.
+ */
+void TextureLoader::dispose() {
+    // Shut down decoding before releasing the staged textures
+    _decoders = nullptr;
+    _assets.clear();
+    _loader = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(_pagemutex);
+        _pages.clear();
+    }
+    if (_releasing && Application::get() != nullptr) {
+        Application::get()->unschedule(_releaseid);
+    }
+    _releasing = false;
+    
+    std::deque<StagedTexture> staged;
+    {
+        std::lock_guard<std::mutex> lock(_stagemutex);
+        staged.swap(_staged);
+        if (_uploading && Application::get() != nullptr) {
+            Application::get()->unschedule(_uploadid);
+            _uploading = false;
+        }
+    }
+    for(auto it = staged.begin(); it != staged.end(); ++it) {
+        releaseSurface(it->surface);
+    }
+    _offthread = 0;
+    
+    std::lock_guard<std::mutex> lock(_stagemutex);
+    for(auto it = _arena.begin(); it != _arena.end(); ++it) {
+        delete *it;
+    }
+    _arena.clear();
+    _arenaSize = 0;
 }
 
 
@@ -172,55 +232,203 @@ SDL_Surface* TextureLoader::preload(const std::string& source) {
         return nullptr;
     }
     
-    SDL_Surface* normal;
 #if CU_MEMORY_ORDER == CU_ORDER_REVERSED
-    normal = SDL_ConvertSurfaceFormat(surface,SDL_PIXELFORMAT_ABGR8888,0);
+    Uint32 format = SDL_PIXELFORMAT_ABGR8888;
 #else
-    normal = SDL_ConvertSurfaceFormat(surface,SDL_PIXELFORMAT_RGBA8888,0);
+    Uint32 format = SDL_PIXELFORMAT_RGBA8888;
 #endif
+
+    // Convert directly into the staging arena when possible
+    SDL_Surface* normal = nullptr;
+    if (!SDL_MUSTLOCK(surface) && !SDL_ISPIXELFORMAT_INDEXED(surface->format->format)) {
+        normal = acquireSurface(surface->w,surface->h,format);
+        if (normal != nullptr &&
+            SDL_ConvertPixels(surface->w, surface->h, surface->format->format, surface->pixels,
+                              surface->pitch, format, normal->pixels, normal->pitch) != 0) {
+            releaseSurface(normal);
+            normal = nullptr;
+        }
+    }
+    if (normal == nullptr) {
+        normal = SDL_ConvertSurfaceFormat(surface,format,0);
+    }
     SDL_FreeSurface(surface);
     return normal;
 }
 
 /**
- * Creates an OpenGL texture from the SDL_Surface, and assigns it the given key.
+ * Loads the portion of this asset that is safe to load outside the main thread.
+ *
+ * This version of preload also supports KTX and KTX2 files (identified by
+ * their suffix).  If the GPU supports the compression format of the file,
+ * this method stores the compressed image in image and returns nullptr.
+ * Otherwise, it decompresses the image (if possible) and returns the
+ * result as an SDL_Surface.  All other files are loaded as with
+ * {@link preload(const std::string&)}.
+ *
+ * @param source    The pathname to the asset
+ * @param image     Reference to store a GPU compressed image
+ *
+ * @return the SDL_Surface with the texture information
+ */
+SDL_Surface* TextureLoader::preload(const std::string& source, std::shared_ptr<CompressedImage>& image) {
+    image = nullptr;
+    size_t dot = source.rfind('.');
+    std::string suffix = (dot == std::string::npos ? "" : source.substr(dot));
+    std::transform(suffix.begin(), suffix.end(), suffix.begin(), ::tolower);
+    if (suffix != ".ktx" && suffix != ".ktx2") {
+        return preload(source);
+    }
+    
+    std::string path = Application::get()->getAssetDirectory();
+    path.append(source);
+    std::shared_ptr<CompressedImage> data = CompressedImage::allocWithFile(path);
+    if (data == nullptr) {
+        return nullptr;
+    } else if (CompressedImage::isSupported(data->getFormat())) {
+        image = data;
+        return nullptr;
+    } else if (!CompressedImage::isDecompressible(data->getFormat())) {
+        CULogError("Compressed format 0x%04X of %s is not supported.", data->getFormat(), source.c_str());
+        return nullptr;
+    }
+    
+    // Fallback to RGBA (byte order R, G, B, A)
+#if CU_MEMORY_ORDER == CU_ORDER_REVERSED
+    Uint32 format = SDL_PIXELFORMAT_ABGR8888;
+#else
+    Uint32 format = SDL_PIXELFORMAT_RGBA8888;
+#endif
+    SDL_Surface* surface = acquireSurface(data->getWidth(),data->getHeight(),format);
+    if (surface != nullptr && !data->decompress((Uint8*)surface->pixels,surface->pitch)) {
+        releaseSurface(surface);
+        surface = nullptr;
+    }
+    return surface;
+}
+
+/**
+ * Creates an OpenGL texture from the compressed image.
  *
  * This method finishes the asset loading started in {@link preload}.  This
  * step is not safe to be done in a separate thread.  Instead, it takes
  * place in the main CUGL thread via {@link Application#schedule}.
  *
- * The loaded texture will have default parameters for scaling and wrap.
- * It will not have any mipmaps.
+ * The texture settings come from the directory entry, if it is not null,
+ * and the loader defaults otherwise. Compressed textures cannot build
+ * mipmaps, so mipmaps are only used if the image contains them.
  *
  * This method supports an optional callback function which reports whether
  * the asset was successfully materialized.
  *
  * @param key       The key to access the asset after loading
- * @param surface   The SDL_Surface to convert
+ * @param json      The asset directory entry (may be nullptr)
+ * @param image     The compressed image
  * @param callback  An optional callback for asynchronous loading
  */
-void TextureLoader::materialize(const std::string& key, SDL_Surface* surface, LoaderCallback callback) {
-    std::shared_ptr<Texture> texture = Texture::allocWithData(surface->pixels, surface->w, surface->h);
+void TextureLoader::materialize(const std::string& key, const std::shared_ptr<JsonValue>& json,
+                                const std::shared_ptr<CompressedImage>& image, LoaderCallback callback) {
+    std::shared_ptr<Texture> texture = Texture::allocWithCompressed(image);
     
     bool success = false;
     if (texture != nullptr) {
+        GLuint minflt = _minfilter;
+        GLuint magflt = _magfilter;
+        GLuint wrapS  = _wraps;
+        GLuint wrapT  = _wrapt;
+        if (json != nullptr) {
+            minflt = decodeMinFilter(json->getString("minfilter",UNKNOWN_MINFLT));
+            magflt = decodeMagFilter(json->getString("magfilter",UNKNOWN_MAGFLT));
+            wrapS = decodeWrap(json->getString("wrapS",UNKNOWN_WRAP));
+            wrapT = decodeWrap(json->getString("wrapT",UNKNOWN_WRAP));
+        }
+        
+        // A mipmap filter without mipmaps would leave the texture incomplete
+        if (!image->hasMipMaps() && minflt != GL_NEAREST && minflt != GL_LINEAR) {
+            minflt = ((minflt == GL_NEAREST_MIPMAP_NEAREST || minflt == GL_NEAREST_MIPMAP_LINEAR) ? GL_NEAREST : GL_LINEAR);
+        }
+        
         _assets[key] = texture;
         texture->bind();
-        if (_mipmaps) { texture->buildMipMaps(); }
-        texture->setMinFilter(_minfilter);
-        texture->setMagFilter(_magfilter);
-        texture->setWrapS(_wraps);
-        texture->setWrapT(_wrapt);
+        texture->setMinFilter(minflt);
+        texture->setMagFilter(magflt);
+        texture->setWrapS(wrapS);
+        texture->setWrapT(wrapT);
         texture->unbind();
+        if (json != nullptr) {
+            parseAtlas(json,texture);
+        }
         success = true;
     }
     
     if (callback != nullptr) {
         callback(key,success);
     }
-    SDL_FreeSurface(surface);
     _queue.erase(key);
 }
+
+/**
+ * Creates an OpenGL texture from the SDL_Surface, and assigns it the given key.
+ *
+ * This method finishes the asset loading started in {@link preload}.  This
+ * step is not safe to be done in a separate thread.  Instead, it takes
+ * place in the main CUGL thread via {@link Application#schedule}.
+ *
+ * The loaded texture will have default parameters for scaling and wrap.
+ * It will not have any mipmaps.
+ *
+ * This method supports an optional callback function which reports whether
+ * the asset was successfully materialized.
+ *
+ * @param key       The key to access the asset after loading
+ * @param surface   The SDL_Surface to convert
+ * @param callback  An optional callback for asynchronous loading
+ */
+void TextureLoader::materialize(const std::string& key, SDL_Surface* surface, LoaderCallback callback) {
+    std::shared_ptr<Texture> texture = allocTexture(key,surface,_minfilter,_magfilter,_wraps,_wrapt,_mipmaps);
+    if (callback != nullptr) {
+        callback(key,texture != nullptr);
+    }
+    releaseSurface(surface);
+    _queue.erase(key);
+}
+
+/**
+ * Returns an OpenGL texture for the SDL_Surface with the given settings.
+ *
+ * This is the shared step of the surface materializers. The texture is
+ * assigned to the given key, but the surface is not released. It is also
+ * used when a texture could not be packed, so that the texture keeps the
+ * per-asset settings that were used to decide whether to pack it.
+ *
+ * This method is not safe to call outside of the main thread.
+ *
+ * @param key       The key to access the asset after loading
+ * @param surface   The SDL_Surface to convert
+ * @param minflt    The texture min filter
+ * @param magflt    The texture mag filter
+ * @param wrapS     The s-coordinate wrap rule
+ * @param wrapT     The t-coordinate wrap rule
+ * @param mipmaps   Whether to build mipmaps
+ *
+ * @return an OpenGL texture for the SDL_Surface (nullptr on failure)
+ */
+std::shared_ptr<Texture> TextureLoader::allocTexture(const std::string& key, SDL_Surface* surface,
+                                                     GLuint minflt, GLuint magflt,
+                                                     GLuint wrapS, GLuint wrapT, bool mipmaps) {
+    std::shared_ptr<Texture> texture = Texture::allocWithData(surface->pixels, surface->w, surface->h);
+    if (texture != nullptr) {
+        _assets[key] = texture;
+        texture->bind();
+        if (mipmaps) { texture->buildMipMaps(); }
+        texture->setMinFilter(minflt);
+        texture->setMagFilter(magflt);
+        texture->setWrapS(wrapS);
+        texture->setWrapT(wrapT);
+        texture->unbind();
+    }
+    return texture;
+}
                                 
 /**
  * Creates an OpenGL texture from the SDL_Surface accoring to the directory entry.
@@ -251,34 +459,22 @@ void TextureLoader::materialize(const std::string& key, SDL_Surface* surface, Lo
  * @param callback  An optional callback for asynchronous loading
  */
 void TextureLoader::materialize(const std::shared_ptr<JsonValue>& json, SDL_Surface* surface, LoaderCallback callback) {
-    std::shared_ptr<Texture> texture = Texture::allocWithData(surface->pixels, surface->w, surface->h);
     std::string key = json->key();
+    GLuint minflt = decodeMinFilter(json->getString("minfilter",UNKNOWN_MINFLT));
+    GLuint magflt = decodeMagFilter(json->getString("magfilter",UNKNOWN_MAGFLT));
+    GLuint wrapS = decodeWrap(json->getString("wrapS",UNKNOWN_WRAP));
+    GLuint wrapT = decodeWrap(json->getString("wrapT",UNKNOWN_WRAP));
+    bool mipmaps = json->getBool("mipmaps",false);
 
-    bool success = false;
+    std::shared_ptr<Texture> texture = allocTexture(key,surface,minflt,magflt,wrapS,wrapT,mipmaps);
     if (texture != nullptr) {
-        GLuint minflt = decodeMinFilter(json->getString("minfilter",UNKNOWN_MINFLT));
-        GLuint magflt = decodeMinFilter(json->getString("magfilter",UNKNOWN_MAGFLT));
-        GLuint wrapS = decodeWrap(json->getString("wrapS",UNKNOWN_WRAP));
-        GLuint wrapT = decodeWrap(json->getString("wrapT",UNKNOWN_WRAP));
-        bool mipmaps = json->getBool("mipmaps",false);
-
-        _assets[key] = texture;
-        texture->bind();
-        if (mipmaps) { texture->buildMipMaps(); }
-        texture->setMinFilter(minflt);
-        texture->setMagFilter(magflt);
-        texture->setWrapS(wrapS);
-        texture->setWrapT(wrapT);
-        texture->unbind();
         parseAtlas(json,texture);
-        
-        success = true;
     }
     
     if (callback != nullptr) {
-        callback(key,success);
+        callback(key,texture != nullptr);
     }
-    SDL_FreeSurface(surface);
+    releaseSurface(surface);
     _queue.erase(key);
 }
 
@@ -306,6 +502,25 @@ bool TextureLoader::read(const std::string& key, const std::string& source, Load
     }
     _queue.emplace(key);
     
+    bool packed = isPackable(_wraps,_wrapt,_mipmaps);
+    GLuint minflt = _minfilter;
+    GLuint magflt = _magfilter;
+    if (packed && (_loader == nullptr || !async)) {
+        SDL_Surface* surface = preload(source);
+        if (surface != nullptr) {
+            std::shared_ptr<AtlasPage> page = pack(key,surface,minflt,magflt);
+            if (page != nullptr) {
+                materialize(key,page,surface,nullptr);
+            } else {
+                // Keep the settings that we packed with
+                allocTexture(key,surface,minflt,magflt,_wraps,_wrapt,_mipmaps);
+                releaseSurface(surface);
+                _queue.erase(key);
+            }
+            return _assets.find(key) != _assets.end();
+        }
+    }
+    
     bool success = false;
     if (_loader == nullptr || !async) {
         std::shared_ptr<Texture> texture = Texture::allocWithFile(source);
@@ -315,12 +530,15 @@ bool TextureLoader::read(const std::string& key, const std::string& source, Load
 		}
         _queue.erase(key);
     } else {
-        _loader->addTask([=](void) {
-            SDL_Surface* surface = this->preload(source);
-            Application::get()->schedule([=](void){
-                this->materialize(key,surface,callback);
-                return false;
-            });
+        _offthread++;
+        getDecoders()->addTask([=](void) {
+            StagedTexture item;
+            item.key = key;
+            item.json = nullptr;
+            item.surface = this->preload(source,item.image);
+            item.page = (packed ? this->pack(key,item.surface,minflt,magflt) : nullptr);
+            item.callback = callback;
+            this->stage(item);
         });
     }
 
@@ -360,6 +578,7 @@ bool TextureLoader::read(const std::string& key, const std::string& source, Load
  *      "magfilter":    The name of the min filter ("nearest" or "linear")
  *      "wrapS":        The s-coord wrap rule ("clamp", "repeat", or "mirrored")
  *      "wrapT":        The t-coord wrap rule ("clamp", "repeat", or "mirrored")
+ *      "packed":       Whether to allow atlas packing (bool, default true)
  *
  * @param json      The directory entry for the asset
  * @param callback  An optional callback for asynchronous loading
@@ -375,6 +594,32 @@ bool TextureLoader::read(const std::shared_ptr<JsonValue>& json, LoaderCallback
     _queue.emplace(key);
     
     std::string source = json->getString("file",UNKNOWN_SOURCE);
+
+    // Get the settings if they exist
+    GLuint minflt = decodeMinFilter(json->getString("minfilter",UNKNOWN_MINFLT));
+    GLuint magflt = decodeMagFilter(json->getString("magfilter",UNKNOWN_MAGFLT));
+    GLuint wrapS = decodeWrap(json->getString("wrapS",UNKNOWN_WRAP));
+    GLuint wrapT = decodeWrap(json->getString("wrapT",UNKNOWN_WRAP));
+    bool mipmaps = json->getBool("mipmaps",false);
+
+    // Atlases already have their own subtextures
+    bool packed = isPackable(wrapS,wrapT,mipmaps) && json->getBool("packed",true) && !json->has("atlas");
+    if (packed && (_loader == nullptr || !async)) {
+        SDL_Surface* surface = preload(source);
+        if (surface != nullptr) {
+            std::shared_ptr<AtlasPage> page = pack(key,surface,minflt,magflt);
+            if (page != nullptr) {
+                materialize(key,page,surface,nullptr);
+            } else {
+                // Keep the per-asset settings (packed entries have no atlas)
+                allocTexture(key,surface,minflt,magflt,wrapS,wrapT,mipmaps);
+                releaseSurface(surface);
+                _queue.erase(key);
+            }
+            return _assets.find(key) != _assets.end();
+        }
+    }
+
     bool success = false;
     if (_loader == nullptr || !async) {
         std::shared_ptr<Texture> texture = Texture::allocWithFile(source);
@@ -384,23 +629,19 @@ bool TextureLoader::read(const std::shared_ptr<JsonValue>& json, LoaderCallback
 		}
         _queue.erase(key);
     } else {
-        _loader->addTask([=](void) {
-            SDL_Surface* surface = this->preload(source);
-            Application::get()->schedule([=](void){
-                this->materialize(json,surface,callback);
-                return false;
-            });
+        _offthread++;
+        getDecoders()->addTask([=](void) {
+            StagedTexture item;
+            item.key = key;
+            item.json = json;
+            item.surface = this->preload(source,item.image);
+            item.page = (packed ? this->pack(key,item.surface,minflt,magflt) : nullptr);
+            item.callback = callback;
+            this->stage(item);
         });
     }
     
     if (success) {
-        // Get the settings if they exist
-        GLuint minflt = decodeMinFilter(json->getString("minfilter",UNKNOWN_MINFLT));
-        GLuint magflt = decodeMinFilter(json->getString("magfilter",UNKNOWN_MAGFLT));
-        GLuint wrapS = decodeWrap(json->getString("wrapS",UNKNOWN_WRAP));
-        GLuint wrapT = decodeWrap(json->getString("wrapT",UNKNOWN_WRAP));
-        bool mipmaps = json->getBool("mipmaps",false);
-        
         std::shared_ptr<Texture> texture = get(key);
         texture->bind();
         if (mipmaps) { texture->buildMipMaps(); }
@@ -485,3 +726,459 @@ void TextureLoader::parseAtlas(const std::shared_ptr<JsonValue>& json, const std
     }
 }
 
+
+
+#pragma mark -
+#pragma mark Staged Uploads
+/**
+ * Returns the thread pool for decoding images
+ *
+ * The pool is allocated the first time it is needed.  If it cannot be
+ * allocated, this method returns the thread pool of the loader.
+ *
+ * @return the thread pool for decoding images
+ */
+std::shared_ptr<ThreadPool> TextureLoader::getDecoders() {
+    std::lock_guard<std::mutex> lock(_stagemutex);
+    if (_decoders == nullptr) {
+        int threads = _decodeThreads;
+        if (threads <= 0) {
+            threads = std::max(1,std::min(4,SDL_GetCPUCount()-1));
+        }
+        _decoders = ThreadPool::alloc(threads);
+    }
+    return (_decoders == nullptr ? _loader : _decoders);
+}
+
+/**
+ * Returns a surface whose pixels belong to the staging arena
+ *
+ * The surface reuses the smallest free buffer of the arena that is large
+ * enough, allocating a new buffer if necessary.  The surface must be
+ * released with {@link releaseSurface}.  This method is safe to call
+ * outside of the main thread.
+ *
+ * @param width     The surface width
+ * @param height    The surface height
+ * @param format    The SDL pixel format (must be 32 bits)
+ *
+ * @return a surface whose pixels belong to the staging arena
+ */
+SDL_Surface* TextureLoader::acquireSurface(int width, int height, Uint32 format) {
+    size_t bytes = (size_t)width*height*4;
+    std::vector<Uint8>* buffer = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(_stagemutex);
+        size_t best = 0;
+        for(size_t ii = 0; ii < _arena.size(); ii++) {
+            size_t capacity = _arena[ii]->capacity();
+            if (capacity >= bytes && (buffer == nullptr || capacity < buffer->capacity())) {
+                buffer = _arena[ii];
+                best = ii;
+            }
+        }
+        if (buffer != nullptr) {
+            _arena[best] = _arena.back();
+            _arena.pop_back();
+            _arenaSize -= buffer->capacity();
+        }
+    }
+    
+    if (buffer == nullptr) {
+        buffer = new std::vector<Uint8>();
+    }
+    buffer->resize(bytes);
+    SDL_Surface* result = SDL_CreateRGBSurfaceWithFormatFrom(buffer->data(),width,height,32,width*4,format);
+    if (result == nullptr) {
+        delete buffer;
+        return nullptr;
+    }
+    result->userdata = buffer;
+    return result;
+}
+
+/**
+ * Releases a surface, returning its pixels to the staging arena
+ *
+ * If the surface did not come from {@link acquireSurface}, or the arena
+ * is already full, the pixels are simply deleted.
+ *
+ * @param surface   The surface to release
+ */
+void TextureLoader::releaseSurface(SDL_Surface* surface) {
+    if (surface == nullptr) {
+        return;
+    }
+    
+    std::vector<Uint8>* buffer = (std::vector<Uint8>*)surface->userdata;
+    SDL_FreeSurface(surface);
+    if (buffer != nullptr) {
+        std::lock_guard<std::mutex> lock(_stagemutex);
+        if (_arenaSize+buffer->capacity() <= TEXTURE_ARENA_LIMIT) {
+            _arena.push_back(buffer);
+            _arenaSize += buffer->capacity();
+        } else {
+            delete buffer;
+        }
+    }
+}
+
+/**
+ * Adds a decoded texture to the upload queue
+ *
+ * This method is safe to call outside of the main thread. It schedules
+ * the upload callback if it is not already active.
+ *
+ * @param item      The decoded texture
+ */
+void TextureLoader::stage(const StagedTexture& item) {
+    std::lock_guard<std::mutex> lock(_stagemutex);
+    _staged.push_back(item);
+    if (!_uploading) {
+        _uploading = true;
+        _uploadid = Application::get()->schedule([=](void){
+            return this->upload();
+        });
+    }
+}
+
+/**
+ * Uploads staged textures until the time budget is exhausted
+ *
+ * This method is executed in the main thread via {@link Application#schedule}.
+ * It returns true if there are still staged textures, so that the
+ * callback repeats on the next animation frame.
+ *
+ * @return true if there are still staged textures
+ */
+bool TextureLoader::upload() {
+    Uint64 start = SDL_GetPerformanceCounter();
+    Uint64 limit = (SDL_GetPerformanceFrequency()*_budget)/1000;
+    while (true) {
+        StagedTexture item;
+        {
+            std::lock_guard<std::mutex> lock(_stagemutex);
+            if (_staged.empty()) {
+                _uploading = false;
+                return false;
+            }
+            item = _staged.front();
+            _staged.pop_front();
+        }
+        
+        if (item.image != nullptr) {
+            materialize(item.key,item.json,item.image,item.callback);
+        } else if (item.surface == nullptr) {
+            if (item.callback != nullptr) {
+                item.callback(item.key,false);
+            }
+            _queue.erase(item.key);
+        } else if (item.page != nullptr) {
+            materialize(item.key,item.page,item.surface,item.callback);
+        } else if (item.json != nullptr) {
+            materialize(item.json,item.surface,item.callback);
+        } else {
+            materialize(item.key,item.surface,item.callback);
+        }
+        if (_offthread > 0) {
+            _offthread--;
+        }
+        
+        if (SDL_GetPerformanceCounter()-start >= limit) {
+            std::lock_guard<std::mutex> lock(_stagemutex);
+            _uploading = !_staged.empty();
+            return _uploading;
+        }
+    }
+}
+
+#pragma mark -
+#pragma mark Atlas Packing
+/**
+ * Returns true if there is room for a rectangle of the given size
+ *
+ * This method uses the best short side fit heuristic of MaxRects.  It
+ * chooses the free rectangle that leaves the smallest leftover along
+ * its shorter side. If there is room, the position is stored in result.
+ *
+ * @param empty     The maximal free rectangles of a page
+ * @param width     The rectangle width
+ * @param height    The rectangle height
+ * @param result    The rectangle to store the position
+ *
+ * @return true if there is room for a rectangle of the given size
+ */
+bool TextureLoader::findSpace(const std::vector<AtlasRect>& empty, int width, int height, AtlasRect& result) {
+    int bestShort = INT_MAX;
+    int bestLong  = INT_MAX;
+    for(auto it = empty.begin(); it != empty.end(); ++it) {
+        if (it->width >= width && it->height >= height) {
+            int leftH = it->width-width;
+            int leftV = it->height-height;
+            int shortSide = std::min(leftH,leftV);
+            int longSide  = std::max(leftH,leftV);
+            if (shortSide < bestShort || (shortSide == bestShort && longSide < bestLong)) {
+                result.x = it->x;
+                result.y = it->y;
+                result.width  = width;
+                result.height = height;
+                bestShort = shortSide;
+                bestLong  = longSide;
+            }
+        }
+    }
+    return bestShort != INT_MAX;
+}
+
+/**
+ * Removes the used rectangle from the free rectangles of a page
+ *
+ * Every free rectangle overlapping the used rectangle is split into
+ * (up to four) maximal rectangles around it.  Any free rectangle
+ * contained in another is then pruned.
+ *
+ * @param empty     The maximal free rectangles of a page
+ * @param used      The newly used rectangle
+ */
+void TextureLoader::claimSpace(std::vector<AtlasRect>& empty, const AtlasRect& used) {
+    std::vector<AtlasRect> split;
+    for(size_t ii = 0; ii < empty.size(); ) {
+        AtlasRect rect = empty[ii];
+        if (used.x >= rect.x+rect.width  || used.x+used.width  <= rect.x ||
+            used.y >= rect.y+rect.height || used.y+used.height <= rect.y) {
+            ii++;
+            continue;
+        }
+        
+        // Split into the maximal rectangles on each side
+        if (used.x > rect.x) {
+            split.push_back({rect.x, rect.y, used.x-rect.x, rect.height});
+        }
+        if (used.x+used.width < rect.x+rect.width) {
+            int x = used.x+used.width;
+            split.push_back({x, rect.y, rect.x+rect.width-x, rect.height});
+        }
+        if (used.y > rect.y) {
+            split.push_back({rect.x, rect.y, rect.width, used.y-rect.y});
+        }
+        if (used.y+used.height < rect.y+rect.height) {
+            int y = used.y+used.height;
+            split.push_back({rect.x, y, rect.width, rect.y+rect.height-y});
+        }
+        empty[ii] = empty.back();
+        empty.pop_back();
+    }
+    empty.insert(empty.end(),split.begin(),split.end());
+    
+    // Prune rectangles contained in another
+    for(size_t ii = 0; ii < empty.size(); ii++) {
+        for(size_t jj = ii+1; jj < empty.size(); ) {
+            const AtlasRect& a = empty[ii];
+            const AtlasRect& b = empty[jj];
+            if (b.x >= a.x && b.y >= a.y && b.x+b.width <= a.x+a.width && b.y+b.height <= a.y+a.height) {
+                empty.erase(empty.begin()+jj);
+            } else if (a.x >= b.x && a.y >= b.y && a.x+a.width <= b.x+b.width && a.y+a.height <= b.y+b.height) {
+                empty.erase(empty.begin()+ii);
+                jj = ii+1;
+            } else {
+                jj++;
+            }
+        }
+    }
+}
+
+/**
+ * Returns the atlas page after packing the surface into it
+ *
+ * This method is safe to call outside of the main thread. It finds room
+ * for the surface in an existing page with the same filters, creating a
+ * new page if necessary, and copies the pixels into the page.  If the
+ * surface is too large to pack, this method returns nullptr.
+ *
+ * @param key       The key to access the asset after loading
+ * @param surface   The surface to pack
+ * @param minflt    The texture min filter
+ * @param magflt    The texture mag filter
+ *
+ * @return the atlas page after packing the surface into it
+ */
+std::shared_ptr<TextureLoader::AtlasPage> TextureLoader::pack(const std::string& key, SDL_Surface* surface,
+                                                              GLuint minflt, GLuint magflt) {
+    if (surface == nullptr || surface->w <= 0 || surface->h <= 0 ||
+        surface->w > _packLimit || surface->h > _packLimit) {
+        return nullptr;
+    }
+    
+    std::lock_guard<std::mutex> lock(_pagemutex);
+    int border = ATLAS_PACK_BORDER;
+    int width  = surface->w+2*border;
+    int height = surface->h+2*border;
+    if (width > _pageSize || height > _pageSize) {
+        return nullptr;
+    }
+    
+    std::shared_ptr<AtlasPage> page = nullptr;
+    AtlasRect cell;
+    for(auto it = _pages.begin(); page == nullptr && it != _pages.end(); ++it) {
+        AtlasPage* current = it->get();
+        if (current->minfilter == minflt && current->magfilter == magflt &&
+            current->surface->format->format == surface->format->format &&
+            findSpace(current->empty,width,height,cell)) {
+            page = *it;
+        }
+    }
+    
+    if (page == nullptr) {
+        SDL_Surface* pixels = SDL_CreateRGBSurfaceWithFormat(0,_pageSize,_pageSize,32,surface->format->format);
+        if (pixels == nullptr) {
+            return nullptr;
+        }
+        SDL_memset(pixels->pixels,0,pixels->pitch*pixels->h);
+        page = std::make_shared<AtlasPage>();
+        page->surface = pixels;
+        page->minfilter = minflt;
+        page->magfilter = magflt;
+        page->border = border;
+        page->empty.push_back({0,0,_pageSize,_pageSize});
+        findSpace(page->empty,width,height,cell);
+        _pages.push_back(page);
+    }
+    claimSpace(page->empty,cell);
+    
+    // Copy the pixels, extruding the edges into the border
+    const int bpp = 4;
+    Uint8* dst = (Uint8*)page->surface->pixels;
+    const Uint8* src = (const Uint8*)surface->pixels;
+    for(int row = 0; row < cell.height; row++) {
+        int sy = std::min(std::max(row-border,0),surface->h-1);
+        Uint8* drow = dst+(cell.y+row)*page->surface->pitch+cell.x*bpp;
+        const Uint8* srow = src+sy*surface->pitch;
+        for(int ii = 0; ii < border; ii++) {
+            SDL_memcpy(drow+ii*bpp,srow,bpp);
+            SDL_memcpy(drow+(border+surface->w+ii)*bpp,srow+(surface->w-1)*bpp,bpp);
+        }
+        SDL_memcpy(drow+border*bpp,srow,surface->w*bpp);
+    }
+    
+    page->placed[key] = {cell.x+border, cell.y+border, surface->w, surface->h};
+    if (page->texture != nullptr) {
+        page->pending.emplace(key);
+    }
+    return page;
+}
+
+/**
+ * Assigns the given key a subtexture of the atlas page
+ *
+ * This method finishes the asset loading started in {@link pack}.  This
+ * step is not safe to be done in a separate thread.  Instead, it takes
+ * place in the main CUGL thread via {@link Application#schedule}.
+ *
+ * If the page has not been uploaded yet, this method uploads the entire
+ * page, including any textures packed since.  Otherwise it only copies
+ * the region for this texture (if it was packed after the upload).
+ *
+ * This method supports an optional callback function which reports whether
+ * the asset was successfully materialized.
+ *
+ * @param key       The key to access the asset after loading
+ * @param page      The page containing the texture
+ * @param surface   The original SDL_Surface (to be released)
+ * @param callback  An optional callback for asynchronous loading
+ */
+void TextureLoader::materialize(const std::string& key, const std::shared_ptr<AtlasPage>& page,
+                                SDL_Surface* surface, LoaderCallback callback) {
+    bool success = false;
+    {
+        std::lock_guard<std::mutex> lock(_pagemutex);
+        SDL_Surface* pixels = page->surface;
+        if (page->texture == nullptr) {
+            page->texture = Texture::allocWithData(pixels->pixels, pixels->w, pixels->h);
+            if (page->texture != nullptr) {
+                page->texture->bind();
+                page->texture->setMinFilter(page->minfilter);
+                page->texture->setMagFilter(page->magfilter);
+                page->texture->setWrapS(GL_CLAMP_TO_EDGE);
+                page->texture->setWrapT(GL_CLAMP_TO_EDGE);
+                page->texture->unbind();
+                page->pending.clear();
+            }
+        } else if (page->pending.erase(key)) {
+            // Copy the region (with its border) into a contiguous buffer
+            const AtlasRect& image = page->placed[key];
+            const int bpp = 4;
+            int x = image.x-page->border;
+            int y = image.y-page->border;
+            int w = image.width+2*page->border;
+            int h = image.height+2*page->border;
+            std::vector<Uint8> buffer(w*h*bpp);
+            const Uint8* src = (const Uint8*)pixels->pixels;
+            for(int row = 0; row < h; row++) {
+                SDL_memcpy(buffer.data()+row*w*bpp,src+(y+row)*pixels->pitch+x*bpp,w*bpp);
+            }
+            page->texture->bind();
+            page->texture->set(buffer.data(),x,y,w,h);
+            page->texture->unbind();
+        }
+        
+        auto it = page->placed.find(key);
+        if (page->texture != nullptr && it != page->placed.end()) {
+            const AtlasRect& image = it->second;
+            GLfloat width  = (GLfloat)pixels->w;
+            GLfloat height = (GLfloat)pixels->h;
+            _assets[key] = page->texture->getSubTexture(image.x/width, (image.x+image.width)/width,
+                                                        image.y/height,(image.y+image.height)/height);
+            success = true;
+        }
+    }
+    
+    if (callback != nullptr) {
+        callback(key,success);
+    }
+    releaseSurface(surface);
+    _queue.erase(key);
+    scheduleRelease();
+}
+
+/**
+ * Schedules the release of the CPU pixels of the atlas pages
+ *
+ * Each page keeps a CPU copy of its pixels (4 bytes per pixel of the
+ * page size) so that textures packed after the upload can be copied to
+ * the GPU. Once a load batch is finished, this copy is no longer needed.
+ * This method schedules a callback in the main thread that waits until
+ * no texture loads are pending, and then releases the active pages.
+ * Textures loaded later are packed into new pages.
+ *
+ * The page textures are not affected. They remain in use until all of
+ * their subtextures are released.
+ */
+void TextureLoader::scheduleRelease() {
+    if (_releasing || Application::get() == nullptr) {
+        return;
+    }
+    _releasing = true;
+    _releaseid = Application::get()->schedule([=](void){
+        return this->releasePages();
+    });
+}
+
+/**
+ * Releases the CPU pixels of the atlas pages if no loads are pending
+ *
+ * This method is executed in the main thread via {@link Application#schedule}.
+ * It returns true if texture loads are still pending, so that the
+ * callback repeats on the next animation frame.
+ *
+ * @return true if texture loads are still pending
+ */
+bool TextureLoader::releasePages() {
+    // A synchronous batch finishes within a frame, and async loads stay queued
+    if (!_queue.empty()) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(_pagemutex);
+    _pages.clear();
+    _releasing = false;
+    return false;
+}
@@ -440,6 +440,19 @@ std::shared_ptr<AudioQueue> AudioEngine::getMusicQueue() const {
     return _queues[0];
 }
 
+/**
+ * Returns the sample rate of the output device for this audio engine
+ *
+ * Sounds at any other rate are resampled during playback. Loaders can
+ * use this value to convert in-memory samples once, at load time (see
+ * {@link SoundLoader#setSampleRate}).
+ *
+ * @return the sample rate of the output device for this audio engine
+ */
+Uint32 AudioEngine::getSampleRate() const {
+    return _output == nullptr ? 0 : _output->getRate();
+}
+
 /**
  * Allocates a new queue for managing audio.
  *
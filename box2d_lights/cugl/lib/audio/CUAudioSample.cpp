@@ -40,6 +40,14 @@
 #include <cugl/util/CUDebug.h>
 #include <cugl/util/CUFiletools.h>
 #include <cugl/audio/codecs/cu_codecs.h>
+#include <cugl/math/dsp/CUPolyphaseFilter.h>
+#include <algorithm>
+#include <cmath>
+
+/** The alignment of in-memory PCM data (for vectorization) */
+#define PCM_ALIGNMENT   16
+/** The number of frames converted at a time by resample */
+#define RESAMPLE_CHUNK  1024
 
 using namespace cugl;
 
@@ -86,7 +94,8 @@ bool AudioSample::init(const char* file, bool stream) {
     _rate   = decoder->getSampleRate();
     
     if (!_stream) {
-        _buffer = (float*)SDL_malloc((size_t)(_frames*_channels*sizeof(float)));
+        _pcmdata = Aligned<float>::alloc((size_t)(_frames*_channels),PCM_ALIGNMENT);
+        _buffer = *_pcmdata;
         Sint64 size = decoder->decode(_buffer);
         return size >= 0;
     }
@@ -110,12 +119,40 @@ bool AudioSample::init(Uint8 channels, Uint32 rate, Uint32 frames) {
     _channels = channels;
     _frames = frames;
     _rate = rate;
-    _buffer = (float*)SDL_malloc((size_t)(_channels*_frames*sizeof(float)));
+    _pcmdata = Aligned<float>::alloc((size_t)(_channels*_frames),PCM_ALIGNMENT);
+    _pcmdata->clear();
+    _buffer = *_pcmdata;
     _stream = false;
     _type  = Type::IN_MEMORY;
     return true;
 }
 
+/**
+ * Initializes an audio sample that shares the data of another sample.
+ *
+ * If the source is in-memory, this sample shares its PCM buffer rather
+ * than decoding the file again. Otherwise, this sample streams from the
+ * same file. Only the volume and other sound attributes are distinct.
+ *
+ * @param source    The audio sample to share
+ *
+ * @return true if the audio sample was initialized successfully
+ */
+bool AudioSample::init(const std::shared_ptr<AudioSample>& source) {
+    if (source == nullptr) {
+        return false;
+    }
+    _file = source->_file;
+    _type = source->_type;
+    _channels = source->_channels;
+    _frames = source->_frames;
+    _rate   = source->_rate;
+    _stream = source->_stream;
+    _pcmdata = source->_pcmdata;
+    _buffer  = source->_buffer;
+    return true;
+}
+
 /**
  * Returns a newly allocated audio sample with the given JSON specificaton.
  *
@@ -161,13 +198,56 @@ void AudioSample::dispose() {
     _frames = 0;
     _channels = 0;
     _stream = false;
-    if (_buffer != nullptr) {
-        SDL_free(_buffer);
-        _buffer = nullptr;
-    }
+    _pcmdata = nullptr;
+    _buffer  = nullptr;
     _type = Type::UNKNOWN;
 }
 
+/**
+ * Converts the in-memory PCM data to the given sample rate.
+ *
+ * This is intended to be called once at load time, so that playback
+ * at the device rate does not need an {@link audio::AudioResampler}.
+ * It has no effect on streamed samples, or if the rate is unchanged.
+ * The sample must not be playing, and its buffer must not be shared,
+ * when this method is called.
+ *
+ * @param rate  The new sample rate
+ *
+ * @return true if the sample was converted
+ */
+bool AudioSample::resample(Uint32 rate) {
+    if (_stream || _buffer == nullptr || rate == 0 || rate == _rate) {
+        return false;
+    }
+    CUAssertLog(_pcmdata.use_count() == 1, "Cannot resample a shared buffer");
+
+    Uint64 frames = (Uint64)std::ceil((double)_frames*rate/_rate);
+    std::shared_ptr<Aligned<float>> data = Aligned<float>::alloc((size_t)(frames*_channels),PCM_ALIGNMENT);
+    dsp::PolyphaseFilter filter(_channels,_rate,rate,RESAMPLE_CHUNK);
+
+    // Pad the end with silence to flush the filter
+    Uint64 readpos = 0;
+    Uint64 outpos  = 0;
+    while (outpos < frames) {
+        size_t want = (size_t)std::min(frames-outpos,(Uint64)RESAMPLE_CHUNK);
+        size_t need = filter.getInputNeeded(want);
+        float* input = filter.getInputBuffer();
+        size_t avail = (size_t)std::min((Uint64)need,_frames-std::min(readpos,_frames));
+        std::memcpy(input,_buffer+readpos*_channels,avail*_channels*sizeof(float));
+        std::memset(input+avail*_channels,0,(need-avail)*_channels*sizeof(float));
+        filter.appendInput(need);
+        readpos += need;
+        outpos += filter.calculate(*data+outpos*_channels,want);
+    }
+
+    _pcmdata = data;
+    _buffer = *_pcmdata;
+    _frames = frames;
+    _rate = rate;
+    return true;
+}
+
 #pragma mark -
 #pragma mark Decoder Supports
 /**
@@ -34,14 +34,36 @@
 //  Version: 11/7/18
 //
 #include <cugl/audio/graph/CUAudioMixer.h>
-#include <cugl/audio/CUAudioDevices.h>
 #include <cugl/math/dsp/CUDSPMath.h>
 #include <cugl/util/CUDebug.h>
 #include <atomic>
+#if defined (_MSC_VER)
+    #include <intrin.h>
+#endif
 
 using namespace cugl;
 using namespace cugl::audio;
 
+/** The number of slots tracked by each occupancy word */
+#define SLOTS_PER_WORD  64
+
+/**
+ * Returns the index of the lowest set bit of a (nonzero) occupancy word
+ *
+ * @param bits  The occupancy word
+ *
+ * @return the index of the lowest set bit of a (nonzero) occupancy word
+ */
+static inline Uint32 lowest_slot(Uint64 bits) {
+#if defined (_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index,bits);
+    return (Uint32)index;
+#else
+    return (Uint32)__builtin_ctzll(bits);
+#endif
+}
+
 /** The default number of inputs supported (typically 8) */
 const Uint8 AudioMixer::DEFAULT_WIDTH = 8;
 /** The standard knee value for preventing clipping */
@@ -57,11 +79,14 @@ const float AudioMixer::DEFAULT_KNEE  = 0.9;
  * must be initialized to be used.
  */
 AudioMixer::AudioMixer() :
+_inputs(nullptr),
+_staged(nullptr),
+_occupied(nullptr),
 _width(0),
-_knee(-1),
+_buffer(nullptr),
 _capacity(0),
-_inputs(nullptr),
-_buffer(nullptr) {
+_knee(-1),
+_cycle(0) {
     _classname = "AudioScheduler";
 #if CU_PLATFORM == CU_PLATFORM_ANDROID
 	// Android handles clipping very badly.
@@ -144,10 +169,18 @@ bool AudioMixer::init(Uint8 width, Uint8 channels, Uint32 rate) {
         CUAssertLog(width,"Mixer width is 0");
         _width = width;
         _knee  = -1;
-        _capacity = AudioDevices::get()->getReadSize();
+        _capacity = getDefaultReadSize();
+        _cycle = 0;
         _inputs = new std::shared_ptr<AudioNode>[_width];
+        _staged = new std::atomic<AudioNode*>[_width];
         for (int ii = 0; ii < _width; ii++) {
             _inputs[ii] = nullptr;
+            _staged[ii] = nullptr;
+        }
+        Uint32 words = (_width+SLOTS_PER_WORD-1)/SLOTS_PER_WORD;
+        _occupied = new std::atomic<Uint64>[words];
+        for (Uint32 ii = 0; ii < words; ii++) {
+            _occupied[ii] = 0;
         }
         _buffer = (float*)malloc(_capacity*_channels*sizeof(float));
         return true;
@@ -165,8 +198,13 @@ void AudioMixer::dispose() {
     if (_booted) {
         AudioNode::dispose();
         delete[] _inputs;
+        delete[] _staged;
+        delete[] _occupied;
         free(_buffer);
+        _retired.clear();
         _inputs = nullptr;
+        _staged = nullptr;
+        _occupied = nullptr;
         _buffer = nullptr;
         _width = 0;
         _knee  = -1;
@@ -203,7 +241,12 @@ std::shared_ptr<AudioNode> AudioMixer::attach(Uint8 slot, const std::shared_ptr<
     }
     _marked.store(0,std::memory_order_relaxed);
     _offset.store(0,std::memory_order_relaxed);
-    return std::atomic_exchange_explicit(_inputs+slot,input,std::memory_order_relaxed);
+    std::shared_ptr<AudioNode> result = _inputs[slot];
+    _inputs[slot] = input;
+    _staged[slot].store(input.get());
+    _occupied[slot/SLOTS_PER_WORD].fetch_or((Uint64)1 << (slot % SLOTS_PER_WORD));
+    retire(result);
+    return result;
 }
 
 /**
@@ -217,7 +260,12 @@ std::shared_ptr<AudioNode> AudioMixer::attach(Uint8 slot, const std::shared_ptr<
  */
 std::shared_ptr<AudioNode> AudioMixer::detach(Uint8 slot) {
     CUAssertLog(slot < _width, "Slot %d is out of range",slot);
-    return std::atomic_exchange_explicit(_inputs+slot,{},std::memory_order_relaxed);
+    std::shared_ptr<AudioNode> result = _inputs[slot];
+    _inputs[slot] = nullptr;
+    _occupied[slot/SLOTS_PER_WORD].fetch_and(~((Uint64)1 << (slot % SLOTS_PER_WORD)));
+    _staged[slot].store(nullptr);
+    retire(result);
+    return result;
 }
 
 /**
@@ -239,29 +287,54 @@ std::shared_ptr<AudioNode> AudioMixer::detach(Uint8 slot) {
  * @return the actual number of frames read
  */
 Uint32 AudioMixer::read(float* buffer, Uint32 frames) {
-    std::memset(buffer,0,frames*_channels*sizeof(float));
-    frames = std::min(frames,_capacity);
+    if (frames > _capacity) {
+        std::memset(buffer+_capacity*_channels,0,(frames-_capacity)*_channels*sizeof(float));
+        frames = _capacity;
+    }
     Uint32 actual = 0;
     if (!_paused.load(std::memory_order_relaxed)) {
-        std::lock_guard<std::mutex> lock(_mutex);
-        std::shared_ptr<AudioNode> temp;
-        for(int ii = 0; ii < _width; ii++) {
-            temp = std::atomic_load_explicit(_inputs+ii,std::memory_order_relaxed);
-            if (temp) {
-                Uint32 amt = temp->read(_buffer,frames);
-                actual = std::max(amt,actual);
-                if (amt < frames) {
-                    std::memset(_buffer+amt,0,(frames-amt)*_channels*sizeof(float));
+        // The gain is folded into the accumulation of each input
+        float gain = _ndgain.load(std::memory_order_relaxed);
+        Uint32 words = (_width+SLOTS_PER_WORD-1)/SLOTS_PER_WORD;
+        bool first = true;
+        for(Uint32 kk = 0; kk < words; kk++) {
+            Uint64 bits = _occupied[kk].load();
+            while (bits) {
+                Uint32 ii = kk*SLOTS_PER_WORD+lowest_slot(bits);
+                bits &= bits-1;
+                
+                // Raw pointers, so that this thread never releases an input
+                AudioNode* temp = _staged[ii].load();
+                if (temp == nullptr) {
+                    continue;
+                } else if (first) {
+                    // The first input is read in place
+                    Uint32 amt = temp->read(buffer,frames);
+                    if (amt < frames) {
+                        std::memset(buffer+amt*_channels,0,(frames-amt)*_channels*sizeof(float));
+                    }
+                    if (gain != 1) {
+                        dsp::DSPMath::scale(buffer,gain,buffer,amt*_channels);
+                    }
+                    actual = amt;
+                    first = false;
+                } else {
+                    Uint32 amt = temp->read(_buffer,frames);
+                    dsp::DSPMath::scale_add(_buffer,buffer,gain,buffer,amt*_channels);
+                    actual = std::max(amt,actual);
                 }
-                dsp::DSPMath::add(_buffer,buffer,buffer,frames*_channels);
             }
         }
-        dsp::DSPMath::scale(buffer,_ndgain.load(std::memory_order_relaxed),buffer,frames*_channels);
-        float knee = _knee.load(std::memory_order_relaxed);
-        if (knee == 1) {
-            dsp::DSPMath::clamp(buffer,-1,1,frames*_channels);
-        } else if (knee > 0) {
-            dsp::DSPMath::ease(buffer,1,knee,frames*_channels);
+        
+        if (first) {
+            std::memset(buffer,0,frames*_channels*sizeof(float));
+        } else {
+            float knee = _knee.load(std::memory_order_relaxed);
+            if (knee == 1) {
+                dsp::DSPMath::clamp(buffer,-1,1,actual*_channels);
+            } else if (knee > 0) {
+                dsp::DSPMath::ease(buffer,1,knee,actual*_channels);
+            }
         }
     } else {
         std::memset(buffer,0,frames*sizeof(float)*_channels);
@@ -270,6 +343,7 @@ Uint32 AudioMixer::read(float* buffer, Uint32 frames) {
     
     Uint64 pos = _offset.load(std::memory_order_relaxed);
     _offset.store(pos+actual,std::memory_order_relaxed);
+    _cycle.fetch_add(1);
     return actual;
 }
 
@@ -288,17 +362,75 @@ Uint32 AudioMixer::read(float* buffer, Uint32 frames) {
 bool AudioMixer::setWidth(Uint8 width) {
     if (_paused.load(std::memory_order_relaxed)) {
         std::shared_ptr<AudioNode>* replace = new std::shared_ptr<AudioNode>[width];
+        std::atomic<AudioNode*>* staged = new std::atomic<AudioNode*>[width];
+        Uint32 words = (width+SLOTS_PER_WORD-1)/SLOTS_PER_WORD;
+        std::atomic<Uint64>* occupied = new std::atomic<Uint64>[words];
+        for(Uint32 ii = 0; ii < words; ii++) {
+            occupied[ii] = 0;
+        }
         Uint32 min = width < _width ? width : _width;
         for(int ii = 0; ii < width; ii++) {
             replace[ii] = ii < min ? _inputs[ii] : nullptr;
+            staged[ii]  = replace[ii].get();
+            if (replace[ii]) {
+                occupied[ii/SLOTS_PER_WORD] |= (Uint64)1 << (ii % SLOTS_PER_WORD);
+            }
+        }
+        for(int ii = min; ii < _width; ii++) {
+            retire(_inputs[ii]);
         }
         delete[] _inputs;
+        delete[] _staged;
+        delete[] _occupied;
         _inputs = replace;
+        _staged = staged;
+        _occupied = occupied;
+        _width  = width;
         return true;
     }
     return false;
 }
 
+/**
+ * Retires an input node detached from this mixer.
+ *
+ * The audio thread never owns its inputs, so it may still be reading
+ * from a detached node in the current buffer. This method holds on to
+ * the node until the audio thread has finished that buffer, so that
+ * the node is never deallocated in the audio thread.
+ *
+ * @param node  The detached input node
+ */
+void AudioMixer::retire(const std::shared_ptr<AudioNode>& node) {
+    collect();
+    if (node) {
+        // Any buffer that saw the old input finishes with a higher cycle
+        _retired.push_back(std::make_pair(_cycle.load(),node));
+    }
+}
+
+/**
+ * Releases any retired input nodes no longer used by the audio thread.
+ *
+ * This method is called by the main thread whenever the graph changes.
+ */
+void AudioMixer::collect() {
+    if (_retired.empty()) {
+        return;
+    }
+    Uint64 cycle = _cycle.load();
+    size_t keep = 0;
+    for(size_t ii = 0; ii < _retired.size(); ii++) {
+        if (_retired[ii].first >= cycle) {
+            if (keep != ii) {
+                _retired[keep] = std::move(_retired[ii]);
+            }
+            keep++;
+        }
+    }
+    _retired.resize(keep);
+}
+
 #pragma mark -
 #pragma mark Audio Graph Methods
 /**
@@ -356,11 +488,10 @@ void AudioMixer::setKnee(float knee) {
  * @return true if the read position was marked across all inputs.
  */
 bool AudioMixer::mark() {
-    std::lock_guard<std::mutex> lock(_mutex);
     bool success = true;
     std::shared_ptr<AudioNode> temp;
     for(int ii = 0; ii < _width; ii++) {
-        temp = std::atomic_load_explicit(_inputs+ii,std::memory_order_relaxed);
+        temp = _inputs[ii];
         if (temp) {
             success = temp->mark() && success;
         }
@@ -389,11 +520,10 @@ bool AudioMixer::mark() {
  * @return true if the read position was marked.
  */
 bool AudioMixer::unmark() {
-    std::lock_guard<std::mutex> lock(_mutex);
     bool success = true;
     std::shared_ptr<AudioNode> temp;
     for(int ii = 0; ii < _width; ii++) {
-        temp = std::atomic_load_explicit(_inputs+ii,std::memory_order_relaxed);
+        temp = _inputs[ii];
         if (temp) {
             success = temp->unmark() && success;
         }
@@ -417,11 +547,10 @@ bool AudioMixer::unmark() {
  * @return true if the read position was moved.
  */
 bool AudioMixer::reset() {
-    std::lock_guard<std::mutex> lock(_mutex);
     bool success = true;
     std::shared_ptr<AudioNode> temp;
     for(int ii = 0; ii < _width; ii++) {
-        temp = std::atomic_load_explicit(_inputs+ii,std::memory_order_relaxed);
+        temp = _inputs[ii];
         if (temp) {
             success = temp->reset() && success;
         }
@@ -447,12 +576,11 @@ bool AudioMixer::reset() {
  * @return the actual number of frames advanced; -1 if not supported
  */
 Sint64 AudioMixer::advance(Uint32 frames) {
-    std::lock_guard<std::mutex> lock(_mutex);
     Sint64 actual = 0;
     bool fail = false;
     std::shared_ptr<AudioNode> temp;
     for(int ii = 0; ii < _width; ii++) {
-        temp = std::atomic_load_explicit(_inputs+ii,std::memory_order_relaxed);
+        temp = _inputs[ii];
         if (temp) {
             Sint64 amt = temp->advance(frames);
             actual = std::max(actual,amt);
@@ -501,12 +629,11 @@ Sint64 AudioMixer::getPosition() const {
  * @return the new frame position of this audio node.
  */
 Sint64 AudioMixer::setPosition(Uint32 position) {
-    std::lock_guard<std::mutex> lock(_mutex);
     Sint64 actual = 0;
     bool fail = false;
     std::shared_ptr<AudioNode> temp;
     for(int ii = 0; ii < _width; ii++) {
-        temp = std::atomic_load_explicit(_inputs+ii,std::memory_order_relaxed);
+        temp = _inputs[ii];
         if (temp) {
             Sint64 amt = temp->setPosition(position);
             actual = std::max(actual,amt);
@@ -580,7 +707,7 @@ double AudioMixer::getRemaining() const {
     bool fail = false;
     std::shared_ptr<AudioNode> temp;
     for(int ii = 0; ii < _width; ii++) {
-        temp = std::atomic_load_explicit(_inputs+ii,std::memory_order_relaxed);
+        temp = _inputs[ii];
         if (temp) {
             double amt = temp->getRemaining();
             actual = std::max(actual,amt);
@@ -613,14 +740,12 @@ double AudioMixer::getRemaining() const {
  * @return the new remaining time in seconds.
  */
 double AudioMixer::setRemaining(double time) {
-    std::lock_guard<std::mutex> lock(_mutex);
-    
     // Get longest time remaining
     double actual = 0;
     bool fail = false;
     std::shared_ptr<AudioNode> temp;
     for(int ii = 0; ii < _width; ii++) {
-        temp = std::atomic_load_explicit(_inputs+ii,std::memory_order_relaxed);
+        temp = _inputs[ii];
         if (temp) {
             double amt = temp->getRemaining();
             actual = std::max(actual,amt);
@@ -632,7 +757,7 @@ double AudioMixer::setRemaining(double time) {
     
     // Now push forward
     for(int ii = 0; ii < _width; ii++) {
-        temp = std::atomic_load_explicit(_inputs+ii,std::memory_order_relaxed);
+        temp = _inputs[ii];
         if (temp) {
             Uint64 off = temp->setPosition((Uint32)pos);
             if (off < 0) {
@@ -57,6 +57,27 @@ const Uint32 AudioNode::DEFAULT_CHANNELS = 2;
 /** The default sampling frequency for an audio graph node */
 const Uint32 AudioNode::DEFAULT_SAMPLING = 48000;
 
+/** The read size for nodes allocated without an audio device manager */
+Uint32 AudioNode::_readsize = 512;
+
+/**
+ * Returns the read size used to allocate the buffers of new nodes.
+ *
+ * This is the number of frames that a node expects to be asked for in a
+ * single {@link read}. If there is an active {@link AudioDevices} manager,
+ * this is the read size of its output devices. Otherwise, it is the value
+ * set by {@link setDefaultReadSize}. This allows an audio graph to be built
+ * and rendered without any device (such as with an {@link AudioRenderer}).
+ *
+ * Nodes only consult this value when they are initialized.
+ *
+ * @return the read size used to allocate the buffers of new nodes.
+ */
+Uint32 AudioNode::getDefaultReadSize() {
+    AudioDevices* devices = AudioDevices::get();
+    return devices ? devices->getReadSize() : _readsize;
+}
+
 #pragma mark -
 #pragma mark Constructors
 
@@ -116,9 +137,6 @@ bool AudioNode::init(Uint8 channels, Uint32 rate) {
     if (_booted) {
         CUAssertLog(false,"This node has already been initialized");
         return false;
-    } else if (!AudioDevices::get()) {
-        CUAssertLog(false,"Attempt to allocate a node without an active audio device manager");
-        return false;
     }
     _channels = channels;
     _sampling = rate;
@@ -32,7 +32,6 @@
 //  Version: 12/5/18
 //
 #include <cugl/audio/graph/CUAudioPanner.h>
-#include <cugl/audio/CUAudioDevices.h>
 #include <cugl/util/CUDebug.h>
 #include <cmath>
 
@@ -103,7 +102,7 @@ bool AudioPanner::init(Uint8 channels, Uint32 rate) {
 bool AudioPanner::init(Uint8 channels, Uint8 field, Uint32 rate) {
     if (AudioNode::init(channels,rate)) {
         setField(field);
-        _capacity = AudioDevices::get()->getReadSize();
+        _capacity = getDefaultReadSize();
         _buffer = (float*)malloc(_capacity*_field*sizeof(float));
         return true;
     }
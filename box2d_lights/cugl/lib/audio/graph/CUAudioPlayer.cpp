@@ -44,10 +44,283 @@
 #include <cugl/util/CUTimestamp.h>
 #include <cugl/math/dsp/CUDSPMath.h>
 #include <cugl/audio/codecs/cu_codecs.h>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 using namespace cugl::audio;
 using namespace cugl;
 
+/** The time for the decoder thread to sleep when every ring is full */
+#define STREAM_SLEEP_MILLIS 2
+
+/** The read-ahead in seconds for newly initialized players */
+double AudioPlayer::_readahead = DEFAULT_STREAM_READAHEAD;
+
+#pragma mark -
+#pragma mark Stream State
+/**
+ * The stream decoding state of a single player.
+ *
+ * This state is shared by the audio thread (which copies from the ring)
+ * and the decoder thread (which fills it). It is allocated separately from
+ * the player, so that a player can be disposed (or deleted) in the audio
+ * thread without waiting on the decoder. A disposed player simply marks its
+ * stream as retired, and the decoder thread deletes it.
+ */
+class cugl::audio::AudioStream {
+public:
+    /**
+     * A single decoded page of a streamed sample
+     *
+     * The pages form the ring shared by the decoder and audio threads.
+     */
+    class Page {
+    public:
+        /** The absolute frame position of the start of this page */
+        Uint64 frame;
+        /** The number of frames in this page (0 at the end of the stream) */
+        Uint32 size;
+        /** The seek generation when this page was decoded */
+        Uint32 generation;
+        /** The decoded data (owned by the stream) */
+        float* data;
+    };
+
+    /** The decoder for the current asset (DECODER THREAD ONLY after creation) */
+    std::shared_ptr<AudioDecoder> decoder;
+    /** The size of a single page in frames */
+    Uint32 chksize;
+    /** The first page of the stream, decoded on creation */
+    float* intro;
+    /** The number of frames in the first page */
+    Uint32 introSize;
+    /** The backing data for the stream pages */
+    float* pageData;
+    /** The ring of decoded pages */
+    std::vector<Page> pages;
+    /** The number of pages written by the decoder thread */
+    std::atomic<Uint64> pageHead;
+    /** The number of pages released by the audio thread */
+    std::atomic<Uint64> pageTail;
+    /** The current seek generation (written by the audio thread) */
+    std::atomic<Uint32> seekGen;
+    /** The frame position for the decoder thread to seek to */
+    std::atomic<Uint64> seekFrame;
+    /** The seek generation of the decoder (DECODER THREAD ONLY) */
+    Uint32 decodeGen;
+    /** Whether the decoder has reached the end of the stream (DECODER THREAD ONLY) */
+    bool decodeDone;
+    /** Whether the player has released this stream */
+    std::atomic<bool> retired;
+
+    /**
+     * Creates the stream state for the given decoder.
+     *
+     * The first page is decoded immediately, so that restarts are seamless.
+     * The ring holds enough pages for the given read-ahead.
+     *
+     * @param source    The decoder for the streamed asset
+     * @param readahead The read-ahead in seconds
+     */
+    AudioStream(const std::shared_ptr<AudioDecoder>& source, double readahead) :
+    decoder(source),
+    pageHead(0),
+    pageTail(0),
+    seekGen(0),
+    decodeGen(0),
+    retired(false) {
+        Uint32 channels = decoder->getChannels();
+        chksize = decoder->getPageSize();
+
+        intro = (float*)malloc(chksize*channels*sizeof(float));
+        Sint32 amt = decoder->pagein(intro);
+        introSize = amt < 0 ? 0 : (Uint32)amt;
+
+        // The decoder thread starts at the second page
+        double frames = readahead*decoder->getSampleRate();
+        size_t count = (size_t)std::ceil(frames/chksize);
+        count = std::max(count,(size_t)2);
+        pageData = (float*)malloc(count*chksize*channels*sizeof(float));
+        pages.resize(count);
+        for(size_t ii = 0; ii < count; ii++) {
+            pages[ii].frame = 0;
+            pages[ii].size  = 0;
+            pages[ii].generation = 0;
+            pages[ii].data  = pageData+ii*chksize*channels;
+        }
+        seekFrame.store(chksize);
+        decodeDone = (introSize < chksize);
+    }
+
+    /**
+     * Deletes the stream state, releasing all buffers.
+     */
+    ~AudioStream() {
+        free(pageData);
+        free(intro);
+    }
+
+    /**
+     * Decodes the next page of the stream into the ring, if there is room.
+     *
+     * DECODER THREAD ONLY: This method seeks the decoder whenever the audio
+     * thread has requested a new read position.
+     *
+     * @return true if a page was decoded
+     */
+    bool decode() {
+        Uint32 gen = seekGen.load(std::memory_order_acquire);
+        if (gen != decodeGen) {
+            Uint64 frame = seekFrame.load(std::memory_order_relaxed);
+            decoder->setPage(frame/chksize);
+            decodeGen  = gen;
+            decodeDone = (introSize < chksize);
+        }
+        if (decodeDone) {
+            return false;
+        }
+
+        Uint64 head = pageHead.load(std::memory_order_relaxed);
+        Uint64 tail = pageTail.load(std::memory_order_acquire);
+        if (head-tail >= pages.size()) {
+            return false;
+        }
+
+        Page& page = pages[head % pages.size()];
+        page.frame = decoder->getPage()*chksize;
+        Sint32 amt = decoder->pagein(page.data);
+        page.size = amt < 0 ? 0 : (Uint32)amt;
+        page.generation = gen;
+        decodeDone = (page.size == 0);
+        pageHead.store(head+1,std::memory_order_release);
+        return true;
+    }
+};
+
+#pragma mark -
+#pragma mark Decoder Thread
+/**
+ * The decoder thread shared by all streamed players.
+ *
+ * The thread is started when the first streamed player is initialized.
+ * It round-robins through the registered streams, decoding a page for each
+ * one with room in its ring. When every ring is full, it sleeps briefly.
+ *
+ * The decoder thread owns the teardown of every stream. A player releases
+ * its stream by marking it retired, which never locks or waits, as players
+ * may be disposed in the audio thread. The decoder thread deletes retired
+ * streams on its next pass. The mutex only guards the list of streams, and
+ * it is never held while decoding.
+ *
+ * The streamer is never deleted, as players may be disposed during static
+ * destruction.
+ */
+class AudioStreamer {
+private:
+    /** The registered streams */
+    std::vector<AudioStream*> _streams;
+    /** The mutex guarding the stream list */
+    std::mutex _mutex;
+    /** The condition variable to wake the thread */
+    std::condition_variable _wakeup;
+    /** The decoder thread */
+    std::thread* _thread;
+
+    /**
+     * Decodes pages for the registered streams until the program ends.
+     */
+    void run() {
+        std::vector<AudioStream*> streams;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                streams.assign(_streams.begin(), _streams.end());
+            }
+
+            bool busy = false;
+            for(auto it = streams.begin(); it != streams.end(); ++it) {
+                AudioStream* stream = *it;
+                if (stream->retired.load(std::memory_order_acquire)) {
+                    remove(stream);
+                    delete stream;
+                } else {
+                    busy = stream->decode() || busy;
+                }
+            }
+
+            if (!busy) {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _wakeup.wait_for(lock, std::chrono::milliseconds(STREAM_SLEEP_MILLIS));
+            }
+        }
+    }
+
+    /**
+     * Removes a stream from the registered streams
+     *
+     * @param stream    The stream to remove
+     */
+    void remove(AudioStream* stream) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        auto it = std::find(_streams.begin(), _streams.end(), stream);
+        if (it != _streams.end()) {
+            _streams.erase(it);
+        }
+    }
+
+public:
+    /**
+     * Creates the streamer with no thread.
+     */
+    AudioStreamer() : _thread(nullptr) {}
+
+    /**
+     * Returns the streamer singleton
+     *
+     * @return the streamer singleton
+     */
+    static AudioStreamer* get() {
+        static AudioStreamer* streamer = new AudioStreamer();
+        return streamer;
+    }
+
+    /**
+     * Registers a stream with the decoder thread
+     *
+     * The stream should have decoded its first page. The thread will decode
+     * the remaining pages. This method should never be called in the audio
+     * thread.
+     *
+     * @param stream    The stream to register
+     */
+    void attach(AudioStream* stream) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (_thread == nullptr) {
+            _thread = new std::thread([this] { run(); });
+            _thread->detach();
+        }
+        _streams.push_back(stream);
+        _wakeup.notify_one();
+    }
+
+    /**
+     * Releases a stream to the decoder thread for teardown
+     *
+     * The caller may not access the stream after this method is called.
+     * This method never locks or waits, so it is safe to call in the audio
+     * thread. The decoder thread deletes the stream on its next pass.
+     *
+     * @param stream    The stream to release
+     */
+    static void release(AudioStream* stream) {
+        stream->retired.store(true,std::memory_order_release);
+    }
+};
+
+#pragma mark -
+
 #pragma mark Constructors
 /**
  * Creates a degenerate audio player with no associated source.
@@ -56,15 +329,11 @@ using namespace cugl;
  * The player must be initialized to be used.
  */
 AudioPlayer::AudioPlayer() : AudioNode(),
+_source(nullptr),
 _offset(0),
 _marked(0),
 _buffer(nullptr),
-_decoder(nullptr),
-_source(nullptr),
-_chunker(nullptr),
-_chklimt(0),
-_chklast(0),
-_chksize(0),
+_stream(nullptr),
 _dirty(false) {
     _classname = "AudioPlayer";
 }
@@ -85,15 +354,11 @@ bool AudioPlayer::init(const std::shared_ptr<AudioSample>& source) {
         _buffer = source->getBuffer();
         _dirty  = false;
         
-        // TODO: Require manager active and access buffer from it.
-        _decoder = source->getDecoder();
-        if (source->isStreamed() && _decoder != nullptr) {
-            Uint32 channels = _decoder->getChannels();
-            _chksize  = _decoder->getPageSize();
-            _chklimt  = _chksize;
-            _chklast  = _chksize;
-            _chunker  = (float*)malloc(_chksize*channels*sizeof(float));
-            std::memset(_chunker,0,_chksize*channels*sizeof(float));
+        // In-memory samples never touch the file again
+        std::shared_ptr<AudioDecoder> decoder = source->isStreamed() ? source->getDecoder() : nullptr;
+        if (decoder != nullptr) {
+            _stream = new AudioStream(decoder,_readahead);
+            AudioStreamer::get()->attach(_stream);
         }
         return true;
     }
@@ -110,18 +375,15 @@ void AudioPlayer::dispose() {
     if (_booted) {
         AudioNode::dispose();
         _source = nullptr;
-        _decoder = nullptr;
         _offset.store(0);
         _marked.store(0);
         _buffer  = nullptr;
         _calling.store(false);
         _callback = nullptr;
-        _chksize = 0;
-        _chklimt = 0;
-        _chklast = 0;
-        if (_chunker) {
-            free(_chunker);
-            _chunker = nullptr;
+        if (_stream) {
+            // The decoder thread deletes the stream, so we never wait here
+            AudioStreamer::release(_stream);
+            _stream = nullptr;
         }
     }
 }
@@ -167,28 +429,24 @@ Uint32 AudioPlayer::read(float* buffer, Uint32 frames) {
         std::memcpy(buffer,input,sizeof(float)*amt*_source->getChannels());
     } else {
         if (_dirty.load(std::memory_order_acquire)) {
-            scan(off);
+            // Ask the decoder thread to seek (the first page is always ready)
+            Uint32 chksize = _stream->chksize;
+            Uint64 frame = off < chksize ? chksize : (off/chksize)*chksize;
+            _stream->seekFrame.store(frame,std::memory_order_relaxed);
+            _stream->seekGen.store(_stream->seekGen.load(std::memory_order_relaxed)+1,std::memory_order_release);
             _dirty.store(false,std::memory_order_relaxed);
         }
         
-        Uint32 remnant  = frames;
-        Uint32 channels = _decoder->getChannels();
-        bool okay = true;
-        while (okay && remnant) {
-            if (_chklast >= _chklimt) {
-                _chklimt = _decoder->pagein(_chunker);
-                _chklast = 0;
-            }
-            Uint32 avail = std::min((_chklimt-_chklast),remnant);
-            if (avail == 0) {
-                okay = false;
-            } else {
-                std::memcpy(buffer+(frames-remnant)*channels, _chunker+_chklast*channels, avail*channels*sizeof(float));
-                remnant  -= avail;
-                _chklast += avail;
-            }
+        bool eof = false;
+        amt = drain(buffer, frames, off, eof);
+        if (!eof && amt < frames) {
+            // The decoder has fallen behind; pad with silence but do not advance
+            std::memset(buffer+amt*_channels,0,(frames-amt)*_channels*sizeof(float));
+            dsp::DSPMath::scale(buffer,_ndgain.load(std::memory_order_relaxed),buffer,amt*_channels);
+            _offset.store(off+amt,std::memory_order_release);
+            _polling.store(false);
+            return frames;
         }
-        amt -= remnant;
     }
 
     dsp::DSPMath::scale(buffer,_ndgain.load(std::memory_order_relaxed),buffer,amt*_channels);
@@ -380,20 +638,65 @@ double AudioPlayer::setRemaining(double time) {
 #pragma mark -
 #pragma mark Stream Decoding
 /**
- * Decodes the audio stream up to the given position.
+ * Copies the streamed audio at the given position into the buffer
  *
  * AUDIO THREAD ONLY: Users should never access this method directly.
- * The only exception is when the user needs to create a custom subclass
- * of this AudioNode.
  *
- * If the frame is longer than the stream length, it goes to the end of
- * the stream.
+ * This method never decodes. It copies from the first page and from the
+ * ring filled by the decoder thread. If the decoder thread has fallen
+ * behind, it reads fewer frames than requested.
  *
- * @param frame    The absolute frame to skip to
+ * @param buffer    The read buffer to store the results
+ * @param frames    The maximum number of frames to read
+ * @param offset    The absolute frame position to read from
+ * @param eof       Set to true if the end of the stream was reached
+ *
+ * @return the number of frames copied
  */
-void AudioPlayer::scan(Uint64 frame) {
-    Uint32 page = (Uint32)(frame/_chksize);
-    _decoder->setPage(page);
-    _chklimt = (Uint32)_decoder->pagein(_chunker);
-    _chklast = (Uint32)(_chklimt == 0 ? _chksize : frame % _chksize);
+Uint32 AudioPlayer::drain(float* buffer, Uint32 frames, Uint64 offset, bool& eof) {
+    AudioStream* stream = _stream;
+    Uint32 channels = _channels;
+    Uint32 copied = 0;
+    eof = false;
+    
+    // The first page is always available
+    if (offset < stream->introSize) {
+        Uint32 avail = std::min((Uint32)(stream->introSize-offset),frames);
+        std::memcpy(buffer, stream->intro+offset*channels, avail*channels*sizeof(float));
+        copied += avail;
+        offset += avail;
+    }
+    if (offset >= stream->introSize && stream->introSize < stream->chksize) {
+        eof = true;
+        return copied;
+    }
+    
+    Uint32 gen = stream->seekGen.load(std::memory_order_relaxed);
+    size_t count = stream->pages.size();
+    while (copied < frames) {
+        Uint64 tail = stream->pageTail.load(std::memory_order_relaxed);
+        if (tail == stream->pageHead.load(std::memory_order_acquire)) {
+            break;
+        }
+        
+        const AudioStream::Page& page = stream->pages[tail % count];
+        if (page.generation == gen && page.size == 0) {
+            eof = true;
+            break;
+        } else if (page.generation != gen || offset >= page.frame+page.size || offset < page.frame) {
+            // Stale or already consumed
+            stream->pageTail.store(tail+1,std::memory_order_release);
+            continue;
+        }
+        
+        Uint32 start = (Uint32)(offset-page.frame);
+        Uint32 avail = std::min(page.size-start,frames-copied);
+        std::memcpy(buffer+copied*channels, page.data+start*channels, avail*channels*sizeof(float));
+        copied += avail;
+        offset += avail;
+        if (start+avail == page.size) {
+            stream->pageTail.store(tail+1,std::memory_order_release);
+        }
+    }
+    return copied;
 }
@@ -0,0 +1,347 @@
+//
+//  CUAudioRenderer.cpp
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides an offline terminal node for an audio graph. It is
+//  an alternative to AudioOutput that is not attached to any device. Instead,
+//  the graph is pulled on demand, as fast as possible, into memory. This makes
+//  it possible to render or profile an audio graph headless (such as on a
+//  build server), where there is no audio device.
+//
+//  The renderer also times every block that it pulls. These statistics can
+//  be compared against the real-time budget of a block to detect throughput
+//  regressions in the audio graph or its DSP filters.
+//
+//  CUGL MIT License:
+//
+//     This software is provided 'as-is', without any express or implied
+//     warranty.  In no event will the authors be held liable for any damages
+//     arising from the use of this software.
+//
+//     Permission is granted to anyone to use this software for any purpose,
+//     including commercial applications, and to alter it and redistribute it
+//     freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not
+//     be misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Walker White
+//  Version: 5/12/21
+//
+#include <cugl/audio/graph/CUAudioRenderer.h>
+#include <cugl/audio/CUAudioSample.h>
+#include <cugl/audio/CUAudioDevices.h>
+#include <cugl/util/CUDebug.h>
+#include <cugl/util/CUTimestamp.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace cugl;
+using namespace cugl::audio;
+
+/** The default number of frames pulled from the graph at a time */
+const Uint32 AudioRenderer::DEFAULT_BLOCK = 512;
+
+#pragma mark -
+#pragma mark Constructors
+/**
+ * Creates a degenerate offline renderer.
+ *
+ * The node has not been initialized, so it cannot be used.
+ *
+ * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate a node on
+ * the heap, use one of the static constructors instead.
+ */
+AudioRenderer::AudioRenderer() : AudioNode(),
+_input(nullptr),
+_blocksize(0),
+_blocks(0),
+_frames(0),
+_elapsed(0),
+_maxtime(0),
+_overruns(0) {
+    _classname = "AudioRenderer";
+}
+
+/**
+ * Initializes the renderer with default stereo settings
+ *
+ * The number of channels is two, for stereo output.  The sample rate is
+ * the modern standard of 48000 HZ.  The block size is {@link DEFAULT_BLOCK}.
+ *
+ * These values determine the buffer the structure for all {@link read}
+ * operations.  Any attached graph must agree with these settings.
+ *
+ * @return true if initialization was successful
+ */
+bool AudioRenderer::init() {
+    return init(DEFAULT_CHANNELS,DEFAULT_SAMPLING,DEFAULT_BLOCK);
+}
+
+/**
+ * Initializes the renderer with the given number of channels and sample rate
+ *
+ * The block size is {@link DEFAULT_BLOCK}. These values determine the
+ * buffer the structure for all {@link read} operations.  Any attached
+ * graph must agree with these settings.
+ *
+ * @param channels  The number of audio channels
+ * @param rate      The sample rate (frequency) in HZ
+ *
+ * @return true if initialization was successful
+ */
+bool AudioRenderer::init(Uint8 channels, Uint32 rate) {
+    return init(channels,rate,DEFAULT_BLOCK);
+}
+
+/**
+ * Initializes the renderer with the given channels, sample rate, and block size
+ *
+ * The block size is the number of frames pulled from the graph at a time,
+ * and should match the read size of the output device being simulated.
+ * Any attached graph must agree with the channels and sample rate.
+ *
+ * If there is no active {@link AudioDevices} manager, this method also sets
+ * {@link AudioNode#setDefaultReadSize} to the block size. Hence any graph
+ * nodes allocated after this renderer will be sized to match it.
+ *
+ * @param channels  The number of audio channels
+ * @param rate      The sample rate (frequency) in HZ
+ * @param block     The number of frames pulled from the graph at a time
+ *
+ * @return true if initialization was successful
+ */
+bool AudioRenderer::init(Uint8 channels, Uint32 rate, Uint32 block) {
+    CUAssertLog(block > 0, "The block size must be positive");
+    if (AudioNode::init(channels,rate)) {
+        if (!AudioDevices::get()) {
+            setDefaultReadSize(block);
+        }
+        _input = nullptr;
+        _blocksize = block;
+        resetStatistics();
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Disposes any resources allocated for this renderer
+ *
+ * The state of the node is reset to that of an uninitialized constructor.
+ * Unlike the destructor, this method allows the node to be reinitialized.
+ */
+void AudioRenderer::dispose() {
+    if (_booted) {
+        AudioNode::dispose();
+        _input = nullptr;
+        _blocksize = 0;
+        resetStatistics();
+    }
+}
+
+#pragma mark -
+#pragma mark Audio Graph
+/**
+ * Attaches an audio graph to this renderer.
+ *
+ * This method will fail if the channels or sample rate of the audio graph
+ * do not agree with this node.
+ *
+ * @param node  The terminal node of the audio graph
+ *
+ * @return true if the attachment was successful
+ */
+bool AudioRenderer::attach(const std::shared_ptr<AudioNode>& node) {
+    if (!_booted) {
+        CUAssertLog(_booted, "Cannot attach to an uninitialized renderer");
+        return false;
+    } else if (node == nullptr) {
+        detach();
+        return true;
+    } else if (node->getChannels() != _channels) {
+        CUAssertLog(false,"Terminal node of audio graph has wrong number of channels: %d",
+                    node->getChannels());
+        return false;
+    } else if (node->getRate() != _sampling) {
+        CUAssertLog(false,"Terminal node of audio graph has wrong sample rate: %d",
+                    node->getRate());
+        return false;
+    }
+
+    std::atomic_exchange_explicit(&_input,node,std::memory_order_relaxed);
+    return true;
+}
+
+/**
+ * Detaches an audio graph from this renderer.
+ *
+ * If the method succeeds, it returns the terminal node of the audio graph.
+ *
+ * @return  the terminal node of the audio graph (or null if failed)
+ */
+std::shared_ptr<AudioNode> AudioRenderer::detach() {
+    if (!_booted) {
+        CUAssertLog(_booted, "Cannot detach from an uninitialized renderer");
+        return nullptr;
+    }
+
+    std::shared_ptr<AudioNode> result = std::atomic_exchange_explicit(&_input,{},std::memory_order_relaxed);
+    return result;
+}
+
+#pragma mark -
+#pragma mark Rendering
+/**
+ * Renders the given number of frames into the buffer.
+ *
+ * The buffer should have enough room to store frames * channels elements.
+ * The graph is pulled in blocks of {@link getBlockSize} frames. If the
+ * graph completes or is paused, the remainder of the buffer is silent.
+ * Hence this method always renders all of the frames, unless the renderer
+ * is not initialized. In that case it renders nothing.
+ *
+ * @param buffer    The buffer to store the results
+ * @param frames    The number of frames to render
+ *
+ * @return the number of frames rendered
+ */
+Uint64 AudioRenderer::render(float* buffer, Uint64 frames) {
+    if (!_booted || _blocksize == 0) {
+        CUAssertLog(_booted, "Cannot render from an uninitialized renderer");
+        return 0;
+    }
+
+    Uint64 take = 0;
+    while (take < frames) {
+        Uint32 amt = (Uint32)std::min((Uint64)_blocksize,frames-take);
+        take += read(buffer+take*_channels,amt);
+    }
+    return take;
+}
+
+/**
+ * Returns an in-memory sample with the given duration of the graph
+ *
+ * The sample has the channels and sample rate of this node. The graph
+ * is pulled in blocks of {@link getBlockSize} frames. If the graph
+ * completes or is paused, the remainder of the sample is silent.
+ *
+ * @param seconds   The duration to render
+ *
+ * @return an in-memory sample with the given duration of the graph (or null if uninitialized)
+ */
+std::shared_ptr<AudioSample> AudioRenderer::render(double seconds) {
+    if (!_booted) {
+        CUAssertLog(_booted, "Cannot render from an uninitialized renderer");
+        return nullptr;
+    }
+
+    Uint32 frames = (Uint32)std::ceil(seconds*_sampling);
+    std::shared_ptr<AudioSample> result = AudioSample::alloc(_channels,_sampling,frames);
+    if (result != nullptr) {
+        render(result->getBuffer(),frames);
+    }
+    return result;
+}
+
+/**
+ * Returns true if this audio node has no more data.
+ *
+ * This renderer is completed if there is no attached graph, or if the
+ * attached graph is completed.
+ *
+ * @return true if this audio node has no more data.
+ */
+bool AudioRenderer::completed() {
+    std::shared_ptr<AudioNode> input = std::atomic_load_explicit(&_input,std::memory_order_relaxed);
+    return (input == nullptr || input->completed());
+}
+
+/**
+ * Reads up to the specified number of frames into the given buffer
+ *
+ * This method pulls a single block from the attached graph, and records
+ * the time required. It is called by {@link render}, and should only be
+ * called directly to drive the graph one block at a time.
+ *
+ * The buffer should have enough room to store frames * channels elements.
+ * The channels are interleaved into the output buffer. If the graph does
+ * not produce enough frames, the remainder of the buffer is silent.
+ *
+ * This method will always forward the read position.
+ *
+ * @param buffer    The read buffer to store the results
+ * @param frames    The maximum number of frames to read
+ *
+ * @return the actual number of frames read
+ */
+Uint32 AudioRenderer::read(float* buffer, Uint32 frames) {
+    Timestamp start;
+
+    Uint32 take = 0;
+    std::shared_ptr<AudioNode> input = std::atomic_load_explicit(&_input,std::memory_order_relaxed);
+    if (input != nullptr && !_paused.load(std::memory_order_relaxed)) {
+        // Unlike a device, we can afford to ask again for a short read
+        bool search = true;
+        while (take < frames && search) {
+            Uint32 amt = input->read(buffer+take*_channels,frames-take);
+            search = (amt > 0 && !input->completed());
+            take += amt;
+        }
+    }
+    if (take < frames) {
+        std::memset(buffer+take*_channels,0,(frames-take)*_channels*sizeof(float));
+    }
+
+    Timestamp end;
+    // Blocks of a cheap graph take less than a microsecond
+    Uint64 nanos = Timestamp::ellapsedNanos(start,end);
+    _blocks++;
+    _frames  += frames;
+    _elapsed += nanos;
+    _maxtime  = std::max(_maxtime,nanos);
+    if (nanos*_sampling > (Uint64)frames*1000000000) {
+        _overruns++;
+    }
+    return frames;
+}
+
+#pragma mark -
+#pragma mark Statistics
+/**
+ * Returns the ratio of audio rendered to time spent rendering
+ *
+ * This is the duration of the audio rendered, divided by the wall time
+ * required to render it. A graph can only play in real time if this
+ * value is more than 1. This value is since the last reset.
+ *
+ * @return the ratio of audio rendered to time spent rendering
+ */
+double AudioRenderer::getRealtimeFactor() const {
+    if (_elapsed == 0) {
+        return _frames == 0 ? 0 : INFINITY;
+    }
+    return ((double)_frames*1000000000.0)/((double)_elapsed*_sampling);
+}
+
+/**
+ * Resets all of the rendering statistics
+ *
+ * This does not affect the attached graph.
+ */
+void AudioRenderer::resetStatistics() {
+    _blocks = 0;
+    _frames = 0;
+    _elapsed  = 0;
+    _maxtime  = 0;
+    _overruns = 0;
+}
@@ -3,7 +3,7 @@
 //  Cornell University Game Library (CUGL)
 //
 //  This module provides a graph node for converting from one sample rate to
-//  another.  It uses SDL_AudioStream to perform continuous resampling on a
+//  another.  It uses a polyphase filter to perform continuous resampling on a
 //  potentially infinite audio stream.  This is is necessary for cross-platform
 //  reasons as iPhones are very stubborn about delivering any requested sampling
 //  rates other than 48000.
@@ -32,37 +32,24 @@
 //  Version: 1/26/19
 //
 #include <cugl/audio/graph/CUAudioResampler.h>
-#include <cugl/audio/CUAudioDevices.h>
 #include <cugl/math/dsp/CUDSPMath.h>
 #include <cugl/util/CUDebug.h>
+#include <algorithm>
 #include <cmath>
 
 using namespace cugl::audio;
 
-/** Constants taken from SDL */
-#define RESAMPLER_ZERO_CROSSINGS  5
-#define RESAMPLER_BITS_PER_SAMPLE 16
-#define RESAMPLER_SAMPLES_PER_ZERO_CROSSING  (1 << ((RESAMPLER_BITS_PER_SAMPLE / 2) + 1))
-#define RESAMPLER_FILTER_SIZE ((RESAMPLER_SAMPLES_PER_ZERO_CROSSING * RESAMPLER_ZERO_CROSSINGS) + 1)
-
+#pragma mark -
+#pragma mark Conversion State
 /**
- * Returns the padding size necessary to go from one sample rate to another
- *
- * This computation is done internally in SDL.  We needed to expose it so that we
- * can correcly "pre-fill" the buffer.
- *
- * @param inrate    The input sampling rate
- * @param outrate   The output sampling rate
- *
- * @return the padding size necessary to go from one sample rate to another
+ * Deletes this conversion, releasing the filter
  */
-static int paddingSize(Uint32 inrate, Uint32 outrate) {
-    if (inrate == outrate) {
-        return 0;
-    } else if (inrate > outrate) {
-        return (int) SDL_ceil(((float) (RESAMPLER_SAMPLES_PER_ZERO_CROSSING * inrate) / ((float) outrate)));
+AudioResampler::Conversion::~Conversion() {
+    if (filter != nullptr) {
+        delete filter;
+        filter = nullptr;
     }
-    return RESAMPLER_SAMPLES_PER_ZERO_CROSSING;
+    input = nullptr;
 }
 
 #pragma mark -
@@ -79,10 +66,10 @@ static int paddingSize(Uint32 inrate, Uint32 outrate) {
  */
 AudioResampler::AudioResampler() : AudioNode(),
 _inputrate(0),
-_capacity(0),
 _cvtratio(1.0f),
-_cvtbuffer(nullptr),
-_resampler(nullptr) {
+_current(nullptr),
+_pending(nullptr),
+_retired(nullptr) {
     _input = nullptr;
     _classname = "AudioResampler";
 }
@@ -114,11 +101,8 @@ bool AudioResampler::init() {
  */
 bool AudioResampler::init(Uint8 channels, Uint32 rate) {
     if (AudioNode::init(channels,rate)) {
-        _capacity = sizeof(float)*_channels*2*AudioDevices::get()->getReadSize();
-        _cvtbuffer = (float*)malloc(_capacity);
-        std::memset(_cvtbuffer,0,_capacity);
-        
         _inputrate = rate;
+        _cvtratio  = 1.0f;
         return true;
     }
     return false;
@@ -132,15 +116,10 @@ bool AudioResampler::init(Uint8 channels, Uint32 rate) {
  */
 void AudioResampler::dispose() {
     if (_booted) {
+        AudioNode::dispose();
         _input = nullptr;
-        if (_resampler != NULL) {
-            SDL_AudioStreamClear(_resampler);
-            SDL_FreeAudioStream(_resampler);
-            free(_cvtbuffer);
-            _resampler = NULL;
-            _cvtbuffer = nullptr;
-        }
-        _capacity  = 0;
+        publish(nullptr);
+        delete _current.exchange(nullptr);
         _cvtratio  = 1.0f;
         _inputrate = 0;
     }
@@ -172,47 +151,21 @@ bool AudioResampler::attach(const std::shared_ptr<AudioNode>& node) {
         return false;
     }
     
-    std::shared_ptr<AudioNode> input = std::atomic_load_explicit(&_input,std::memory_order_relaxed);
-    if (input) {
-        detach();
-    }
-
-    {
-        std::unique_lock<std::mutex> lk(_buffmtex);
-        if (node->getRate() != _inputrate) {
-            _inputrate = node->getRate();
-            _cvtratio  = ((float)_inputrate)/getRate();
-            size_t bsize = sizeof(float)*_channels*std::ceil(_cvtratio*AudioDevices::get()->getReadSize());
-            if (bsize > _capacity) {
-                free(_cvtbuffer);
-                _capacity  = bsize;
-                _cvtbuffer = (float*)malloc(_capacity);
-            }
-            if (_resampler != NULL) {
-                SDL_AudioStreamClear(_resampler);
-                SDL_FreeAudioStream(_resampler);
-            }
-            if (_inputrate != getRate()) {
-                _resampler = SDL_NewAudioStream(AUDIO_F32SYS, _channels, _inputrate,
-                                                AUDIO_F32SYS, _channels, getRate());
-                if (_resampler == NULL) {
-                    CULogError("[AUDIO] Could not create a resampler.");
-                    return false;
-                }
-            }
-        }
-        
-        // Initial 0s (else it will pop)
-        std::memset(_cvtbuffer,0,_capacity);
-        Uint32 padding = paddingSize(_inputrate, getRate())*_channels;
-        if (padding) {
-            SDL_AudioStreamPut(_resampler, _cvtbuffer, padding*sizeof(float));
-        }
-        
-        std::atomic_store_explicit(&_input,node,std::memory_order_relaxed);
-        return true;
+    Conversion* state = new Conversion();
+    state->input = node;
+    _inputrate = node->getRate();
+    state->ratio = ((float)_inputrate)/getRate();
+    
+    if (_inputrate != getRate()) {
+        // The filter starts with silence (else it will pop)
+        state->filter = new dsp::PolyphaseFilter(_channels,_inputrate,getRate(),
+                                                 getDefaultReadSize());
     }
-    return false;
+    
+    _input = node;
+    _cvtratio = state->ratio;
+    publish(state);
+    return true;
 }
 
 /**
@@ -229,10 +182,47 @@ std::shared_ptr<AudioNode> AudioResampler::detach() {
         return nullptr;
     }
     
-    std::shared_ptr<AudioNode> result = std::atomic_exchange_explicit(&_input,{},std::memory_order_relaxed);
+    std::shared_ptr<AudioNode> result = _input;
+    _input = nullptr;
+    publish(new Conversion());
     return result;
 }
 
+/**
+ * Hands off the given conversion to the audio thread.
+ *
+ * The audio thread picks up the conversion at the start of the next
+ * buffer. Any conversions released by the audio thread are deleted.
+ *
+ * @param state The new conversion state
+ */
+void AudioResampler::publish(Conversion* state) {
+    // A pending state never seen by the audio thread is ours to delete
+    delete _pending.exchange(state,std::memory_order_acq_rel);
+    Conversion* retired = _retired.exchange(nullptr,std::memory_order_acquire);
+    while (retired != nullptr) {
+        Conversion* next = retired->next;
+        delete retired;
+        retired = next;
+    }
+}
+
+/**
+ * Returns the input node as seen by the audio thread.
+ *
+ * This is the input of the conversion currently in use by the audio
+ * thread. It is kept alive by that conversion, which is only deleted
+ * in the main thread after the audio thread has released it. Hence
+ * this method never locks and never releases a reference, so it is
+ * safe to call in either thread.
+ *
+ * @return the input node as seen by the audio thread.
+ */
+AudioNode* AudioResampler::staged() const {
+    Conversion* state = _current.load(std::memory_order_acquire);
+    return state == nullptr ? nullptr : state->input.get();
+}
+
 #pragma mark -
 #pragma mark Playback Control
 /**
@@ -247,7 +237,7 @@ std::shared_ptr<AudioNode> AudioResampler::detach() {
  * @return true if this audio node has no more data.
  */
 bool AudioResampler::completed() {
-    std::shared_ptr<AudioNode> input = std::atomic_load_explicit(&_input,std::memory_order_relaxed);
+    AudioNode* input = staged();
     return (input == nullptr || input->completed());
 }
 
@@ -269,33 +259,37 @@ bool AudioResampler::completed() {
  * @return the actual number of frames read
  */
 Uint32 AudioResampler::read(float* buffer, Uint32 frames) {
-    std::shared_ptr<AudioNode> input = std::atomic_load_explicit(&_input,std::memory_order_relaxed);
+    // Graph changes are only applied at buffer boundaries
+    Conversion* state = _pending.exchange(nullptr,std::memory_order_acq_rel);
+    if (state != nullptr) {
+        Conversion* previous = _current.exchange(state,std::memory_order_acq_rel);
+        if (previous != nullptr) {
+            // The main thread deletes the old state; never free here
+            Conversion* head = _retired.load(std::memory_order_relaxed);
+            do {
+                previous->next = head;
+            } while (!_retired.compare_exchange_weak(head,previous,std::memory_order_release,
+                                                     std::memory_order_relaxed));
+        }
+    }
+    
+    state = _current.load(std::memory_order_relaxed);
+    AudioNode* input = state == nullptr ? nullptr : state->input.get();
     if (input == nullptr || _paused.load(std::memory_order_relaxed)) {
         std::memset(buffer,0,frames*_channels*sizeof(float));
     } else {
-        std::unique_lock<std::mutex> lk(_buffmtex);
-        Sint32 take = 0;
-        if (_resampler != NULL) {
-            bool search = true;
-            while (take < frames && search) {
-                Sint32 amt = std::ceil(frames*_cvtratio);
-                amt = input->read(_cvtbuffer, amt);
-                if (SDL_AudioStreamPut(_resampler, _cvtbuffer, amt*sizeof(float)*_channels) < 0) {
-                    CULogError("[AUDIO] Resampling error.");
-                    std::memset(buffer+take*_channels,0,(frames-take)*_channels*sizeof(float));
-                    take = frames;
-                } else {
-                    amt  = SDL_AudioStreamGet(_resampler, buffer+take*_channels,
-                                              (int)((frames-take)*_channels*sizeof(float)));
-                    if (amt == -1) {
-                        CULogError("[AUDIO] Resampling error.");
-                        std::memset(buffer+take*_channels,0,(frames-take)*_channels*sizeof(float));
-                        take = frames;
-                    } else if (amt == 0) {
-                        search = false;
-                    } else {
-                        take += amt/sizeof(float)*_channels;
-                    }
+        Uint32 take = 0;
+        if (state->filter != nullptr) {
+            // Read straight into the filter history; no intermediate copies
+            dsp::PolyphaseFilter* filter = state->filter;
+            while (take < frames) {
+                Uint32 need = (Uint32)filter->getInputNeeded(frames-take);
+                Uint32 amt  = need ? input->read(filter->getInputBuffer(), need) : 0;
+                filter->appendInput(amt);
+                Uint32 made = (Uint32)filter->calculate(buffer+take*_channels, frames-take);
+                take += made;
+                if (amt < need || made == 0) {
+                    break;
                 }
             }
         } else {
@@ -327,7 +321,7 @@ Uint32 AudioResampler::read(float* buffer, Uint32 frames) {
  * @return true if the read position was marked.
  */
 bool AudioResampler::mark() {
-    std::shared_ptr<AudioNode> input = std::atomic_load_explicit(&_input,std::memory_order_relaxed);
+    AudioNode* input = staged();
     if (input) {
         return input->mark();
     }
@@ -348,7 +342,7 @@ bool AudioResampler::mark() {
  * @return true if the read position was marked.
  */
 bool AudioResampler::unmark() {
-    std::shared_ptr<AudioNode> input = std::atomic_load_explicit(&_input,std::memory_order_relaxed);
+    AudioNode* input = staged();
     if (input) {
         return input->unmark();
     }
@@ -370,7 +364,7 @@ bool AudioResampler::unmark() {
  * @return true if the read position was moved.
  */
 bool AudioResampler::reset() {
-    std::shared_ptr<AudioNode> input = std::atomic_load_explicit(&_input,std::memory_order_relaxed);
+    AudioNode* input = staged();
     if (input) {
         return input->reset();
     }
@@ -392,9 +386,8 @@ bool AudioResampler::reset() {
  * @return the actual number of frames advanced; -1 if not supported
  */
 Sint64 AudioResampler::advance(Uint32 frames) {
-    std::shared_ptr<AudioNode> input = std::atomic_load_explicit(&_input,std::memory_order_relaxed);
+    AudioNode* input = staged();
     if (input) {
-        std::unique_lock<std::mutex> lk(_buffmtex);
         return input->advance(std::ceil(frames*_cvtratio));
     }
     return -1;
@@ -414,7 +407,7 @@ Sint64 AudioResampler::advance(Uint32 frames) {
  * @return the current frame position of this audio node.
  */
 Sint64 AudioResampler::getPosition() const {
-    std::shared_ptr<AudioNode> input = std::atomic_load_explicit(&_input,std::memory_order_relaxed);
+    AudioNode* input = staged();
     if (input) {
         return std::ceil(input->getPosition()*_cvtratio.load(std::memory_order_relaxed));
     }
@@ -437,7 +430,7 @@ Sint64 AudioResampler::getPosition() const {
  * @return the new frame position of this audio node.
  */
 Sint64 AudioResampler::setPosition(Uint32 position) {
-    std::shared_ptr<AudioNode> input = std::atomic_load_explicit(&_input,std::memory_order_relaxed);
+    AudioNode* input = staged();
     if (input) {
         return input->setPosition(std::ceil(position*_cvtratio));
     }
@@ -458,7 +451,7 @@ Sint64 AudioResampler::setPosition(Uint32 position) {
  * @return the elapsed time in seconds.
  */
 double AudioResampler::getElapsed() const {
-    std::shared_ptr<AudioNode> input = std::atomic_load_explicit(&_input,std::memory_order_relaxed);
+    AudioNode* input = staged();
     if (input) {
         return input->getElapsed();
     }
@@ -481,7 +474,7 @@ double AudioResampler::getElapsed() const {
  * @return the new elapsed time in seconds.
  */
 double AudioResampler::setElapsed(double time) {
-    std::shared_ptr<AudioNode> input = std::atomic_load_explicit(&_input,std::memory_order_relaxed);
+    AudioNode* input = staged();
     if (input) {
         return input->setElapsed(time);
     }
@@ -505,7 +498,7 @@ double AudioResampler::setElapsed(double time) {
  * @return the remaining time in seconds.
  */
 double AudioResampler::getRemaining() const {
-    std::shared_ptr<AudioNode> input = std::atomic_load_explicit(&_input,std::memory_order_relaxed);
+    AudioNode* input = staged();
     if (input) {
         return input->getRemaining();
     }
@@ -530,7 +523,7 @@ double AudioResampler::getRemaining() const {
  * @return the new remaining time in seconds.
  */
 double AudioResampler::setRemaining(double time) {
-    std::shared_ptr<AudioNode> input = std::atomic_load_explicit(&_input,std::memory_order_relaxed);
+    AudioNode* input = staged();
     if (input) {
         return input->setRemaining(time);
     }
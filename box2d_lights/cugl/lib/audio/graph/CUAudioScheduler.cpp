@@ -30,7 +30,6 @@
 //  Author: Walker White
 //  Version: 11/20/18
 //
-#include <cugl/audio/CUAudioDevices.h>
 #include <cugl/audio/CUAudioSample.h>
 #include <cugl/audio/graph/CUAudioScheduler.h>
 #include <cugl/math/dsp/CUDSPMath.h>
@@ -218,7 +217,7 @@ AudioScheduler::~AudioScheduler() {
  */
 bool AudioScheduler::init() {
     if (AudioNode::init()) {
-        Uint32 size   = AudioDevices::get()->getReadSize();
+        Uint32 size   = getDefaultReadSize();
         _buffer  = (float*)malloc(size*_channels*sizeof(float));
         return true;
     }
@@ -239,7 +238,7 @@ bool AudioScheduler::init() {
  */
 bool AudioScheduler::init(Uint8 channels, Uint32 rate) {
     if (AudioNode::init(channels,rate)) {
-        Uint32 size   = AudioDevices::get()->getReadSize();
+        Uint32 size   = getDefaultReadSize();
         _buffer  = (float*)malloc(size*channels*sizeof(float));
         return true;
     }
@@ -0,0 +1,630 @@
+//
+//  CUAudioSpatializer.cpp
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides a mixer that places each of its inputs in 2d space.
+//  Every input slot is an emitter with a world-space position, and the node
+//  has a single listener. Once per audio buffer, the audio thread computes
+//  the distance attenuation and the stereo pan of each emitter relative to
+//  the listener, ramping from the previous values so that moving emitters
+//  do not click.
+//
+//  Positions are stored in a lock-free table. The main thread only writes
+//  positions; it never computes gains or touches the audio graph. This makes
+//  it cheap to move many emitters every animation frame.
+//
+//  CUGL MIT License:
+//
+//     This software is provided 'as-is', without any express or implied
+//     warranty.  In no event will the authors be held liable for any damages
+//     arising from the use of this software.
+//
+//     Permission is granted to anyone to use this software for any purpose,
+//     including commercial applications, and to alter it and redistribute it
+//     freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not
+//     be misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Walker White
+//  Version: 5/12/21
+//
+#include <cugl/audio/graph/CUAudioSpatializer.h>
+#include <cugl/math/dsp/CUDSPMath.h>
+#include <cugl/util/CUDebug.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace cugl;
+using namespace cugl::audio;
+
+/** The square root of two, to normalize the equal-power pan law */
+#define PAN_NORMAL  1.41421356237309504880f
+
+/**
+ * Returns a position packed into a single word
+ *
+ * Packing the coordinates together ensures that the audio thread never
+ * sees the x-coordinate of one position with the y-coordinate of another.
+ *
+ * @param position  The position to pack
+ *
+ * @return a position packed into a single word
+ */
+static inline Uint64 pack_position(const Vec2& position) {
+    Uint32 x, y;
+    std::memcpy(&x,&position.x,sizeof(float));
+    std::memcpy(&y,&position.y,sizeof(float));
+    return ((Uint64)y << 32) | x;
+}
+
+/**
+ * Returns a position unpacked from a single word
+ *
+ * @param word  The packed position
+ *
+ * @return a position unpacked from a single word
+ */
+static inline Vec2 unpack_position(Uint64 word) {
+    Uint32 x = (Uint32)(word & 0xffffffff);
+    Uint32 y = (Uint32)(word >> 32);
+    Vec2 result;
+    std::memcpy(&result.x,&x,sizeof(float));
+    std::memcpy(&result.y,&y,sizeof(float));
+    return result;
+}
+
+/** The default number of inputs supported (typically 8) */
+const Uint8 AudioSpatializer::DEFAULT_WIDTH = 8;
+/** The default distance at which attenuation begins */
+const float AudioSpatializer::DEFAULT_REFERENCE = 1.0f;
+
+#pragma mark -
+#pragma mark Constructors
+/**
+ * Creates a degenerate spatializer that takes no inputs
+ *
+ * The spatializer has no width and therefore cannot accept any inputs.
+ * The spatializer must be initialized to be used.
+ *
+ * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate a graph node on
+ * the heap, use one of the static constructors instead.
+ */
+AudioSpatializer::AudioSpatializer() : AudioNode(),
+_inputs(nullptr),
+_staged(nullptr),
+_width(0),
+_emitters(nullptr),
+_relative(nullptr),
+_snapped(nullptr),
+_listener(0),
+_reference(DEFAULT_REFERENCE),
+_rolloff(1),
+_current(nullptr),
+_buffer(nullptr),
+_capacity(0),
+_cycle(0) {
+    _classname = "AudioSpatializer";
+}
+
+/**
+ * Initializes the spatializer with default stereo settings
+ *
+ * The number of channels is two, for stereo output.  The sample rate is
+ * the modern standard of 48000 HZ. The spatializer has
+ * {@link DEFAULT_WIDTH} slots.
+ *
+ * @return true if initialization was successful
+ */
+bool AudioSpatializer::init() {
+    return init(DEFAULT_WIDTH,DEFAULT_CHANNELS,DEFAULT_SAMPLING);
+}
+
+/**
+ * Initializes the spatializer with default stereo settings
+ *
+ * The number of channels is two, for stereo output.  The sample rate is
+ * the modern standard of 48000 HZ.
+ *
+ * @param width     The number of emitters that may be attached
+ *
+ * @return true if initialization was successful
+ */
+bool AudioSpatializer::init(Uint8 width) {
+    return init(width,DEFAULT_CHANNELS,DEFAULT_SAMPLING);
+}
+
+/**
+ * Initializes the spatializer with the given number of channels and sample rate
+ *
+ * The spatializer has {@link DEFAULT_WIDTH} slots. Only stereo output
+ * supports panning; other channel counts are only attenuated.
+ *
+ * @param channels  The number of audio channels
+ * @param rate      The sample rate (frequency) in HZ
+ *
+ * @return true if initialization was successful
+ */
+bool AudioSpatializer::init(Uint8 channels, Uint32 rate) {
+    return init(DEFAULT_WIDTH,channels,rate);
+}
+
+/**
+ * Initializes the spatializer with the given number of channels and sample rate
+ *
+ * Only stereo output supports panning; other channel counts are only
+ * attenuated.
+ *
+ * @param width     The number of emitters that may be attached
+ * @param channels  The number of audio channels
+ * @param rate      The sample rate (frequency) in HZ
+ *
+ * @return true if initialization was successful
+ */
+bool AudioSpatializer::init(Uint8 width, Uint8 channels, Uint32 rate) {
+    if (AudioNode::init(channels,rate)) {
+        CUAssertLog(width,"Spatializer width is 0");
+        _width = width;
+        _capacity = getDefaultReadSize();
+        _cycle = 0;
+        _listener = pack_position(Vec2::ZERO);
+        _reference = DEFAULT_REFERENCE;
+        _rolloff = 1;
+        _inputs   = new std::shared_ptr<AudioNode>[_width];
+        _staged   = new std::atomic<AudioNode*>[_width];
+        _emitters = new std::atomic<Uint64>[_width];
+        _relative = new std::atomic<bool>[_width];
+        _snapped  = new std::atomic<bool>[_width];
+        _current  = new float[2*_width];
+        for (int ii = 0; ii < _width; ii++) {
+            _inputs[ii] = nullptr;
+            _staged[ii] = nullptr;
+            _emitters[ii] = pack_position(Vec2::ZERO);
+            _relative[ii] = true;
+            _snapped[ii]  = true;
+            _current[2*ii  ] = 0;
+            _current[2*ii+1] = 0;
+        }
+        _buffer = (float*)malloc(_capacity*_channels*sizeof(float));
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Disposes any resources allocated for this spatializer
+ *
+ * The state of the node is reset to that of an uninitialized constructor.
+ * Unlike the destructor, this method allows the node to be reinitialized.
+ */
+void AudioSpatializer::dispose() {
+    if (_booted) {
+        AudioNode::dispose();
+        delete[] _inputs;
+        delete[] _staged;
+        delete[] _emitters;
+        delete[] _relative;
+        delete[] _snapped;
+        delete[] _current;
+        free(_buffer);
+        _retired.clear();
+        _inputs = nullptr;
+        _staged = nullptr;
+        _emitters = nullptr;
+        _relative = nullptr;
+        _snapped  = nullptr;
+        _current  = nullptr;
+        _buffer = nullptr;
+        _width = 0;
+        _capacity = 0;
+    }
+}
+
+#pragma mark -
+#pragma mark Audio Graph Methods
+/**
+ * Attaches an input node to this spatializer.
+ *
+ * The input is attached at the given slot. Any input node previously at
+ * that slot is removed (use {@link getInput} to access it first). The
+ * input must either have one channel or the same number of channels as
+ * this node. It must also have the same sample rate, as the spatializer
+ * does not resample. Wrap the input in an {@link AudioResampler} if the
+ * rates differ. An input that fails these checks is not attached, and
+ * the error is logged.
+ *
+ * The new input starts at the gains for the current emitter position
+ * of this slot. Hence the emitter position should be set before the
+ * input is attached.
+ *
+ * @param slot  The slot for the input node
+ * @param input The input node to attach
+ *
+ * @return true if the input was attached
+ */
+bool AudioSpatializer::attach(Uint8 slot, const std::shared_ptr<AudioNode>& input) {
+    CUAssertLog(slot < _width, "Slot %d is out of range",slot);
+    if (input == nullptr) {
+        detach(slot);
+        return true;
+    } else if (input->getChannels() != 1 && input->getChannels() != _channels) {
+        CULogError("[AUDIO] Spatializer input has wrong number of channels: %d vs %d",
+                   input->getChannels(),_channels);
+        return false;
+    } else if (input->getRate() != _sampling) {
+        CULogError("[AUDIO] Spatializer input has wrong sample rate: %d vs %d",
+                   input->getRate(),_sampling);
+        return false;
+    }
+    std::shared_ptr<AudioNode> result = _inputs[slot];
+    _inputs[slot] = input;
+    _snapped[slot].store(true);
+    _staged[slot].store(input.get());
+    retire(result);
+    return true;
+}
+
+/**
+ * Detaches the input node at the given slot.
+ *
+ * The input node detached is returned by this method.
+ *
+ * @param slot  The slot for the input node
+ *
+ * @return the input node detached from the slot
+ */
+std::shared_ptr<AudioNode> AudioSpatializer::detach(Uint8 slot) {
+    CUAssertLog(slot < _width, "Slot %d is out of range",slot);
+    std::shared_ptr<AudioNode> result = _inputs[slot];
+    _inputs[slot] = nullptr;
+    _staged[slot].store(nullptr);
+    retire(result);
+    return result;
+}
+
+/**
+ * Returns the input node at the given slot.
+ *
+ * @param slot  The slot for the input node
+ *
+ * @return the input node at the given slot.
+ */
+std::shared_ptr<AudioNode> AudioSpatializer::getInput(Uint8 slot) const {
+    CUAssertLog(slot < _width, "Slot %d is out of range",slot);
+    return _inputs[slot];
+}
+
+/**
+ * Returns true if the given slot has an input that is not completed.
+ *
+ * A slot is free to reuse if this method is false.
+ *
+ * @param slot  The slot for the input node
+ *
+ * @return true if the given slot has an input that is not completed.
+ */
+bool AudioSpatializer::isActive(Uint8 slot) const {
+    CUAssertLog(slot < _width, "Slot %d is out of range",slot);
+    return _inputs[slot] != nullptr && !_inputs[slot]->completed();
+}
+
+/**
+ * Retires an input node detached from this spatializer.
+ *
+ * The node is held until the audio thread has finished any buffer that
+ * might still be reading from it.
+ *
+ * @param node  The detached input node
+ */
+void AudioSpatializer::retire(const std::shared_ptr<AudioNode>& node) {
+    collect();
+    if (node) {
+        // Any buffer that saw the old input finishes with a higher cycle
+        _retired.push_back(std::make_pair(_cycle.load(),node));
+    }
+}
+
+/**
+ * Releases any retired input nodes no longer used by the audio thread.
+ *
+ * This method is called by the main thread whenever the graph changes.
+ */
+void AudioSpatializer::collect() {
+    if (_retired.empty()) {
+        return;
+    }
+    Uint64 cycle = _cycle.load();
+    size_t keep = 0;
+    for(size_t ii = 0; ii < _retired.size(); ii++) {
+        if (_retired[ii].first >= cycle) {
+            if (keep != ii) {
+                _retired[keep] = std::move(_retired[ii]);
+            }
+            keep++;
+        }
+    }
+    _retired.resize(keep);
+}
+
+#pragma mark -
+#pragma mark Spatial Attributes
+/**
+ * Returns the position of the listener.
+ *
+ * @return the position of the listener.
+ */
+Vec2 AudioSpatializer::getListener() const {
+    return unpack_position(_listener.load(std::memory_order_relaxed));
+}
+
+/**
+ * Sets the position of the listener.
+ *
+ * This method may be called every animation frame. The change takes
+ * effect at the start of the next buffer, and is smoothed across it.
+ *
+ * @param position  The position of the listener
+ */
+void AudioSpatializer::setListener(const Vec2& position) {
+    _listener.store(pack_position(position),std::memory_order_relaxed);
+}
+
+/**
+ * Returns the position of the emitter at the given slot.
+ *
+ * If the emitter is relative, this position is an offset from the
+ * listener. Otherwise it is in world space.
+ *
+ * @param slot  The emitter slot
+ *
+ * @return the position of the emitter at the given slot.
+ */
+Vec2 AudioSpatializer::getEmitter(Uint8 slot) const {
+    CUAssertLog(slot < _width, "Slot %d is out of range",slot);
+    return unpack_position(_emitters[slot].load(std::memory_order_relaxed));
+}
+
+/**
+ * Sets the position of the emitter at the given slot.
+ *
+ * If relative is true, the position is an offset from the listener, and
+ * moves with it. This is useful for sounds, such as interface sounds,
+ * that should not be spatialized. Such sounds should use the position
+ * (0,0). Otherwise, the position is in world space.
+ *
+ * This method may be called every animation frame. The change takes
+ * effect at the start of the next buffer, and is smoothed across it.
+ * This method may be called whether or not an input is attached.
+ *
+ * @param slot      The emitter slot
+ * @param position  The position of the emitter
+ * @param relative  Whether the position is relative to the listener
+ */
+void AudioSpatializer::setEmitter(Uint8 slot, const Vec2& position, bool relative) {
+    CUAssertLog(slot < _width, "Slot %d is out of range",slot);
+    _relative[slot].store(relative,std::memory_order_relaxed);
+    _emitters[slot].store(pack_position(position),std::memory_order_relaxed);
+}
+
+/**
+ * Returns true if the emitter position is relative to the listener.
+ *
+ * @param slot  The emitter slot
+ *
+ * @return true if the emitter position is relative to the listener.
+ */
+bool AudioSpatializer::isRelative(Uint8 slot) const {
+    CUAssertLog(slot < _width, "Slot %d is out of range",slot);
+    return _relative[slot].load(std::memory_order_relaxed);
+}
+
+/**
+ * Returns the distance at which attenuation begins.
+ *
+ * Emitters within this distance of the listener play at full gain.
+ *
+ * @return the distance at which attenuation begins.
+ */
+float AudioSpatializer::getReference() const {
+    return _reference.load(std::memory_order_relaxed);
+}
+
+/**
+ * Sets the distance at which attenuation begins.
+ *
+ * Emitters within this distance of the listener play at full gain. This
+ * value must be positive.
+ *
+ * @param distance  The distance at which attenuation begins.
+ */
+void AudioSpatializer::setReference(float distance) {
+    CUAssertLog(distance > 0, "Reference distance %f is not positive",distance);
+    _reference.store(distance,std::memory_order_relaxed);
+}
+
+/**
+ * Returns the rate of attenuation beyond the reference distance.
+ *
+ * A rolloff of 1 halves the gain every time the distance doubles. A
+ * rolloff of 0 disables attenuation.
+ *
+ * @return the rate of attenuation beyond the reference distance.
+ */
+float AudioSpatializer::getRolloff() const {
+    return _rolloff.load(std::memory_order_relaxed);
+}
+
+/**
+ * Sets the rate of attenuation beyond the reference distance.
+ *
+ * A rolloff of 1 halves the gain every time the distance doubles. A
+ * rolloff of 0 disables attenuation. This value cannot be negative.
+ *
+ * @param rolloff   The rate of attenuation beyond the reference distance.
+ */
+void AudioSpatializer::setRolloff(float rolloff) {
+    CUAssertLog(rolloff >= 0, "Rolloff %f is negative",rolloff);
+    _rolloff.store(rolloff,std::memory_order_relaxed);
+}
+
+#pragma mark -
+#pragma mark Playback Control
+/**
+ * Computes the target left and right gains for the given slot.
+ *
+ * AUDIO THREAD ONLY: This method reads the position table, and is called
+ * once per slot at the start of each buffer.
+ *
+ * @param slot      The emitter slot
+ * @param listener  The current listener position
+ * @param left      The left (or only) gain to store the result
+ * @param right     The right gain to store the result
+ */
+void AudioSpatializer::target(Uint8 slot, const Vec2& listener, float& left, float& right) const {
+    Vec2 offset = unpack_position(_emitters[slot].load(std::memory_order_relaxed));
+    if (!_relative[slot].load(std::memory_order_relaxed)) {
+        offset -= listener;
+    }
+    float reference = _reference.load(std::memory_order_relaxed);
+    float rolloff = _rolloff.load(std::memory_order_relaxed);
+    float distance = offset.length();
+
+    float gain = 1;
+    if (distance > reference) {
+        gain = reference/(reference+rolloff*(distance-reference));
+    }
+    if (_channels != 2) {
+        left  = gain;
+        right = gain;
+        return;
+    }
+
+    // Equal-power pan, normalized so that the center is at full gain
+    float pan = offset.x/std::max(distance,reference);
+    float angle = (pan+1)*M_PI_4;
+    left  = gain*std::min(1.0f,PAN_NORMAL*cosf(angle));
+    right = gain*std::min(1.0f,PAN_NORMAL*sinf(angle));
+}
+
+/**
+ * Accumulates an input buffer into the output, ramping the gains
+ *
+ * AUDIO THREAD ONLY: The intermediate buffer is added to the output,
+ * with the gains ramping linearly from (left0,right0) to (left1,right1)
+ * over the given number of frames.
+ *
+ * @param output    The output buffer
+ * @param field     The number of channels in the intermediate buffer
+ * @param frames    The number of frames to accumulate
+ * @param left0     The left gain at the start of the buffer
+ * @param right0    The right gain at the start of the buffer
+ * @param left1     The left gain at the end of the buffer
+ * @param right1    The right gain at the end of the buffer
+ */
+void AudioSpatializer::accumulate(float* output, Uint8 field, Uint32 frames,
+                                  float left0, float right0, float left1, float right1) {
+    if (frames == 0) {
+        return;
+    }
+    float* input = _buffer;
+    if (_channels == 2) {
+        float lstep = (left1-left0)/frames;
+        float rstep = (right1-right0)/frames;
+        float lgain = left0;
+        float rgain = right0;
+        if (field == 1) {
+            for(Uint32 ii = 0; ii < frames; ii++) {
+                lgain += lstep;
+                rgain += rstep;
+                output[0] += input[0]*lgain;
+                output[1] += input[0]*rgain;
+                output += 2;
+                input  += 1;
+            }
+        } else {
+            for(Uint32 ii = 0; ii < frames; ii++) {
+                lgain += lstep;
+                rgain += rstep;
+                output[0] += input[0]*lgain;
+                output[1] += input[1]*rgain;
+                output += 2;
+                input  += 2;
+            }
+        }
+    } else if (left0 == left1 && field == _channels) {
+        dsp::DSPMath::scale_add(input,output,left1,output,frames*_channels);
+    } else {
+        float step = (left1-left0)/frames;
+        float gain = left0;
+        for(Uint32 ii = 0; ii < frames; ii++) {
+            gain += step;
+            for(Uint32 jj = 0; jj < _channels; jj++) {
+                output[jj] += input[field == 1 ? 0 : jj]*gain;
+            }
+            output += _channels;
+            input  += field;
+        }
+    }
+}
+
+/**
+ * Reads up to the specified number of frames into the given buffer
+ *
+ * AUDIO THREAD ONLY: Users should never access this method directly, unless
+ * part of a custom audio graph node.
+ *
+ * The buffer should have enough room to store frames * channels elements.
+ * The channels are interleaved into the output buffer.
+ *
+ * This method will always forward the read position.
+ *
+ * @param buffer    The read buffer to store the results
+ * @param frames    The maximum number of frames to read
+ *
+ * @return the actual number of frames read
+ */
+Uint32 AudioSpatializer::read(float* buffer, Uint32 frames) {
+    if (frames > _capacity) {
+        std::memset(buffer+_capacity*_channels,0,(frames-_capacity)*_channels*sizeof(float));
+        frames = _capacity;
+    }
+    std::memset(buffer,0,frames*_channels*sizeof(float));
+    if (!_paused.load(std::memory_order_relaxed)) {
+        // The listener is read once, so every emitter sees the same position
+        Vec2 listener = unpack_position(_listener.load(std::memory_order_relaxed));
+        for(Uint8 ii = 0; ii < _width; ii++) {
+            // Raw pointers, so that this thread never releases an input
+            AudioNode* input = _staged[ii].load();
+            if (input == nullptr) {
+                continue;
+            }
+
+            float left, right;
+            target(ii,listener,left,right);
+            if (_snapped[ii].exchange(false)) {
+                _current[2*ii  ] = left;
+                _current[2*ii+1] = right;
+            }
+
+            Uint32 amt = input->read(_buffer,frames);
+            accumulate(buffer,input->getChannels(),amt,_current[2*ii],_current[2*ii+1],left,right);
+            _current[2*ii  ] = left;
+            _current[2*ii+1] = right;
+        }
+
+        float gain = _ndgain.load(std::memory_order_relaxed);
+        if (gain != 1) {
+            dsp::DSPMath::scale(buffer,gain,buffer,frames*_channels);
+        }
+    }
+    _cycle.fetch_add(1);
+    return frames;
+}
@@ -33,7 +33,6 @@
 //  Version: 12/5/18
 //
 #include <cugl/audio/graph/CUAudioSpinner.h>
-#include <cugl/audio/CUAudioDevices.h>
 #include <cugl/util/CUDebug.h>
 #include <cmath>
 
@@ -134,7 +133,7 @@ bool AudioSpinner::init(Uint8 channels, Uint8 field, Uint32 rate) {
         _outlines = new std::atomic<float>[channels];
         initPlan(_inplan,_inlines);
         initPlan(_outplan,_outlines);
-        _capacity = AudioDevices::get()->getReadSize();
+        _capacity = getDefaultReadSize();
         _buffer = (float*)malloc(_capacity*_field*sizeof(float));
         
         _crossover = DEFAULT_CROSSOVER;
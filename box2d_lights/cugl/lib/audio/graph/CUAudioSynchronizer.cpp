@@ -31,7 +31,6 @@
 //
 #include <cugl/audio/graph/CUAudioSynchronizer.h>
 #include <cugl/base/CUApplication.h>
-#include <cugl/audio/CUAudioDevices.h>
 #include <cugl/util/CUDebug.h>
 #include <cmath>
 
@@ -88,7 +87,7 @@ bool AudioSynchronizer::init() {
  */
 bool AudioSynchronizer::init(Uint8 channels, Uint32 rate) {
     if (AudioNode::init(channels,rate)) {
-        _capacity = AudioDevices::get()->getReadSize();
+        _capacity = getDefaultReadSize();
         _buffer = (float*)malloc(_capacity*(_channels+1)*sizeof(float));
         Timestamp start;
         _timestamp = start.getTime();
@@ -214,7 +213,7 @@ bool AudioSynchronizer::onBeat() {
     }
 
     // Unreliable.  Factor out to read specific values.
-    Uint32 size = AudioDevices::get()->getReadSize();
+    Uint32 size = getDefaultReadSize();
 
     // Compute the time bounds on the audio rendering
     timestamp_t current = cuclock_t::now();
@@ -33,6 +33,8 @@
 #include <cugl/base/CUApplication.h>
 #include <cugl/base/CUDisplay.h>
 #include <cugl/render/CUTexture.h>
+#include <cugl/render/CUShader.h>
+#include <cugl/render/CURenderThread.h>
 #include <cugl/input/CUInput.h>
 #include <cugl/util/CUDebug.h>
 #include <algorithm>
@@ -146,6 +148,7 @@ bool Application::init() {
     SDL_GL_SetSwapInterval(1);
     Input::start();
     Texture::getBlank(); // Prevent this from happening in loading threads
+    Shader::setBinaryCache(getSaveDirectory()+"shaders");
     Application::_theapp = this;
     _state = State::STARTUP;
     return true;
@@ -182,6 +185,11 @@ void Application::onStartup() {
  * causing the application to be deleted.
  */
 void Application::onShutdown() {
+    // Replay any outstanding commands and return OpenGL to this thread
+    if (RenderThread::get() != nullptr) {
+        RenderThread::stop();
+    }
+    
     // Switch states
     Input::stop();
     _state = State::NONE;
@@ -273,8 +281,11 @@ bool Application::step() {
         processCallbacks(((Uint32)micros)/1000);
         update(micros/1000000.0f);
 
-        glClearColor(_clearColor.r, _clearColor.g, _clearColor.b, _clearColor.a);
-        glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        Color4f clear = _clearColor;
+        RenderThread::post([=] {
+            glClearColor(clear.r, clear.g, clear.b, clear.a);
+            glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        });
 
         draw();
         Display::get()->refresh();
@@ -654,8 +665,11 @@ float Application::getAverageFPS() const {
  * @return the OpenGL description for this application
  */
 const std::string Application::getOpenGLDescription() const {
-    const char* glinfo = (const char*)glGetString(GL_VERSION);
-    return std::string(glinfo);
+    std::string result;
+    RenderThread::call([&] {
+        result = std::string((const char*)glGetString(GL_VERSION));
+    });
+    return result;
 }
 
 
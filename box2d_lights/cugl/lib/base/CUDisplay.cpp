@@ -36,6 +36,7 @@
 //  Version: 12/12/18
 #include <cugl/base/CUBase.h>
 #include <cugl/base/CUDisplay.h>
+#include <cugl/render/CURenderThread.h>
 #include <cugl/util/CUDebug.h>
 #include "platform/CUDisplay-impl.h"
 #include <SDL/SDL_ttf.h>
@@ -457,8 +458,12 @@ bool Display::removeOrientationListener() {
  * on iOS).
  */
 void Display::restoreRenderTarget() {
-    glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
-    glBindRenderbuffer(GL_RENDERBUFFER, _rendbuffer);
+    GLuint framebuffer = _framebuffer;
+    GLuint rendbuffer  = _rendbuffer;
+    RenderThread::post([=] {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, rendbuffer);
+    });
 }
 
 /**
@@ -470,8 +475,10 @@ void Display::restoreRenderTarget() {
  * on iOS).
  */
 void Display::queryRenderTarget() {
-    glGetIntegerv(GL_FRAMEBUFFER_BINDING,  &_framebuffer);
-    glGetIntegerv(GL_RENDERBUFFER_BINDING, &_rendbuffer);
+    RenderThread::call([&] {
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING,  &_framebuffer);
+        glGetIntegerv(GL_RENDERBUFFER_BINDING, &_rendbuffer);
+    });
 }
 
 /**
@@ -563,11 +570,20 @@ bool Display::initOpenGL(bool multisample) {
  *
  * This method will swap the OpenGL framebuffers, drawing the screen.
  *
+ * If the {@link RenderThread} is active, the swap is recorded with the
+ * rest of the frame, and the frame is submitted to the GL thread. The
+ * GL thread will then draw this frame while the application updates
+ * the next one.
+ *
  * It will also reassess the orientation state and call the listener as
  * necessary
  */
 void Display::refresh() {
-    SDL_GL_SwapWindow(_window);
+    SDL_Window* window = _window;
+    RenderThread::post([=] { SDL_GL_SwapWindow(window); });
+    if (RenderThread::get() != nullptr) {
+        RenderThread::get()->submit();
+    }
     Orientation oldDisplay = _displayOrientation;
     Orientation oldDevice  = _deviceOrientation;
     _displayOrientation = DisplayOrientation(true);
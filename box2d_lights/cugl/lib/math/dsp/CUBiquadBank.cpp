@@ -0,0 +1,537 @@
+//
+//  CUBiquadBank.cpp
+//  Cornell University Game Library (CUGL)
+//
+//  This class is a bank of independent biquad filters that are processed in
+//  parallel. Each filter is a "lane", with its own coefficients and state.
+//  A typical use is a per-voice lowpass (e.g. for distance or occlusion),
+//  where every active voice has its own filter. Lanes are stored in SoA
+//  (structure of arrays) layout, so that four lanes fit in a single vector
+//  register and advance together, one frame at a time.
+//
+//  This class supports vector optimizations for SSE and Neon 64.  On hosts
+//  that support AVX2, interleaved lanes are processed eight at a time.
+//
+//  This class is NOT THREAD SAFE.  This is by design, for performance reasons.
+//  External locking may be required when the filter is shared between multiple
+//  threads (such as between an audio thread and the main thread).
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Walker White
+//  Version: 5/12/21
+//
+#include <cugl/math/dsp/CUBiquadBank.h>
+#include <cugl/util/CUDebug.h>
+#include "cuDSP128.inl"
+#include "cuDSP256.inl"
+
+using namespace cugl;
+using namespace cugl::dsp;
+
+/** Whether to use a vectorization algorithm */
+bool BiquadBank::VECTORIZE = true;
+
+#if defined (CU_MATH_VECTOR_SSE)
+/**
+ * Returns the next output for four lanes, updating the lane state
+ *
+ * This is the transposed direct form II of the biquad equation.
+ *
+ * @param x     The input for each lane
+ * @param b0    The upper zero-order coefficient of each lane
+ * @param b1    The upper first-order coefficient of each lane
+ * @param b2    The upper second-order coefficient of each lane
+ * @param a1    The lower first-order coefficient of each lane
+ * @param a2    The lower second-order coefficient of each lane
+ * @param z1    The first delay state of each lane
+ * @param z2    The second delay state of each lane
+ *
+ * @return the next output for four lanes
+ */
+static inline __m128 biquad_step(__m128 x, __m128 b0, __m128 b1, __m128 b2,
+                                 __m128 a1, __m128 a2, __m128& z1, __m128& z2) {
+    __m128 y = _mm_add_ps(_mm_mul_ps(b0,x),z1);
+    z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1,x),_mm_mul_ps(a1,y)),z2);
+    z2 = _mm_sub_ps(_mm_mul_ps(b2,x),_mm_mul_ps(a2,y));
+    return y;
+}
+#elif defined (CU_MATH_VECTOR_NEON64)
+/**
+ * Returns the next output for four lanes, updating the lane state
+ *
+ * This is the transposed direct form II of the biquad equation.
+ *
+ * @param x     The input for each lane
+ * @param b0    The upper zero-order coefficient of each lane
+ * @param b1    The upper first-order coefficient of each lane
+ * @param b2    The upper second-order coefficient of each lane
+ * @param a1    The lower first-order coefficient of each lane
+ * @param a2    The lower second-order coefficient of each lane
+ * @param z1    The first delay state of each lane
+ * @param z2    The second delay state of each lane
+ *
+ * @return the next output for four lanes
+ */
+static inline float32x4_t biquad_step(float32x4_t x, float32x4_t b0, float32x4_t b1, float32x4_t b2,
+                                      float32x4_t a1, float32x4_t a2, float32x4_t& z1, float32x4_t& z2) {
+    float32x4_t y = vmlaq_f32(z1,b0,x);
+    z1 = vmlsq_f32(vmlaq_f32(z2,b1,x),a1,y);
+    z2 = vmlsq_f32(vmulq_f32(b2,x),a2,y);
+    return y;
+}
+#endif
+
+#pragma mark -
+#pragma mark Constructors
+/**
+ * Creates a bank with a single pass-through lane.
+ */
+BiquadBank::BiquadBank() :
+_lanes(0),
+_padded(0) {
+    allocate(1);
+}
+
+/**
+ * Creates a bank with the given number of pass-through lanes.
+ *
+ * @param lanes The number of lanes
+ */
+BiquadBank::BiquadBank(unsigned lanes) :
+_lanes(0),
+_padded(0) {
+    allocate(lanes);
+}
+
+/**
+ * Allocates the coefficient and state buffers for the given lanes.
+ *
+ * All lanes are reset to pass-through filters with no state.
+ *
+ * @param lanes The number of lanes
+ */
+void BiquadBank::allocate(unsigned lanes) {
+    _lanes  = lanes;
+    _padded = 4*((lanes+3)/4);
+    _b0.reset(_padded,16);
+    _b1.reset(_padded,16);
+    _b2.reset(_padded,16);
+    _a1.reset(_padded,16);
+    _a2.reset(_padded,16);
+    _z1.reset(_padded,16);
+    _z2.reset(_padded,16);
+    _b1.clear();
+    _b2.clear();
+    _a1.clear();
+    _a2.clear();
+    _z1.clear();
+    _z2.clear();
+    for(unsigned ii = 0; ii < _padded; ii++) {
+        _b0[ii] = 1.0f;
+    }
+}
+
+#pragma mark -
+#pragma mark Attributes
+/**
+ * Sets the number of lanes in this bank
+ *
+ * The coefficient and state buffers depend on the number of lanes.
+ * Changing this value resets every lane to a pass-through filter.
+ *
+ * @param lanes The number of lanes in this bank
+ */
+void BiquadBank::setLanes(unsigned lanes) {
+    if (lanes != _lanes) {
+        allocate(lanes);
+    }
+}
+
+/**
+ * Sets the coefficients for the given lane.
+ *
+ * Each lane implements the standard difference equation:
+ *
+ *   y[n] = b0*x[n] + b1*x[n-1] + b2*x[n-2] - a1*y[n-1] - a2*y[n-2]
+ *
+ * where y is the output and x in the input. The state of the lane is
+ * unchanged, so coefficients may be updated smoothly while filtering.
+ *
+ * @param lane  The lane to modify
+ * @param b0    The upper zero-order coefficient
+ * @param b1    The upper first-order coefficient
+ * @param b2    The upper second-order coefficient
+ * @param a1    The lower first-order coefficient
+ * @param a2    The lower second-order coefficient
+ */
+void BiquadBank::setCoeff(unsigned lane, float b0, float b1, float b2, float a1, float a2) {
+    CUAssertLog(lane < _lanes, "Lane %d is out of range",lane);
+    _b0[lane] = b0;
+    _b1[lane] = b1;
+    _b2[lane] = b2;
+    _a1[lane] = a1;
+    _a2[lane] = a2;
+}
+
+/**
+ * Sets the coefficients of the given lane to match a biquad filter.
+ *
+ * The state of the lane is unchanged.
+ *
+ * @param lane      The lane to modify
+ * @param filter    The filter to copy
+ */
+void BiquadBank::setCoeff(unsigned lane, const BiquadIIR& filter) {
+    std::vector<float> bvals = filter.getBCoeff();
+    std::vector<float> avals = filter.getACoeff();
+    setCoeff(lane,bvals[0],bvals[1],bvals[2],avals[1],avals[2]);
+}
+
+/**
+ * Sets the given lane to the special purpose filter of the given type
+ *
+ * This method uses the same filter design as {@link BiquadIIR#setType}.
+ * As with that class, frequencies are specified in "normalized" format
+ * and the gain is in decibels. The state of the lane is unchanged.
+ *
+ * This method computes the coefficients from scratch and is not intended
+ * to be called on the audio thread.
+ *
+ * @param lane      The lane to modify
+ * @param type      The filter type
+ * @param frequency The (normalized) target frequency
+ * @param gainDB    The gain at the target frequency in decibels
+ * @param qVal      The special Q factor
+ */
+void BiquadBank::setType(unsigned lane, BiquadIIR::Type type, float frequency,
+                         float gainDB, float qVal) {
+    BiquadIIR filter(1,type,frequency,gainDB,qVal);
+    setCoeff(lane,filter);
+}
+
+/**
+ * Returns the upper coefficients for the given lane.
+ *
+ * @param lane  The lane to query
+ *
+ * @return The upper coefficients for the given lane.
+ */
+const std::vector<float> BiquadBank::getBCoeff(unsigned lane) const {
+    CUAssertLog(lane < _lanes, "Lane %d is out of range",lane);
+    std::vector<float> result;
+    result.push_back(_b0[lane]);
+    result.push_back(_b1[lane]);
+    result.push_back(_b2[lane]);
+    return result;
+}
+
+/**
+ * Returns the lower coefficients for the given lane.
+ *
+ * The first coefficient is always 1 (the coefficients are normalized).
+ *
+ * @param lane  The lane to query
+ *
+ * @return The lower coefficients for the given lane.
+ */
+const std::vector<float> BiquadBank::getACoeff(unsigned lane) const {
+    CUAssertLog(lane < _lanes, "Lane %d is out of range",lane);
+    std::vector<float> result;
+    result.push_back(1.0f);  // Assume normalization
+    result.push_back(_a1[lane]);
+    result.push_back(_a2[lane]);
+    return result;
+}
+
+#pragma mark -
+#pragma mark Filter Methods
+/**
+ * Performs a filter of interleaved lane data.
+ *
+ * The data is laid out like interleaved audio with one channel per lane.
+ * The output is written to the given output array, which should be the
+ * same size as the input array. The size is the number of frames, not
+ * samples.  Hence the arrays must be size times the number of lanes in
+ * size. The input and output may be the same array.
+ *
+ * The gain parameter is applied at the filter input, but does not affect
+ * the filter coefficients.
+ *
+ * @param gain      The input gain factor
+ * @param input     The array of input samples
+ * @param output    The array to write the sample output
+ * @param size      The input size in frames
+ */
+void BiquadBank::calculate(float gain, const float* input, float* output, size_t size) {
+    interleaved(gain,input,output,size);
+}
+
+/**
+ * Performs a filter of lane data stored in separate buffers.
+ *
+ * There should be one input buffer and one output buffer per lane,
+ * each with size samples. An output buffer may be the same as the
+ * matching input buffer.
+ *
+ * The gain parameter is applied at the filter input, but does not affect
+ * the filter coefficients.
+ *
+ * @param gain      The input gain factor
+ * @param input     The input buffers, one per lane
+ * @param output    The output buffers, one per lane
+ * @param size      The input size in frames
+ */
+void BiquadBank::calculate(float gain, const float* const* input, float* const* output, size_t size) {
+    separate(gain,input,output,size);
+}
+
+/**
+ * Clears the state of every lane, leaving the coefficients unchanged
+ */
+void BiquadBank::clear() {
+    _z1.clear();
+    _z2.clear();
+}
+
+/**
+ * Clears the state of the given lane, leaving the coefficients unchanged
+ *
+ * This should be called when a lane is reassigned to a new voice.
+ *
+ * @param lane  The lane to clear
+ */
+void BiquadBank::clear(unsigned lane) {
+    CUAssertLog(lane < _lanes, "Lane %d is out of range",lane);
+    _z1[lane] = 0.0f;
+    _z2[lane] = 0.0f;
+}
+
+#pragma mark -
+#pragma mark Specialized Filters
+/**
+ * Performs a filter of a single lane with the scalar algorithm.
+ *
+ * The input and output strides are the distance (in samples) between
+ * consecutive frames of this lane.
+ *
+ * @param lane      The lane to process
+ * @param gain      The input gain factor
+ * @param input     The array of input samples
+ * @param istride   The input stride
+ * @param output    The array to write the sample output
+ * @param ostride   The output stride
+ * @param size      The input size in frames
+ */
+void BiquadBank::lane(unsigned lane, float gain, const float* input, size_t istride,
+                      float* output, size_t ostride, size_t size) {
+    float b0 = _b0[lane];
+    float b1 = _b1[lane];
+    float b2 = _b2[lane];
+    float a1 = _a1[lane];
+    float a2 = _a2[lane];
+    float z1 = _z1[lane];
+    float z2 = _z2[lane];
+    for(size_t ii = 0; ii < size; ii++) {
+        float x = gain*input[ii*istride];
+        float y = b0*x+z1;
+        z1 = b1*x-a1*y+z2;
+        z2 = b2*x-a2*y;
+        output[ii*ostride] = y;
+    }
+    _z1[lane] = z1;
+    _z2[lane] = z2;
+}
+
+/**
+ * Performs a filter of interleaved lane data.
+ *
+ * This method uses the vectorized algorithm, if available.
+ *
+ * @param gain      The input gain factor
+ * @param input     The array of input samples
+ * @param output    The array to write the sample output
+ * @param size      The input size in frames
+ */
+void BiquadBank::interleaved(float gain, const float* input, float* output, size_t size) {
+    unsigned start = 0;
+#if defined (CU_MATH_VECTOR_SSE)
+    if (VECTORIZE) {
+#if defined (CU_MATH_VECTOR_AVX2)
+        if (DSPMath::useAVX2()) {
+            const float* coeff[5] = { _b0, _b1, _b2, _a1, _a2 };
+            start = avx2_biquad(gain,input,output,size,_lanes,coeff,_z1,_z2);
+        }
+#endif
+        // Each group of four lanes stays in registers for the whole buffer
+        __m128 factor = _mm_set1_ps(gain);
+        for(; start+4 <= _lanes; start += 4) {
+            __m128 b0 = _mm_load_ps(_b0+start);
+            __m128 b1 = _mm_load_ps(_b1+start);
+            __m128 b2 = _mm_load_ps(_b2+start);
+            __m128 a1 = _mm_load_ps(_a1+start);
+            __m128 a2 = _mm_load_ps(_a2+start);
+            __m128 z1 = _mm_load_ps(_z1+start);
+            __m128 z2 = _mm_load_ps(_z2+start);
+            const float* src = input+start;
+            float* dst = output+start;
+            for(size_t ii = 0; ii < size; ii++) {
+                __m128 x = _mm_mul_ps(factor,_mm_loadu_ps(src));
+                _mm_storeu_ps(dst,biquad_step(x,b0,b1,b2,a1,a2,z1,z2));
+                src += _lanes;
+                dst += _lanes;
+            }
+            _mm_store_ps(_z1+start,z1);
+            _mm_store_ps(_z2+start,z2);
+        }
+    }
+#elif defined (CU_MATH_VECTOR_NEON64)
+#if defined (__ANDROID__)
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
+#else
+    if (VECTORIZE) {
+#endif
+        // Each group of four lanes stays in registers for the whole buffer
+        float32x4_t factor = vdupq_n_f32(gain);
+        for(; start+4 <= _lanes; start += 4) {
+            float32x4_t b0 = vld1q_f32(_b0+start);
+            float32x4_t b1 = vld1q_f32(_b1+start);
+            float32x4_t b2 = vld1q_f32(_b2+start);
+            float32x4_t a1 = vld1q_f32(_a1+start);
+            float32x4_t a2 = vld1q_f32(_a2+start);
+            float32x4_t z1 = vld1q_f32(_z1+start);
+            float32x4_t z2 = vld1q_f32(_z2+start);
+            const float* src = input+start;
+            float* dst = output+start;
+            for(size_t ii = 0; ii < size; ii++) {
+                float32x4_t x = vmulq_f32(factor,vld1q_f32(src));
+                vst1q_f32(dst,biquad_step(x,b0,b1,b2,a1,a2,z1,z2));
+                src += _lanes;
+                dst += _lanes;
+            }
+            vst1q_f32(_z1+start,z1);
+            vst1q_f32(_z2+start,z2);
+        }
+    }
+#endif
+    // Any lanes not in a group of four
+    for(unsigned ll = start; ll < _lanes; ll++) {
+        lane(ll,gain,input+ll,_lanes,output+ll,_lanes,size);
+    }
+}
+
+/**
+ * Performs a filter of lane data stored in separate buffers.
+ *
+ * This method uses the vectorized algorithm, if available.
+ *
+ * @param gain      The input gain factor
+ * @param input     The input buffers, one per lane
+ * @param output    The output buffers, one per lane
+ * @param size      The input size in frames
+ */
+void BiquadBank::separate(float gain, const float* const* input, float* const* output, size_t size) {
+    unsigned start = 0;
+#if defined (CU_MATH_VECTOR_SSE)
+    if (VECTORIZE) {
+        // Load four frames of four lanes and transpose into four lane vectors
+        size_t whole = size-(size % 4);
+        __m128 factor = _mm_set1_ps(gain);
+        for(; start+4 <= _lanes; start += 4) {
+            __m128 b0 = _mm_load_ps(_b0+start);
+            __m128 b1 = _mm_load_ps(_b1+start);
+            __m128 b2 = _mm_load_ps(_b2+start);
+            __m128 a1 = _mm_load_ps(_a1+start);
+            __m128 a2 = _mm_load_ps(_a2+start);
+            __m128 z1 = _mm_load_ps(_z1+start);
+            __m128 z2 = _mm_load_ps(_z2+start);
+            const float* const* src = input+start;
+            float* const* dst = output+start;
+            for(size_t ii = 0; ii < whole; ii += 4) {
+                __m128 row0 = _mm_loadu_ps(src[0]+ii);
+                __m128 row1 = _mm_loadu_ps(src[1]+ii);
+                __m128 row2 = _mm_loadu_ps(src[2]+ii);
+                __m128 row3 = _mm_loadu_ps(src[3]+ii);
+                _mm_transpose4_ps(row0,row1,row2,row3);
+                row0 = biquad_step(_mm_mul_ps(factor,row0),b0,b1,b2,a1,a2,z1,z2);
+                row1 = biquad_step(_mm_mul_ps(factor,row1),b0,b1,b2,a1,a2,z1,z2);
+                row2 = biquad_step(_mm_mul_ps(factor,row2),b0,b1,b2,a1,a2,z1,z2);
+                row3 = biquad_step(_mm_mul_ps(factor,row3),b0,b1,b2,a1,a2,z1,z2);
+                _mm_transpose4_ps(row0,row1,row2,row3);
+                _mm_storeu_ps(dst[0]+ii,row0);
+                _mm_storeu_ps(dst[1]+ii,row1);
+                _mm_storeu_ps(dst[2]+ii,row2);
+                _mm_storeu_ps(dst[3]+ii,row3);
+            }
+            _mm_store_ps(_z1+start,z1);
+            _mm_store_ps(_z2+start,z2);
+            for(unsigned ll = start; ll < start+4; ll++) {
+                lane(ll,gain,input[ll]+whole,1,output[ll]+whole,1,size-whole);
+            }
+        }
+    }
+#elif defined (CU_MATH_VECTOR_NEON64)
+#if defined (__ANDROID__)
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
+#else
+    if (VECTORIZE) {
+#endif
+        // Load four frames of four lanes and transpose into four lane vectors
+        size_t whole = size-(size % 4);
+        float32x4_t factor = vdupq_n_f32(gain);
+        for(; start+4 <= _lanes; start += 4) {
+            float32x4_t b0 = vld1q_f32(_b0+start);
+            float32x4_t b1 = vld1q_f32(_b1+start);
+            float32x4_t b2 = vld1q_f32(_b2+start);
+            float32x4_t a1 = vld1q_f32(_a1+start);
+            float32x4_t a2 = vld1q_f32(_a2+start);
+            float32x4_t z1 = vld1q_f32(_z1+start);
+            float32x4_t z2 = vld1q_f32(_z2+start);
+            const float* const* src = input+start;
+            float* const* dst = output+start;
+            for(size_t ii = 0; ii < whole; ii += 4) {
+                float32x4_t row0 = vld1q_f32(src[0]+ii);
+                float32x4_t row1 = vld1q_f32(src[1]+ii);
+                float32x4_t row2 = vld1q_f32(src[2]+ii);
+                float32x4_t row3 = vld1q_f32(src[3]+ii);
+                vtrn4q_f32(row0,row1,row2,row3);
+                row0 = biquad_step(vmulq_f32(factor,row0),b0,b1,b2,a1,a2,z1,z2);
+                row1 = biquad_step(vmulq_f32(factor,row1),b0,b1,b2,a1,a2,z1,z2);
+                row2 = biquad_step(vmulq_f32(factor,row2),b0,b1,b2,a1,a2,z1,z2);
+                row3 = biquad_step(vmulq_f32(factor,row3),b0,b1,b2,a1,a2,z1,z2);
+                vtrn4q_f32(row0,row1,row2,row3);
+                vst1q_f32(dst[0]+ii,row0);
+                vst1q_f32(dst[1]+ii,row1);
+                vst1q_f32(dst[2]+ii,row2);
+                vst1q_f32(dst[3]+ii,row3);
+            }
+            vst1q_f32(_z1+start,z1);
+            vst1q_f32(_z2+start,z2);
+            for(unsigned ll = start; ll < start+4; ll++) {
+                lane(ll,gain,input[ll]+whole,1,output[ll]+whole,1,size-whole);
+            }
+        }
+    }
+#endif
+    // Any lanes not in a group of four
+    for(unsigned ll = start; ll < _lanes; ll++) {
+        lane(ll,gain,input[ll],1,output[ll],1,size);
+    }
+}
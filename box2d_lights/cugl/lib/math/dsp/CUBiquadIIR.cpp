@@ -216,8 +216,7 @@ void BiquadIIR::reset() {
     _mm_store_ps(_d2+12,    _mm_setr_ps(   0,    0,      0,           1 ));
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if ( android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if ( android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     {
 #endif
@@ -798,8 +797,7 @@ void BiquadIIR::stride(float gain, float* input, float* output, size_t size, uns
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -941,8 +939,7 @@ void BiquadIIR::single(float gain, float* input, float* output, size_t size) {
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -1083,8 +1080,7 @@ void BiquadIIR::dual(float gain, float* input, float* output, size_t size) {
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -1198,8 +1194,7 @@ void BiquadIIR::dual(float gain, float* input, float* output, size_t size) {
 void BiquadIIR::trio(float gain, float* input, float* output, size_t size) {
 #if defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -1372,8 +1367,7 @@ void BiquadIIR::quad(float gain, float* input, float* output, size_t size) {
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -1522,8 +1516,7 @@ void BiquadIIR::quart(float gain, float* input, float* output, size_t size) {
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
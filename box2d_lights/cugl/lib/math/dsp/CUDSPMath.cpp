@@ -33,13 +33,66 @@
 //
 #include <cugl/math/dsp/CUDSPMath.h>
 #include <cugl/util/CUDebug.h>
+#include <SDL/SDL.h>
+#if defined (_MSC_VER)
+#include <intrin.h>
+#endif
 #include "cuDSP128.inl"
+#include "cuDSP256.inl"
 
 using namespace cugl;
 using namespace cugl::dsp;
 
 /** Whether to use a vectorization algorithm */
 bool DSPMath::VECTORIZE = true;
+/** Whether to use the 256-bit kernels when supported */
+bool DSPMath::VECTORIZE_AVX2 = true;
+
+#if defined (CU_MATH_VECTOR_AVX2)
+/**
+ * Returns true if this CPU supports the AVX2 and FMA instruction sets
+ *
+ * The 256-bit kernels use fused multiply-add, which is a separate CPUID
+ * feature from AVX2. SDL does not report FMA, so we query CPUID directly.
+ *
+ * @return true if this CPU supports the AVX2 and FMA instruction sets
+ */
+static bool detect_avx2() {
+#if defined (__AVX2__) && (defined (__FMA__) || defined (_MSC_VER))
+    // The whole library was built for AVX2 (e.g. -mavx2 -mfma or /arch:AVX2)
+    return true;
+#elif defined (_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    bool fma = (info[2] & (1 << 12)) != 0;
+    return fma && SDL_HasAVX2() == SDL_TRUE;
+#else
+    __builtin_cpu_init();
+    bool fma = __builtin_cpu_supports("fma");
+    return fma && SDL_HasAVX2() == SDL_TRUE;
+#endif
+}
+
+/** Whether this CPU supports AVX2 and FMA (detected once at startup) */
+static const bool AVX2_SUPPORTED = detect_avx2();
+#else
+/** Whether this CPU supports AVX2 (never, without the kernels) */
+static const bool AVX2_SUPPORTED = false;
+#endif
+
+#pragma mark -
+#pragma mark Vectorization
+/**
+ * Returns true if this CPU supports the 256-bit (AVX2) kernels
+ *
+ * The kernels require both AVX2 and FMA. This value is detected once, at
+ * startup. It is false on any platform other than x86 (with SSE enabled).
+ *
+ * @return true if this CPU supports the 256-bit (AVX2) kernels
+ */
+bool DSPMath::hasAVX2() {
+    return AVX2_SUPPORTED;
+}
 
 #pragma mark -
 #pragma mark Arithmetic Methods
@@ -56,6 +109,11 @@ bool DSPMath::VECTORIZE = true;
  * @return the number of elements successfully added
  */
 size_t DSPMath::add(float* input1, float* input2, float* output, size_t size) {
+#if defined (CU_MATH_VECTOR_AVX2)
+    if (VECTORIZE && useAVX2()) {
+        avx2_add(input1,input2,output,size);
+    } else
+#endif
 #if defined (CU_MATH_VECTOR_SSE)
     if (VECTORIZE) {
         for(int ii = 0; ii < (int)size-3; ii += 4) {
@@ -70,8 +128,7 @@ size_t DSPMath::add(float* input1, float* input2, float* output, size_t size) {
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -109,6 +166,11 @@ size_t DSPMath::add(float* input1, float* input2, float* output, size_t size) {
  * @return the number of elements successfully multiplied
  */
 size_t DSPMath::multiply(float* input1, float* input2, float* output, size_t size) {
+#if defined (CU_MATH_VECTOR_AVX2)
+    if (VECTORIZE && useAVX2()) {
+        avx2_multiply(input1,input2,output,size);
+    } else
+#endif
 #if defined (CU_MATH_VECTOR_SSE)
     if (VECTORIZE) {
         for(int ii = 0; ii < (int)size-3; ii += 4) {
@@ -123,8 +185,7 @@ size_t DSPMath::multiply(float* input1, float* input2, float* output, size_t siz
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -161,6 +222,11 @@ size_t DSPMath::multiply(float* input1, float* input2, float* output, size_t siz
  * @return the number of elements successfully multiplied
  */
 size_t DSPMath::scale(float* input, float scalar, float* output, size_t size) {
+#if defined (CU_MATH_VECTOR_AVX2)
+    if (VECTORIZE && useAVX2()) {
+        avx2_scale(input,scalar,output,size);
+    } else
+#endif
 #if defined (CU_MATH_VECTOR_SSE)
     if (VECTORIZE) {
         const __m128 gain = _mm_set1_ps(scalar);
@@ -176,8 +242,7 @@ size_t DSPMath::scale(float* input, float scalar, float* output, size_t size) {
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -216,6 +281,11 @@ size_t DSPMath::scale(float* input, float scalar, float* output, size_t size) {
  * @return the number of elements successfully processed
  */
 size_t DSPMath::scale_add(float* input1, float* input2, float scalar, float* output, size_t size) {
+#if defined (CU_MATH_VECTOR_AVX2)
+    if (VECTORIZE && useAVX2()) {
+        avx2_scale_add(input1,input2,scalar,output,size);
+    } else
+#endif
 #if defined (CU_MATH_VECTOR_SSE)
     if (VECTORIZE) {
         const __m128 gain = _mm_set1_ps(scalar);
@@ -232,8 +302,7 @@ size_t DSPMath::scale_add(float* input1, float* input2, float scalar, float* out
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -302,8 +371,7 @@ size_t DSPMath::slide(float* input, float start, float end, float* output, size_
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -376,8 +444,7 @@ size_t DSPMath::slide_add(float* input1, float* input2, float start, float end,
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -423,6 +490,11 @@ size_t DSPMath::slide_add(float* input1, float* input2, float start, float end,
  * @return the number of elements successfully clamped
  */
 size_t DSPMath::clamp(float* data, float min, float max, size_t size) {
+#if defined (CU_MATH_VECTOR_AVX2)
+    if (VECTORIZE && useAVX2()) {
+        avx2_clamp(data,min,max,size);
+    } else
+#endif
 #if defined (CU_MATH_VECTOR_SSE)
     if (VECTORIZE) {
         const __m128 vmin = _mm_set1_ps(min);
@@ -441,8 +513,7 @@ size_t DSPMath::clamp(float* data, float min, float max, size_t size) {
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -486,6 +557,11 @@ size_t DSPMath::clamp(float* data, float min, float max, size_t size) {
  */
 size_t DSPMath::ease(float* data, float bound, float knee, size_t size) {
     float factor = bound*knee-knee*knee;
+#if defined (CU_MATH_VECTOR_AVX2)
+    if (VECTORIZE && useAVX2()) {
+        avx2_ease(data,bound,knee,size);
+    } else
+#endif
 #if defined (CU_MATH_VECTOR_SSE)
     if (VECTORIZE) {
         const __m128 gain = _mm_set1_ps(bound);
@@ -499,7 +575,7 @@ size_t DSPMath::ease(float* data, float bound, float knee, size_t size) {
             temp1 = _mm_cmpgt_ps(value,uppr);
             temp2 = _mm_cmplt_ps(value,lowr);
             temp3 = _mm_or_ps(temp1,temp2);
-            if (!_mm_test_all_zeros(temp3,mask)) {
+            if (!_mm_test_all_zeros(_mm_castps_si128(temp3),mask)) {
                 rght  = _mm_div_ps(fact,value);
                 left  = _mm_and_ps(temp1,_mm_sub_ps(gain,rght));
                 rght  = _mm_and_ps(temp2,_mm_add_ps(gain,rght));
@@ -521,8 +597,7 @@ size_t DSPMath::ease(float* data, float bound, float knee, size_t size) {
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -440,8 +440,7 @@ void FIRFilter::stride(float gain, float* input, float* output, size_t size, uns
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -574,8 +573,7 @@ void FIRFilter::single(float gain, float* input, float* output, size_t size) {
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -713,8 +711,7 @@ void FIRFilter::dual(float gain, float* input, float* output, size_t size) {
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -824,8 +821,7 @@ void FIRFilter::dual(float gain, float* input, float* output, size_t size) {
 void FIRFilter::trio(float gain, float* input, float* output, size_t size) {
 #if defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -942,8 +938,7 @@ void FIRFilter::quad(float gain, float* input, float* output, size_t size) {
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -1055,8 +1050,7 @@ void FIRFilter::quart(float gain, float* input, float* output, size_t size) {
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
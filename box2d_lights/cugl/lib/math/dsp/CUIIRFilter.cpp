@@ -280,8 +280,7 @@ void IIRFilter::reset() {
         _mm_store_ps(_d2+12,    _mm_setr_ps(0,    0,      0,               1));
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-        if ( android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-            (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+        if ( android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
         {
 #endif
@@ -333,8 +332,7 @@ void IIRFilter::reset() {
         _mm_store_ps(_d2+12,    _mm_setr_ps(0, 0, 0, 1));
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-        if ( android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-            (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+        if ( android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
         {
 #endif
@@ -878,8 +876,7 @@ void IIRFilter::stride(float gain, float* input, float* output, size_t size, uns
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -1269,8 +1266,7 @@ void IIRFilter::single(float gain, float* input, float* output, size_t size) {
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -1663,8 +1659,7 @@ void IIRFilter::dual(float gain, float* input, float* output, size_t size) {
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -1934,8 +1929,7 @@ void IIRFilter::dual(float gain, float* input, float* output, size_t size) {
 void IIRFilter::trio(float gain, float* input, float* output, size_t size) {
 #if defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -2244,8 +2238,7 @@ void IIRFilter::quad(float gain, float* input, float* output, size_t size) {
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -2470,8 +2463,7 @@ void IIRFilter::quart(float gain, float* input, float* output, size_t size) {
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -168,8 +168,7 @@ void OnePoleIIR::reset() {
     _mm_store_ps(_d2+12, _mm_setr_ps(0.0f, 0.0f,  0.0f,  1.0f));
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if ( android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if ( android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     {
 #endif
@@ -593,8 +592,7 @@ void OnePoleIIR::stride(float gain, float* input, float* output, size_t size, un
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -693,8 +691,7 @@ void OnePoleIIR::single(float gain, float* input, float* output, size_t size) {
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-         (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -793,8 +790,7 @@ void OnePoleIIR::dual(float gain, float* input, float* output, size_t size) {
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -871,8 +867,7 @@ void OnePoleIIR::dual(float gain, float* input, float* output, size_t size) {
 void OnePoleIIR::trio(float gain, float* input, float* output, size_t size) {
 #if defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -1001,8 +996,7 @@ void OnePoleIIR::quad(float gain, float* input, float* output, size_t size) {
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
@@ -1088,8 +1082,7 @@ void OnePoleIIR::quart(float gain, float* input, float* output, size_t size) {
     } else {
 #elif defined (CU_MATH_VECTOR_NEON64)
 #if defined (__ANDROID__)
-    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
-        (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0) {
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
 #else
     if (VECTORIZE) {
 #endif
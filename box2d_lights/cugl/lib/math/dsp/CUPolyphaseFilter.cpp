@@ -0,0 +1,554 @@
+//
+//  CUPolyphaseFilter.cpp
+//  Cornell University Game Library (CUGL)
+//
+//  This class is a polyphase, windowed-sinc sample rate converter. It converts
+//  a (potentially infinite) stream of interleaved audio from one sample rate
+//  to another, using a filter bank that is precomputed once per conversion
+//  ratio. The streaming state is kept in a single history buffer, so input
+//  may be written directly into the filter with no intermediate copies.
+//
+//  This class supports vector optimizations for SSE and Neon 64.  On hosts
+//  that support AVX2, mono and stereo conversion use 256-bit words.
+//
+//  This class is NOT THREAD SAFE.  This is by design, for performance reasons.
+//  External locking may be required when the filter is shared between multiple
+//  threads (such as between an audio thread and the main thread).
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Walker White
+//  Version: 5/12/21
+//
+#include <cugl/math/dsp/CUPolyphaseFilter.h>
+#include <cugl/util/CUDebug.h>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+#include "cuDSP128.inl"
+#include "cuDSP256.inl"
+
+using namespace cugl;
+using namespace cugl::dsp;
+
+/** The maximum number of taps on each side of a filter phase */
+#define MAX_HALF_TAPS   64
+/** The cutoff relative to the lower Nyquist rate (leaves a transition band) */
+#define FILTER_ROLLOFF  0.95
+
+/** Whether to use a vectorization algorithm */
+bool PolyphaseFilter::VECTORIZE = true;
+/** The maximum number of phases in a filter bank */
+const Uint32 PolyphaseFilter::MAX_PHASES = 512;
+/** The number of sinc zero crossings on each side of the filter */
+const Uint32 PolyphaseFilter::ZERO_CROSSINGS = 8;
+
+/**
+ * Returns the greatest common divisor of a and b
+ *
+ * @param a     The first value
+ * @param b     The second value
+ *
+ * @return the greatest common divisor of a and b
+ */
+static Uint32 gcd(Uint32 a, Uint32 b) {
+    while (b) {
+        Uint32 t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+#pragma mark Constructors
+/**
+ * Creates a single channel pass-through converter at 48000 Hz.
+ */
+PolyphaseFilter::PolyphaseFilter() :
+_channels(1),
+_inrate(48000),
+_outrate(48000) {
+    setup(0);
+}
+
+/**
+ * Creates a converter for the given channels and sample rates.
+ *
+ * The value frames is the maximum number of output frames requested
+ * in a single call to {@link #calculate}. It determines the size of
+ * the input history.
+ *
+ * @param channels  The number of channels
+ * @param inrate    The input sample rate
+ * @param outrate   The output sample rate
+ * @param frames    The maximum number of output frames per calculation
+ */
+PolyphaseFilter::PolyphaseFilter(unsigned channels, Uint32 inrate, Uint32 outrate, size_t frames) :
+_channels(channels),
+_inrate(inrate),
+_outrate(outrate) {
+    setup(frames);
+}
+
+/**
+ * Returns the filter bank for the given conversion.
+ *
+ * The bank is computed the first time a conversion is requested, and
+ * is cached afterwards. This method is thread safe, but it should not
+ * be called in the audio thread, as it may lock or allocate memory.
+ *
+ * @param channels  The number of channels
+ * @param inrate    The input sample rate
+ * @param outrate   The output sample rate
+ *
+ * @return the filter bank for the given conversion.
+ */
+std::shared_ptr<const PolyphaseFilter::Bank> PolyphaseFilter::acquire(unsigned channels,
+                                                                      Uint32 inrate,
+                                                                      Uint32 outrate) {
+    // Widen the filter when decimating, so the cutoff is the output Nyquist
+    double ratio  = (double)inrate/(double)outrate;
+    double cutoff = FILTER_ROLLOFF*std::min(1.0,1.0/ratio);
+    Uint32 half = (Uint32)std::ceil(ZERO_CROSSINGS*std::max(1.0,ratio));
+    half = std::min(half+(half % 2),(Uint32)MAX_HALF_TAPS);
+    Uint32 taps = 2*half;
+
+    // Banks are few and small, so they are never evicted
+    typedef std::tuple<Uint32,Uint32,Uint32,unsigned> Key;
+    static std::map<Key,std::shared_ptr<const Bank>> cache;
+    static std::mutex mutex;
+
+    Key key(inrate,outrate,taps,channels);
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+        return it->second;
+    }
+
+    std::shared_ptr<Bank> bank = std::make_shared<Bank>();
+    Uint32 div = gcd(inrate,outrate);
+    bank->upsample = outrate/div;
+    bank->dnsample = inrate/div;
+    bank->phases = std::min(bank->upsample,MAX_PHASES);
+    bank->taps = taps;
+
+    // One extra phase for rounding up to the next input frame
+    Uint32 phases = bank->phases;
+    size_t rowsize = taps*channels;
+    bank->coeffs.reset((phases+1)*rowsize,16);
+    std::vector<double> row(taps);
+    for(Uint32 pp = 0; pp <= phases; pp++) {
+        double offset = (double)pp/phases;
+        double total = 0;
+        for(Uint32 jj = 0; jj < taps; jj++) {
+            double x = jj-(double)(half-1)-offset;
+            double t = (x+half)/(2.0*half);
+            double w = 0.42-0.5*std::cos(2*M_PI*t)+0.08*std::cos(4*M_PI*t);
+            double s = x == 0 ? 1.0 : std::sin(M_PI*cutoff*x)/(M_PI*cutoff*x);
+            row[jj] = w*s;
+            total += row[jj];
+        }
+
+        // Normalize each phase to unity gain, or the phases ripple at DC
+        float* dst = bank->coeffs+pp*rowsize;
+        for(Uint32 jj = 0; jj < taps; jj++) {
+            float value = (float)(row[jj]/total);
+            for(unsigned ch = 0; ch < channels; ch++) {
+                dst[jj*channels+ch] = value;
+            }
+        }
+    }
+
+    cache[key] = bank;
+    return bank;
+}
+
+/**
+ * Acquires the filter bank for the current rates and channels.
+ *
+ * This method also allocates the input history large enough to produce
+ * the given number of output frames in a single call.
+ *
+ * @param frames    The maximum number of output frames per calculation
+ */
+void PolyphaseFilter::setup(size_t frames) {
+    CUAssertLog(_channels && _inrate && _outrate, "Converter format is degenerate");
+    _bank = acquire(_channels,_inrate,_outrate);
+    _upsample = _bank->upsample;
+    _dnsample = _bank->dnsample;
+    _phases = _bank->phases;
+    _taps = _bank->taps;
+    _coeffs = _bank->coeffs;
+
+    double ratio = (double)_inrate/(double)_outrate;
+    _capacity = _taps+2+(size_t)std::ceil(frames*ratio);
+    _inns.reset(_capacity*_channels,16);
+    clear();
+}
+
+#pragma mark Attributes
+/**
+ * Resets the converter to the given channels and sample rates.
+ *
+ * This acquires a new filter bank and clears the input history. The
+ * value frames is the maximum number of output frames requested in a
+ * single call to {@link #calculate}.
+ *
+ * @param channels  The number of channels
+ * @param inrate    The input sample rate
+ * @param outrate   The output sample rate
+ * @param frames    The maximum number of output frames per calculation
+ */
+void PolyphaseFilter::reset(unsigned channels, Uint32 inrate, Uint32 outrate, size_t frames) {
+    _channels = channels;
+    _inrate  = inrate;
+    _outrate = outrate;
+    setup(frames);
+}
+
+#pragma mark Filter Methods
+/**
+ * Returns the number of input frames needed for the given output frames.
+ *
+ * This value is exact. Appending this many frames guarantees that the
+ * next call to {@link #calculate} produces all of the requested frames.
+ * It is limited by the free space in the input history.
+ *
+ * @param frames    The number of output frames
+ *
+ * @return the number of input frames needed for the given output frames.
+ */
+size_t PolyphaseFilter::getInputNeeded(size_t frames) const {
+    if (frames == 0) {
+        return 0;
+    }
+    Uint64 total = _phase+(Uint64)(frames-1)*_dnsample;
+    size_t want = _index+(size_t)(total/_upsample)+_taps/2+1;
+    if (want <= _count) {
+        return 0;
+    }
+    return std::min(want-_count,_capacity-_count);
+}
+
+/**
+ * Appends the given number of frames written to the input buffer.
+ *
+ * @param frames    The number of frames written
+ */
+void PolyphaseFilter::appendInput(size_t frames) {
+    CUAssertLog(_count+frames <= _capacity, "Input history overflow");
+    _count = std::min(_count+frames,_capacity);
+}
+
+/**
+ * Converts the input history, writing up to size frames to output.
+ *
+ * The output is interleaved, and has the same number of channels as
+ * the input. This method returns fewer than size frames only if not
+ * enough input has been appended. Input no longer needed by future
+ * frames is discarded from the history.
+ *
+ * @param output    The array to write the sample output
+ * @param size      The maximum number of output frames
+ *
+ * @return the number of frames written to output
+ */
+size_t PolyphaseFilter::calculate(float* output, size_t size) {
+    // Count the frames the history can support
+    size_t half = _taps/2;
+    size_t amt = 0;
+    if (_index+half < _count) {
+        Uint64 avail = (Uint64)(_count-half-_index)*_upsample-_phase;
+        amt = (size_t)std::min((Uint64)size,(avail+_dnsample-1)/_dnsample);
+    }
+
+    if (amt) {
+        switch (_channels) {
+            case 1:
+                single(output,amt);
+                break;
+            case 2:
+                dual(output,amt);
+                break;
+            default:
+                if (_channels % 4 == 0) {
+                    quad(output,amt);
+                } else {
+                    stride(output,amt);
+                }
+                break;
+        }
+    }
+
+    // Shift the unused history to the front
+    size_t start = std::min(_index+1-half,_count);
+    if (start > 0) {
+        std::memmove(_inns, _inns+start*_channels, (_count-start)*_channels*sizeof(float));
+        _count -= start;
+        _index -= start;
+    }
+    return amt;
+}
+
+/**
+ * Clears the input history, resetting the stream position.
+ *
+ * The history is padded with enough silence that the first output frame
+ * is aligned with the first input frame.
+ */
+void PolyphaseFilter::clear() {
+    _inns.clear();
+    _count = _taps/2-1;
+    _index = _count;
+    _phase = 0;
+}
+
+#pragma mark SPECIALIZED FILTERS
+/**
+ * Converts single channel input data from the input history.
+ *
+ * This method uses the vectorized algorithm, if available.
+ *
+ * @param output    The array to write the sample output
+ * @param size      The output size in frames
+ */
+void PolyphaseFilter::single(float* output, size_t size) {
+    size_t back = _taps/2-1;
+#if defined (CU_MATH_VECTOR_AVX2)
+    if (VECTORIZE && DSPMath::useAVX2()) {
+        __m128 temp;
+        for(size_t ii = 0; ii < size; ii++) {
+            temp = avx2_dot4(_inns+(_index-back),coeff(),_taps);
+            output[ii] = temp[0]+temp[1]+temp[2]+temp[3];
+            step();
+        }
+    } else
+#endif
+#if defined (CU_MATH_VECTOR_SSE)
+    if (VECTORIZE) {
+        __m128 temp;
+        for(size_t ii = 0; ii < size; ii++) {
+            const float* coef = coeff();
+            const float* data = _inns+(_index-back);
+            temp = _mm_setzero_ps();
+            for(size_t jj = 0; jj < _taps; jj += 4) {
+                temp = _mm_add_ps(temp,_mm_mul_ps(_mm_loadu_ps(data+jj),_mm_load_ps(coef+jj)));
+            }
+            output[ii] = temp[0]+temp[1]+temp[2]+temp[3];
+            step();
+        }
+    } else {
+#elif defined (CU_MATH_VECTOR_NEON64)
+#if defined (__ANDROID__)
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
+#else
+    if (VECTORIZE) {
+#endif
+        float32x4_t temp;
+        for(size_t ii = 0; ii < size; ii++) {
+            const float* coef = coeff();
+            const float* data = _inns+(_index-back);
+            temp = vdupq_n_f32(0);
+            for(size_t jj = 0; jj < _taps; jj += 4) {
+                temp = vmlaq_f32(temp, vld1q_f32(data+jj), vld1q_f32(coef+jj));
+            }
+            output[ii] = vaddvq_f32(temp);
+            step();
+        }
+    } else {
+#else
+    {
+#endif
+        for(size_t ii = 0; ii < size; ii++) {
+            const float* coef = coeff();
+            const float* data = _inns+(_index-back);
+            float temp = 0;
+            for(size_t jj = 0; jj < _taps; jj++) {
+                temp += data[jj]*coef[jj];
+            }
+            output[ii] = temp;
+            step();
+        }
+    }
+}
+
+/**
+ * Converts interleaved, dual channel input data from the input history.
+ *
+ * This method uses the vectorized algorithm, if available.
+ *
+ * @param output    The array to write the sample output
+ * @param size      The output size in frames
+ */
+void PolyphaseFilter::dual(float* output, size_t size) {
+    size_t back = _taps/2-1;
+    size_t len  = 2*_taps;
+#if defined (CU_MATH_VECTOR_AVX2)
+    if (VECTORIZE && DSPMath::useAVX2()) {
+        // Lanes alternate left and right, as do the coefficients
+        __m128 temp;
+        for(size_t ii = 0; ii < size; ii++) {
+            temp = avx2_dot4(_inns+2*(_index-back),coeff(),len);
+            output[2*ii  ] = temp[0]+temp[2];
+            output[2*ii+1] = temp[1]+temp[3];
+            step();
+        }
+    } else
+#endif
+#if defined (CU_MATH_VECTOR_SSE)
+    if (VECTORIZE) {
+        // Lanes alternate left and right, as do the coefficients
+        __m128 temp;
+        for(size_t ii = 0; ii < size; ii++) {
+            const float* coef = coeff();
+            const float* data = _inns+2*(_index-back);
+            temp = _mm_setzero_ps();
+            for(size_t jj = 0; jj < len; jj += 4) {
+                temp = _mm_add_ps(temp,_mm_mul_ps(_mm_loadu_ps(data+jj),_mm_load_ps(coef+jj)));
+            }
+            output[2*ii  ] = temp[0]+temp[2];
+            output[2*ii+1] = temp[1]+temp[3];
+            step();
+        }
+    } else {
+#elif defined (CU_MATH_VECTOR_NEON64)
+#if defined (__ANDROID__)
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
+#else
+    if (VECTORIZE) {
+#endif
+        // Lanes alternate left and right, as do the coefficients
+        float32x4_t temp;
+        for(size_t ii = 0; ii < size; ii++) {
+            const float* coef = coeff();
+            const float* data = _inns+2*(_index-back);
+            temp = vdupq_n_f32(0);
+            for(size_t jj = 0; jj < len; jj += 4) {
+                temp = vmlaq_f32(temp, vld1q_f32(data+jj), vld1q_f32(coef+jj));
+            }
+            vst1_f32(output+2*ii, vadd_f32(vget_low_f32(temp),vget_high_f32(temp)));
+            step();
+        }
+    } else {
+#else
+    {
+#endif
+        for(size_t ii = 0; ii < size; ii++) {
+            const float* coef = coeff();
+            const float* data = _inns+2*(_index-back);
+            float left  = 0;
+            float right = 0;
+            for(size_t jj = 0; jj < len; jj += 2) {
+                left  += data[jj  ]*coef[jj  ];
+                right += data[jj+1]*coef[jj+1];
+            }
+            output[2*ii  ] = left;
+            output[2*ii+1] = right;
+            step();
+        }
+    }
+}
+
+/**
+ * Converts interleaved input data whose channels are a multiple of 4.
+ *
+ * This method uses the vectorized algorithm, if available.
+ *
+ * @param output    The array to write the sample output
+ * @param size      The output size in frames
+ */
+void PolyphaseFilter::quad(float* output, size_t size) {
+#if defined (CU_MATH_VECTOR_SSE)
+    if (VECTORIZE) {
+        // Each lane is a single channel in a group of four
+        size_t back = _taps/2-1;
+        size_t len  = _taps*_channels;
+        __m128 temp;
+        for(size_t ii = 0; ii < size; ii++) {
+            const float* coef = coeff();
+            const float* data = _inns+(_index-back)*_channels;
+            for(size_t kk = 0; kk < _channels; kk += 4) {
+                temp = _mm_setzero_ps();
+                for(size_t jj = kk; jj < len; jj += _channels) {
+                    temp = _mm_add_ps(temp,_mm_mul_ps(_mm_loadu_ps(data+jj),_mm_load_ps(coef+jj)));
+                }
+                _mm_storeu_ps(output+ii*_channels+kk,temp);
+            }
+            step();
+        }
+    } else {
+#elif defined (CU_MATH_VECTOR_NEON64)
+#if defined (__ANDROID__)
+    if (VECTORIZE && android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM64) {
+#else
+    if (VECTORIZE) {
+#endif
+        // Each lane is a single channel in a group of four
+        size_t back = _taps/2-1;
+        size_t len  = _taps*_channels;
+        float32x4_t temp;
+        for(size_t ii = 0; ii < size; ii++) {
+            const float* coef = coeff();
+            const float* data = _inns+(_index-back)*_channels;
+            for(size_t kk = 0; kk < _channels; kk += 4) {
+                temp = vdupq_n_f32(0);
+                for(size_t jj = kk; jj < len; jj += _channels) {
+                    temp = vmlaq_f32(temp, vld1q_f32(data+jj), vld1q_f32(coef+jj));
+                }
+                vst1q_f32(output+ii*_channels+kk,temp);
+            }
+            step();
+        }
+    } else {
+#else
+    {
+#endif
+        stride(output,size);
+    }
+}
+
+/**
+ * Converts interleaved input data with an arbitrary number of channels.
+ *
+ * This method is not vectorized.
+ *
+ * @param output    The array to write the sample output
+ * @param size      The output size in frames
+ */
+void PolyphaseFilter::stride(float* output, size_t size) {
+    size_t back = _taps/2-1;
+    size_t len  = _taps*_channels;
+    for(size_t ii = 0; ii < size; ii++) {
+        const float* coef = coeff();
+        const float* data = _inns+(_index-back)*_channels;
+        float* out = output+ii*_channels;
+        for(unsigned kk = 0; kk < _channels; kk++) {
+            float temp = 0;
+            for(size_t jj = kk; jj < len; jj += _channels) {
+                temp += data[jj]*coef[jj];
+            }
+            out[kk] = temp;
+        }
+        step();
+    }
+}
@@ -61,6 +61,22 @@ static inline __m128 _mm_skipload_ps(float* src, size_t stride) {
     return result;
 }
 
+/**
+ * Transposes four __m128 float vectors in place
+ *
+ * If the vectors are the rows of a 4x4 matrix, they are the columns of that
+ * matrix afterwards. This converts four frames of four lanes to four lanes
+ * of four frames (and back again).
+ *
+ * @param row0      The first vector
+ * @param row1      The second vector
+ * @param row2      The third vector
+ * @param row3      The fourth vector
+ */
+static inline void _mm_transpose4_ps(__m128& row0, __m128& row1, __m128& row2, __m128& row3) {
+    _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+}
+
 #elif defined (CU_MATH_VECTOR_NEON64)
 /**
  * Stores a float32x4_t vector into a strided array
@@ -114,4 +130,27 @@ static inline float32x2_t vld1_skip_f32(float* src, size_t stride) {
     return result;
 }
 
+/**
+ * Transposes four float32x4_t vectors in place
+ *
+ * If the vectors are the rows of a 4x4 matrix, they are the columns of that
+ * matrix afterwards. This converts four frames of four lanes to four lanes
+ * of four frames (and back again).
+ *
+ * @param row0      The first vector
+ * @param row1      The second vector
+ * @param row2      The third vector
+ * @param row3      The fourth vector
+ */
+static inline void vtrn4q_f32(float32x4_t& row0, float32x4_t& row1, float32x4_t& row2, float32x4_t& row3) {
+    float32x4_t tmp0 = vtrn1q_f32(row0,row1);
+    float32x4_t tmp1 = vtrn2q_f32(row0,row1);
+    float32x4_t tmp2 = vtrn1q_f32(row2,row3);
+    float32x4_t tmp3 = vtrn2q_f32(row2,row3);
+    row0 = vreinterpretq_f32_f64(vtrn1q_f64(vreinterpretq_f64_f32(tmp0),vreinterpretq_f64_f32(tmp2)));
+    row1 = vreinterpretq_f32_f64(vtrn1q_f64(vreinterpretq_f64_f32(tmp1),vreinterpretq_f64_f32(tmp3)));
+    row2 = vreinterpretq_f32_f64(vtrn2q_f64(vreinterpretq_f64_f32(tmp0),vreinterpretq_f64_f32(tmp2)));
+    row3 = vreinterpretq_f32_f64(vtrn2q_f64(vreinterpretq_f64_f32(tmp1),vreinterpretq_f64_f32(tmp3)));
+}
+
 #endif
@@ -0,0 +1,265 @@
+//
+//  cuDSP256.inl
+//  Cornell University Game Library (CUGL)
+//
+//  This include file provides 256-bit (AVX2) kernels for the DSP algorithms.
+//  Unlike SSE, AVX2 cannot be assumed on desktop hosts, and so these kernels
+//  are compiled for AVX2 individually and selected at runtime. Each kernel
+//  is only called when DSPMath::useAVX2() is true (which requires both AVX2
+//  and FMA), and so it is safe to build the rest of the library for SSE alone.
+//  GCC and Clang enable the instructions with a target attribute on each
+//  kernel. MSVC accepts AVX2 intrinsics in any function, so no attribute
+//  (or /arch:AVX2) is needed there.
+//
+//  These kernels are only defined for SSE builds. Neon 64 continues to use
+//  the 128-bit kernels, as that is the full width of the architecture.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Walker White
+//  Version: 5/12/21
+//
+#include <cugl/math/dsp/CUDSPMath.h>
+
+#if defined (CU_MATH_VECTOR_SSE)
+    #define CU_MATH_VECTOR_AVX2
+    #if defined (__GNUC__) || defined (__clang__)
+        #define CU_AVX2_TARGET __attribute__((target("avx2,fma")))
+    #else
+        #define CU_AVX2_TARGET
+    #endif
+#endif
+
+#if defined (CU_MATH_VECTOR_AVX2)
+#include <algorithm>
+
+#pragma mark Arithmetic Kernels
+/**
+ * Adds two input signals together, storing the result in output
+ *
+ * @param input1    The first input buffer
+ * @param input2    The second input buffer
+ * @param output    The output buffer
+ * @param size      The number of elements to add
+ */
+static inline CU_AVX2_TARGET void avx2_add(float* input1, float* input2, float* output, size_t size) {
+    size_t ii = 0;
+    for(; ii+8 <= size; ii += 8) {
+        _mm256_storeu_ps(output+ii, _mm256_add_ps(_mm256_loadu_ps(input1+ii),_mm256_loadu_ps(input2+ii)));
+    }
+    for(; ii < size; ii++) {
+        output[ii] = input1[ii]+input2[ii];
+    }
+}
+
+/**
+ * Multiplies two input signals together, storing the result in output
+ *
+ * @param input1    The first input buffer
+ * @param input2    The second input buffer
+ * @param output    The output buffer
+ * @param size      The number of elements to multiply
+ */
+static inline CU_AVX2_TARGET void avx2_multiply(float* input1, float* input2, float* output, size_t size) {
+    size_t ii = 0;
+    for(; ii+8 <= size; ii += 8) {
+        _mm256_storeu_ps(output+ii, _mm256_mul_ps(_mm256_loadu_ps(input1+ii),_mm256_loadu_ps(input2+ii)));
+    }
+    for(; ii < size; ii++) {
+        output[ii] = input1[ii]*input2[ii];
+    }
+}
+
+/**
+ * Scales an input signal, storing the result in output
+ *
+ * @param input     The input buffer
+ * @param scalar    The scalar to multiply by
+ * @param output    The output buffer
+ * @param size      The number of elements to multiply
+ */
+static inline CU_AVX2_TARGET void avx2_scale(float* input, float scalar, float* output, size_t size) {
+    const __m256 gain = _mm256_set1_ps(scalar);
+    size_t ii = 0;
+    for(; ii+8 <= size; ii += 8) {
+        _mm256_storeu_ps(output+ii, _mm256_mul_ps(_mm256_loadu_ps(input+ii),gain));
+    }
+    for(; ii < size; ii++) {
+        output[ii] = input[ii]*scalar;
+    }
+}
+
+/**
+ * Scales an input signal and adds it to another, storing the result in output
+ *
+ * @param input1    The input buffer to scale
+ * @param input2    The input buffer to add
+ * @param scalar    The scalar to multiply by
+ * @param output    The output buffer
+ * @param size      The number of elements to multiply
+ */
+static inline CU_AVX2_TARGET void avx2_scale_add(float* input1, float* input2, float scalar,
+                                                 float* output, size_t size) {
+    const __m256 gain = _mm256_set1_ps(scalar);
+    size_t ii = 0;
+    for(; ii+8 <= size; ii += 8) {
+        _mm256_storeu_ps(output+ii, _mm256_fmadd_ps(_mm256_loadu_ps(input1+ii),gain,
+                                                    _mm256_loadu_ps(input2+ii)));
+    }
+    for(; ii < size; ii++) {
+        output[ii] = input1[ii]*scalar+input2[ii];
+    }
+}
+
+/**
+ * Clamps the data stream to the range [min,max]
+ *
+ * @param data      The stream buffer
+ * @param min       The minimum allowed value
+ * @param max       The maximum allowed value
+ * @param size      The number of elements to clamp
+ */
+static inline CU_AVX2_TARGET void avx2_clamp(float* data, float min, float max, size_t size) {
+    const __m256 vmin = _mm256_set1_ps(min);
+    const __m256 vmax = _mm256_set1_ps(max);
+    size_t ii = 0;
+    for(; ii+8 <= size; ii += 8) {
+        _mm256_storeu_ps(data+ii, _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(data+ii),vmin),vmax));
+    }
+    for(; ii < size; ii++) {
+        data[ii] = std::min(std::max(data[ii],min),max);
+    }
+}
+
+/**
+ * Soft clamps the data stream to the range [-bound,bound]
+ *
+ * @param data      The stream buffer
+ * @param bound     The asymptotic bound
+ * @param knee      The soft knee bound
+ * @param size      The number of elements to clamp
+ */
+static inline CU_AVX2_TARGET void avx2_ease(float* data, float bound, float knee, size_t size) {
+    float factor = bound*knee-knee*knee;
+    const __m256 gain = _mm256_set1_ps(bound);
+    const __m256 uppr = _mm256_set1_ps(knee);
+    const __m256 lowr = _mm256_set1_ps(-knee);
+    const __m256 fact = _mm256_set1_ps(factor);
+    __m256 value, temp1, temp2, temp3, left, rght;
+    size_t ii = 0;
+    for(; ii+8 <= size; ii += 8) {
+        value = _mm256_loadu_ps(data+ii);
+        temp1 = _mm256_cmp_ps(value,uppr,_CMP_GT_OQ);
+        temp2 = _mm256_cmp_ps(value,lowr,_CMP_LT_OQ);
+        temp3 = _mm256_or_ps(temp1,temp2);
+        if (!_mm256_testz_ps(temp3,temp3)) {
+            rght  = _mm256_div_ps(fact,value);
+            left  = _mm256_and_ps(temp1,_mm256_sub_ps(gain,rght));
+            rght  = _mm256_and_ps(temp2,_mm256_add_ps(gain,rght));
+            _mm256_storeu_ps(data+ii,_mm256_or_ps(_mm256_andnot_ps(temp3,value),
+                                                  _mm256_or_ps(left,rght)));
+        }
+    }
+    for(; ii < size; ii++) {
+        float tmp = data[ii];
+        if (tmp > knee) {
+            data[ii] = (bound*tmp-factor)/tmp;
+        } else if (tmp < - knee) {
+            data[ii] = (bound*tmp+factor)/tmp;
+        }
+    }
+}
+
+#pragma mark Filter Kernels
+/**
+ * Returns the dot product of two arrays, folded into four lanes
+ *
+ * The arrays are multiplied pointwise, and the products are summed by lane
+ * modulo four. Hence lane k of the result is the sum of all products whose
+ * index is k modulo four. The length must be a multiple of 4.
+ *
+ * @param data      The first array
+ * @param coef      The second array
+ * @param len       The array length
+ *
+ * @return the dot product of two arrays, folded into four lanes
+ */
+static inline CU_AVX2_TARGET __m128 avx2_dot4(const float* data, const float* coef, size_t len) {
+    __m256 wide = _mm256_setzero_ps();
+    size_t jj = 0;
+    for(; jj+8 <= len; jj += 8) {
+        wide = _mm256_fmadd_ps(_mm256_loadu_ps(data+jj),_mm256_loadu_ps(coef+jj),wide);
+    }
+    __m128 temp = _mm_add_ps(_mm256_castps256_ps128(wide),_mm256_extractf128_ps(wide,1));
+    if (jj < len) {
+        temp = _mm_add_ps(temp,_mm_mul_ps(_mm_loadu_ps(data+jj),_mm_loadu_ps(coef+jj)));
+    }
+    return temp;
+}
+
+/**
+ * Performs a biquad filter of interleaved lane data, eight lanes at a time
+ *
+ * The lanes are processed in groups of eight, using the transposed direct
+ * form II. This function returns the first lane not processed, which is
+ * the number of lanes rounded down to a multiple of eight.
+ *
+ * @param gain      The input gain factor
+ * @param input     The array of input samples
+ * @param output    The array to write the sample output
+ * @param size      The input size in frames
+ * @param lanes     The number of (interleaved) lanes
+ * @param coeff     The coefficient arrays b0, b1, b2, a1, a2
+ * @param z1        The first delay state of each lane
+ * @param z2        The second delay state of each lane
+ *
+ * @return the first lane not processed
+ */
+static inline CU_AVX2_TARGET unsigned avx2_biquad(float gain, const float* input, float* output,
+                                                  size_t size, unsigned lanes, const float* const* coeff,
+                                                  float* z1, float* z2) {
+    const __m256 factor = _mm256_set1_ps(gain);
+    unsigned start = 0;
+    for(; start+8 <= lanes; start += 8) {
+        __m256 b0 = _mm256_loadu_ps(coeff[0]+start);
+        __m256 b1 = _mm256_loadu_ps(coeff[1]+start);
+        __m256 b2 = _mm256_loadu_ps(coeff[2]+start);
+        __m256 a1 = _mm256_loadu_ps(coeff[3]+start);
+        __m256 a2 = _mm256_loadu_ps(coeff[4]+start);
+        __m256 s1 = _mm256_loadu_ps(z1+start);
+        __m256 s2 = _mm256_loadu_ps(z2+start);
+        const float* src = input+start;
+        float* dst = output+start;
+        for(size_t ii = 0; ii < size; ii++) {
+            __m256 x = _mm256_mul_ps(factor,_mm256_loadu_ps(src));
+            __m256 y = _mm256_fmadd_ps(b0,x,s1);
+            s1 = _mm256_fnmadd_ps(a1,y,_mm256_fmadd_ps(b1,x,s2));
+            s2 = _mm256_fnmadd_ps(a2,y,_mm256_mul_ps(b2,x));
+            _mm256_storeu_ps(dst,y);
+            src += lanes;
+            dst += lanes;
+        }
+        _mm256_storeu_ps(z1+start,s1);
+        _mm256_storeu_ps(z2+start,s2);
+    }
+    return start;
+}
+
+#endif
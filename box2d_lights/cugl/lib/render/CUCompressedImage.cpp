@@ -0,0 +1,821 @@
+//
+//  CUCompressedImage.cpp
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides support for GPU compressed images stored in KTX
+//  (version 1 or 2) containers.  These images are uploaded directly to the
+//  GPU with their mipmaps, using a fraction of the memory of an RGBA texture.
+//  This class only stores the image data; it is the Texture class that
+//  uploads it.  Hence it is safe to load these images outside the main thread.
+//
+//  We support the ETC2/EAC formats (which are mandatory in OpenGLES 3) and
+//  the LDR ASTC formats. As not every desktop driver supports ETC2, the ETC2
+//  formats (and ETC1) can be decompressed to RGBA in software as a fallback.
+//  There is no such fallback for ASTC.
+//
+//  This class uses our standard shared-pointer architecture.
+//
+//  1. The constructor does not perform any initialization; it just sets all
+//     attributes to their defaults.
+//
+//  2. All initialization takes place via init methods, which can fail if an
+//     object is initialized more than once.
+//
+//  3. All allocation takes place via static constructors which return a shared
+//     pointer.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Walker White
+//  Version: 5/12/21
+#include <SDL/SDL.h>
+#include <cstring>
+#include <algorithm>
+#include <cugl/util/CUDebug.h>
+#include <cugl/util/CUFiletools.h>
+#include <cugl/render/CUCompressedImage.h>
+#include <cugl/render/CURenderThread.h>
+
+using namespace cugl;
+
+/** The compressed formats supported by the OpenGL driver */
+std::vector<GLenum> CompressedImage::_supported;
+/** Whether the supported formats have been queried */
+bool CompressedImage::_queried = false;
+
+#pragma mark Internal Helpers
+/** The file identifier for KTX 1 */
+static const Uint8 KTX1_IDENTIFIER[12] = {
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+};
+
+/** The file identifier for KTX 2 */
+static const Uint8 KTX2_IDENTIFIER[12] = {
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+};
+
+/** The size of the KTX 1 header (including the identifier) */
+#define KTX1_HEADER_SIZE    64
+/** The size of the KTX 2 header and index (including the identifier) */
+#define KTX2_HEADER_SIZE    80
+/** The size of a KTX 2 level index entry */
+#define KTX2_LEVEL_SIZE     24
+
+/** The Vulkan format for the first ETC2 format */
+#define VK_FORMAT_ETC2_FIRST    147
+/** The Vulkan format for the last ETC2 format */
+#define VK_FORMAT_ETC2_LAST     152
+/** The Vulkan format for the first ASTC format */
+#define VK_FORMAT_ASTC_FIRST    157
+/** The Vulkan format for the last ASTC format */
+#define VK_FORMAT_ASTC_LAST     184
+
+/** The block dimensions of the ASTC formats (in GL enum order) */
+static const int ASTC_BLOCKS[14][2] = {
+    {4,4}, {5,4}, {5,5}, {6,5}, {6,6}, {8,5}, {8,6},
+    {8,8}, {10,5}, {10,6}, {10,8}, {10,10}, {12,10}, {12,12}
+};
+
+/** The ETC1 intensity modifier tables */
+static const int ETC_MODIFIERS[8][4] = {
+    {  2,   8,  -2,   -8 },
+    {  5,  17,  -5,  -17 },
+    {  9,  29,  -9,  -29 },
+    { 13,  42, -13,  -42 },
+    { 18,  60, -18,  -60 },
+    { 24,  80, -24,  -80 },
+    { 33, 106, -33, -106 },
+    { 47, 183, -47, -183 }
+};
+
+/** The ETC2 distance table for the T and H modes */
+static const int ETC_DISTANCES[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
+
+/** The EAC alpha modifier tables */
+static const int EAC_MODIFIERS[16][8] = {
+    { -3, -6,  -9, -15, 2, 5, 8, 14 },
+    { -3, -7, -10, -13, 2, 6, 9, 12 },
+    { -2, -5,  -8, -13, 1, 4, 7, 12 },
+    { -2, -4,  -6, -13, 1, 3, 5, 12 },
+    { -3, -6,  -8, -12, 2, 5, 7, 11 },
+    { -3, -7,  -9, -11, 2, 6, 8, 10 },
+    { -4, -7,  -8, -11, 3, 6, 7, 10 },
+    { -3, -5,  -8, -11, 2, 4, 7, 10 },
+    { -2, -6,  -8, -10, 1, 5, 7,  9 },
+    { -2, -5,  -8, -10, 1, 4, 7,  9 },
+    { -2, -4,  -8, -10, 1, 3, 7,  9 },
+    { -2, -5,  -7, -10, 1, 4, 6,  9 },
+    { -3, -4,  -7, -10, 2, 3, 6,  9 },
+    { -1, -2,  -3, -10, 0, 1, 2,  9 },
+    { -4, -6,  -8,  -9, 3, 5, 7,  8 },
+    { -3, -5,  -7,  -9, 2, 4, 6,  8 }
+};
+
+/**
+ * Returns the 32 bit little-endian value at the given position
+ *
+ * @param data  The data buffer
+ *
+ * @return the 32 bit little-endian value at the given position
+ */
+static Uint32 read_le32(const Uint8* data) {
+    return (Uint32)data[0] | ((Uint32)data[1] << 8) | ((Uint32)data[2] << 16) | ((Uint32)data[3] << 24);
+}
+
+/**
+ * Returns the 64 bit little-endian value at the given position
+ *
+ * @param data  The data buffer
+ *
+ * @return the 64 bit little-endian value at the given position
+ */
+static Uint64 read_le64(const Uint8* data) {
+    return (Uint64)read_le32(data) | ((Uint64)read_le32(data+4) << 32);
+}
+
+/**
+ * Returns the 64 bit big-endian value at the given position
+ *
+ * ETC blocks are stored in big-endian order.
+ *
+ * @param data  The data buffer
+ *
+ * @return the 64 bit big-endian value at the given position
+ */
+static Uint64 read_be64(const Uint8* data) {
+    Uint64 result = 0;
+    for(int ii = 0; ii < 8; ii++) {
+        result = (result << 8) | data[ii];
+    }
+    return result;
+}
+
+/**
+ * Returns the bits of value from position high down to high-count+1
+ *
+ * @param value The value to extract the bits
+ * @param high  The highest bit position
+ * @param count The number of bits
+ *
+ * @return the bits of value from position high down to high-count+1
+ */
+static inline int get_bits(Uint64 value, int high, int count) {
+    return (int)((value >> (high-count+1)) & ((1u << count)-1));
+}
+
+/** Returns the value clamped to the range 0..255 */
+static inline Uint8 clamp_byte(int value) {
+    return (Uint8)(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+/** Returns the 4 bit value extended to 8 bits */
+static inline int extend4(int value) { return (value << 4) | value; }
+/** Returns the 5 bit value extended to 8 bits */
+static inline int extend5(int value) { return (value << 3) | (value >> 2); }
+/** Returns the 6 bit value extended to 8 bits */
+static inline int extend6(int value) { return (value << 2) | (value >> 4); }
+/** Returns the 7 bit value extended to 8 bits */
+static inline int extend7(int value) { return (value << 1) | (value >> 6); }
+
+/**
+ * Returns the block dimensions and size for the given compressed format
+ *
+ * @param format    The OpenGL internal format
+ * @param width     Reference to store the block width
+ * @param height    Reference to store the block height
+ * @param bytes     Reference to store the block size in bytes
+ *
+ * @return true if the format is recognized
+ */
+static bool block_info(GLenum format, int& width, int& height, int& bytes) {
+    switch (format) {
+        case GL_ETC1_RGB8_OES:
+        case GL_COMPRESSED_RGB8_ETC2:
+        case GL_COMPRESSED_SRGB8_ETC2:
+        case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+        case GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+            width = height = 4;
+            bytes = 8;
+            return true;
+        case GL_COMPRESSED_RGBA8_ETC2_EAC:
+        case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+            width = height = 4;
+            bytes = 16;
+            return true;
+    }
+    if (format >= GL_COMPRESSED_RGBA_ASTC_4x4_KHR && format <= GL_COMPRESSED_RGBA_ASTC_12x12_KHR) {
+        width  = ASTC_BLOCKS[format-GL_COMPRESSED_RGBA_ASTC_4x4_KHR][0];
+        height = ASTC_BLOCKS[format-GL_COMPRESSED_RGBA_ASTC_4x4_KHR][1];
+        bytes  = 16;
+        return true;
+    }
+    if (format >= GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR && format <= GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x12_KHR) {
+        width  = ASTC_BLOCKS[format-GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR][0];
+        height = ASTC_BLOCKS[format-GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR][1];
+        bytes  = 16;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Returns the expected size of a compressed level in bytes
+ *
+ * @param format    The OpenGL internal format
+ * @param width     The level width
+ * @param height    The level height
+ *
+ * @return the expected size of a compressed level in bytes
+ */
+static size_t level_size(GLenum format, int width, int height) {
+    int bw, bh, bytes;
+    if (!block_info(format, bw, bh, bytes)) {
+        return 0;
+    }
+    return (size_t)((width+bw-1)/bw)*(size_t)((height+bh-1)/bh)*bytes;
+}
+
+/**
+ * Returns the number of levels in a full mipmap chain for the given size
+ *
+ * This is floor(log2(max(width,height)))+1. No file may have more levels
+ * than this, as the shifted dimensions would be meaningless.
+ *
+ * @param width     The base level width
+ * @param height    The base level height
+ *
+ * @return the number of levels in a full mipmap chain for the given size
+ */
+static Uint32 max_levels(int width, int height) {
+    Uint32 side = (Uint32)std::max(width,height);
+    Uint32 result = 1;
+    while (side > 1) {
+        side >>= 1;
+        result++;
+    }
+    return result;
+}
+
+/**
+ * Decodes an ETC1/ETC2 color block into 16 RGBA pixels
+ *
+ * The pixels are stored in row-major order.  If punchthrough is true, the
+ * block is decoded as ETC2 RGB8A1, where bit 33 is the opaque flag.  The
+ * alpha values of the pixels are only written for punchthrough blocks.
+ *
+ * @param block         The 8 byte block
+ * @param pixels        The 64 byte pixel buffer
+ * @param punchthrough  Whether to decode as RGB8A1
+ */
+static void decode_etc_color(const Uint8* block, Uint8* pixels, bool punchthrough) {
+    Uint64 bits = read_be64(block);
+    bool diff = get_bits(bits,33,1) != 0;
+    bool flip = get_bits(bits,32,1) != 0;
+    bool opaque = true;
+    if (punchthrough) {
+        opaque = diff;
+        diff = true;
+    }
+
+    int paint[4][3];
+    bool paintmode = false;
+    int base[2][3];
+    if (!diff) {
+        base[0][0] = extend4(get_bits(bits,63,4));
+        base[1][0] = extend4(get_bits(bits,59,4));
+        base[0][1] = extend4(get_bits(bits,55,4));
+        base[1][1] = extend4(get_bits(bits,51,4));
+        base[0][2] = extend4(get_bits(bits,47,4));
+        base[1][2] = extend4(get_bits(bits,43,4));
+    } else {
+        int r = get_bits(bits,63,5);
+        int g = get_bits(bits,55,5);
+        int b = get_bits(bits,47,5);
+        int dr = get_bits(bits,58,3);
+        int dg = get_bits(bits,50,3);
+        int db = get_bits(bits,42,3);
+        int r2 = r+(dr >= 4 ? dr-8 : dr);
+        int g2 = g+(dg >= 4 ? dg-8 : dg);
+        int b2 = b+(db >= 4 ? db-8 : db);
+        if (r2 < 0 || r2 > 31) {
+            // T mode
+            int c1[3], c2[3];
+            c1[0] = extend4((get_bits(bits,60,2) << 2) | get_bits(bits,57,2));
+            c1[1] = extend4(get_bits(bits,55,4));
+            c1[2] = extend4(get_bits(bits,51,4));
+            c2[0] = extend4(get_bits(bits,47,4));
+            c2[1] = extend4(get_bits(bits,43,4));
+            c2[2] = extend4(get_bits(bits,39,4));
+            int dist = ETC_DISTANCES[(get_bits(bits,35,2) << 1) | get_bits(bits,32,1)];
+            for(int ii = 0; ii < 3; ii++) {
+                paint[0][ii] = c1[ii];
+                paint[1][ii] = c2[ii]+dist;
+                paint[2][ii] = c2[ii];
+                paint[3][ii] = c2[ii]-dist;
+            }
+            paintmode = true;
+        } else if (g2 < 0 || g2 > 31) {
+            // H mode
+            int c1[3], c2[3];
+            c1[0] = extend4(get_bits(bits,62,4));
+            c1[1] = extend4((get_bits(bits,58,3) << 1) | get_bits(bits,52,1));
+            c1[2] = extend4((get_bits(bits,51,1) << 3) | get_bits(bits,49,3));
+            c2[0] = extend4(get_bits(bits,46,4));
+            c2[1] = extend4(get_bits(bits,42,4));
+            c2[2] = extend4(get_bits(bits,38,4));
+            int v1 = (c1[0] << 16) | (c1[1] << 8) | c1[2];
+            int v2 = (c2[0] << 16) | (c2[1] << 8) | c2[2];
+            int index = (get_bits(bits,34,1) << 2) | (get_bits(bits,32,1) << 1) | (v1 >= v2 ? 1 : 0);
+            int dist = ETC_DISTANCES[index];
+            for(int ii = 0; ii < 3; ii++) {
+                paint[0][ii] = c1[ii]+dist;
+                paint[1][ii] = c1[ii]-dist;
+                paint[2][ii] = c2[ii]+dist;
+                paint[3][ii] = c2[ii]-dist;
+            }
+            paintmode = true;
+        } else if (b2 < 0 || b2 > 31) {
+            // Planar mode (always opaque)
+            int o[3], h[3], v[3];
+            o[0] = extend6(get_bits(bits,62,6));
+            o[1] = extend7((get_bits(bits,56,1) << 6) | get_bits(bits,54,6));
+            o[2] = extend6((get_bits(bits,48,1) << 5) | (get_bits(bits,44,2) << 3) | get_bits(bits,41,3));
+            h[0] = extend6((get_bits(bits,38,5) << 1) | get_bits(bits,32,1));
+            h[1] = extend7(get_bits(bits,31,7));
+            h[2] = extend6(get_bits(bits,24,6));
+            v[0] = extend6(get_bits(bits,18,6));
+            v[1] = extend7(get_bits(bits,12,7));
+            v[2] = extend6(get_bits(bits,5,6));
+            for(int y = 0; y < 4; y++) {
+                for(int x = 0; x < 4; x++) {
+                    Uint8* pixel = pixels+(y*4+x)*4;
+                    for(int ii = 0; ii < 3; ii++) {
+                        pixel[ii] = clamp_byte((x*(h[ii]-o[ii])+y*(v[ii]-o[ii])+4*o[ii]+2) >> 2);
+                    }
+                    if (punchthrough) {
+                        pixel[3] = 255;
+                    }
+                }
+            }
+            return;
+        } else {
+            base[0][0] = extend5(r);
+            base[1][0] = extend5(r2);
+            base[0][1] = extend5(g);
+            base[1][1] = extend5(g2);
+            base[0][2] = extend5(b);
+            base[1][2] = extend5(b2);
+        }
+    }
+
+    int table[2] = { get_bits(bits,39,3), get_bits(bits,36,3) };
+    for(int x = 0; x < 4; x++) {
+        for(int y = 0; y < 4; y++) {
+            int pos = x*4+y;
+            int index = (int)(((bits >> (pos+16)) & 1) << 1 | ((bits >> pos) & 1));
+            Uint8* pixel = pixels+(y*4+x)*4;
+            if (!opaque && index == 2) {
+                pixel[0] = pixel[1] = pixel[2] = pixel[3] = 0;
+                continue;
+            }
+            if (paintmode) {
+                for(int ii = 0; ii < 3; ii++) {
+                    pixel[ii] = clamp_byte(paint[index][ii]);
+                }
+            } else {
+                int sub = (flip ? (y >= 2) : (x >= 2));
+                int mod = (!opaque && index == 0) ? 0 : ETC_MODIFIERS[table[sub]][index];
+                for(int ii = 0; ii < 3; ii++) {
+                    pixel[ii] = clamp_byte(base[sub][ii]+mod);
+                }
+            }
+            if (punchthrough) {
+                pixel[3] = 255;
+            }
+        }
+    }
+}
+
+/**
+ * Decodes an EAC alpha block into the alpha values of 16 RGBA pixels
+ *
+ * The pixels are stored in row-major order.
+ *
+ * @param block     The 8 byte block
+ * @param pixels    The 64 byte pixel buffer
+ */
+static void decode_eac_alpha(const Uint8* block, Uint8* pixels) {
+    Uint64 bits = read_be64(block);
+    int base  = get_bits(bits,63,8);
+    int mult  = get_bits(bits,55,4);
+    int table = get_bits(bits,51,4);
+    for(int pos = 0; pos < 16; pos++) {
+        int index = (int)((bits >> (45-3*pos)) & 7);
+        int x = pos/4;
+        int y = pos%4;
+        pixels[(y*4+x)*4+3] = clamp_byte(base+EAC_MODIFIERS[table][index]*mult);
+    }
+}
+
+#pragma mark -
+#pragma mark Constructors
+/**
+ * Deletes the image data, freeing all resources.
+ *
+ * You must reinitialize the image to use it.
+ */
+void CompressedImage::dispose() {
+    _levels.clear();
+    _format = 0;
+}
+
+/**
+ * Initializes a compressed image with the contents of a KTX file.
+ *
+ * Both KTX 1 and KTX 2 files are supported. The file must store a 2D
+ * image with a supported compression format (see {@link isCompressed}).
+ *
+ * IMPORTANT: In CUGL, relative path names always refer to the asset
+ * directory. If you wish to load an image from somewhere else, you must
+ * use an absolute pathname.
+ *
+ * @param filename  The KTX file
+ *
+ * @return true if initialization was successful.
+ */
+bool CompressedImage::initWithFile(const std::string& filename) {
+    std::string fullpath = filetool::normalize_path(filename);
+    SDL_RWops* stream = SDL_RWFromFile(fullpath.c_str(), "rb");
+    if (stream == nullptr) {
+        CULogError("Could not load file %s. %s", filename.c_str(), SDL_GetError());
+        return false;
+    }
+
+    Sint64 size = SDL_RWsize(stream);
+    std::vector<Uint8> contents(size > 0 ? (size_t)size : 0);
+    bool success = (size > 0 && SDL_RWread(stream, contents.data(), 1, (size_t)size) == (size_t)size);
+    SDL_RWclose(stream);
+    if (!success) {
+        CULogError("Could not read file %s.", filename.c_str());
+        return false;
+    }
+
+    success = initWithData(contents.data(), contents.size());
+    if (!success) {
+        CULogError("File %s is not a supported KTX image.", filename.c_str());
+    }
+    return success;
+}
+
+/**
+ * Initializes a compressed image with the contents of a KTX file in memory.
+ *
+ * Both KTX 1 and KTX 2 files are supported. The file must store a 2D
+ * image with a supported compression format (see {@link isCompressed}).
+ *
+ * @param data  The file contents
+ * @param size  The file size in bytes
+ *
+ * @return true if initialization was successful.
+ */
+bool CompressedImage::initWithData(const Uint8* data, size_t size) {
+    if (!_levels.empty()) {
+        CUAssertLog(false, "Image is already initialized");
+        return false; // In case asserts are off.
+    }
+
+    bool success = false;
+    if (size >= KTX1_HEADER_SIZE && memcmp(data, KTX1_IDENTIFIER, 12) == 0) {
+        success = parseKTX1(data, size);
+    } else if (size >= KTX2_HEADER_SIZE && memcmp(data, KTX2_IDENTIFIER, 12) == 0) {
+        success = parseKTX2(data, size);
+    }
+    if (!success) {
+        dispose();
+    }
+    return success;
+}
+
+#pragma mark -
+#pragma mark File Parsing
+/**
+ * Returns true if the data is successfully parsed as a KTX 1 file.
+ *
+ * @param data  The file contents
+ * @param size  The file size in bytes
+ *
+ * @return true if the data is successfully parsed as a KTX 1 file.
+ */
+bool CompressedImage::parseKTX1(const Uint8* data, size_t size) {
+    Uint32 header[13];
+    for(int ii = 0; ii < 13; ii++) {
+        header[ii] = read_le32(data+12+4*ii);
+    }
+
+    // The file may be written in the other byte order
+    bool swap = (header[0] == 0x01020304);
+    if (swap) {
+        for(int ii = 0; ii < 13; ii++) {
+            header[ii] = SDL_Swap32(header[ii]);
+        }
+    } else if (header[0] != 0x04030201) {
+        return false;
+    }
+
+    // glType and glFormat are 0 for compressed data
+    GLenum format = (GLenum)header[4];
+    int width  = (int)header[6];
+    int height = (int)header[7];
+    if (header[1] != 0 || header[3] != 0 || !isCompressed(format) || width <= 0 || height <= 0 ||
+        header[8] > 1 || header[9] > 0 || header[10] != 1) {
+        return false;
+    }
+
+    Uint32 levels = std::max(header[11],(Uint32)1);
+    if (levels > max_levels(width,height)) {
+        return false;
+    }
+
+    _format = format;
+    size_t offset = KTX1_HEADER_SIZE+(size_t)header[12];
+    for(Uint32 ii = 0; ii < levels; ii++) {
+        if (offset > size || 4 > size-offset) {
+            return false;
+        }
+        Uint32 bytes = read_le32(data+offset);
+        if (swap) {
+            bytes = SDL_Swap32(bytes);
+        }
+        offset += 4;
+
+        Level level;
+        level.width  = std::max(1,width >> ii);
+        level.height = std::max(1,height >> ii);
+        if (bytes != level_size(format,level.width,level.height) || bytes > size-offset) {
+            return false;
+        }
+        level.data.assign(data+offset,data+offset+bytes);
+        _levels.push_back(std::move(level));
+        offset = (offset+bytes+3) & ~((size_t)3);
+    }
+    return true;
+}
+
+/**
+ * Returns true if the data is successfully parsed as a KTX 2 file.
+ *
+ * @param data  The file contents
+ * @param size  The file size in bytes
+ *
+ * @return true if the data is successfully parsed as a KTX 2 file.
+ */
+bool CompressedImage::parseKTX2(const Uint8* data, size_t size) {
+    Uint32 vkformat = read_le32(data+12);
+    int width  = (int)read_le32(data+20);
+    int height = (int)read_le32(data+24);
+    Uint32 depth  = read_le32(data+28);
+    Uint32 layers = read_le32(data+32);
+    Uint32 faces  = read_le32(data+36);
+    Uint32 levels = std::max(read_le32(data+40),(Uint32)1);
+    Uint32 scheme = read_le32(data+44);
+    if (width <= 0 || height <= 0 || depth > 0 || layers > 0 || faces != 1 || scheme != 0) {
+        return false;
+    }
+
+    // Convert the Vulkan format to OpenGL
+    GLenum format = 0;
+    if (vkformat >= VK_FORMAT_ETC2_FIRST && vkformat <= VK_FORMAT_ETC2_LAST) {
+        format = GL_COMPRESSED_RGB8_ETC2+(vkformat-VK_FORMAT_ETC2_FIRST);
+    } else if (vkformat >= VK_FORMAT_ASTC_FIRST && vkformat <= VK_FORMAT_ASTC_LAST) {
+        Uint32 index = (vkformat-VK_FORMAT_ASTC_FIRST)/2;
+        bool srgb = ((vkformat-VK_FORMAT_ASTC_FIRST) % 2) == 1;
+        format = (srgb ? GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR : GL_COMPRESSED_RGBA_ASTC_4x4_KHR)+index;
+    } else {
+        return false;
+    }
+
+    if (levels > max_levels(width,height) || KTX2_HEADER_SIZE+(size_t)levels*KTX2_LEVEL_SIZE > size) {
+        return false;
+    }
+
+    _format = format;
+    for(Uint32 ii = 0; ii < levels; ii++) {
+        const Uint8* entry = data+KTX2_HEADER_SIZE+ii*KTX2_LEVEL_SIZE;
+        Uint64 offset = read_le64(entry);
+        Uint64 bytes  = read_le64(entry+8);
+
+        Level level;
+        level.width  = std::max(1,width >> ii);
+        level.height = std::max(1,height >> ii);
+        // Written to avoid overflow on hostile offsets
+        if (bytes != level_size(format,level.width,level.height) || offset > size || bytes > size-offset) {
+            return false;
+        }
+        level.data.assign(data+offset,data+offset+bytes);
+        _levels.push_back(std::move(level));
+    }
+    return true;
+}
+
+#pragma mark -
+#pragma mark Attributes
+/**
+ * Returns true if this image has the full chain of mipmaps.
+ *
+ * Mipmap filtering is only valid if the chain reaches a 1x1 image.
+ *
+ * @return true if this image has the full chain of mipmaps.
+ */
+bool CompressedImage::hasMipMaps() const {
+    if (_levels.size() <= 1) {
+        return false;
+    }
+    const Level& last = _levels.back();
+    return last.width == 1 && last.height == 1;
+}
+
+/**
+ * Returns the total size of the compressed data in bytes
+ *
+ * @return the total size of the compressed data in bytes
+ */
+size_t CompressedImage::getByteSize() const {
+    size_t result = 0;
+    for(auto it = _levels.begin(); it != _levels.end(); ++it) {
+        result += it->data.size();
+    }
+    return result;
+}
+
+#pragma mark -
+#pragma mark Format Support
+/**
+ * Queries the compressed formats supported by the OpenGL driver.
+ *
+ * This method must be called in the main thread (with an active OpenGL
+ * context) before {@link isSupported} is used in any other thread. It
+ * is safe to call this method more than once.
+ */
+void CompressedImage::queryFormats() {
+    if (_queried) {
+        return;
+    }
+
+    // These are queries, so they cannot be deferred
+    RenderThread::call([&] {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+        if (count > 0) {
+            std::vector<GLint> formats(count);
+            glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.data());
+            for(auto it = formats.begin(); it != formats.end(); ++it) {
+                _supported.push_back((GLenum)*it);
+            }
+        }
+
+        // Drivers are not required to list every format they support
+        bool etc2 = false;
+        bool astc = false;
+#if CU_GL_PLATFORM == CU_GL_OPENGLES
+        etc2 = true;
+#endif
+        GLint extensions = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+        for(GLint ii = 0; ii < extensions; ii++) {
+            const char* name = (const char*)glGetStringi(GL_EXTENSIONS, ii);
+            if (name == nullptr) {
+                continue;
+            } else if (strcmp(name, "GL_ARB_ES3_compatibility") == 0) {
+                etc2 = true;
+            } else if (strcmp(name, "GL_KHR_texture_compression_astc_ldr") == 0) {
+                astc = true;
+            }
+        }
+
+        if (etc2) {
+            for(GLenum format = GL_COMPRESSED_RGB8_ETC2; format <= GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC; format++) {
+                _supported.push_back(format);
+            }
+        }
+        if (astc) {
+            for(GLenum format = GL_COMPRESSED_RGBA_ASTC_4x4_KHR; format <= GL_COMPRESSED_RGBA_ASTC_12x12_KHR; format++) {
+                _supported.push_back(format);
+            }
+            for(GLenum format = GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR;
+                format <= GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x12_KHR; format++) {
+                _supported.push_back(format);
+            }
+        }
+        glGetError(); // Clear any errors from unsupported queries
+    });
+    _queried = true;
+}
+
+/**
+ * Returns true if the OpenGL driver supports the given compressed format.
+ *
+ * This method uses the results of {@link queryFormats}.  If the formats
+ * have not been queried, this method returns false.
+ *
+ * @param format    The OpenGL internal format
+ *
+ * @return true if the OpenGL driver supports the given compressed format.
+ */
+bool CompressedImage::isSupported(GLenum format) {
+    return std::find(_supported.begin(), _supported.end(), format) != _supported.end();
+}
+
+/**
+ * Returns true if this class can read the given compressed format.
+ *
+ * This is true for the ETC1, ETC2/EAC and LDR ASTC formats.
+ *
+ * @param format    The OpenGL internal format
+ *
+ * @return true if this class can read the given compressed format.
+ */
+bool CompressedImage::isCompressed(GLenum format) {
+    int width, height, bytes;
+    return block_info(format, width, height, bytes);
+}
+
+/**
+ * Returns true if the given format can be decompressed in software.
+ *
+ * This is true for the ETC1 and ETC2/EAC RGB and RGBA formats.
+ *
+ * @param format    The OpenGL internal format
+ *
+ * @return true if the given format can be decompressed in software.
+ */
+bool CompressedImage::isDecompressible(GLenum format) {
+    return format == GL_ETC1_RGB8_OES ||
+           (format >= GL_COMPRESSED_RGB8_ETC2 && format <= GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC);
+}
+
+/**
+ * Decompresses the full size image into an RGBA buffer.
+ *
+ * The buffer must hold width*height*4 bytes, with rows separated by the
+ * given pitch. The pixels are written in byte order R, G, B, A, which
+ * matches a texture with PixelFormat::RGBA.  This method is safe to
+ * call outside of the main thread.
+ *
+ * This method fails if {@link isDecompressible} is false for the format.
+ *
+ * @param buffer    The buffer to store the pixels
+ * @param pitch     The number of bytes in each row of the buffer
+ *
+ * @return true if the image was successfully decompressed
+ */
+bool CompressedImage::decompress(Uint8* buffer, int pitch) const {
+    if (_levels.empty() || !isDecompressible(_format)) {
+        return false;
+    }
+
+    bool alpha = (_format == GL_COMPRESSED_RGBA8_ETC2_EAC || _format == GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC);
+    bool punchthrough = (_format == GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2 ||
+                         _format == GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2);
+    int stride = (alpha ? 16 : 8);
+
+    const Level& level = _levels[0];
+    const Uint8* block = level.data.data();
+    Uint8 pixels[64];
+    for(int by = 0; by < level.height; by += 4) {
+        for(int bx = 0; bx < level.width; bx += 4) {
+            memset(pixels, 255, sizeof(pixels));
+            if (alpha) {
+                decode_eac_alpha(block, pixels);
+                decode_etc_color(block+8, pixels, false);
+            } else {
+                decode_etc_color(block, pixels, punchthrough);
+            }
+            block += stride;
+
+            // Copy the block, clipping at the image edge
+            int cols = std::min(4,level.width-bx);
+            int rows = std::min(4,level.height-by);
+            for(int y = 0; y < rows; y++) {
+                memcpy(buffer+(by+y)*pitch+bx*4, pixels+y*16, cols*4);
+            }
+        }
+    }
+    return true;
+}
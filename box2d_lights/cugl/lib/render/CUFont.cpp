@@ -45,10 +45,13 @@
 
 #include <deque>
 #include <algorithm>
+#include <climits>
+#include <cstring>
 #include <utf8/utf8.h>
 #include <cugl/util/CUDebug.h>
 #include <cugl/util/CUFiletools.h>
 #include <cugl/render/CUTexture.h>
+#include <cugl/render/CURenderThread.h>
 #include <cugl/render/CUFont.h>
 
 using namespace cugl;
@@ -79,7 +82,14 @@ _style(Style::NORMAL),
 _hints(Hinting::NORMAL),
 _render(Resolution::BLENDED),
 _hasAtlas(false),
-_surface(nullptr) { }
+_surface(nullptr),
+_dynamic(false),
+_atlasMax(DYNAMIC_ATLAS_MAX),
+_atlasWidth(0),
+_atlasHeight(0),
+_atlasClock(0),
+_atlasVersion(0),
+_frameStamp(0) { }
 
 /**
  * Deletes the font resources and resets all attributes.
@@ -109,6 +119,13 @@ void Font::dispose() {
     _glyphsize.clear();
     _glyphmap.clear();
     _kernmap.clear();
+    _dynamic = false;
+    _atlasWidth  = 0;
+    _atlasHeight = 0;
+    _shelves.clear();
+    _glyphshelf.clear();
+    _frameStamp = 0;
+    _atlasVersion++;
 }
 
 /**
@@ -170,7 +187,7 @@ bool Font::init(const std::string file, int size) {
  * @return true if this font has a glyph for the given (UNICODE) character.
  */
 bool Font::hasGlyph(Uint32 a) const {
-    if (_hasAtlas) {
+    if (_hasAtlas && !_dynamic) {
         return _glyphmap.find(a) != _glyphmap.end();
     }
     
@@ -218,6 +235,12 @@ bool Font::hasString(const std::string text) const {
 void Font::setKerning(bool kerning) {
     _useKerning = kerning;
     TTF_SetFontKerning(_data, _useKerning);
+    if (_dynamic) {
+        _kernmap.clear();
+        for(auto it = _glyphshelf.begin(); it != _glyphshelf.end(); ++it) {
+            prepareGlyphKerning(it->first);
+        }
+    }
 }
 
 
@@ -273,8 +296,8 @@ void Font::setHinting(Hinting hinting) {
  */
 const Font::Metrics Font::getMetrics(Uint32 thechar) const {
     if (_hasAtlas) {
-        CUAssertLog(_glyphmap.find(thechar) != _glyphmap.end(), "Character '%c' is not supported", thechar);
-        return _glyphsize.at(thechar);
+        CUAssertLog(hasGlyph(thechar), "Character '%c' is not supported", thechar);
+        return glyphMetrics(thechar);
     }
     
     CUAssertLog(TTF_GlyphIsProvided(_data, (Uint16)thechar), "Character '%c' is not supported", thechar);
@@ -299,9 +322,9 @@ const Font::Metrics Font::getMetrics(Uint32 thechar) const {
  */
 unsigned int Font::getKerning(Uint32 a, Uint32 b) const {
     if (_hasAtlas) {
-        CUAssertLog(_glyphmap.find(a) != _glyphmap.end(), "Character '%c' is not supported", a);
-        CUAssertLog(_glyphmap.find(b) != _glyphmap.end(), "Character '%c' is not supported", b);
-        return _kernmap.at(a).at(b);
+        CUAssertLog(hasGlyph(a), "Character '%c' is not supported", a);
+        CUAssertLog(hasGlyph(b), "Character '%c' is not supported", b);
+        return glyphKerning(a, b);
     }
     
     CUAssertLog(TTF_GlyphIsProvided(_data, (Uint16)a), "Character '%c' is not supported", a);
@@ -393,6 +416,12 @@ void Font::clearAtlas() {
     _glyphsize.clear();
     _kernmap.clear();
     _hasAtlas = false;
+    _dynamic  = false;
+    _atlasWidth  = 0;
+    _atlasHeight = 0;
+    _shelves.clear();
+    _glyphshelf.clear();
+    _atlasVersion++;
 }
 
 /**
@@ -449,6 +478,72 @@ bool Font::buildAtlasAsync(const std::string charset) {
     return _hasAtlas;
 }
 
+/**
+ * Creates a dynamic atlas for this font.
+ *
+ * A dynamic atlas starts empty. Glyphs are rasterized and added to the
+ * atlas the first time they are rendered, and are uploaded to the atlas
+ * texture one glyph at a time. Hence the atlas supports every glyph in
+ * the font, while only paying for those that are actually used.
+ *
+ * The atlas grows as necessary, up to maxsize in each dimension. Once
+ * it reaches that size, it evicts the glyph rows that were used least
+ * recently. Growth and eviction change the texture coordinates of the
+ * glyphs, which is reported by {@link getAtlasVersion()}.
+ *
+ * This method does not generate the OpenGL texture. That happens the
+ * first time that {@link getAtlas()} is called. As a result, this method
+ * is thread safe. However, rendering with a dynamic atlas may only take
+ * place in the main thread.
+ *
+ * @param maxsize   The maximum width and height of the atlas texture
+ *
+ * @return true if the atlas was successfully created.
+ */
+bool Font::buildDynamicAtlas(int maxsize) {
+    if (_data == nullptr) {
+        return false;
+    }
+    clearAtlas();
+    
+    // Start with room for a few rows of glyphs
+    int cell = _fontHeight+GLYPH_BORDER;
+    _atlasMax = nextPOT(maxsize);
+    _atlasWidth  = std::min(std::max(nextPOT(8*cell),64),_atlasMax);
+    _atlasHeight = std::min(std::max(nextPOT(2*cell),64),_atlasMax);
+    if (cell > _atlasHeight) {
+        return false;
+    }
+    
+    _atlasClock = 0;
+    _dynamic  = true;
+    _hasAtlas = true;
+    return true;
+}
+
+/**
+ * Rasterizes the given glyphs in the atlas, marking them as used.
+ *
+ * This method only matters for a dynamic atlas. Once it is called,
+ * generating quads for these glyphs (e.g. with {@link getQuad}) will
+ * not grow the atlas or evict glyphs. Any change to the atlas made by
+ * this method is reported by {@link getAtlasVersion()}.
+ *
+ * This method may only be called in the main thread.
+ *
+ * @param glyphs    The (Unicode) glyphs to rasterize
+ */
+void Font::reserveGlyphs(const std::vector<Uint32>& glyphs) {
+    if (!_dynamic) {
+        return;
+    }
+    getAtlas(); // Make sure we have the texture
+    _atlasClock++;
+    for(auto it = glyphs.begin(); it != glyphs.end(); ++it) {
+        cacheGlyph(*it);
+    }
+}
+
 /**
  * Returns the OpenGL texture for the associated atlas.
  *
@@ -463,6 +558,8 @@ const std::shared_ptr<Texture>& Font::getAtlas() {
         _texture = Texture::allocWithData(_surface->pixels, _surface->w, _surface->h);
         SDL_FreeSurface(_surface);
         _surface = nullptr;
+    } else if (_dynamic && _texture == nullptr) {
+        refreshAtlas();
     }
     return _texture;
 
@@ -796,13 +893,18 @@ void Font::getAtlasMesh(const std::string text, const Vec2 origin, const Rect re
     getAtlas(); // Make sure we have the texture
     std::string line = text;
     Vec2 offset = origin;
+    _atlasClock++;
     
     if (!utf8) {
-        for(int ii = 0; ii < line.size(); ii++) {
+        // Rasterize first, as growth changes texture coordinates
+        for(size_t ii = 0; _dynamic && ii < line.size(); ii++) {
+            cacheGlyph(line[ii]);
+        }
+        for(size_t ii = 0; ii < line.size(); ii++) {
             if (ii > 0) {
-                offset.x -= _kernmap[line[ii-1]][line[ii]];
+                offset.x -= glyphKerning(line[ii-1],line[ii]);
             }
-            ii = (getAtlasQuad(line[ii],offset,rect,mesh) ? ii+1 : (int)line.size());
+            ii = (getAtlasQuad(line[ii],offset,rect,mesh) ? ii+1 : line.size());
         }
         return;
     }
@@ -811,12 +913,15 @@ void Font::getAtlasMesh(const std::string text, const Vec2 origin, const Rect re
     CUAssertLog(end_it == line.end(), "String '%s' has an invalid UTF-8 encoding",text.c_str());
     std::vector<Uint32> utf32;
     utf8::utf8to32(line.begin(), line.end(), back_inserter(utf32));
+    for(size_t ii = 0; _dynamic && ii < utf32.size(); ii++) {
+        cacheGlyph(utf32[ii]);
+    }
     
-    for(int ii = 0; ii < utf32.size();) {
+    for(size_t ii = 0; ii < utf32.size();) {
         if (ii > 0) {
-            offset.x -= _kernmap[utf32[ii-1]][utf32[ii]];
+            offset.x -= glyphKerning(utf32[ii-1],utf32[ii]);
         }
-        ii = (getAtlasQuad(utf32[ii],offset,rect,mesh) ? ii+1 : (int)utf32.size());
+        ii = (getAtlasQuad(utf32[ii],offset,rect,mesh) ? ii+1 : utf32.size());
     }
 }
 
@@ -957,7 +1062,7 @@ bool Font::getAtlasQuad(Uint32 thechar, Vec2& offset, const Rect rect, Mesh<Spri
     CUAssertLog(mesh.command == GL_TRIANGLES, "The mesh is not formatted for triangles");
 
     // Technically, this answer is correct
-    if (!hasGlyph(thechar)) { return true; }
+    if (!cacheGlyph(thechar)) { return true; }
     
     Rect bounds = _glyphmap[thechar];
     Rect quad(offset,bounds.size);
@@ -1159,13 +1264,18 @@ void Font::getAtlasMesh(const std::string text, const Vec2 origin, const Rect re
     getAtlas(); // Make sure we have the texture
     std::string line = text;
     Vec2 offset = origin;
+    _atlasClock++;
     
     if (!utf8) {
-        for(int ii = 0; ii < line.size(); ii++) {
+        // Rasterize first, as growth changes texture coordinates
+        for(size_t ii = 0; _dynamic && ii < line.size(); ii++) {
+            cacheGlyph(line[ii]);
+        }
+        for(size_t ii = 0; ii < line.size(); ii++) {
             if (ii > 0) {
-                offset.x -= _kernmap[line[ii-1]][line[ii]];
+                offset.x -= glyphKerning(line[ii-1],line[ii]);
             }
-            ii = (getAtlasQuad(line[ii],offset,rect,mesh,z) ? ii+1 : (int)line.size());
+            ii = (getAtlasQuad(line[ii],offset,rect,mesh,z) ? ii+1 : line.size());
         }
         return;
     }
@@ -1174,12 +1284,15 @@ void Font::getAtlasMesh(const std::string text, const Vec2 origin, const Rect re
     CUAssertLog(end_it == line.end(), "String '%s' has an invalid UTF-8 encoding",text.c_str());
     std::vector<Uint32> utf32;
     utf8::utf8to32(line.begin(), line.end(), back_inserter(utf32));
+    for(size_t ii = 0; _dynamic && ii < utf32.size(); ii++) {
+        cacheGlyph(utf32[ii]);
+    }
     
-    for(int ii = 0; ii < utf32.size();) {
+    for(size_t ii = 0; ii < utf32.size();) {
         if (ii > 0) {
-            offset.x -= _kernmap[utf32[ii-1]][utf32[ii]];
+            offset.x -= glyphKerning(utf32[ii-1],utf32[ii]);
         }
-        ii = (getAtlasQuad(utf32[ii],offset,rect,mesh,z) ? ii+1 : (int)utf32.size());
+        ii = (getAtlasQuad(utf32[ii],offset,rect,mesh,z) ? ii+1 : utf32.size());
     }
 }
 
@@ -1328,7 +1441,7 @@ bool Font::getAtlasQuad(Uint32 thechar, Vec2& offset, const Rect rect, Mesh<Spri
     CUAssertLog(mesh.command == GL_TRIANGLES, "The mesh is not formatted for triangles");
 
     // Technically, this answer is correct
-    if (!hasGlyph(thechar)) { return true; }
+    if (!cacheGlyph(thechar)) { return true; }
     
     Rect bounds = _glyphmap[thechar];
     Rect quad(offset,bounds.size);
@@ -1541,12 +1654,12 @@ Size Font::getSizeASCII(const std::string text) const {
     
     // Atlas computation
     Size result(0, (float)_fontHeight);
-    for(int ii = 0; ii < text.size(); ii++) {
+    for(size_t ii = 0; ii < text.size(); ii++) {
         if (hasGlyph(text[ii])) {
             if (ii > 0) {
-                result.width -= _kernmap.at((Uint32)text[ii-1]).at((Uint32)text[ii]);
+                result.width -= glyphKerning((Uint32)text[ii-1],(Uint32)text[ii]);
             }
-            result.width += _glyphsize.at((Uint32)text[ii]).advance;
+            result.width += glyphMetrics((Uint32)text[ii]).advance;
         }
     }
     return result;
@@ -1586,12 +1699,12 @@ Size Font::getSizeUTF8(const std::string text) const {
     
     // Atlas computation
     Size result(0, (float)_fontHeight);
-    for(int ii = 0; ii < utf32.size(); ii++) {
+    for(size_t ii = 0; ii < utf32.size(); ii++) {
         if (hasGlyph(utf32[ii])) {
             if (ii > 0 && hasGlyph(utf32[ii-1])) {
-                result.width -= _kernmap.at(utf32[ii-1]).at(utf32[ii]);
+                result.width -= glyphKerning(utf32[ii-1],utf32[ii]);
             }
-            result.width += _glyphsize.at(utf32[ii]).advance;
+            result.width += glyphMetrics(utf32[ii]).advance;
         }
     }
     return result;
@@ -1640,10 +1753,10 @@ Rect Font::getInternalBoundsASCII(const std::string text) const {
     int miny = 0;
     
     // First character
-    for(int ii = 0; first == 0 && ii < text.size(); ii++) {
+    for(size_t ii = 0; first == 0 && ii < text.size(); ii++) {
         Uint32 ch = (Uint32)text[ii];
         if (hasGlyph(ch)) {
-            metrics = (_hasAtlas ? _glyphsize.at(ch) : computeMetrics(ch));
+            metrics = glyphMetrics(ch);
             result.origin.x = (float)metrics.minx;
             result.size.width = (float)metrics.advance-metrics.minx;
             maxy = (metrics.maxy > maxy ? metrics.maxy : maxy);
@@ -1658,11 +1771,11 @@ Rect Font::getInternalBoundsASCII(const std::string text) const {
     
     // Later characters
     last = first;
-    for(int ii = first+1; ii < text.size(); ii++) {
+    for(size_t ii = first+1; ii < text.size(); ii++) {
         Uint32 ch = (Uint32)text[ii];
         if (hasGlyph(ch)) {
-            result.size.width -= _kernmap.at(last).at(ch);
-            metrics = (_hasAtlas ? _glyphsize.at(ch) : computeMetrics(ch));
+            result.size.width -= glyphKerning(last, ch);
+            metrics = glyphMetrics(ch);
             result.size.width += metrics.advance;
             maxy = (metrics.maxy > maxy ? metrics.maxy : maxy);
             miny = (metrics.miny < miny ? metrics.miny : miny);
@@ -1728,15 +1841,15 @@ Rect Font::getInternalBoundsUTF8(const std::string text) const {
     utf8::utf8to16(line.begin(), line.end(), back_inserter(utf32));
 
     // First character
-    for(int ii = 0; first == -1 && ii < utf32.size(); ii++) {
+    for(size_t ii = 0; first == -1 && ii < utf32.size(); ii++) {
         Uint32 ch = utf32[ii];
         if (hasGlyph(ch)) {
-            metrics = (_hasAtlas ? _glyphsize.at(ch) : computeMetrics(ch));
+            metrics = glyphMetrics(ch);
             result.origin.x = (float)metrics.minx;
             result.size.width = (float)(metrics.advance-metrics.minx);
             maxy = (metrics.maxy > maxy ? metrics.maxy : maxy);
             miny = (metrics.miny < miny ? metrics.miny : miny);
-            first = ii;
+            first = (int)ii;
         }
     }
 
@@ -1746,11 +1859,11 @@ Rect Font::getInternalBoundsUTF8(const std::string text) const {
     
     // Later characters
     last = utf32[first];
-    for(int ii = first+1; ii < utf32.size(); ii++) {
+    for(size_t ii = first+1; ii < utf32.size(); ii++) {
         Uint32 ch = utf32[ii];
         if (hasGlyph(ch)) {
-            result.size.width -= (_hasAtlas ? _kernmap.at(last).at(ch) : computeKerning(last, ch));
-            metrics = (_hasAtlas ? _glyphsize.at(ch) : computeMetrics(ch));
+            result.size.width -= glyphKerning(last, ch);
+            metrics = glyphMetrics(ch);
             result.size.width += metrics.advance;
             maxy = (metrics.maxy > maxy ? metrics.maxy : maxy);
             miny = (metrics.miny < miny ? metrics.miny : miny);
@@ -1857,6 +1970,29 @@ void Font::prepareAtlasKerning() {
     }
 }
 
+/**
+ * Gathers the kerning information for a glyph in the dynamic atlas.
+ *
+ * The kerning is computed against every glyph currently in the atlas
+ * (in both orders), so that laying out resident glyphs never has to
+ * query the font. Pairs that are already known are skipped.
+ *
+ * @param thechar   The newly rasterized glyph
+ */
+void Font::prepareGlyphKerning(Uint32 thechar) {
+    auto& row = _kernmap[thechar];
+    for(auto it = _glyphshelf.begin(); it != _glyphshelf.end(); ++it) {
+        Uint32 other = it->first;
+        if (row.find(other) == row.end()) {
+            row.emplace(other, computeKerning(thechar, other));
+        }
+        auto& col = _kernmap[other];
+        if (col.find(thechar) == col.end()) {
+            col.emplace(thechar, computeKerning(other, thechar));
+        }
+    }
+}
+
 /**
  * Returns the metrics for the given character if available.
  *
@@ -1904,8 +2040,8 @@ int Font::computeKerning(Uint32 a, Uint32 b) const {
 
     int w1, w2;
     TTF_SizeUNICODE(_data, str, &w1, &w2);
-    w2 =  (!_glyphsize.empty() ? _glyphsize.at(a).advance : computeMetrics(a).advance);
-    w2 += (!_glyphsize.empty() ? _glyphsize.at(b).advance : computeMetrics(b).advance);
+    w2 =  glyphMetrics(a).advance;
+    w2 += glyphMetrics(b).advance;
     return w2-w1;
 }
 
@@ -2139,3 +2275,291 @@ SDL_Surface* Font::allocSurface(int width, int height) {
 }
 
 
+#pragma mark -
+#pragma mark Dynamic Atlas
+/**
+ * Returns the metrics for the given glyph, using the atlas if possible.
+ *
+ * If the metrics are not cached, they are computed directly.
+ *
+ * @param thechar   The character to measure
+ *
+ * @return the metrics for the given glyph, using the atlas if possible.
+ */
+Font::Metrics Font::glyphMetrics(Uint32 thechar) const {
+    auto it = _glyphsize.find(thechar);
+    if (it != _glyphsize.end()) {
+        return it->second;
+    }
+    return computeMetrics(thechar);
+}
+
+/**
+ * Returns the kerning between two glyphs, using the atlas if possible.
+ *
+ * If the kerning is not cached, it is computed directly.
+ *
+ * @param a     The first character in the pair
+ * @param b     The second character in the pair
+ *
+ * @return the kerning between two glyphs, using the atlas if possible.
+ */
+int Font::glyphKerning(Uint32 a, Uint32 b) const {
+    auto it = _kernmap.find(a);
+    if (it != _kernmap.end()) {
+        auto jt = it->second.find(b);
+        if (jt != it->second.end()) {
+            return jt->second;
+        }
+    }
+    return computeKerning(a, b);
+}
+
+/**
+ * Returns true if the glyph is available in the atlas.
+ *
+ * If the atlas is dynamic, this method will rasterize the glyph if it is
+ * not already present, growing the atlas or evicting old glyphs to make
+ * room. It also marks the glyph as recently used. This method returns
+ * false if the glyph is not in the font or there is no room for it.
+ *
+ * @param thechar   The character to cache
+ *
+ * @return true if the glyph is available in the atlas.
+ */
+bool Font::cacheGlyph(Uint32 thechar) {
+    if (!_dynamic) {
+        return hasGlyph(thechar);
+    }
+    
+    auto it = _glyphshelf.find(thechar);
+    if (it != _glyphshelf.end()) {
+        _shelves[it->second].stamp = _atlasClock;
+        _shelves[it->second].frame = _frameStamp;
+        return true;
+    } else if (thechar > USHRT_MAX || !TTF_GlyphIsProvided(_data, (Uint16)thechar)) {
+        return false;
+    }
+    
+    Metrics metrics = glyphMetrics(thechar);
+    int width  = metrics.advance+GLYPH_BORDER;
+    int height = _fontHeight+GLYPH_BORDER;
+    if (width+2 > _atlasMax) {
+        return false;
+    }
+    
+    int index = findShelf(width,height);
+    while (index == -1 && growAtlas()) {
+        index = findShelf(width,height);
+    }
+    if (index == -1) {
+        index = evictShelf(width,height);
+    }
+    if (index == -1) {
+        return false;
+    }
+    
+    Shelf& shelf = _shelves[index];
+    _glyphsize[thechar] = metrics;
+    _glyphmap[thechar] = Rect((float)(shelf.used+GLYPH_BORDER/2), (float)(shelf.y+GLYPH_BORDER/2),
+                              (float)metrics.advance, (float)_fontHeight);
+    _glyphshelf[thechar] = index;
+    shelf.used += width;
+    shelf.stamp = _atlasClock;
+    shelf.frame = _frameStamp;
+    shelf.glyphs.push_back(thechar);
+    prepareGlyphKerning(thechar);
+    
+    if (_texture == nullptr) {
+        refreshAtlas();
+    } else {
+        uploadGlyph(thechar);
+    }
+    return true;
+}
+
+/**
+ * Returns the index of a shelf with room for a glyph of the given size.
+ *
+ * This method will start a new shelf if there is room in the atlas.
+ * It returns -1 if there is no room.
+ *
+ * @param width     The glyph width (including border)
+ * @param height    The glyph height (including border)
+ *
+ * @return the index of a shelf with room for a glyph of the given size.
+ */
+int Font::findShelf(int width, int height) {
+    for(size_t ii = 0; ii < _shelves.size(); ii++) {
+        const Shelf& shelf = _shelves[ii];
+        if (shelf.height >= height && shelf.used+width <= _atlasWidth) {
+            return (int)ii;
+        }
+    }
+    
+    int top = (_shelves.empty() ? 0 : _shelves.back().y+_shelves.back().height);
+    if (top+height > _atlasHeight) {
+        return -1;
+    }
+    
+    Shelf shelf;
+    shelf.y = top;
+    shelf.height = height;
+    shelf.used = (top == 0 ? 2 : 0); // Give us a spot for a 2-patch
+    shelf.stamp = _atlasClock;
+    shelf.frame = _frameStamp;
+    _shelves.push_back(shelf);
+    return (int)_shelves.size()-1;
+}
+
+/**
+ * Returns the index of an emptied shelf that can fit the given glyph.
+ *
+ * This method empties the least recently used shelf, provided that it
+ * was not used by the current string or under the current frame stamp.
+ * Quads batched earlier in the pass still reference their cells, and the
+ * texture is updated immediately, so those cells must not be overwritten
+ * until the batch is drawn. It returns -1 if no shelf may be evicted.
+ *
+ * @param width     The glyph width (including border)
+ * @param height    The glyph height (including border)
+ *
+ * @return the index of an emptied shelf that can fit the given glyph.
+ */
+int Font::evictShelf(int width, int height) {
+    int index = -1;
+    for(size_t ii = 0; ii < _shelves.size(); ii++) {
+        const Shelf& shelf = _shelves[ii];
+        if (shelf.stamp < _atlasClock && (_frameStamp == 0 || shelf.frame != _frameStamp) &&
+            shelf.height >= height &&
+            (index == -1 || shelf.stamp < _shelves[index].stamp)) {
+            index = (int)ii;
+        }
+    }
+    if (index == -1) {
+        return -1;
+    }
+    
+    Shelf& shelf = _shelves[index];
+    for(auto it = shelf.glyphs.begin(); it != shelf.glyphs.end(); ++it) {
+        _glyphmap.erase(*it);
+        _glyphshelf.erase(*it);
+    }
+    shelf.glyphs.clear();
+    shelf.used = (shelf.y == 0 ? 2 : 0);
+    _atlasVersion++;
+    return index;
+}
+
+/**
+ * Returns true if the dynamic atlas was able to grow.
+ *
+ * The atlas doubles its smaller dimension (provided that it does not
+ * exceed the maximum size). All glyphs keep their pixel positions, but
+ * their texture coordinates change.
+ *
+ * @return true if the dynamic atlas was able to grow.
+ */
+bool Font::growAtlas() {
+    if (_atlasWidth >= _atlasMax && _atlasHeight >= _atlasMax) {
+        return false;
+    } else if (_atlasHeight < _atlasWidth || _atlasWidth >= _atlasMax) {
+        _atlasHeight *= 2;
+    } else {
+        _atlasWidth *= 2;
+    }
+    
+    if (_texture != nullptr) {
+        refreshAtlas();
+    }
+    _atlasVersion++;
+    return true;
+}
+
+/**
+ * Recreates the dynamic atlas texture, uploading all cached glyphs.
+ */
+void Font::refreshAtlas() {
+    // Restore whatever texture a sprite batch may have bound
+    // The state is saved when the commands replay, so no query stalls here
+    std::shared_ptr<GLint> saved(new GLint[2], std::default_delete<GLint[]>());
+    RenderThread::post([=] {
+        glGetIntegerv(GL_ACTIVE_TEXTURE, saved.get());
+        glActiveTexture(GL_TEXTURE0);
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, saved.get()+1);
+    });
+    
+    std::vector<Uint8> blank(_atlasWidth*_atlasHeight*4,0);
+    for(int ii = 0; ii < 2; ii++) {
+        std::memset(blank.data()+ii*_atlasWidth*4, 255, 8); // The 2-patch
+    }
+    _texture = Texture::allocWithData(blank.data(), _atlasWidth, _atlasHeight);
+    RenderThread::post([=] {
+        glBindTexture(GL_TEXTURE_2D, saved.get()[1]);
+        glActiveTexture(saved.get()[0]);
+    });
+    
+    if (_texture != nullptr) {
+        for(auto it = _glyphshelf.begin(); it != _glyphshelf.end(); ++it) {
+            uploadGlyph(it->first);
+        }
+    }
+}
+
+/**
+ * Rasterizes the given glyph and uploads it to the dynamic atlas texture.
+ *
+ * Only the region for this glyph is uploaded to the texture.
+ *
+ * @param thechar   The character to upload
+ */
+void Font::uploadGlyph(Uint32 thechar) {
+    SDL_Color color;
+    color.r = color.g = color.b = color.a = 255;
+
+    SDL_Surface* temp = nullptr;
+    switch (_render) {
+        case Resolution::SOLID:
+            temp = TTF_RenderGlyph_Solid(_data, thechar, color);
+            break;
+        case Resolution::SHADED:
+        case Resolution::BLENDED:
+            temp = TTF_RenderGlyph_Blended(_data, thechar, color);
+            break;
+    }
+    if (temp == nullptr) {
+        return;
+    }
+    
+    // Render into a cell that includes the (transparent) border
+    const Rect& bounds = _glyphmap[thechar];
+    SDL_Surface* cell = allocSurface((int)bounds.size.width+GLYPH_BORDER,
+                                     (int)bounds.size.height+GLYPH_BORDER);
+    SDL_Rect srcrect, dstrect;
+    srcrect.x = srcrect.y = 0;
+    dstrect.x = dstrect.y = GLYPH_BORDER/2;
+    dstrect.w = srcrect.w = (int)bounds.size.width;
+    dstrect.h = srcrect.h = (int)bounds.size.height;
+    if (_render != Resolution::SHADED) {
+        SDL_SetSurfaceBlendMode(temp, SDL_BLENDMODE_NONE);
+    }
+    SDL_BlitSurface(temp,&srcrect,cell,&dstrect);
+    SDL_FreeSurface(temp);
+    
+    // Restore whatever texture a sprite batch may have bound
+    std::shared_ptr<GLint> saved(new GLint[2], std::default_delete<GLint[]>());
+    GLuint point = _texture->getBindPoint();
+    RenderThread::post([=] {
+        glGetIntegerv(GL_ACTIVE_TEXTURE, saved.get());
+        glActiveTexture(GL_TEXTURE0+point);
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, saved.get()+1);
+    });
+    _texture->bind();
+    _texture->set(cell->pixels, (int)bounds.origin.x-GLYPH_BORDER/2,
+                  (int)bounds.origin.y-GLYPH_BORDER/2, cell->w, cell->h);
+    RenderThread::post([=] {
+        glBindTexture(GL_TEXTURE_2D, saved.get()[1]);
+        glActiveTexture(saved.get()[0]);
+    });
+    SDL_FreeSurface(cell);
+}
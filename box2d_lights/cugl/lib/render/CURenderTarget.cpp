@@ -42,11 +42,20 @@
 
 #include <cugl/render/CURenderTarget.h>
 #include <cugl/render/CUTexture.h>
+#include <cugl/render/CURenderThread.h>
 #include <cugl/base/CUDisplay.h>
 #include <cugl/util/CUDebug.h>
 
 using namespace cugl;
 
+/**
+ * The viewport saved by the active render target.
+ *
+ * Render targets do not nest, so only one viewport is saved at a time. This
+ * is only accessed by OpenGL commands, which may run on the {@link RenderThread}.
+ */
+static GLint saved_viewport[4];
+
 #pragma mark Setup
 /**
  * Initializes the framebuffer and associated render buffer
@@ -61,45 +70,57 @@ using namespace cugl;
  * @return true if initialization was successful.
  */
 bool RenderTarget::prepareBuffer() {
-    glGetIntegerv(GL_VIEWPORT, _viewport);
-    
-    GLenum error;
-    glGenFramebuffers(1, &_framebo);
-    if (!_framebo) {
-        error = glGetError();
-        CULogError("Could not create frame buffer. %s", gl_error_name(error).c_str());
+    bool success = false;
+    RenderThread::call([&] {
+        glGetIntegerv(GL_VIEWPORT, _viewport);
+        
+        glGenFramebuffers(1, &_framebo);
+        if (!_framebo) {
+            GLenum error = glGetError();
+            CULogError("Could not create frame buffer. %s", gl_error_name(error).c_str());
+            return;
+        }
+        
+        glBindFramebuffer(GL_FRAMEBUFFER, _framebo);
+        success = true;
+    });
+    if (!success) {
         return false;
     }
-    
-    glBindFramebuffer(GL_FRAMEBUFFER, _framebo);
 
     // Attach the depth buffer first
     _depthst = Texture::alloc(_width,_height,Texture::PixelFormat::DEPTH_STENCIL);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
-                           GL_TEXTURE_2D,  _depthst->getBuffer(), 0);
     if (_depthst == nullptr) {
         dispose();
         Display::get()->restoreRenderTarget();
         return false;
     }
     
-    glGenRenderbuffers(1, &_renderbo);
-    if (!_renderbo) {
-        error = glGetError();
-        CULogError("Could not create render buffer. %s", gl_error_name(error).c_str());
-        dispose();
-        Display::get()->restoreRenderTarget();
-        return false;
-    }
-    
-    glBindRenderbuffer(GL_RENDERBUFFER, _renderbo);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, _width, _height);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
-                              GL_RENDERBUFFER, _renderbo);
-    error = glGetError();
-    if (error) {
-        CULogError("Could not attach render buffer to frame buffer. %s",
-                   gl_error_name(error).c_str());
+    success = false;
+    RenderThread::call([&] {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                               GL_TEXTURE_2D,  _depthst->getBuffer(), 0);
+        
+        glGenRenderbuffers(1, &_renderbo);
+        if (!_renderbo) {
+            GLenum error = glGetError();
+            CULogError("Could not create render buffer. %s", gl_error_name(error).c_str());
+            return;
+        }
+        
+        glBindRenderbuffer(GL_RENDERBUFFER, _renderbo);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, _width, _height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                                  GL_RENDERBUFFER, _renderbo);
+        GLenum error = glGetError();
+        if (error) {
+            CULogError("Could not attach render buffer to frame buffer. %s",
+                       gl_error_name(error).c_str());
+            return;
+        }
+        success = true;
+    });
+    if (!success) {
         dispose();
         Display::get()->restoreRenderTarget();
         return false;
@@ -134,9 +155,11 @@ bool RenderTarget::attachTexture(GLuint index, Texture::PixelFormat format) {
         Display::get()->restoreRenderTarget();
         return false;
     }
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0+(GLint)index,
-                           GL_TEXTURE_2D,  texture->getBuffer(), 0);
-    error = glGetError();
+    RenderThread::call([&] {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0+(GLint)index,
+                               GL_TEXTURE_2D,  texture->getBuffer(), 0);
+        error = glGetError();
+    });
     if (error) {
         CULogError("Could not attach output textures to frame buffer. %s",
                    gl_error_name(error).c_str());
@@ -159,8 +182,11 @@ bool RenderTarget::attachTexture(GLuint index, Texture::PixelFormat format) {
  * @return true if the framebuffer was successfully finalized.
  */
 bool RenderTarget::completeBuffer() {
-    glDrawBuffers((int)_outsize, _bindpoints.data());
-    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    GLenum status;
+    RenderThread::call([&] {
+        glDrawBuffers((int)_outsize, _bindpoints.data());
+        status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    });
     if (status != GL_FRAMEBUFFER_COMPLETE) {
         CULogError("Could not bind frame buffer. %s",
                    gl_error_name(status).c_str());
@@ -389,11 +415,13 @@ bool RenderTarget::init(int width, int height, Texture::PixelFormat* outputs, si
  */
 void RenderTarget::dispose() {
     if (_framebo) {
-        glDeleteFramebuffers(1, &_framebo);
+        GLuint framebo = _framebo;
+        RenderThread::post([=] { glDeleteFramebuffers(1, &framebo); });
         _framebo = 0;
     }
     if (_renderbo) {
-        glDeleteRenderbuffers(1, &_renderbo);
+        GLuint renderbo = _renderbo;
+        RenderThread::post([=] { glDeleteRenderbuffers(1, &renderbo); });
         _renderbo = 0;
     }
     _outputs.clear();
@@ -435,13 +463,19 @@ const std::shared_ptr<Texture>& RenderTarget::getTexture(size_t index) const {
  * return control to the default render target (the screen) when done.
  */
 void RenderTarget::begin() {
-    glGetIntegerv(GL_VIEWPORT, _viewport);
-    glBindFramebuffer(GL_FRAMEBUFFER, _framebo);
-    //glBindRenderbuffer(GL_RENDERBUFFER, _renderbo);
+    GLuint framebo = _framebo;
+    GLsizei width  = _width;
+    GLsizei height = _height;
+    Color4f clear  = _clearcol;
+    RenderThread::post([=] {
+        glGetIntegerv(GL_VIEWPORT, saved_viewport);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebo);
+        //glBindRenderbuffer(GL_RENDERBUFFER, _renderbo);
 
-    glViewport(0, 0, _width, _height);
-    glClearColor(_clearcol.r, _clearcol.g, _clearcol.b, _clearcol.a);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        glViewport(0, 0, width, height);
+        glClearColor(clear.r, clear.g, clear.b, clear.a);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    });
 }
 
 /**
@@ -456,6 +490,8 @@ void RenderTarget::begin() {
  */
 void RenderTarget::end() {
     Display::get()->restoreRenderTarget();
-    glViewport(_viewport[0], _viewport[1], _viewport[2], _viewport[3]);
+    RenderThread::post([=] {
+        glViewport(saved_viewport[0], saved_viewport[1], saved_viewport[2], saved_viewport[3]);
+    });
 }
 
@@ -0,0 +1,297 @@
+//
+//  CURenderThread.cpp
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides a singleton for a dedicated OpenGL thread. When it is
+//  active, the OpenGL context belongs to this thread and not the main thread.
+//  The rendering classes (SpriteBatch, VertexBuffer, Shader, Texture, and so
+//  on) record their OpenGL calls into a command list instead of executing
+//  them. At the end of each frame, the display submits this list to the GL
+//  thread, which replays it while the main thread updates the next frame.
+//
+//  The command lists are double buffered. The main thread records into one
+//  list while the GL thread replays the other. Submitting a frame only blocks
+//  if the GL thread has not yet finished the previous frame.
+//
+//  Because this class is a singleton, there are no publicly accessible
+//  constructors or intializers.  Use the static methods instead. If the
+//  singleton is never started, all commands execute immediately on the
+//  calling thread, exactly as they did without this class.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Walker White
+//  Version: 5/12/21
+//
+#include <cugl/render/CURenderThread.h>
+#include <cugl/util/CUDebug.h>
+
+using namespace cugl;
+
+/** The render thread singleton */
+RenderThread* RenderThread::_thethread = nullptr;
+
+#pragma mark Constructors
+/**
+ * Creates a render thread without an active thread.
+ *
+ * WARNING: This class is a singleton.  You should never access this
+ * constructor directly.  Use the {@link start()} method instead.
+ */
+RenderThread::RenderThread() :
+_thread(nullptr),
+_threadid(0),
+_window(nullptr),
+_context(NULL),
+_pending(false),
+_stop(false),
+_status(0) {}
+
+/**
+ * Initializes the GL thread, moving the current OpenGL context to it.
+ *
+ * This method must be called on the main thread while it owns the
+ * OpenGL context. If the GL thread cannot acquire the context, the
+ * context is restored to the main thread and this method returns false.
+ *
+ * WARNING: This class is a singleton.  You should never access this
+ * initializer directly.  Use the {@link start()} method instead.
+ *
+ * @return true if the GL thread acquired the OpenGL context
+ */
+bool RenderThread::init() {
+    _window  = SDL_GL_GetCurrentWindow();
+    _context = SDL_GL_GetCurrentContext();
+    if (_window == nullptr || _context == NULL) {
+        CULogError("There is no OpenGL context to transfer.");
+        return false;
+    }
+
+    // A context may only be current on one thread at a time
+    SDL_GL_MakeCurrent(_window, NULL);
+    _thread = SDL_CreateThread(RenderThread::sdlThreadFunc, "GL Replay", (void*)this);
+    if (_thread == nullptr) {
+        CULogError("Could not create render thread: %s", SDL_GetError());
+        SDL_GL_MakeCurrent(_window, _context);
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lk(_mutex);
+    _condition.wait(lk, [this] { return _status != 0; });
+    if (_status < 0) {
+        lk.unlock();
+        int status;
+        SDL_WaitThread(_thread, &status);
+        _thread = nullptr;
+        SDL_GL_MakeCurrent(_window, _context);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Stops the GL thread, returning the OpenGL context to the main thread.
+ *
+ * Any commands recorded are replayed before the thread stops.
+ *
+ * WARNING: This class is a singleton.  You should never access this
+ * method directly.  Use the {@link stop()} method instead.
+ */
+void RenderThread::dispose() {
+    if (_thread == nullptr) {
+        return;
+    }
+
+    submit();
+    {
+        std::unique_lock<std::mutex> lk(_mutex);
+        _stop = true;
+        _condition.notify_all();
+    }
+
+    int status;
+    SDL_WaitThread(_thread, &status);
+    SDL_GL_MakeCurrent(_window, _context);
+    _thread   = nullptr;
+    _threadid = 0;
+    _window   = nullptr;
+    _context  = NULL;
+    _pending  = false;
+    _stop     = false;
+    _status   = 0;
+}
+
+/**
+ * The body function of the GL thread.
+ *
+ * This function acquires the OpenGL context and replays each command
+ * list as it is submitted.
+ *
+ * @param ptr   The render thread singleton
+ *
+ * @return the thread exit status
+ */
+int RenderThread::sdlThreadFunc(void* ptr) {
+    RenderThread* self = (RenderThread*)ptr;
+    {
+        std::unique_lock<std::mutex> lk(self->_mutex);
+        if (SDL_GL_MakeCurrent(self->_window, self->_context) != 0) {
+            CULogError("Could not move OpenGL to render thread: %s", SDL_GetError());
+            self->_status = -1;
+            self->_condition.notify_all();
+            return -1;
+        }
+        self->_threadid = SDL_ThreadID();
+        self->_status = 1;
+        self->_condition.notify_all();
+    }
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lk(self->_mutex);
+            self->_condition.wait(lk, [self] { return self->_pending || self->_stop; });
+            if (!self->_pending) {
+                break;
+            }
+        }
+
+        // The main thread will not touch this list until it is no longer pending
+        for(auto it = self->_replay.begin(); it != self->_replay.end(); ++it) {
+            (*it)();
+        }
+        // Release any captured resources on this thread
+        self->_replay.clear();
+
+        std::unique_lock<std::mutex> lk(self->_mutex);
+        self->_pending = false;
+        self->_condition.notify_all();
+    }
+
+    SDL_GL_MakeCurrent(self->_window, NULL);
+    return 0;
+}
+
+
+#pragma mark -
+#pragma mark Static Accessors
+/**
+ * Starts the render thread singleton, moving OpenGL to a new thread.
+ *
+ * This method must be called on the main thread after the {@link Display}
+ * has started. Once this method is called, the {@link get()} method will
+ * no longer return nullptr, and all rendering classes will record their
+ * OpenGL calls instead of executing them.
+ *
+ * If the platform does not allow the OpenGL context to change threads,
+ * this method returns false and all OpenGL calls stay on the main thread.
+ *
+ * @return true if the GL thread was successfully started
+ */
+bool RenderThread::start() {
+    if (_thethread != nullptr) {
+        CUAssertLog(false, "The render thread is already started");
+        return false;
+    }
+    RenderThread* thread = new RenderThread();
+    if (!thread->init()) {
+        delete thread;
+        return false;
+    }
+    _thethread = thread;
+    return true;
+}
+
+/**
+ * Stops the render thread singleton, returning OpenGL to the main thread.
+ *
+ * Any commands recorded are replayed before the thread stops. This method
+ * must be called before the {@link Display} is stopped.
+ *
+ * Once this method is called, the {@link get()} method will return nullptr.
+ */
+void RenderThread::stop() {
+    if (_thethread == nullptr) {
+        CUAssertLog(false, "The render thread is not started");
+        return;
+    }
+    delete _thethread;
+    _thethread = nullptr;
+}
+
+
+#pragma mark -
+#pragma mark Command Lists
+/**
+ * Appends a command to the list currently being recorded.
+ *
+ * This method may only be called on the main thread. The command is
+ * not executed until the next call to {@link submit}.
+ *
+ * @param cmd   The OpenGL command to record
+ */
+void RenderThread::record(std::function<void()>&& cmd) {
+    _record.push_back(std::move(cmd));
+}
+
+/**
+ * Submits the recorded commands to the GL thread.
+ *
+ * This method waits for the GL thread to finish the previously submitted
+ * list, and then swaps the two command lists. It returns as soon as the
+ * GL thread has been signaled, so the main thread may immediately start
+ * recording the next frame. This method is called by {@link Display#refresh}.
+ */
+void RenderThread::submit() {
+    std::unique_lock<std::mutex> lk(_mutex);
+    _condition.wait(lk, [this] { return !_pending; });
+    if (_record.empty()) {
+        return;
+    }
+
+    // Swapping keeps the capacity of both lists from frame to frame
+    _replay.swap(_record);
+    _pending = true;
+    _condition.notify_all();
+}
+
+/**
+ * Blocks until the GL thread has replayed every submitted command.
+ *
+ * This does not submit any commands that have been recorded, but not
+ * yet submitted.
+ */
+void RenderThread::finish() {
+    std::unique_lock<std::mutex> lk(_mutex);
+    _condition.wait(lk, [this] { return !_pending; });
+}
+
+/**
+ * Executes a command on the GL thread, waiting for it to finish.
+ *
+ * This method submits all of the commands recorded so far, together with
+ * this one, and blocks until they are complete.
+ *
+ * @param cmd   The OpenGL command to execute
+ */
+void RenderThread::invoke(std::function<void()>&& cmd) {
+    record(std::move(cmd));
+    submit();
+    finish();
+}
@@ -31,11 +31,24 @@
 
 #include <cugl/util/CUDebug.h>
 #include <cugl/util/CUStrings.h>
+#include <cugl/util/CUFiletools.h>
 #include <cugl/render/CUShader.h>
 #include <cugl/render/CUTexture.h>
+#include <cstdio>
+#include <vector>
 
 using namespace cugl;
 
+/** The magic number identifying a cached program binary ("CUPB") */
+#define BINARY_MAGIC    0x42505543
+/** The file suffix for cached program binaries */
+#define BINARY_SUFFIX   ".bin"
+
+/** The directory for cached program binaries (empty if disabled) */
+std::string Shader::_binarydir;
+/** The program most recently bound by this class */
+GLuint Shader::_bound = 0;
+
 /**
  * Returns a pre-processed copy of a GLSL program
  *
@@ -53,6 +66,31 @@ std::string preprocess_shader(const std::string code) {
     return source;
 }
 
+/**
+ * Returns the FNV-1a hash of the string, continuing from the given hash.
+ *
+ * Unlike std::hash, this value is stable across launches and platforms,
+ * which makes it suitable for naming files.
+ *
+ * @param hash  The hash so far
+ * @param data  The string to add to the hash
+ *
+ * @return the FNV-1a hash of the string, continuing from the given hash.
+ */
+static Uint64 hash_string(Uint64 hash, const char* data) {
+    if (data == nullptr) {
+        return hash;
+    }
+    for(const char* pos = data; *pos; pos++) {
+        hash ^= (Uint8)(*pos);
+        hash *= 0x100000001b3ULL;
+    }
+    // Separate consecutive strings
+    hash ^= 0xff;
+    hash *= 0x100000001b3ULL;
+    return hash;
+}
+
 #pragma mark -
 #pragma mark Compilation
 /**
@@ -67,6 +105,10 @@ bool Shader::compile() {
     CUAssertLog(!_fragSource.empty(), "Fragment shader source is not defined");
     CUAssertLog(!_program,   "This shader is already compiled");
     
+    if (loadBinary()) {
+        return true;
+    }
+    
     _program = glCreateProgram();
     if (!_program) {
         CULogError("Unable to allocate shader program");
@@ -100,6 +142,9 @@ bool Shader::compile() {
     // Now kiss
     glAttachShader( _program, _vertShader );
     glAttachShader( _program, _fragShader );
+    if (!_binarydir.empty()) {
+        glProgramParameteri( _program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+    }
     glLinkProgram( _program );
     
     //Check for errors
@@ -112,19 +157,173 @@ bool Shader::compile() {
         return false;
     }
     
+    saveBinary();
+    return true;
+}
+
+/**
+ * Returns the file storing the program binary for this shader.
+ *
+ * The file name is a hash of the shader sources and the OpenGL driver
+ * (vendor, renderer, and version). Hence a driver update invalidates
+ * all previously cached binaries. This method returns the empty string
+ * if the binary cache is disabled.
+ *
+ * @return the file storing the program binary for this shader.
+ */
+std::string Shader::getBinaryFile() const {
+    if (_binarydir.empty()) {
+        return "";
+    }
+    
+    Uint64 hash = 0xcbf29ce484222325ULL;
+    hash = hash_string(hash, _vertSource.c_str());
+    hash = hash_string(hash, _fragSource.c_str());
+    hash = hash_string(hash, (const char*)glGetString(GL_VENDOR));
+    hash = hash_string(hash, (const char*)glGetString(GL_RENDERER));
+    hash = hash_string(hash, (const char*)glGetString(GL_VERSION));
+    
+    char name[24];
+    std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+    return filetool::join_path({_binarydir, std::string(name)+BINARY_SUFFIX});
+}
+
+/**
+ * Returns true if this shader was loaded from a cached program binary.
+ *
+ * This method creates the shader program on success. If the binary is
+ * missing or is rejected by the driver, this method returns false and
+ * leaves the shader uncompiled.
+ *
+ * @return true if this shader was loaded from a cached program binary.
+ */
+bool Shader::loadBinary() {
+    std::string path = getBinaryFile();
+    if (path.empty() || !filetool::file_exists(path)) {
+        return false;
+    }
+    
+    SDL_RWops* stream = SDL_RWFromFile(path.c_str(), "rb");
+    if (stream == nullptr) {
+        return false;
+    }
+    
+    Uint32 header[3];
+    std::vector<Uint8> data;
+    bool valid = (SDL_RWread(stream, header, sizeof(Uint32), 3) == 3 && header[0] == BINARY_MAGIC);
+    if (valid) {
+        data.resize(header[2]);
+        valid = (header[2] > 0 && SDL_RWread(stream, data.data(), 1, header[2]) == header[2]);
+    }
+    SDL_RWclose(stream);
+    if (!valid) {
+        return false;
+    }
+    
+    _program = glCreateProgram();
+    if (!_program) {
+        return false;
+    }
+    
+    glProgramBinary(_program, (GLenum)header[1], data.data(), (GLsizei)header[2]);
+    GLint programSuccess = GL_FALSE;
+    glGetProgramiv( _program, GL_LINK_STATUS, &programSuccess );
+    if (programSuccess != GL_TRUE) {
+        // The driver rejected the binary; compile from source instead
+        glDeleteProgram(_program);
+        _program = 0;
+        filetool::file_delete(path);
+        return false;
+    }
     return true;
 }
 
+/**
+ * Saves the linked shader program to the binary cache.
+ *
+ * If the binary cache is disabled, or the driver does not support
+ * program binaries, this method does nothing.
+ */
+void Shader::saveBinary() {
+    std::string path = getBinaryFile();
+    if (path.empty()) {
+        return;
+    }
+    
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    GLint length = 0;
+    glGetProgramiv(_program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (formats <= 0 || length <= 0) {
+        return;
+    }
+    
+    std::vector<Uint8> data(length);
+    GLenum format = 0;
+    glGetProgramBinary(_program, length, &length, &format, data.data());
+    if (glGetError() != GL_NO_ERROR || length <= 0) {
+        return;
+    }
+    
+    SDL_RWops* stream = SDL_RWFromFile(path.c_str(), "wb");
+    if (stream == nullptr) {
+        CUWarn("Unable to cache shader binary '%s'.",path.c_str());
+        return;
+    }
+    
+    Uint32 header[3] = { BINARY_MAGIC, (Uint32)format, (Uint32)length };
+    bool valid = (SDL_RWwrite(stream, header, sizeof(Uint32), 3) == 3 &&
+                  SDL_RWwrite(stream, data.data(), 1, length) == (size_t)length);
+    SDL_RWclose(stream);
+    if (!valid) {
+        // Do not leave a truncated binary behind
+        filetool::file_delete(path);
+    }
+}
+
+/**
+ * Sets the directory for caching linked program binaries.
+ *
+ * When this directory is set, every shader first looks for a program
+ * binary matching its sources and the current OpenGL driver. If one
+ * exists and the driver accepts it, the shader skips compilation.
+ * Otherwise, the shader compiles from source and saves the linked
+ * binary for the next launch.
+ *
+ * The directory is created if it does not exist. Setting the directory
+ * to the empty string disables the cache. By default, {@link Application}
+ * sets this to a subdirectory of the save directory.
+ *
+ * @param dir   The directory for caching linked program binaries
+ */
+void Shader::setBinaryCache(const std::string dir) {
+    if (!dir.empty() && !filetool::is_dir(dir) && !filetool::dir_create(dir)) {
+        CUWarn("Unable to create shader cache '%s'.",dir.c_str());
+        _binarydir.clear();
+        return;
+    }
+    _binarydir = dir;
+}
+
 /**
  * Deletes the OpenGL shader and resets all attributes.
  *
  * You must reinitialize the shader to use it.
  */
 void Shader::dispose() {
-    glUseProgram(NULL);
-    if (_fragShader) { glDeleteShader(_fragShader); _fragShader = 0;}
-    if (_vertShader) { glDeleteShader(_vertShader); _vertShader = 0;}
-    if (_program) { glDeleteShader(_program); _program = 0;}
+    GLuint frag = _fragShader;
+    GLuint vert = _vertShader;
+    GLuint prog = _program;
+    RenderThread::post([=] {
+        glUseProgram(NULL);
+        if (frag) { glDeleteShader(frag); }
+        if (vert) { glDeleteShader(vert); }
+        if (prog) { glDeleteShader(prog); }
+    });
+    _fragShader = 0;
+    _vertShader = 0;
+    _program = 0;
+    _bound = 0;
     _vertSource.clear();
     _fragSource.clear();
 
@@ -134,6 +333,7 @@ void Shader::dispose() {
     _uniformtypes.clear();
     _uniformnames.clear();
     _uniformsizes.clear();
+    _uniformlocs.clear();
     _uniblocknames.clear();
     _uniblocksizes.clear();
     _uniblockfields.clear();
@@ -233,7 +433,7 @@ void Shader::cacheAttributes() {
     GLint size;     // size of the variable
     GLenum type;    // type of the variable (float, vec3 or mat4, etc)
 
-    const GLsizei bufSize = 16; // maximum name length
+    const GLsizei bufSize = 64; // maximum name length
     GLchar name[bufSize];       // variable name in GLSL
     GLsizei length;             // name length
     
@@ -261,7 +461,7 @@ void Shader::cacheUniforms() {
     GLint size;     // size of the variable
     GLenum type;    // type of the variable (float, vec3 or mat4, etc)
 
-    const GLsizei bufSize = 16; // maximum name length
+    const GLsizei bufSize = 64; // maximum name length
     GLchar name[bufSize];       // variable name in GLSL
     GLsizei length;             // name length
     
@@ -274,6 +474,12 @@ void Shader::cacheUniforms() {
             _uniformtypes[key] = type;
             _uniformsizes[key] = size;
             _uniformnames[ii]  = key;
+            
+            GLint locale = glGetUniformLocation(_program, name);
+            _uniformlocs[key] = locale;
+            if (key.size() > 3 && key.compare(key.size()-3, 3, "[0]") == 0) {
+                _uniformlocs[key.substr(0,key.size()-3)] = locale;
+            }
         }
     }
     
@@ -318,12 +524,20 @@ void Shader::cacheUniforms() {
 bool Shader::init(const std::string vsource, const std::string fsource) {
     _vertSource = vsource;
     _fragSource = fsource;
-    if (!compile()) {
+    
+    // Compilation returns values, so it cannot be deferred
+    bool success = false;
+    RenderThread::call([&] {
+        success = compile();
+        if (success) {
+            cacheAttributes();
+            cacheUniforms();
+        }
+    });
+    if (!success) {
         return false;
     }
     
-    cacheAttributes();
-    cacheUniforms();
     bind();
     return true;
 }
@@ -336,7 +550,9 @@ bool Shader::init(const std::string vsource, const std::string fsource) {
  */
 void Shader::bind() {
     CUAssertLog(_program, "Shader has not been initialized.");
-    glUseProgram( _program );
+    GLuint program = _program;
+    RenderThread::post([=] { glUseProgram( program ); });
+    _bound = _program;
 }
 
 /**
@@ -347,7 +563,8 @@ void Shader::bind() {
 void Shader::unbind() {
     CUAssertLog(_program, "Shader has not been initialized.");
     if (isBound()) {
-        glUseProgram( NULL );
+        RenderThread::post([=] { glUseProgram( NULL ); });
+        _bound = 0;
     }
 }
 
@@ -359,6 +576,11 @@ void Shader::unbind() {
  * @return true if this shader is currently bound.
  */
 bool Shader::isBound() const {
+    RenderThread* thread = RenderThread::get();
+    if (thread != nullptr && !thread->isRenderThread()) {
+        // Querying OpenGL would stall the render thread
+        return _bound == _program;
+    }
     GLint prog;
     glGetIntegerv(GL_CURRENT_PROGRAM,&prog);
     return prog == _program;
@@ -390,7 +612,9 @@ std::vector<std::string> Shader::getAttributes() const {
  * @return the program offset of the given attribute
  */
 GLint Shader::getAttributeLocation(const std::string name) const {
-    return glGetAttribLocation(_program,name.c_str());
+    GLint result = -1;
+    RenderThread::call([&] { result = glGetAttribLocation(_program,name.c_str()); });
+    return result;
 }
 
 /**
@@ -447,7 +671,9 @@ GLenum Shader::getAttributeType(const std::string name) const  {
  * @return the program offset of the given output variable.
  */
 GLint Shader::getOutputLocation(const std::string name) const {
-    return glGetFragDataLocation(_program, name.c_str());
+    GLint result = -1;
+    RenderThread::call([&] { result = glGetFragDataLocation(_program, name.c_str()); });
+    return result;
 }
 
 
@@ -475,8 +701,17 @@ std::vector<std::string> Shader::getUniforms() const {
  *
  * @return the program offset of the given uniform
  */
-GLint Shader::getUniformLocation(const std::string name) const {
-    return glGetUniformLocation(_program,name.c_str());
+GLint Shader::getUniformLocation(const std::string& name) const {
+    auto search = _uniformlocs.find(name);
+    if (search != _uniformlocs.end()) {
+        return search->second;
+    } else if (name.find('[') != std::string::npos) {
+        // Only the first element of an array is cached
+        GLint result = -1;
+        RenderThread::call([&] { result = glGetUniformLocation(_program,name.c_str()); });
+        return result;
+    }
+    return -1;
 }
 
 /**
@@ -549,7 +784,8 @@ std::vector<std::string> Shader::getSamplers() const {
  * @return the program offset of the given sampler variable
  */
 GLint Shader::getSamplerLocation(const std::string name) const {
-    GLint result =  glGetUniformLocation(_program,name.c_str());
+    GLint result = -1;
+    RenderThread::call([&] { result = glGetUniformLocation(_program,name.c_str()); });
     if (result != -1 && _uniformtypes.at(name) != GL_SAMPLER_2D) {
         result = -1;
     }
@@ -731,7 +967,8 @@ std::vector<std::string> Shader::getUniformsForBlock(GLint pos) const {
  */
 std::vector<std::string> Shader::getUniformsForBlock(std::string name) const {
     std::vector<std::string> result;
-    GLuint index = glGetUniformBlockIndex(_program, name.c_str());
+    GLuint index = GL_INVALID_INDEX;
+    RenderThread::call([&] { index = glGetUniformBlockIndex(_program, name.c_str()); });
     if (index == GL_INVALID_INDEX) {
         return result;
     }
@@ -757,7 +994,8 @@ std::vector<std::string> Shader::getUniformsForBlock(std::string name) const {
  * @param bpoint   The bindpoint for the uniform block
  */
 void Shader::setUniformBlock(GLint pos, GLuint bindpoint) {
-    glUniformBlockBinding(_program, pos, bindpoint);
+    GLuint program = _program;
+    RenderThread::post([=] { glUniformBlockBinding(program, pos, bindpoint); });
 }
 
 /**
@@ -774,9 +1012,10 @@ void Shader::setUniformBlock(GLint pos, GLuint bindpoint) {
  * @param bpoint   The bindpoint for the uniform block
  */
 void Shader::setUniformBlock(const std::string name, GLuint bindpoint) {
-    GLuint index = glGetUniformBlockIndex(_program, name.c_str());
+    GLuint index = GL_INVALID_INDEX;
+    RenderThread::call([&] { index = glGetUniformBlockIndex(_program, name.c_str()); });
     if (index != GL_INVALID_INDEX) {
-        glUniformBlockBinding(_program, index, bindpoint);
+        setUniformBlock(index, bindpoint);
     }
 }
 
@@ -829,7 +1068,8 @@ void Shader::setUniformBlock(GLint pos, const std::shared_ptr<UniformBuffer>& bu
     }
     
     // Now bind
-    glUniformBlockBinding(_program, pos, bpoint);
+    GLuint program = _program;
+    RenderThread::post([=] { glUniformBlockBinding(program, pos, bpoint); });
 }
 
 /**
@@ -852,7 +1092,8 @@ void Shader::setUniformBlock(GLint pos, const std::shared_ptr<UniformBuffer>& bu
  */
 void Shader::setUniformBlock(const std::string name,
                              const std::shared_ptr<UniformBuffer>& buffer) {
-    GLuint index = glGetUniformBlockIndex(_program, name.c_str());
+    GLuint index = GL_INVALID_INDEX;
+    RenderThread::call([&] { index = glGetUniformBlockIndex(_program, name.c_str()); });
     if (index != GL_INVALID_INDEX) {
         setUniformBlock(index, buffer);
     }
@@ -870,8 +1111,10 @@ void Shader::setUniformBlock(const std::string name,
  * @return the buffer bindpoint associated with the given uniform block.
  */
 GLuint Shader::getUniformBlock(GLint pos) const {
-    GLint block;
-    glGetActiveUniformBlockiv(_program,pos,GL_UNIFORM_BLOCK_BINDING,&block);
+    GLint block = 0;
+    RenderThread::call([&] {
+        glGetActiveUniformBlockiv(_program,pos,GL_UNIFORM_BLOCK_BINDING,&block);
+    });
     return block;
 }
 
@@ -887,13 +1130,13 @@ GLuint Shader::getUniformBlock(GLint pos) const {
  * @return the buffer bindpoint associated with the given uniform block.
  */
 GLuint Shader::getUniformBlock(const std::string name) const {
-    GLuint index = glGetUniformBlockIndex(_program, name.c_str());
-    if (index == GL_INVALID_INDEX) {
-        return 0;
-    }
-    
-    GLint block;
-    glGetActiveUniformBlockiv(_program,index,GL_UNIFORM_BLOCK_BINDING,&block);
+    GLint block = 0;
+    RenderThread::call([&] {
+        GLuint index = glGetUniformBlockIndex(_program, name.c_str());
+        if (index != GL_INVALID_INDEX) {
+            glGetActiveUniformBlockiv(_program,index,GL_UNIFORM_BLOCK_BINDING,&block);
+        }
+    });
     return block;
 }
 
@@ -910,7 +1153,7 @@ GLuint Shader::getUniformBlock(const std::string name) const {
  */
 void Shader::setUniformVec2(GLint pos, const Vec2 vec) {
     CUAssertLog(isBound(), "Shader is not active.");
-    glUniform2f(pos,vec.x,vec.y);
+    RenderThread::post([=] { glUniform2f(pos,vec.x,vec.y); });
 }
 
 /**
@@ -923,8 +1166,8 @@ void Shader::setUniformVec2(GLint pos, const Vec2 vec) {
  */
 void Shader::setUniformVec2(const std::string name, const Vec2 vec) {
     CUAssertLog(isBound(), "Shader is not active.");
-    GLint locale = getUniformLocation(name.c_str());
-    if (locale >= 0) glUniform2f(locale,vec.x,vec.y);
+    GLint locale = getUniformLocation(name);
+    if (locale >= 0) RenderThread::post([=] { glUniform2f(locale,vec.x,vec.y); });
 }
 
 /**
@@ -969,7 +1212,7 @@ bool Shader::getUniformVec2(const std::string name, Vec2& vec) const {
  */
 void Shader::setUniformVec3(GLint pos, const Vec3 vec) {
     CUAssertLog(isBound(), "Shader is not active.");
-    glUniform3f(pos,vec.x,vec.y,vec.z);
+    RenderThread::post([=] { glUniform3f(pos,vec.x,vec.y,vec.z); });
 }
 
 /**
@@ -982,8 +1225,8 @@ void Shader::setUniformVec3(GLint pos, const Vec3 vec) {
  */
 void Shader::setUniformVec3(const std::string name, const Vec3 vec) {
     CUAssertLog(isBound(), "Shader is not active.");
-    GLint locale = getUniformLocation(name.c_str());
-    if (locale >= 0) glUniform3f(locale,vec.x,vec.y,vec.z);
+    GLint locale = getUniformLocation(name);
+    if (locale >= 0) RenderThread::post([=] { glUniform3f(locale,vec.x,vec.y,vec.z); });
 }
 
 /**
@@ -1028,7 +1271,7 @@ bool Shader::getUniformVec3(const std::string name, Vec3& vec) const {
  */
 void Shader::setUniformVec4(GLint pos, const Vec4 vec) {
     CUAssertLog(isBound(), "Shader is not active.");
-    glUniform4f(pos,vec.x,vec.y,vec.z,vec.w);
+    RenderThread::post([=] { glUniform4f(pos,vec.x,vec.y,vec.z,vec.w); });
 }
 
 /**
@@ -1041,8 +1284,8 @@ void Shader::setUniformVec4(GLint pos, const Vec4 vec) {
  */
 void Shader::setUniformVec4(const std::string name, const Vec4 vec) {
     CUAssertLog(isBound(), "Shader is not active.");
-    GLint locale = getUniformLocation(name.c_str());
-    if (locale >= 0) glUniform4f(locale,vec.x,vec.y,vec.z,vec.w);
+    GLint locale = getUniformLocation(name);
+    if (locale >= 0) RenderThread::post([=] { glUniform4f(locale,vec.x,vec.y,vec.z,vec.w); });
 }
 
 /**
@@ -1206,7 +1449,7 @@ bool Shader::getUniformColor4f(const std::string name, Color4f& color) const {
  */
 void Shader::setUniformMat4(GLint pos, const Mat4& mat) {
     CUAssertLog(isBound(), "Shader is not active.");
-    glUniformMatrix4fv(pos,1,false,mat.m);
+    RenderThread::post([=] { glUniformMatrix4fv(pos,1,false,mat.m); });
 }
 
 /**
@@ -1221,8 +1464,8 @@ void Shader::setUniformMat4(GLint pos, const Mat4& mat) {
  */
 void Shader::setUniformMat4(const std::string name, const Mat4& mat) {
     CUAssertLog(isBound(), "Shader is not active.");
-    GLint locale = getUniformLocation(name.c_str());
-    if (locale >= 0) glUniformMatrix4fv(locale,1,false,mat.m);
+    GLint locale = getUniformLocation(name);
+    if (locale >= 0) RenderThread::post([=] { glUniformMatrix4fv(locale,1,false,mat.m); });
 }
 
 /**
@@ -1270,7 +1513,7 @@ void Shader::setUniformAffine2(GLint pos, const Affine2& mat) {
     CUAssertLog(isBound(), "Shader is not active.");
     float data[9];
     mat.get3x3(data);
-    glUniformMatrix3fv(pos,1,false,data);
+    RenderThread::post([=] { glUniformMatrix3fv(pos,1,false,data); });
 }
 
 /**
@@ -1286,11 +1529,11 @@ void Shader::setUniformAffine2(GLint pos, const Affine2& mat) {
  */
 void Shader::setUniformAffine2(const std::string name, const Affine2& mat) {
     CUAssertLog(isBound(), "Shader is not active.");
-    GLint locale = getUniformLocation(name.c_str());
+    GLint locale = getUniformLocation(name);
     if (locale >= 0) {
         float data[9];
         mat.get3x3(data);
-        glUniformMatrix3fv(locale,1,false,data);
+        RenderThread::post([=] { glUniformMatrix3fv(locale,1,false,data); });
     }
 }
 
@@ -1405,7 +1648,7 @@ bool Shader::getUniformQuaternion(const std::string name, Quaternion& quat) cons
  */
 void Shader::setUniform1f(GLint pos, GLfloat v0) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniform1f(pos, v0);
+	RenderThread::post([=] { glUniform1f(pos, v0); });
 }
 
 /**
@@ -1420,8 +1663,8 @@ void Shader::setUniform1f(GLint pos, GLfloat v0) {
  */
 void Shader::setUniform1f(const std::string name, GLfloat v0) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniform1f(locale, v0);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) RenderThread::post([=] { glUniform1f(locale, v0); });
 }
 
 /**
@@ -1435,7 +1678,7 @@ void Shader::setUniform1f(const std::string name, GLfloat v0) {
  */
 void Shader::setUniform2f(GLint pos, GLfloat v0, GLfloat v1) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniform2f(pos, v0, v1);
+	RenderThread::post([=] { glUniform2f(pos, v0, v1); });
 }
 
 /**
@@ -1451,8 +1694,8 @@ void Shader::setUniform2f(GLint pos, GLfloat v0, GLfloat v1) {
  */
 void Shader::setUniform2f(const std::string name, GLfloat v0, GLfloat v1) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniform2f(locale, v0, v1);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) RenderThread::post([=] { glUniform2f(locale, v0, v1); });
 }
 
 /**
@@ -1467,7 +1710,7 @@ void Shader::setUniform2f(const std::string name, GLfloat v0, GLfloat v1) {
  */
 void Shader::setUniform3f(GLint pos, GLfloat v0, GLfloat v1, GLfloat v2) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniform3f(pos, v0, v1, v2);
+	RenderThread::post([=] { glUniform3f(pos, v0, v1, v2); });
 }
 
 /**
@@ -1484,8 +1727,8 @@ void Shader::setUniform3f(GLint pos, GLfloat v0, GLfloat v1, GLfloat v2) {
  */
 void Shader::setUniform3f(const std::string name, GLfloat v0, GLfloat v1, GLfloat v2) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniform3f(locale, v0, v1, v2);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) RenderThread::post([=] { glUniform3f(locale, v0, v1, v2); });
 }
 
 /**
@@ -1501,7 +1744,7 @@ void Shader::setUniform3f(const std::string name, GLfloat v0, GLfloat v1, GLfloa
  */
 void Shader::setUniform4f(GLint pos, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniform4f(pos, v0, v1, v2, v3);
+	RenderThread::post([=] { glUniform4f(pos, v0, v1, v2, v3); });
 }
 
 /**
@@ -1519,8 +1762,8 @@ void Shader::setUniform4f(GLint pos, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat
  */
 void Shader::setUniform4f(const std::string name, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniform4f(locale, v0, v1, v2, v3);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) RenderThread::post([=] { glUniform4f(locale, v0, v1, v2, v3); });
 }
 
 /**
@@ -1533,7 +1776,7 @@ void Shader::setUniform4f(const std::string name, GLfloat v0, GLfloat v1, GLfloa
  */
 void Shader::setUniform1i(GLint pos, GLint v0) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniform1i(pos, v0);
+	RenderThread::post([=] { glUniform1i(pos, v0); });
 }
 
 /**
@@ -1548,8 +1791,8 @@ void Shader::setUniform1i(GLint pos, GLint v0) {
  */
 void Shader::setUniform1i(const std::string name, GLint v0) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniform1i(locale, v0);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) RenderThread::post([=] { glUniform1i(locale, v0); });
 }
 
 /**
@@ -1563,7 +1806,7 @@ void Shader::setUniform1i(const std::string name, GLint v0) {
  */
 void Shader::setUniform2i(GLint pos, GLint v0, GLint v1) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniform2i(pos, v0, v1);
+	RenderThread::post([=] { glUniform2i(pos, v0, v1); });
 }
 
 /**
@@ -1579,8 +1822,8 @@ void Shader::setUniform2i(GLint pos, GLint v0, GLint v1) {
  */
 void Shader::setUniform2i(const std::string name, GLint v0, GLint v1) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniform2i(locale, v0, v1);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) RenderThread::post([=] { glUniform2i(locale, v0, v1); });
 }
 
 /**
@@ -1595,7 +1838,7 @@ void Shader::setUniform2i(const std::string name, GLint v0, GLint v1) {
  */
 void Shader::setUniform3i(GLint pos, GLint v0, GLint v1, GLint v2) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniform3i(pos, v0, v1, v2);
+	RenderThread::post([=] { glUniform3i(pos, v0, v1, v2); });
 }
 
 /**
@@ -1612,8 +1855,8 @@ void Shader::setUniform3i(GLint pos, GLint v0, GLint v1, GLint v2) {
  */
 void Shader::setUniform3i(const std::string name, GLint v0, GLint v1, GLint v2) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniform3i(locale, v0, v1, v2);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) RenderThread::post([=] { glUniform3i(locale, v0, v1, v2); });
 }
 
 /**
@@ -1629,7 +1872,7 @@ void Shader::setUniform3i(const std::string name, GLint v0, GLint v1, GLint v2)
  */
 void Shader::setUniform4i(GLint pos, GLint v0, GLint v1, GLint v2, GLint v3) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniform4i(pos, v0, v1, v2, v3);
+	RenderThread::post([=] { glUniform4i(pos, v0, v1, v2, v3); });
 }
 
 /**
@@ -1647,8 +1890,8 @@ void Shader::setUniform4i(GLint pos, GLint v0, GLint v1, GLint v2, GLint v3) {
  */
 void Shader::setUniform4i(const std::string name, GLint v0, GLint v1, GLint v2, GLint v3) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniform4i(locale, v0, v1, v2, v3);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) RenderThread::post([=] { glUniform4i(locale, v0, v1, v2, v3); });
 }
 
 /**
@@ -1661,7 +1904,7 @@ void Shader::setUniform4i(const std::string name, GLint v0, GLint v1, GLint v2,
  */
 void Shader::setUniform1ui(GLint pos, GLuint v0) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniform1ui(pos, v0);
+	RenderThread::post([=] { glUniform1ui(pos, v0); });
 }
 
 /**
@@ -1676,8 +1919,8 @@ void Shader::setUniform1ui(GLint pos, GLuint v0) {
  */
 void Shader::setUniform1ui(const std::string name, GLuint v0) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniform1ui(locale, v0);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) RenderThread::post([=] { glUniform1ui(locale, v0); });
 }
 
 /**
@@ -1691,7 +1934,7 @@ void Shader::setUniform1ui(const std::string name, GLuint v0) {
  */
 void Shader::setUniform2ui(GLint pos, GLuint v0, GLuint v1) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniform2ui(pos, v0, v1);
+	RenderThread::post([=] { glUniform2ui(pos, v0, v1); });
 }
 
 /**
@@ -1707,8 +1950,8 @@ void Shader::setUniform2ui(GLint pos, GLuint v0, GLuint v1) {
  */
 void Shader::setUniform2ui(const std::string name, GLuint v0, GLuint v1) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniform2ui(locale, v0, v1);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) RenderThread::post([=] { glUniform2ui(locale, v0, v1); });
 }
 
 /**
@@ -1723,7 +1966,7 @@ void Shader::setUniform2ui(const std::string name, GLuint v0, GLuint v1) {
  */
 void Shader::setUniform3ui(GLint pos, GLuint v0, GLuint v1, GLuint v2) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniform3ui(pos, v0, v1, v2);
+	RenderThread::post([=] { glUniform3ui(pos, v0, v1, v2); });
 }
 
 /**
@@ -1740,8 +1983,8 @@ void Shader::setUniform3ui(GLint pos, GLuint v0, GLuint v1, GLuint v2) {
  */
 void Shader::setUniform3ui(const std::string name, GLuint v0, GLuint v1, GLuint v2) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniform3ui(locale, v0, v1, v2);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) RenderThread::post([=] { glUniform3ui(locale, v0, v1, v2); });
 }
 
 /**
@@ -1757,7 +2000,7 @@ void Shader::setUniform3ui(const std::string name, GLuint v0, GLuint v1, GLuint
  */
 void Shader::setUniform4ui(GLint pos, GLuint v0, GLuint v1, GLuint v2, GLuint v3) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniform4ui(pos, v0, v1, v2, v3);
+	RenderThread::post([=] { glUniform4ui(pos, v0, v1, v2, v3); });
 }
 
 /**
@@ -1775,8 +2018,8 @@ void Shader::setUniform4ui(GLint pos, GLuint v0, GLuint v1, GLuint v2, GLuint v3
  */
 void Shader::setUniform4ui(const std::string name, GLuint v0, GLuint v1, GLuint v2, GLuint v3) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniform4ui(locale, v0, v1, v2, v3);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) RenderThread::post([=] { glUniform4ui(locale, v0, v1, v2, v3); });
 }
 
 /**
@@ -1790,7 +2033,8 @@ void Shader::setUniform4ui(const std::string name, GLuint v0, GLuint v1, GLuint
  */
 void Shader::setUniform1fv(GLint pos, GLsizei count, const GLfloat *value) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniform1fv(pos, count, value);
+	std::vector<GLfloat> data(value, value+count);
+	RenderThread::post([=] { glUniform1fv(pos, count, data.data()); });
 }
 
 /**
@@ -1806,8 +2050,11 @@ void Shader::setUniform1fv(GLint pos, GLsizei count, const GLfloat *value) {
  */
 void Shader::setUniform1fv(const std::string name, GLsizei count, const GLfloat *value) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniform1fv(locale, count, value);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) {
+		std::vector<GLfloat> data(value, value+count);
+		RenderThread::post([=] { glUniform1fv(locale, count, data.data()); });
+	}
 }
 
 /**
@@ -1821,7 +2068,8 @@ void Shader::setUniform1fv(const std::string name, GLsizei count, const GLfloat
  */
 void Shader::setUniform2fv(GLint pos, GLsizei count, const GLfloat *value) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniform2fv(pos, count, value);
+	std::vector<GLfloat> data(value, value+count*2);
+	RenderThread::post([=] { glUniform2fv(pos, count, data.data()); });
 }
 
 /**
@@ -1837,8 +2085,11 @@ void Shader::setUniform2fv(GLint pos, GLsizei count, const GLfloat *value) {
  */
 void Shader::setUniform2fv(const std::string name, GLsizei count, const GLfloat *value) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniform2fv(locale, count, value);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) {
+		std::vector<GLfloat> data(value, value+count*2);
+		RenderThread::post([=] { glUniform2fv(locale, count, data.data()); });
+	}
 }
 
 /**
@@ -1852,7 +2103,8 @@ void Shader::setUniform2fv(const std::string name, GLsizei count, const GLfloat
  */
 void Shader::setUniform3fv(GLint pos, GLsizei count, const GLfloat *value) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniform3fv(pos, count, value);
+	std::vector<GLfloat> data(value, value+count*3);
+	RenderThread::post([=] { glUniform3fv(pos, count, data.data()); });
 }
 
 /**
@@ -1868,8 +2120,11 @@ void Shader::setUniform3fv(GLint pos, GLsizei count, const GLfloat *value) {
  */
 void Shader::setUniform3fv(const std::string name, GLsizei count, const GLfloat *value) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniform3fv(locale, count, value);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) {
+		std::vector<GLfloat> data(value, value+count*3);
+		RenderThread::post([=] { glUniform3fv(locale, count, data.data()); });
+	}
 }
 
 /**
@@ -1883,7 +2138,8 @@ void Shader::setUniform3fv(const std::string name, GLsizei count, const GLfloat
  */
 void Shader::setUniform4fv(GLint pos, GLsizei count, const GLfloat *value) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniform4fv(pos, count, value);
+	std::vector<GLfloat> data(value, value+count*4);
+	RenderThread::post([=] { glUniform4fv(pos, count, data.data()); });
 }
 
 /**
@@ -1899,8 +2155,11 @@ void Shader::setUniform4fv(GLint pos, GLsizei count, const GLfloat *value) {
  */
 void Shader::setUniform4fv(const std::string name, GLsizei count, const GLfloat *value) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniform4fv(locale, count, value);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) {
+		std::vector<GLfloat> data(value, value+count*4);
+		RenderThread::post([=] { glUniform4fv(locale, count, data.data()); });
+	}
 }
 
 /**
@@ -1914,7 +2173,8 @@ void Shader::setUniform4fv(const std::string name, GLsizei count, const GLfloat
  */
 void Shader::setUniform1iv(GLint pos, GLsizei count, const GLint *value) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniform1iv(pos, count, value);
+	std::vector<GLint> data(value, value+count);
+	RenderThread::post([=] { glUniform1iv(pos, count, data.data()); });
 }
 
 /**
@@ -1930,8 +2190,11 @@ void Shader::setUniform1iv(GLint pos, GLsizei count, const GLint *value) {
  */
 void Shader::setUniform1iv(const std::string name, GLsizei count, const GLint *value) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniform1iv(locale, count, value);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) {
+		std::vector<GLint> data(value, value+count);
+		RenderThread::post([=] { glUniform1iv(locale, count, data.data()); });
+	}
 }
 
 /**
@@ -1945,7 +2208,8 @@ void Shader::setUniform1iv(const std::string name, GLsizei count, const GLint *v
  */
 void Shader::setUniform2iv(GLint pos, GLsizei count, const GLint *value) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniform2iv(pos, count, value);
+	std::vector<GLint> data(value, value+count*2);
+	RenderThread::post([=] { glUniform2iv(pos, count, data.data()); });
 }
 
 /**
@@ -1961,8 +2225,11 @@ void Shader::setUniform2iv(GLint pos, GLsizei count, const GLint *value) {
  */
 void Shader::setUniform2iv(const std::string name, GLsizei count, const GLint *value) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniform2iv(locale, count, value);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) {
+		std::vector<GLint> data(value, value+count*2);
+		RenderThread::post([=] { glUniform2iv(locale, count, data.data()); });
+	}
 }
 
 /**
@@ -1976,7 +2243,8 @@ void Shader::setUniform2iv(const std::string name, GLsizei count, const GLint *v
  */
 void Shader::setUniform3iv(GLint pos, GLsizei count, const GLint *value) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniform3iv(pos, count, value);
+	std::vector<GLint> data(value, value+count*3);
+	RenderThread::post([=] { glUniform3iv(pos, count, data.data()); });
 }
 
 /**
@@ -1992,8 +2260,11 @@ void Shader::setUniform3iv(GLint pos, GLsizei count, const GLint *value) {
  */
 void Shader::setUniform3iv(const std::string name, GLsizei count, const GLint *value) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniform3iv(locale, count, value);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) {
+		std::vector<GLint> data(value, value+count*3);
+		RenderThread::post([=] { glUniform3iv(locale, count, data.data()); });
+	}
 }
 
 /**
@@ -2007,7 +2278,8 @@ void Shader::setUniform3iv(const std::string name, GLsizei count, const GLint *v
  */
 void Shader::setUniform4iv(GLint pos, GLsizei count, const GLint *value) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniform4iv(pos, count, value);
+	std::vector<GLint> data(value, value+count*4);
+	RenderThread::post([=] { glUniform4iv(pos, count, data.data()); });
 }
 
 /**
@@ -2023,8 +2295,11 @@ void Shader::setUniform4iv(GLint pos, GLsizei count, const GLint *value) {
  */
 void Shader::setUniform4iv(const std::string name, GLsizei count, const GLint *value) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniform4iv(locale, count, value);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) {
+		std::vector<GLint> data(value, value+count*4);
+		RenderThread::post([=] { glUniform4iv(locale, count, data.data()); });
+	}
 }
 
 /**
@@ -2038,7 +2313,8 @@ void Shader::setUniform4iv(const std::string name, GLsizei count, const GLint *v
  */
 void Shader::setUniform1uiv(GLint pos, GLsizei count, const GLuint *value) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniform1uiv(pos, count, value);
+	std::vector<GLuint> data(value, value+count);
+	RenderThread::post([=] { glUniform1uiv(pos, count, data.data()); });
 }
 
 /**
@@ -2054,8 +2330,11 @@ void Shader::setUniform1uiv(GLint pos, GLsizei count, const GLuint *value) {
  */
 void Shader::setUniform1uiv(const std::string name, GLsizei count, const GLuint *value) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniform1uiv(locale, count, value);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) {
+		std::vector<GLuint> data(value, value+count);
+		RenderThread::post([=] { glUniform1uiv(locale, count, data.data()); });
+	}
 }
 
 /**
@@ -2069,7 +2348,8 @@ void Shader::setUniform1uiv(const std::string name, GLsizei count, const GLuint
  */
 void Shader::setUniform2uiv(GLint pos, GLsizei count, const GLuint *value) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniform2uiv(pos, count, value);
+	std::vector<GLuint> data(value, value+count*2);
+	RenderThread::post([=] { glUniform2uiv(pos, count, data.data()); });
 }
 
 /**
@@ -2085,8 +2365,11 @@ void Shader::setUniform2uiv(GLint pos, GLsizei count, const GLuint *value) {
  */
 void Shader::setUniform2uiv(const std::string name, GLsizei count, const GLuint *value) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniform2uiv(locale, count, value);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) {
+		std::vector<GLuint> data(value, value+count*2);
+		RenderThread::post([=] { glUniform2uiv(locale, count, data.data()); });
+	}
 }
 
 /**
@@ -2100,7 +2383,8 @@ void Shader::setUniform2uiv(const std::string name, GLsizei count, const GLuint
  */
 void Shader::setUniform3uiv(GLint pos, GLsizei count, const GLuint *value) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniform3uiv(pos, count, value);
+	std::vector<GLuint> data(value, value+count*3);
+	RenderThread::post([=] { glUniform3uiv(pos, count, data.data()); });
 }
 
 /**
@@ -2116,8 +2400,11 @@ void Shader::setUniform3uiv(GLint pos, GLsizei count, const GLuint *value) {
  */
 void Shader::setUniform3uiv(const std::string name, GLsizei count, const GLuint *value) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniform3uiv(locale, count, value);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) {
+		std::vector<GLuint> data(value, value+count*3);
+		RenderThread::post([=] { glUniform3uiv(locale, count, data.data()); });
+	}
 }
 
 /**
@@ -2131,7 +2418,8 @@ void Shader::setUniform3uiv(const std::string name, GLsizei count, const GLuint
  */
 void Shader::setUniform4uiv(GLint pos, GLsizei count, const GLuint *value) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniform4uiv(pos, count, value);
+	std::vector<GLuint> data(value, value+count*4);
+	RenderThread::post([=] { glUniform4uiv(pos, count, data.data()); });
 }
 
 /**
@@ -2147,8 +2435,11 @@ void Shader::setUniform4uiv(GLint pos, GLsizei count, const GLuint *value) {
  */
 void Shader::setUniform4uiv(const std::string name, GLsizei count, const GLuint *value) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniform4uiv(locale, count, value);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) {
+		std::vector<GLuint> data(value, value+count*4);
+		RenderThread::post([=] { glUniform4uiv(locale, count, data.data()); });
+	}
 }
 
 /**
@@ -2163,7 +2454,8 @@ void Shader::setUniform4uiv(const std::string name, GLsizei count, const GLuint
  */
 void Shader::setUniformMatrix2fv(GLint pos, GLsizei count, const GLfloat *value, GLboolean tpose) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniformMatrix2fv(pos, count, tpose, value);
+	std::vector<GLfloat> data(value, value+count*4);
+	RenderThread::post([=] { glUniformMatrix2fv(pos, count, tpose, data.data()); });
 }
 
 /**
@@ -2180,8 +2472,11 @@ void Shader::setUniformMatrix2fv(GLint pos, GLsizei count, const GLfloat *value,
  */
 void Shader::setUniformMatrix2fv(const std::string name, GLsizei count, const GLfloat *value, GLboolean tpose) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniformMatrix2fv(locale, count, tpose, value);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) {
+		std::vector<GLfloat> data(value, value+count*4);
+		RenderThread::post([=] { glUniformMatrix2fv(locale, count, tpose, data.data()); });
+	}
 }
 
 /**
@@ -2196,7 +2491,8 @@ void Shader::setUniformMatrix2fv(const std::string name, GLsizei count, const GL
  */
 void Shader::setUniformMatrix3fv(GLint pos, GLsizei count, const GLfloat *value, GLboolean tpose) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniformMatrix3fv(pos, count, tpose, value);
+	std::vector<GLfloat> data(value, value+count*9);
+	RenderThread::post([=] { glUniformMatrix3fv(pos, count, tpose, data.data()); });
 }
 
 /**
@@ -2213,8 +2509,11 @@ void Shader::setUniformMatrix3fv(GLint pos, GLsizei count, const GLfloat *value,
  */
 void Shader::setUniformMatrix3fv(const std::string name, GLsizei count, const GLfloat *value, GLboolean tpose) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniformMatrix3fv(locale, count, tpose, value);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) {
+		std::vector<GLfloat> data(value, value+count*9);
+		RenderThread::post([=] { glUniformMatrix3fv(locale, count, tpose, data.data()); });
+	}
 }
 
 /**
@@ -2229,7 +2528,8 @@ void Shader::setUniformMatrix3fv(const std::string name, GLsizei count, const GL
  */
 void Shader::setUniformMatrix4fv(GLint pos, GLsizei count, const GLfloat *value, GLboolean tpose) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniformMatrix4fv(pos, count, tpose, value);
+	std::vector<GLfloat> data(value, value+count*16);
+	RenderThread::post([=] { glUniformMatrix4fv(pos, count, tpose, data.data()); });
 }
 
 /**
@@ -2246,8 +2546,11 @@ void Shader::setUniformMatrix4fv(GLint pos, GLsizei count, const GLfloat *value,
  */
 void Shader::setUniformMatrix4fv(const std::string name, GLsizei count, const GLfloat *value, GLboolean tpose) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniformMatrix4fv(locale, count, tpose, value);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) {
+		std::vector<GLfloat> data(value, value+count*16);
+		RenderThread::post([=] { glUniformMatrix4fv(locale, count, tpose, data.data()); });
+	}
 }
 
 /**
@@ -2262,7 +2565,8 @@ void Shader::setUniformMatrix4fv(const std::string name, GLsizei count, const GL
  */
 void Shader::setUniformMatrix2x3fv(GLint pos, GLsizei count, const GLfloat *value, GLboolean tpose) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniformMatrix2x3fv(pos, count, tpose, value);
+	std::vector<GLfloat> data(value, value+count*6);
+	RenderThread::post([=] { glUniformMatrix2x3fv(pos, count, tpose, data.data()); });
 }
 
 /**
@@ -2279,8 +2583,11 @@ void Shader::setUniformMatrix2x3fv(GLint pos, GLsizei count, const GLfloat *valu
  */
 void Shader::setUniformMatrix2x3fv(const std::string name, GLsizei count, const GLfloat *value, GLboolean tpose) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniformMatrix2x3fv(locale, count, tpose, value);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) {
+		std::vector<GLfloat> data(value, value+count*6);
+		RenderThread::post([=] { glUniformMatrix2x3fv(locale, count, tpose, data.data()); });
+	}
 }
 
 /**
@@ -2295,7 +2602,8 @@ void Shader::setUniformMatrix2x3fv(const std::string name, GLsizei count, const
  */
 void Shader::setUniformMatrix3x2fv(GLint pos, GLsizei count, const GLfloat *value, GLboolean tpose) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniformMatrix3x2fv(pos, count, tpose, value);
+	std::vector<GLfloat> data(value, value+count*6);
+	RenderThread::post([=] { glUniformMatrix3x2fv(pos, count, tpose, data.data()); });
 }
 
 /**
@@ -2312,8 +2620,11 @@ void Shader::setUniformMatrix3x2fv(GLint pos, GLsizei count, const GLfloat *valu
  */
 void Shader::setUniformMatrix3x2fv(const std::string name, GLsizei count, const GLfloat *value, GLboolean tpose) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniformMatrix3x2fv(locale, count, tpose, value);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) {
+		std::vector<GLfloat> data(value, value+count*6);
+		RenderThread::post([=] { glUniformMatrix3x2fv(locale, count, tpose, data.data()); });
+	}
 }
 
 /**
@@ -2328,7 +2639,8 @@ void Shader::setUniformMatrix3x2fv(const std::string name, GLsizei count, const
  */
 void Shader::setUniformMatrix2x4fv(GLint pos, GLsizei count, const GLfloat *value, GLboolean tpose) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniformMatrix2x4fv(pos, count, tpose, value);
+	std::vector<GLfloat> data(value, value+count*8);
+	RenderThread::post([=] { glUniformMatrix2x4fv(pos, count, tpose, data.data()); });
 }
 
 /**
@@ -2345,8 +2657,11 @@ void Shader::setUniformMatrix2x4fv(GLint pos, GLsizei count, const GLfloat *valu
  */
 void Shader::setUniformMatrix2x4fv(const std::string name, GLsizei count, const GLfloat *value, GLboolean tpose) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniformMatrix2x4fv(locale, count, tpose, value);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) {
+		std::vector<GLfloat> data(value, value+count*8);
+		RenderThread::post([=] { glUniformMatrix2x4fv(locale, count, tpose, data.data()); });
+	}
 }
 
 /**
@@ -2361,7 +2676,8 @@ void Shader::setUniformMatrix2x4fv(const std::string name, GLsizei count, const
  */
 void Shader::setUniformMatrix4x2fv(GLint pos, GLsizei count, const GLfloat *value, GLboolean tpose) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniformMatrix4x2fv(pos, count, tpose, value);
+	std::vector<GLfloat> data(value, value+count*8);
+	RenderThread::post([=] { glUniformMatrix4x2fv(pos, count, tpose, data.data()); });
 }
 
 /**
@@ -2378,8 +2694,11 @@ void Shader::setUniformMatrix4x2fv(GLint pos, GLsizei count, const GLfloat *valu
  */
 void Shader::setUniformMatrix4x2fv(const std::string name, GLsizei count, const GLfloat *value, GLboolean tpose) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniformMatrix4x2fv(locale, count, tpose, value);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) {
+		std::vector<GLfloat> data(value, value+count*8);
+		RenderThread::post([=] { glUniformMatrix4x2fv(locale, count, tpose, data.data()); });
+	}
 }
 
 /**
@@ -2394,7 +2713,8 @@ void Shader::setUniformMatrix4x2fv(const std::string name, GLsizei count, const
  */
 void Shader::setUniformMatrix3x4fv(GLint pos, GLsizei count, const GLfloat *value, GLboolean tpose) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniformMatrix3x4fv(pos, count, tpose, value);
+	std::vector<GLfloat> data(value, value+count*12);
+	RenderThread::post([=] { glUniformMatrix3x4fv(pos, count, tpose, data.data()); });
 }
 
 /**
@@ -2411,8 +2731,11 @@ void Shader::setUniformMatrix3x4fv(GLint pos, GLsizei count, const GLfloat *valu
  */
 void Shader::setUniformMatrix3x4fv(const std::string name, GLsizei count, const GLfloat *value, GLboolean tpose) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-	if (locale >= 0) glUniformMatrix3x4fv(locale, count, tpose, value);
+	GLint locale = getUniformLocation(name);
+	if (locale >= 0) {
+		std::vector<GLfloat> data(value, value+count*12);
+		RenderThread::post([=] { glUniformMatrix3x4fv(locale, count, tpose, data.data()); });
+	}
 }
 
 /**
@@ -2427,7 +2750,8 @@ void Shader::setUniformMatrix3x4fv(const std::string name, GLsizei count, const
  */
 void Shader::setUniformMatrix4x3fv(GLint pos, GLsizei count, const GLfloat *value, GLboolean tpose) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	glUniformMatrix4x3fv(pos, count, tpose, value);
+	std::vector<GLfloat> data(value, value+count*12);
+	RenderThread::post([=] { glUniformMatrix4x3fv(pos, count, tpose, data.data()); });
 }
 
 /**
@@ -2444,8 +2768,11 @@ void Shader::setUniformMatrix4x3fv(GLint pos, GLsizei count, const GLfloat *valu
  */
 void Shader::setUniformMatrix4x3fv(const std::string name, GLsizei count, const GLfloat *value, GLboolean tpose) {
 	CUAssertLog(isBound(), "Shader is not active.");
-	GLint locale = getUniformLocation(name.c_str());
-    if (locale >= 0) glUniformMatrix4x3fv(locale, count, tpose, value);
+	GLint locale = getUniformLocation(name);
+    if (locale >= 0) {
+        std::vector<GLfloat> data(value, value+count*12);
+        RenderThread::post([=] { glUniformMatrix4x3fv(locale, count, tpose, data.data()); });
+    }
 }
 
 /**
@@ -2461,8 +2788,12 @@ void Shader::setUniformMatrix4x3fv(const std::string name, GLsizei count, const
  */
 bool Shader::getUniformfv(GLint pos, GLsizei size, GLfloat *value) const {
     CUAssertLog(isBound(), "Shader is not active.");
-    glGetUniformfv(_program,pos,value);
-    return !(glGetError());
+    GLenum error = GL_NO_ERROR;
+    RenderThread::call([&] {
+        glGetUniformfv(_program,pos,value);
+        error = glGetError();
+    });
+    return !error;
 }
 
 /**
@@ -2480,10 +2811,14 @@ bool Shader::getUniformfv(GLint pos, GLsizei size, GLfloat *value) const {
  */
 bool Shader::getUniformfv(const std::string name, GLsizei size, GLfloat *value) const {
     CUAssertLog(isBound(), "Shader is not active.");
-    GLint locale = getUniformLocation(name.c_str());
+    GLint locale = getUniformLocation(name);
     if (locale >= 0) {
-        glGetUniformfv(_program,locale,value);
-        return !(glGetError());
+        GLenum error = GL_NO_ERROR;
+        RenderThread::call([&] {
+            glGetUniformfv(_program,locale,value);
+            error = glGetError();
+        });
+        return !error;
     }
     return false;
 }
@@ -2501,8 +2836,12 @@ bool Shader::getUniformfv(const std::string name, GLsizei size, GLfloat *value)
  */
 bool Shader::getUniformiv(GLint pos, GLsizei size, GLint *value) const {
     CUAssertLog(isBound(), "Shader is not active.");
-    glGetUniformiv(_program,pos,value);
-    return !(glGetError());
+    GLenum error = GL_NO_ERROR;
+    RenderThread::call([&] {
+        glGetUniformiv(_program,pos,value);
+        error = glGetError();
+    });
+    return !error;
 }
 
 /**
@@ -2520,10 +2859,14 @@ bool Shader::getUniformiv(GLint pos, GLsizei size, GLint *value) const {
  */
 bool Shader::getUniformiv(const std::string name, GLsizei size, GLint *value) const {
     CUAssertLog(isBound(), "Shader is not active.");
-    GLint locale = getUniformLocation(name.c_str());
+    GLint locale = getUniformLocation(name);
     if (locale >= 0) {
-        glGetUniformiv(_program,locale,value);
-        return !(glGetError());
+        GLenum error = GL_NO_ERROR;
+        RenderThread::call([&] {
+            glGetUniformiv(_program,locale,value);
+            error = glGetError();
+        });
+        return !error;
     }
     return false;
 }
@@ -2541,8 +2884,12 @@ bool Shader::getUniformiv(const std::string name, GLsizei size, GLint *value) co
  */
 bool Shader::getUniformuiv(GLint pos, GLsizei size, GLuint *value) const {
     CUAssertLog(isBound(), "Shader is not active.");
-    glGetUniformuiv(_program,pos,value);
-    return !(glGetError());
+    GLenum error = GL_NO_ERROR;
+    RenderThread::call([&] {
+        glGetUniformuiv(_program,pos,value);
+        error = glGetError();
+    });
+    return !error;
 }
 
 /**
@@ -2560,10 +2907,14 @@ bool Shader::getUniformuiv(GLint pos, GLsizei size, GLuint *value) const {
  */
 bool Shader::getUniformuiv(const std::string name, GLsizei size, GLuint *value) const {
     CUAssertLog(isBound(), "Shader is not active.");
-    GLint locale = getUniformLocation(name.c_str());
+    GLint locale = getUniformLocation(name);
     if (locale >= 0) {
-        glGetUniformuiv(_program,locale,value);
-        return !(glGetError());
+        GLenum error = GL_NO_ERROR;
+        RenderThread::call([&] {
+            glGetUniformuiv(_program,locale,value);
+            error = glGetError();
+        });
+        return !error;
     }
     return false;
 }
@@ -50,6 +50,7 @@
 #include <cugl/render/CUShader.h>
 #include <cugl/render/CUGradient.h>
 #include <cugl/render/CUScissor.h>
+#include <cugl/render/CURenderThread.h>
 
 /**
  * Default fragment shader
@@ -124,6 +125,7 @@ SpriteBatch::Context::Context() {
     perspective = std::make_shared<Mat4>();
     perspective->setIdentity();
     texture  = nullptr;
+    texslot  = 0;
     blurstep = 0;
     blockptr = -1;
     type = 0;
@@ -145,6 +147,32 @@ SpriteBatch::Context::Context(Context* copy) {
     blendEquation = copy->blendEquation;
     perspective = copy->perspective;
     texture  = copy->texture;
+    texslot  = copy->texslot;
+    blockptr = copy->blockptr;
+    blurstep = copy->blurstep;
+    dirty = 0;
+}
+
+/**
+ * Sets this context to be a copy of the given uniforms
+ *
+ * This method allows a context to be reused without reallocation.
+ * Like the copy constructor, it clears the dirty bits.
+ *
+ * @param copy  The uniforms to copy
+ */
+void SpriteBatch::Context::set(const Context* copy) {
+    first = copy->first;
+    last  = copy->last;
+    type  = copy->type;
+    command = copy->command;
+    srcFactor = copy->srcFactor;
+    dstFactor = copy->dstFactor;
+    depthFunc = copy->depthFunc;
+    blendEquation = copy->blendEquation;
+    perspective = copy->perspective;
+    texture  = copy->texture;
+    texslot  = copy->texslot;
     blockptr = copy->blockptr;
     blurstep = copy->blurstep;
     dirty = 0;
@@ -177,23 +205,29 @@ SpriteBatch::Context::~Context() {
 SpriteBatch::SpriteBatch() :
 _initialized(false),
 _active(false),
-_inflight(false),
+_passes(1),
 _vertData(nullptr),
-_indxData(nullptr),
-_color(Color4f::WHITE),
-_context(nullptr),
-_depth(0),
 _vertMax(0),
 _vertSize(0),
+_indxData(nullptr),
 _indxMax(0),
 _indxSize(0),
+_context(nullptr),
+_inflight(false),
+_histSize(0),
+_vertMark(0),
+_texUnits(1),
+_texCount(0),
+_color(Color4f::WHITE),
+_depth(0),
+_hasScissor(false),
+_scissorDepth(0),
 _vertTotal(0),
 _callTotal(0) {
     _shader = nullptr;
     _vertbuff = nullptr;
     _unifbuff = nullptr;
     _gradient = nullptr;
-    _scissor  = nullptr;
 }
 
 /**
@@ -211,11 +245,23 @@ void SpriteBatch::dispose() {
     if (_context != nullptr) {
         delete _context; _context = nullptr;
     }
+    for(auto it = _history.begin(); it != _history.end(); ++it) {
+        delete *it;
+    }
+    _history.clear();
+    _histSize = 0;
     _shader = nullptr;
     _vertbuff = nullptr;
     _unifbuff = nullptr;
     _gradient = nullptr;
-    _scissor  = nullptr;
+    _scissor.setZero();
+    _hasScissor = false;
+    _scissorStack.clear();
+    _scissorDepth = 0;
+    _texSlots.clear();
+    _texCount = 0;
+    _texUnits = 1;
+    _vertMark = 0;
     
     _vertMax  = 0;
     _vertSize = 0;
@@ -319,13 +365,18 @@ bool SpriteBatch::init(unsigned int capacity, const std::shared_ptr<Shader>& sha
                             offsetof(cugl::SpriteVertex3,color));
     _vertbuff->setupAttribute("aTexCoord", 2, GL_FLOAT, GL_FALSE,
                             offsetof(cugl::SpriteVertex3,texcoord));
+    _vertbuff->setupAttribute("aTexSlot",  1, GL_FLOAT, GL_FALSE,
+                            offsetof(cugl::SpriteVertex3,texslot));
     _vertbuff->attach(_shader);
+    setupUniforms();
+    setupTextureUnits();
     
     // Set up data arrays;
     _vertMax = capacity;
     _vertData = new SpriteVertex3[_vertMax];
     _indxMax = capacity*3;
     _indxData = new GLuint[_indxMax];
+    _vertbuff->setStreamCapacity(DEFAULT_STREAM_RING*_vertMax, DEFAULT_STREAM_RING*_indxMax);
     
     // Create uniform buffer (this has its own backing array)
     _unifbuff = UniformBuffer::alloc(40*sizeof(float),capacity/16);
@@ -345,6 +396,7 @@ bool SpriteBatch::init(unsigned int capacity, const std::shared_ptr<Shader>& sha
     
     _context = new Context();
     _context->dirty = DIRTY_ALL_VALS;
+    _scissorStack.resize(DEFAULT_SCISSOR_DEPTH);
     return true;
 }
 
@@ -385,6 +437,8 @@ void SpriteBatch::setShader(const std::shared_ptr<Shader>& shader) {
     _shader = shader;
     _vertbuff->attach(_shader);
     _shader->setUniformBlock("uContext", _unifbuff);
+    setupUniforms();
+    setupTextureUnits();
 }
 
 
@@ -398,7 +452,7 @@ void SpriteBatch::setShader(const std::shared_ptr<Shader>& shader) {
  * @param perspective   The active perspective matrix for this sprite batch
  */
 void SpriteBatch::setPerspective(const Mat4& perspective) {
-    if (_context->perspective.get() != &perspective) {
+    if (*(_context->perspective) != perspective) {
         if (_inflight) { record(); }
         auto matrix = std::make_shared<Mat4>(perspective);
         _context->perspective = matrix;
@@ -446,6 +500,10 @@ void SpriteBatch::setTexture(const std::shared_ptr<Texture>& texture) {
             _context->texture->setBindPoint(0);
         }
     }
+    
+    if (texture != nullptr && _texUnits > 1) {
+        _context->texslot = acquireTextureSlot(texture);
+    }
 }
 
 /**
@@ -532,11 +590,15 @@ void SpriteBatch::setGradient(const std::shared_ptr<Gradient>& gradient) {
  * This method returns a copy of the internal scissor. Changes to this
  * object have no effect on the sprite batch.
  *
+ * This method allocates a new scissor mask on every call. Code that runs
+ * every frame should use {@link #hasScissor} and {@link #getActiveScissor}
+ * instead.
+ *
  * @return The active scissor mask for this sprite batch
  */
 std::shared_ptr<Scissor> SpriteBatch::getScissor() const {
-    if (_scissor != nullptr) {
-        return Scissor::alloc(_scissor);
+    if (_hasScissor) {
+        return std::make_shared<Scissor>(_scissor);
     }
     return nullptr;
 }
@@ -557,20 +619,104 @@ std::shared_ptr<Scissor> SpriteBatch::getScissor() const {
  * @param scissor   The active scissor mask for this sprite batch
  */
 void SpriteBatch::setScissor(const std::shared_ptr<Scissor>& scissor) {
-    if (scissor == _scissor) {
+    if (scissor == nullptr && !_hasScissor) {
         return;
     }
     
     if (_inflight) { record(); }
     if (scissor == nullptr) {
-        // Active gradient is not null
+        // Active scissor is not null
         _context->dirty = _context->dirty | DIRTY_UNIBLOCK | DIRTY_DRAWTYPE;
         _context->type = _context->type & ~TYPE_SCISSOR;
-        _scissor = nullptr;
+        _hasScissor = false;
     } else {
         _context->dirty = _context->dirty | DIRTY_UNIBLOCK | DIRTY_DRAWTYPE;
         _context->type = _context->type | TYPE_SCISSOR;
-        _scissor = Scissor::alloc(scissor);
+        _scissor = *scissor;
+        _hasScissor = true;
+    }
+}
+
+/**
+ * Pushes a scissor mask on to the scissor stack of this sprite batch
+ *
+ * The scissor mask is first transformed by the given matrix. If there
+ * is an active scissor mask, the result is intersected with it (in the
+ * coordinate space of the active mask). Otherwise, the transformed mask
+ * is used as is. The result becomes the new active scissor mask, and the
+ * previous state is restored with {@link #popScissor}.
+ *
+ * Unlike {@link #setScissor}, this method does not allocate any memory
+ * once the stack has reached its working depth. Hence it is the preferred
+ * way to nest scissor masks, such as in a scene graph.
+ *
+ * @param scissor   The scissor mask to push
+ * @param transform The transform to apply to the scissor mask
+ */
+void SpriteBatch::pushScissor(const Scissor& scissor, const Mat4& transform) {
+    Scissor local = scissor;
+    local.setTransform(transform);
+    pushScissor(local);
+}
+
+/**
+ * Pushes a scissor mask on to the scissor stack of this sprite batch
+ *
+ * This version uses the scissor mask as is, with its current transform.
+ * Otherwise it is the same as {@link #pushScissor(const Scissor&,const Mat4&)}.
+ * If there is an active scissor mask, the result is intersected with it.
+ * The previous state is restored with {@link #popScissor}.
+ *
+ * @param scissor   The scissor mask to push
+ */
+void SpriteBatch::pushScissor(const Scissor& scissor) {
+    if (_scissorDepth == _scissorStack.size()) {
+        _scissorStack.emplace_back();
+    }
+    ScissorFrame& frame = _scissorStack[_scissorDepth++];
+    frame.active = _hasScissor;
+    if (_hasScissor) {
+        frame.mask = _scissor;
+    }
+    
+    if (_inflight) { record(); }
+    if (_hasScissor) {
+        _scissor.intersect(scissor,false);
+    } else {
+        _scissor = scissor;
+        _hasScissor = true;
+    }
+    _context->dirty = _context->dirty | DIRTY_UNIBLOCK | DIRTY_DRAWTYPE;
+    _context->type = _context->type | TYPE_SCISSOR;
+}
+
+/**
+ * Restores the scissor mask active before the last call to {@link #pushScissor}
+ *
+ * Any changes made with {@link #setScissor} since the last push are
+ * discarded as well. It is an error to call this method when the
+ * scissor stack is empty.
+ */
+void SpriteBatch::popScissor() {
+    CUAssertLog(_scissorDepth > 0, "The scissor stack is empty");
+    if (_scissorDepth == 0) {
+        return; // If asserts are turned off.
+    }
+    
+    const ScissorFrame& frame = _scissorStack[--_scissorDepth];
+    if (!frame.active && !_hasScissor) {
+        return;
+    }
+    
+    if (_inflight) { record(); }
+    _context->dirty = _context->dirty | DIRTY_UNIBLOCK | DIRTY_DRAWTYPE;
+    if (frame.active) {
+        _context->type = _context->type | TYPE_SCISSOR;
+        _scissor = frame.mask;
+        _hasScissor = true;
+    } else {
+        _context->type = _context->type & ~TYPE_SCISSOR;
+        _hasScissor = false;
     }
 }
 
@@ -712,9 +858,11 @@ void SpriteBatch::setBlurStep(GLuint step) {
  * Calling this method will reset the vertex and OpenGL call counters to 0.
  */
 void SpriteBatch::begin() {
-    glDisable(GL_CULL_FACE);
-    glDepthMask(true);
-    glEnable(GL_BLEND);
+    RenderThread::post([=] {
+        glDisable(GL_CULL_FACE);
+        glDepthMask(true);
+        glEnable(GL_BLEND);
+    });
 
     // DO NOT CLEAR.  This responsibility lies elsewhere
     _shader->bind();
@@ -722,6 +870,7 @@ void SpriteBatch::begin() {
     _unifbuff->bind(false);
     _unifbuff->deactivate();
     _active = true;
+    _passes++;
     _callTotal = 0;
     _vertTotal = 0;
 }
@@ -754,40 +903,56 @@ void SpriteBatch::flush() {
         record();
     }
     
-    // Load all the vertex data at once
-    _vertbuff->loadVertexData(_vertData, _vertSize);
-    _vertbuff->loadIndexData(_indxData, _indxSize);
+    // Stream all the vertex data at once
+    GLsizei offset = _vertbuff->streamData(_vertData, _vertSize, _indxData, _indxSize);
     _unifbuff->activate();
     _unifbuff->flush();
     
+    // Bind the textures for multitexture batching
+    if (_texUnits > 1) {
+        for(GLuint ii = 0; ii < _texCount; ii++) {
+            _texSlots[ii]->bindToUnit(ii);
+        }
+        RenderThread::post([=] { glActiveTexture(GL_TEXTURE0); });
+    }
+    
     // Chunk the uniforms
     std::shared_ptr<Texture> previous = _context->texture;
-    for(auto it = _history.begin(); it != _history.end(); ++it) {
+    GLuint merge = (_texUnits > 1 ? DIRTY_TEXTURE : 0);
+    auto stop = _history.begin()+_histSize;
+    for(auto it = _history.begin(); it != stop; ) {
         Context* next = *it;
-        if (next->dirty & DIRTY_EQUATION) {
-            glBlendEquation(next->blendEquation);
-        }
-        if (next->dirty & DIRTY_BLENDFACTOR) {
-            glBlendFunc(next->srcFactor, next->dstFactor);
-        }
-        if (next->dirty & DIRTY_BLENDFACTOR) {
-            glBlendFunc(next->srcFactor, next->dstFactor);
-        }
-        if (next->dirty & DIRTY_DEPTHTEST) {
-            if (next->depthFunc == GL_ALWAYS) {
-                glDisable(GL_DEPTH_TEST);
-            } else {
-                glEnable(GL_DEPTH_TEST);
-                glDepthFunc(next->depthFunc);
-            }
+        if (next->dirty & (DIRTY_EQUATION | DIRTY_BLENDFACTOR | DIRTY_DEPTHTEST)) {
+            // The context may change before this is replayed
+            GLuint dirty = next->dirty;
+            GLenum equation = next->blendEquation;
+            GLenum srcFactor = next->srcFactor;
+            GLenum dstFactor = next->dstFactor;
+            GLenum depthFunc = next->depthFunc;
+            RenderThread::post([=] {
+                if (dirty & DIRTY_EQUATION) {
+                    glBlendEquation(equation);
+                }
+                if (dirty & DIRTY_BLENDFACTOR) {
+                    glBlendFunc(srcFactor, dstFactor);
+                }
+                if (dirty & DIRTY_DEPTHTEST) {
+                    if (depthFunc == GL_ALWAYS) {
+                        glDisable(GL_DEPTH_TEST);
+                    } else {
+                        glEnable(GL_DEPTH_TEST);
+                        glDepthFunc(depthFunc);
+                    }
+                }
+            });
         }
         if (next->dirty & DIRTY_DRAWTYPE) {
-             _shader->setUniform1i("uType", next->type);
+            _uType.set(next->type);
         }
         if (next->dirty & DIRTY_PERSPECTIVE) {
-            _shader->setUniformMat4("uPerspective",*(next->perspective.get()));
+            _uPerspective.set(*(next->perspective.get()));
         }
-        if (next->dirty & DIRTY_TEXTURE) {
+        if ((next->dirty & DIRTY_TEXTURE) && !merge) {
             previous = next->texture;
             if (previous != nullptr) {
                 previous->bind();
@@ -799,8 +964,20 @@ void SpriteBatch::flush() {
         if (next->dirty & DIRTY_BLURSTEP) {
             blurTexture(next->texture,next->blurstep);
         }
-        GLuint amt = next->last-next->first;
-        _vertbuff->draw(next->command, amt, next->first);
+        
+        // Later contexts that only change the texture unit share this draw
+        GLuint last = next->last;
+        for(++it; it != stop; ++it) {
+            Context* after = *it;
+            if ((after->dirty & ~merge) || after->command != next->command ||
+                (after->type & TYPE_GAUSSBLUR)) {
+                break;
+            }
+            last = after->last;
+        }
+        
+        GLuint amt = last-next->first;
+        _vertbuff->draw(next->command, amt, offset+next->first);
         _callTotal++;
     }
     
@@ -810,10 +987,22 @@ void SpriteBatch::flush() {
     _vertTotal += _indxSize;
     
     _vertSize = _indxSize = 0;
+    _vertMark = 0;
     unwind();
     _context->first = 0;
     _context->last  = 0;
     _context->blockptr = -1;
+    
+    // Start a new set of texture units with the active texture
+    if (_texUnits > 1) {
+        for(GLuint ii = 0; ii < _texCount; ii++) {
+            _texSlots[ii] = nullptr;
+        }
+        _texCount = 0;
+        if (_context->texture != nullptr) {
+            _context->texslot = acquireTextureSlot(_context->texture);
+        }
+    }
 }
 
 
@@ -1126,6 +1315,31 @@ void SpriteBatch::fill(const Mesh<SpriteVertex3>& mesh, const Mat4& transform, b
     prepare(mesh,transform,tint);
 }
 
+/**
+ * Fills the given mesh with the current texture and/or gradient.
+ *
+ * The mesh vertices must already be in world space (e.g. the mesh was
+ * transformed ahead of time). They are copied into the buffer as is,
+ * which makes this the fastest way to draw a mesh that does not change
+ * from frame to frame. This method will use the depth of each vertex
+ * and ignore the sprite batch depth.
+ *
+ * The triangulation will be determined by the mesh indices. If necessary,
+ * these can be generated via one of the triangulation factories
+ * {@link SimpleTriangulator} or {@link DelaunayTriangulator}.
+ *
+ * The mesh vertices use their own color values.  However, if tint is true,
+ * these values will be tinted (i.e. multiplied) by the current active color.
+ *
+ * @param mesh      The sprite mesh in world space
+ * @param tint      Whether to tint with the active color
+ */
+void SpriteBatch::fill(const Mesh<SpriteVertex3>& mesh, bool tint) {
+    CUAssertLog(mesh.command == GL_TRIANGLES, "The mesh is not triangulated properly.");
+    setCommand(GL_TRIANGLES);
+    prepare(mesh,tint);
+}
+
 
 #pragma mark -
 #pragma mark Outlines
@@ -1437,6 +1651,26 @@ void SpriteBatch::outline(const Mesh<SpriteVertex3>& mesh, const Mat4& transform
     prepare(mesh,transform,tint);
 }
 
+/**
+ * Outlines the given mesh with the current texture and/or gradient.
+ *
+ * The mesh vertices must already be in world space (e.g. the mesh was
+ * transformed ahead of time). They are copied into the buffer as is,
+ * which makes this the fastest way to draw a mesh that does not change
+ * from frame to frame. This method will use the depth of each vertex
+ * and ignore the sprite batch depth.
+ *
+ * The mesh vertices use their own color values.  However, if tint is true,
+ * these values will be tinted (i.e. multiplied) by the current active color.
+ *
+ * @param mesh      The sprite mesh in world space
+ * @param tint      Whether to tint with the active color
+ */
+void SpriteBatch::outline(const Mesh<SpriteVertex3>& mesh, bool tint) {
+    setCommand(GL_LINES);
+    prepare(mesh,tint);
+}
+
 
 #pragma mark -
 #pragma mark Convenience Methods
@@ -2020,24 +2254,116 @@ void SpriteBatch::draw(const std::shared_ptr<Texture>& texture, const Color4f co
  * will use the correct set of uniforms.
  */
 void SpriteBatch::record() {
-    Context* next = new Context(_context);
+    if (_texUnits > 1) {
+        GLfloat slot = (GLfloat)_context->texslot;
+        for(unsigned int ii = _vertMark; ii < _vertSize; ii++) {
+            _vertData[ii].texslot = slot;
+        }
+    }
+    _vertMark = _vertSize;
+    
+    // Swap the active context with a spare, if we have one
+    Context* next;
+    if (_histSize < _history.size()) {
+        next = _history[_histSize];
+        _history[_histSize] = _context;
+    } else {
+        next = new Context();
+        _history.push_back(_context);
+    }
+    _histSize++;
+
+    next->set(_context);
     _context->last = _indxSize;
     next->first = _indxSize;
-    _history.push_back(_context);
     _context = next;
     _inflight = false;
 }
 
 /**
- * Deletes the recorded uniforms.
+ * Clears the recorded uniforms.
  *
- * This method is called upon flushing or cleanup.
+ * This method is called upon flushing. The contexts are kept for reuse
+ * by the next call to {@link record}, but release their textures.
  */
 void SpriteBatch::unwind() {
-    for(auto it = _history.begin(); it != _history.end(); ++it) {
-        delete *it;
+    for(size_t ii = 0; ii < _histSize; ii++) {
+        _history[ii]->texture = nullptr;
+    }
+    _histSize = 0;
+}
+
+/**
+ * Returns the texture unit for the given texture in the current batch.
+ *
+ * This method is only used for multitexture batching. If the texture
+ * (or its parent) is not yet assigned to a texture unit, it is assigned
+ * to the next free one. If there are no free units, the sprite batch
+ * flushes before assigning it.
+ *
+ * @param texture   The texture to assign
+ *
+ * @return the texture unit for the given texture in the current batch.
+ */
+GLint SpriteBatch::acquireTextureSlot(const std::shared_ptr<Texture>& texture) {
+    GLuint buffer = texture->getBuffer();
+    for(GLuint ii = 0; ii < _texCount; ii++) {
+        if (_texSlots[ii]->getBuffer() == buffer) {
+            return ii;
+        }
+    }
+    
+    if (_texCount == _texUnits) {
+        // Flushing reassigns the active texture
+        flush();
+        for(GLuint ii = 0; ii < _texCount; ii++) {
+            if (_texSlots[ii]->getBuffer() == buffer) {
+                return ii;
+            }
+        }
+    }
+    
+    _texSlots[_texCount] = texture;
+    return _texCount++;
+}
+
+/**
+ * Acquires the uniform handles for the active shader.
+ *
+ * The handles skip any upload of a value the shader already has.
+ * They must be reacquired whenever the shader changes.
+ */
+void SpriteBatch::setupUniforms() {
+    _uType = _shader->getUniformHandle<GLint>("uType");
+    _uPerspective = _shader->getUniformHandle<Mat4>("uPerspective");
+    _uBlur = _shader->getUniformHandle<Vec2>("uBlur");
+}
+
+/**
+ * Configures multitexture batching for the active shader.
+ *
+ * Multitexture batching is enabled if the shader has the sampler array
+ * uTextures and the vertex attribute aTexSlot. Otherwise, the sprite
+ * batch binds a single texture at a time.
+ */
+void SpriteBatch::setupTextureUnits() {
+    _texSlots.clear();
+    _texCount = 0;
+    GLint pos = _shader->getUniformLocation("uTextures");
+    if (pos >= 0 && _shader->getAttributeLocation("aTexSlot") >= 0) {
+        GLint units[DEFAULT_TEXTURE_UNITS];
+        for(GLint ii = 0; ii < DEFAULT_TEXTURE_UNITS; ii++) {
+            units[ii] = ii;
+        }
+        _shader->setUniform1iv(pos, DEFAULT_TEXTURE_UNITS, units);
+        _texUnits = DEFAULT_TEXTURE_UNITS;
+        _texSlots.resize(_texUnits);
+    } else {
+        _texUnits = 1;
+    }
+    if (_context != nullptr && _context->texture != nullptr && _texUnits > 1) {
+        _context->texslot = acquireTextureSlot(_context->texture);
     }
-    _history.clear();
 }
 
 /**
@@ -2056,8 +2382,8 @@ void SpriteBatch::setUniformBlock(Context* context, bool tint) {
         flush();
     }
     float data[40];
-    if (_scissor != nullptr) {
-        _scissor->getData(data);
+    if (_hasScissor) {
+        _scissor.getData(data);
     } else {
         std::memset(data,0,16*sizeof(float));
     }
@@ -2085,13 +2411,11 @@ void SpriteBatch::setUniformBlock(Context* context, bool tint) {
  */
 void SpriteBatch::blurTexture(const std::shared_ptr<Texture>& texture, GLuint step) {
     if (texture == nullptr) {
-        _shader->setUniform2f("uBlur", 0, 0);
+        _uBlur.set(Vec2::ZERO);
         return;
     }
     Size size = texture->getSize();
-    size.width  = step/size.width;
-    size.height = step/size.height;
-    _shader->setUniform2f("uBlur",size.width,size.height);
+    _uBlur.set(Vec2(step/size.width,step/size.height));
 }
 
 /**
@@ -2726,3 +3050,45 @@ unsigned int SpriteBatch::chunkify(const Mesh<SpriteVertex3>& mesh, const Mat4&
     return (unsigned int)(mesh.indices.size()+start);
 }
 
+/**
+ * Returns the number of vertices added to the drawing buffer.
+ *
+ * This method adds the given mesh (both vertices and indices) to the
+ * vertex buffer, but does not draw it.  The vertices are already in
+ * world space, so they are copied without a transform. You must call
+ * {@link #flush} or {@link #end} to draw the complete mesh. This method
+ * will automatically flush if the maximum number of vertices (or uniform
+ * blocks) is reached.
+ *
+ * @param mesh  The mesh to add to the buffer
+ * @param tint  Whether to tint with the active color
+ *
+ * @return the number of vertices added to the drawing buffer.
+ */
+unsigned int SpriteBatch::prepare(const Mesh<SpriteVertex3>& mesh, bool tint) {
+    CUAssertLog(mesh.isSliceable(), "Sprite batches only support sliceable meshes");
+    if (mesh.vertices.size() >= _vertMax || mesh.indices.size() >= _indxMax) {
+        return chunkify(mesh, Mat4::IDENTITY, tint);
+    } else if(_vertSize+mesh.vertices.size() > _vertMax || _indxSize+mesh.indices.size() > _indxMax) {
+        flush();
+    }
+    
+    setUniformBlock(_context,tint);
+    unsigned int vsize = (unsigned int)mesh.vertices.size();
+    unsigned int isize = (unsigned int)mesh.indices.size();
+    std::memcpy(_vertData+_vertSize, mesh.vertices.data(), vsize*sizeof(SpriteVertex3));
+    if (tint && _gradient == nullptr && _color != Color4f::WHITE) {
+        for(unsigned int ii = 0; ii < vsize; ii++) {
+            _vertData[_vertSize+ii].color *= _color;
+        }
+    }
+    
+    for(unsigned int jj = 0; jj < isize; jj++) {
+        _indxData[_indxSize+jj] = _vertSize+mesh.indices[jj];
+    }
+    
+    _vertSize += vsize;
+    _indxSize += isize;
+    _inflight = true;
+    return vsize;
+}
@@ -32,9 +32,12 @@
 #include <SDL/SDL.h>
 #include <SDL/SDL_image.h>
 #include <sstream>
+#include <algorithm>
 #include <cugl/util/CUDebug.h>
 #include <cugl/util/CUFiletools.h>
 #include <cugl/render/CUTexture.h>
+#include <cugl/render/CURenderThread.h>
+#include <vector>
 
 using namespace cugl;
 
@@ -155,6 +158,32 @@ unsigned char* expand2rgba(unsigned char* buffer, int width, int height, int bsi
     return result;
 }
 
+/**
+ * Returns true if the given texture buffer is active at the given bind point.
+ *
+ * This function queries OpenGL, and so it must be called on the thread that
+ * owns the OpenGL context. See {@link Texture#isActive} for a definition of
+ * an active texture.
+ *
+ * @param buffer    The OpenGL texture buffer
+ * @param bindpoint The bind point of the texture
+ *
+ * @return true if the given texture buffer is active at the given bind point.
+ */
+static bool is_active(GLuint buffer, GLuint bindpoint) {
+    if (!buffer) {
+        return false;
+    }
+    GLint orig;
+    glGetIntegerv(GL_ACTIVE_TEXTURE,&orig);
+    if (orig != bindpoint+GL_TEXTURE0) {
+        return false;
+    }
+    GLint bind;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &bind);
+    return (bind == buffer);
+}
+
 /** The blank texture corresponding to cu_2x2_white_image */
 std::shared_ptr<Texture> Texture::_blank = nullptr;
 
@@ -183,7 +212,8 @@ _minS(0),
 _maxS(1),
 _minT(0),
 _maxT(1),
-_dirty(false) {}
+_dirty(false),
+_compressed(0) {}
 
 /**
  * Deletes the OpenGL texture and resets all attributes.
@@ -194,7 +224,8 @@ void Texture::dispose() {
     if (_buffer != 0) {
         // Do we own the texture?
         if (_parent == nullptr) {
-            glDeleteTextures(1, &_buffer);
+            GLuint buffer = _buffer;
+            RenderThread::post([=] { glDeleteTextures(1, &buffer); });
         }
         _buffer = 0;
         _width = 0; _height = 0;
@@ -208,6 +239,7 @@ void Texture::dispose() {
         _hasMipmaps = false;
         _bindpoint  = 0;
         _dirty = false;
+        _compressed = 0;
     }
 }
 
@@ -238,37 +270,46 @@ bool Texture::initWithData(const void *data, int width, int height, Texture::Pix
         return false; // In case asserts are off.
     }
     
-    glGenTextures(1, &_buffer);
-    if (_buffer == 0) {
+    // Allocation returns values, so it cannot be deferred
+    bool success = false;
+    RenderThread::call([&] {
+        glGenTextures(1, &_buffer);
+        if (_buffer == 0) {
+            error = glGetError();
+            CULogError("Could not allocate texture. %s", gl_error_name(error).c_str());
+            return;
+        }
+        
+        _width  = width;
+        _height = height;
+        _pixelFormat = format;
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, _buffer);
+
+        GLint  internal = internal_format(format);
+        GLenum datatype = format_type(format);
+        glTexImage2D(GL_TEXTURE_2D, 0, internal, width, height, 0, (GLenum)format, datatype, data);
+        
         error = glGetError();
-        CULogError("Could not allocate texture. %s", gl_error_name(error).c_str());
+        if (error) {
+            CULogError("Could not initialize texture. %s", gl_error_name(error).c_str());
+            glDeleteTextures(1, &_buffer);
+            _buffer = 0;
+            return;
+        }
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, _minFilter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, _magFilter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, _wrapS);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, _wrapT);
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        success = true;
+    });
+    if (!success) {
         return false;
     }
     
-    _width  = width;
-    _height = height;
-    _pixelFormat = format;
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, _buffer);
-
-    GLint  internal = internal_format(format);
-    GLenum datatype = format_type(format);
-    glTexImage2D(GL_TEXTURE_2D, 0, internal, width, height, 0, (GLenum)format, datatype, data);
-    
-    error = glGetError();
-    if (error) {
-        CULogError("Could not initialize texture. %s", gl_error_name(error).c_str());
-        glDeleteTextures(1, &_buffer);
-        _buffer = 0;
-        return false;
-    }
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, _minFilter);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, _magFilter);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, _wrapS);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, _wrapT);
-
-    glBindTexture(GL_TEXTURE_2D, 0);
     std::stringstream ss;
     ss << "@" << data;
     setName(ss.str());
@@ -294,6 +335,31 @@ bool Texture::initWithData(const void *data, int width, int height, Texture::Pix
  */
 bool Texture::initWithFile(const std::string filename) {
     std::string fullpath = filetool::normalize_path(filename);
+    size_t dot = fullpath.rfind('.');
+    std::string suffix = (dot == std::string::npos ? "" : fullpath.substr(dot));
+    std::transform(suffix.begin(), suffix.end(), suffix.begin(), ::tolower);
+    if (suffix == ".ktx" || suffix == ".ktx2") {
+        std::shared_ptr<CompressedImage> image = CompressedImage::allocWithFile(fullpath);
+        if (image == nullptr) {
+            return false;
+        }
+        
+        bool result = false;
+        CompressedImage::queryFormats();
+        if (CompressedImage::isSupported(image->getFormat())) {
+            result = initWithCompressed(image);
+        } else if (CompressedImage::isDecompressible(image->getFormat())) {
+            int width  = image->getWidth();
+            int height = image->getHeight();
+            std::vector<Uint8> pixels((size_t)width*height*4);
+            result = image->decompress(pixels.data(), width*4) && initWithData(pixels.data(), width, height);
+        } else {
+            CULogError("Compressed format 0x%04X of %s is not supported.", image->getFormat(), filename.c_str());
+        }
+        if (result) setName(filename);
+        return result;
+    }
+    
     SDL_Surface* surface = IMG_Load(fullpath.c_str());
     if (surface == nullptr) {
         CULogError("Could not load file %s. %s", filename.c_str(), SDL_GetError());
@@ -318,6 +384,86 @@ bool Texture::initWithFile(const std::string filename) {
     return result;
 }
 
+/**
+ * Initializes a texture with the given compressed image.
+ *
+ * Initializing a texture requires the use of the binding point at 0. Any
+ * texture bound to that point will be unbound. In addition, once
+ * initialization is done, this texture will not longer be bound as well.
+ *
+ * The compressed data is uploaded directly to the GPU, together with
+ * any mipmaps in the image.  The driver must support the compression
+ * format (see {@link CompressedImage#isSupported}). A compressed texture
+ * cannot be modified with the set() methods, and it cannot build mipmaps.
+ *
+ * @param image     The compressed image
+ *
+ * @return true if initialization was successful.
+ */
+bool Texture::initWithCompressed(const std::shared_ptr<CompressedImage>& image) {
+    CUAssertLog(image != nullptr && !image->getLevels().empty(), "Compressed image is not valid");
+    GLenum error;
+    
+    if (_buffer) {
+        CUAssertLog(false, "Texture is already initialized");
+        return false; // In case asserts are off.
+    }
+    
+    // Allocation returns values, so it cannot be deferred
+    bool success = false;
+    RenderThread::call([&] {
+        glGenTextures(1, &_buffer);
+        if (_buffer == 0) {
+            error = glGetError();
+            CULogError("Could not allocate texture. %s", gl_error_name(error).c_str());
+            return;
+        }
+        
+        _width  = image->getWidth();
+        _height = image->getHeight();
+        _pixelFormat = PixelFormat::RGBA;
+        _compressed  = image->getFormat();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, _buffer);
+        
+        const std::vector<CompressedImage::Level>& levels = image->getLevels();
+        for(size_t ii = 0; ii < levels.size(); ii++) {
+            const CompressedImage::Level& level = levels[ii];
+            glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)ii, _compressed, level.width, level.height, 0,
+                                   (GLsizei)level.data.size(), level.data.data());
+        }
+        
+        error = glGetError();
+        if (error) {
+            CULogError("Could not initialize compressed texture. %s", gl_error_name(error).c_str());
+            glBindTexture(GL_TEXTURE_2D, 0);
+            glDeleteTextures(1, &_buffer);
+            _buffer = 0;
+            _compressed = 0;
+            return;
+        }
+        
+        // Limit sampling to the levels we have
+        _hasMipmaps = image->hasMipMaps();
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)levels.size()-1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, _minFilter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, _magFilter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, _wrapS);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, _wrapT);
+        
+        glBindTexture(GL_TEXTURE_2D, 0);
+        success = true;
+    });
+    if (!success) {
+        return false;
+    }
+    
+    std::stringstream ss;
+    ss << "@" << image.get();
+    setName(ss.str());
+    return true;
+}
+
 /**
  * Returns a blank texture that can be used to make solid shapes.
  *
@@ -363,13 +509,71 @@ const std::shared_ptr<Texture>& Texture::getBlank() {
  * @return a reference to this (modified) texture for chaining.
  */
 const Texture& Texture::set(const void *data) {
-    if (!isActive()) {
-        CUAssertLog(false,"Texture %s is not currently active.",_name.c_str());
-        return *this;
+    CUAssertLog(!_compressed, "Cannot set the data of a compressed texture");
+    
+    // The command may run after the caller reuses its data
+    std::vector<Uint8> copy;
+    if (data != nullptr) {
+        copy.assign((const Uint8*)data, (const Uint8*)data+getByteSize()*_width*_height);
     }
+    
+    // The active texture is only known when the command runs
+    GLuint buffer = _buffer;
+    GLuint point  = _bindpoint;
+    GLenum format = (GLenum)_pixelFormat;
+    GLsizei width  = _width;
+    GLsizei height = _height;
+    std::string name = _name;
+    RenderThread::post([=] {
+        if (!is_active(buffer,point)) {
+            CUAssertLog(false,"Texture %s is not currently active.",name.c_str());
+            return;
+        }
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0,
+                     format, GL_UNSIGNED_BYTE, copy.empty() ? nullptr : copy.data());
+    });
+    return *this;
+}
 
-    glTexImage2D(GL_TEXTURE_2D, 0, (GLenum)_pixelFormat, _width, _height, 0,
-                 (GLenum)_pixelFormat, GL_UNSIGNED_BYTE, data);
+/**
+ * Sets a rectangular region of this texture to the contents of the buffer.
+ *
+ * The buffer must have the correct data format. In addition, the buffer
+ * must be size width*height*bytesize, with no padding between rows. The
+ * region is specified in pixels, with the origin at the start of the
+ * texture data (the first row).
+ *
+ * This method is only successful if the texture is currently active.
+ *
+ * @param data      The buffer to read into the texture
+ * @param x         The x-coordinate of the region
+ * @param y         The y-coordinate of the region
+ * @param width     The width of the region
+ * @param height    The height of the region
+ *
+ * @return a reference to this (modified) texture for chaining.
+ */
+const Texture& Texture::set(const void *data, int x, int y, int width, int height) {
+    CUAssertLog(!_compressed, "Cannot set the data of a compressed texture");
+    CUAssertLog(x >= 0 && y >= 0 && x+width <= (int)_width && y+height <= (int)_height,
+                "Region %dx%d at (%d,%d) is out of bounds",width,height,x,y);
+    
+    // The command may run after the caller reuses its data
+    std::vector<Uint8> copy((const Uint8*)data, (const Uint8*)data+getByteSize()*width*height);
+    
+    // The active texture is only known when the command runs
+    GLuint buffer = _buffer;
+    GLuint point  = _bindpoint;
+    GLenum format = (GLenum)_pixelFormat;
+    std::string name = _name;
+    RenderThread::post([=] {
+        if (!is_active(buffer,point)) {
+            CUAssertLog(false,"Texture %s is not currently active.",name.c_str());
+            return;
+        }
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height,
+                        format, GL_UNSIGNED_BYTE, copy.data());
+    });
     return *this;
 }
 
@@ -418,7 +622,11 @@ void Texture::buildMipMaps() {
     CUAssertLog(nextPOT(_height) == _height, "Height %d is not a power of two", _height);
     CUAssertLog(_parent == nullptr, "Cannot build mipmaps for a subtexture");
     CUAssertLog(isActive(), "Texture is not active");
-    glGenerateMipmap(GL_TEXTURE_2D);
+    if (_compressed) {
+        CUWarn("Cannot build mipmaps for compressed texture %s", _name.c_str());
+        return;
+    }
+    RenderThread::post([=] { glGenerateMipmap(GL_TEXTURE_2D); });
     _hasMipmaps = true;
 }
 
@@ -439,11 +647,7 @@ void Texture::buildMipMaps() {
 void Texture::setMinFilter(GLuint minFilter) {
     CUAssertLog(_parent == nullptr, "Cannot set filters for a subtexture");
     _minFilter = minFilter;
-    if (isActive()) {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, _minFilter);
-    } else {
-    	_dirty = true;
-    }
+    setParameter(GL_TEXTURE_MIN_FILTER, _minFilter);
 }
 
 /**
@@ -463,11 +667,7 @@ void Texture::setMinFilter(GLuint minFilter) {
 void Texture::setMagFilter(GLuint magFilter) {
     CUAssertLog(_parent == nullptr, "Cannot set filters for a subtexture");
     _magFilter = magFilter;
-    if (isActive()) {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, _magFilter);
-	} else {
-    	_dirty = true;
-    }
+    setParameter(GL_TEXTURE_MAG_FILTER, _magFilter);
 }
 
 /**
@@ -486,11 +686,7 @@ void Texture::setMagFilter(GLuint magFilter) {
 void Texture::setWrapS(GLuint wrap) {
     CUAssertLog(_parent == nullptr, "Cannot set wrap S for a subtexture");
     _wrapS = wrap;
-    if (isActive()) {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, _wrapS);
-	} else {
-    	_dirty = true;
-    }
+    setParameter(GL_TEXTURE_WRAP_S, _wrapS);
 }
 
 /**
@@ -509,14 +705,32 @@ void Texture::setWrapS(GLuint wrap) {
 void Texture::setWrapT(GLuint wrap) {
     CUAssertLog(_parent == nullptr, "Cannot set wrap T for a subtexture");
     _wrapT = wrap;
-    if (isActive()) {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, _wrapT);
-	} else {
-    	_dirty = true;
-    }
+    setParameter(GL_TEXTURE_WRAP_T, _wrapT);
 }
 
 
+/**
+ * Applies the given texture parameter if this texture is active.
+ *
+ * Whether or not the texture is active is only known to the thread that
+ * owns the OpenGL context (see {@link RenderThread}). Therefore, this
+ * method also marks the texture as dirty, so that the parameter is
+ * applied the next time the texture is bound.
+ *
+ * @param pname The texture parameter
+ * @param value The parameter value
+ */
+void Texture::setParameter(GLenum pname, GLint value) {
+    GLuint buffer = _buffer;
+    GLuint point  = _bindpoint;
+    RenderThread::post([=] {
+        if (is_active(buffer,point)) {
+            glTexParameteri(GL_TEXTURE_2D, pname, value);
+        }
+    });
+    _dirty = true;
+}
+
 #pragma mark -
 #pragma mark Atlas Support
 /**
@@ -558,6 +772,7 @@ std::shared_ptr<Texture> Texture::getSubTexture(GLfloat minS, GLfloat maxS,
     result->_buffer = source->_buffer;
     result->_parent = source;
     result->_pixelFormat = source->_pixelFormat;
+    result->_compressed  = source->_compressed;
     result->_name = source->_name;
     
     // Filters, wrap, and binding defer to parent.
@@ -593,21 +808,25 @@ std::shared_ptr<Texture> Texture::getSubTexture(GLfloat minS, GLfloat maxS,
  * @param the texture location to associate with this texture.
  */
 void Texture::setBindPoint(GLuint point) {
-    GLint orig;
-    glGetIntegerv(GL_ACTIVE_TEXTURE,&orig);
-    if (orig != _bindpoint+GL_TEXTURE0) {
-        glActiveTexture(GL_TEXTURE0+_bindpoint);
-    }
-    GLint bind;
-    glGetIntegerv(GL_TEXTURE_BINDING_2D, &bind);
-    if (bind == _buffer) {
-        glBindTexture(GL_TEXTURE_2D, 0);
-    }
-    if (orig != _bindpoint+GL_TEXTURE0) {
-        glActiveTexture(orig);
-    }
-    GLenum error = glGetError();
-    CUAssertLog(error == GL_NO_ERROR, "Texture: %s", gl_error_name(error).c_str());
+    GLuint buffer = _buffer;
+    GLuint bindpoint = _bindpoint;
+    RenderThread::post([=] {
+        GLint orig;
+        glGetIntegerv(GL_ACTIVE_TEXTURE,&orig);
+        if (orig != bindpoint+GL_TEXTURE0) {
+            glActiveTexture(GL_TEXTURE0+bindpoint);
+        }
+        GLint bind;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &bind);
+        if (bind == buffer) {
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+        if (orig != bindpoint+GL_TEXTURE0) {
+            glActiveTexture(orig);
+        }
+        GLenum error = glGetError();
+        CUAssertLog(error == GL_NO_ERROR, "Texture: %s", gl_error_name(error).c_str());
+    });
     _bindpoint = point;
 }
 
@@ -632,15 +851,46 @@ void Texture::bind() {
         _parent->bind();
         return;
     }
+    bindToUnit(_bindpoint);
+}
+
+/**
+ * Binds this texture to the given texture unit, making it active.
+ *
+ * This method is the same as {@link #bind}, except that it ignores the
+ * bind point of this texture. It allows a {@link SpriteBatch} to bind
+ * several textures at once without reassigning their bind points.
+ *
+ * This call is reentrant. If can be safely called multiple times.
+ *
+ * @param unit  The texture unit to bind to
+ */
+void Texture::bindToUnit(GLuint unit) {
+    if (_parent != nullptr) {
+        _parent->bindToUnit(unit);
+        return;
+    }
     
-    glActiveTexture(GL_TEXTURE0+_bindpoint);
-    glBindTexture(GL_TEXTURE_2D,_buffer);
+    GLuint buffer = _buffer;
     if (_dirty) {
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, _minFilter);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, _magFilter);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, _wrapS);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, _wrapT);
-		_dirty = false;    
+        GLint minFilter = _minFilter;
+        GLint magFilter = _magFilter;
+        GLint wrapS = _wrapS;
+        GLint wrapT = _wrapT;
+        RenderThread::post([=] {
+            glActiveTexture(GL_TEXTURE0+unit);
+            glBindTexture(GL_TEXTURE_2D,buffer);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapS);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapT);
+        });
+        _dirty = false;
+    } else {
+        RenderThread::post([=] {
+            glActiveTexture(GL_TEXTURE0+unit);
+            glBindTexture(GL_TEXTURE_2D,buffer);
+        });
     }
 }
 
@@ -661,15 +911,18 @@ void Texture::unbind() {
         return;
     }
 
-    GLint orig;
-    glGetIntegerv(GL_ACTIVE_TEXTURE,&orig);
-    if (orig != _bindpoint+GL_TEXTURE0) {
-        glActiveTexture(GL_TEXTURE0+_bindpoint);
-    }
-    glBindTexture(GL_TEXTURE_2D, 0);
-    if (orig != _bindpoint+GL_TEXTURE0) {
-        glActiveTexture(orig);
-    }
+    GLuint bindpoint = _bindpoint;
+    RenderThread::post([=] {
+        GLint orig;
+        glGetIntegerv(GL_ACTIVE_TEXTURE,&orig);
+        if (orig != bindpoint+GL_TEXTURE0) {
+            glActiveTexture(GL_TEXTURE0+bindpoint);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        if (orig != bindpoint+GL_TEXTURE0) {
+            glActiveTexture(orig);
+        }
+    });
 }
 
 /**
@@ -690,17 +943,21 @@ bool Texture::isBound() const {
         return false;
     }
     
-    GLint orig;
-    glGetIntegerv(GL_ACTIVE_TEXTURE,&orig);
-    if (orig != _bindpoint+GL_TEXTURE0) {
-        glActiveTexture(GL_TEXTURE0+_bindpoint);
-    }
-    GLint bind;
-    glGetIntegerv(GL_TEXTURE_BINDING_2D, &bind);
-    bool result = (bind == _buffer);
-    if (orig != _bindpoint+GL_TEXTURE0) {
-        glActiveTexture(orig);
-    }
+    // This is a query, so it cannot be deferred
+    bool result = false;
+    RenderThread::call([&] {
+        GLint orig;
+        glGetIntegerv(GL_ACTIVE_TEXTURE,&orig);
+        if (orig != _bindpoint+GL_TEXTURE0) {
+            glActiveTexture(GL_TEXTURE0+_bindpoint);
+        }
+        GLint bind;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &bind);
+        result = (bind == _buffer);
+        if (orig != _bindpoint+GL_TEXTURE0) {
+            glActiveTexture(orig);
+        }
+    });
     return result;
 }
 
@@ -718,17 +975,10 @@ bool Texture::isBound() const {
  * @return true if this texture is bound to its specified slot.
  */
 bool Texture::isActive() const {
-    if (!_buffer) {
-        return false;
-    }
-    GLint orig;
-    glGetIntegerv(GL_ACTIVE_TEXTURE,&orig);
-    if (orig != _bindpoint+GL_TEXTURE0) {
-        return false;
-    }
-    GLint bind;
-    glGetIntegerv(GL_TEXTURE_BINDING_2D, &bind);
-    return (bind == _buffer);
+    // This is a query, so it cannot be deferred
+    bool result = false;
+    RenderThread::call([&] { result = is_active(_buffer,_bindpoint); });
+    return result;
 }
 
 
@@ -810,8 +1060,11 @@ bool Texture::save(const std::string file) {
     SDL_Surface* surface;
     unsigned int bsize = getByteSize();
     unsigned char* buffer = (unsigned char*)malloc(bsize*_width*_height);
-    glGetTexImage(GL_TEXTURE_2D,0,(GLenum)_pixelFormat,format_type(_pixelFormat),buffer);
-    GLenum error = glGetError();
+    GLenum error = GL_NO_ERROR;
+    RenderThread::call([&] {
+        glGetTexImage(GL_TEXTURE_2D,0,(GLenum)_pixelFormat,format_type(_pixelFormat),buffer);
+        error = glGetError();
+    });
     if (error) {
         CULogError("Could not write file %s. %s", file.c_str(), gl_error_name(error).c_str());
         free(buffer);
@@ -44,9 +44,14 @@
 //  Version: 2/29/20
 #include <cugl/util/CUDebug.h>
 #include <cugl/render/CUUniformBuffer.h>
+#include <cugl/render/CURenderThread.h>
+#include <vector>
 
 using namespace cugl;
 
+/** The uniform buffer most recently activated by this class */
+GLuint UniformBuffer::_active = 0;
+
 
 #pragma mark Constructors
 /**
@@ -115,14 +120,18 @@ bool UniformBuffer::init(GLsizei capacity, GLuint blocks) {
     _blockcount = blocks;
     _blocksize = capacity;
     
+    // These are queries, so they cannot be deferred
+    GLint align;
     GLint value;
-    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &value);
+    RenderThread::call([&] {
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+        glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &value);
+    });
     while (_blockstride < _blocksize) {
-        _blockstride += value;
+        _blockstride += align;
     }
     
     // Quit if the memory request is too high
-    glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &value);
     if (_blockstride > value) {
         CUAssertLog(false,"Capacity exceeds maximum value of %d bytes",value);
         _blockcount  = 0;
@@ -131,27 +140,35 @@ bool UniformBuffer::init(GLsizei capacity, GLuint blocks) {
         return false;
     }    
     
-    GLenum error;
-    glGenBuffers(1, &_dataBuffer);
-    if (!_dataBuffer) {
-        error = glGetError();
-        CULogError("Could not create uniform buffer. %s", gl_error_name(error).c_str());
-        return false;
-    }
+    bool success = false;
+    RenderThread::call([&] {
+        GLenum error;
+        glGenBuffers(1, &_dataBuffer);
+        if (!_dataBuffer) {
+            error = glGetError();
+            CULogError("Could not create uniform buffer. %s", gl_error_name(error).c_str());
+            return;
+        }
 
-    _bytebuffer = (char*)malloc(_blockstride*_blockcount);
-    glBindBuffer(GL_UNIFORM_BUFFER, _dataBuffer);
-    glBufferData(GL_UNIFORM_BUFFER, _blockstride*_blockcount, NULL, _drawtype);
-    error = glGetError();
-    if (error) {
-        glDeleteBuffers(1, &_dataBuffer);
-        _dataBuffer = 0;
-        CULogError("Could not allocate memory for uniform buffer. %s",
-                   gl_error_name(error).c_str());
+        glBindBuffer(GL_UNIFORM_BUFFER, _dataBuffer);
+        glBufferData(GL_UNIFORM_BUFFER, _blockstride*_blockcount, NULL, _drawtype);
+        error = glGetError();
+        if (error) {
+            glDeleteBuffers(1, &_dataBuffer);
+            _dataBuffer = 0;
+            CULogError("Could not allocate memory for uniform buffer. %s",
+                       gl_error_name(error).c_str());
+            return;
+        }
+        
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        success = true;
+    });
+    if (!success) {
         return false;
     }
     
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    _bytebuffer = (char*)malloc(_blockstride*_blockcount);
     return true;
 }
 
@@ -162,7 +179,11 @@ bool UniformBuffer::init(GLsizei capacity, GLuint blocks) {
  */
 void UniformBuffer::dispose() {
     if (_dataBuffer) {
-        glDeleteBuffers(1,&_dataBuffer);
+        GLuint buffer = _dataBuffer;
+        RenderThread::post([=] { glDeleteBuffers(1,&buffer); });
+        if (_active == _dataBuffer) {
+            _active = 0;
+        }
         _dataBuffer = 0;
     }
     if (_bytebuffer) {
@@ -198,11 +219,7 @@ void UniformBuffer::dispose() {
  * @param point The bind point for for this uniform buffer.
  */
 void UniformBuffer::setBindPoint(GLuint point) {
-    GLint bound;
-    glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING,_bindpoint,&bound);
-    if (bound == _dataBuffer) {
-        glBindBufferBase(GL_UNIFORM_BUFFER, _bindpoint, 0);
-    }
+    unbind();
     _bindpoint = point;
 }
 
@@ -230,7 +247,9 @@ void UniformBuffer::bind(bool activate) {
     if (activate) {
         this->activate();
     }
-    glBindBufferBase(GL_UNIFORM_BUFFER, _bindpoint, _dataBuffer);
+    GLuint point  = _bindpoint;
+    GLuint buffer = _dataBuffer;
+    RenderThread::post([=] { glBindBufferBase(GL_UNIFORM_BUFFER, point, buffer); });
 }
 
 /**
@@ -247,11 +266,15 @@ void UniformBuffer::bind(bool activate) {
  * This call is reentrant.  If can be safely called multiple times.
  */
 void UniformBuffer::unbind() {
-    GLint bound;
-    glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING,_bindpoint,&bound);
-    if (bound == _dataBuffer) {
-        glBindBufferBase(GL_UNIFORM_BUFFER, _bindpoint, 0);
-    }
+    GLuint point  = _bindpoint;
+    GLuint buffer = _dataBuffer;
+    RenderThread::post([=] {
+        GLint bound;
+        glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING,point,&bound);
+        if (bound == buffer) {
+            glBindBufferBase(GL_UNIFORM_BUFFER, point, 0);
+        }
+    });
 }
 
 /**
@@ -269,10 +292,11 @@ void UniformBuffer::unbind() {
  * This call is reentrant.  If can be safely called multiple times.
  */
 void UniformBuffer::activate() {
-    glBindBuffer(GL_UNIFORM_BUFFER, _dataBuffer);
+    GLuint buffer = _dataBuffer;
+    RenderThread::post([=] { glBindBuffer(GL_UNIFORM_BUFFER, buffer); });
+    _active = _dataBuffer;
     if (_autoflush && _dirty) {
-        glBufferData(GL_UNIFORM_BUFFER,_blockstride*_blockcount,_bytebuffer,_drawtype);
-        _dirty = false;
+        flush();
     }
 }
 
@@ -290,12 +314,12 @@ void UniformBuffer::activate() {
 void UniformBuffer::deactivate() {
 #if CU_PLATFORM == CU_PLATFORM_ANDROID
  	// There are problems with this query on emulator
- 	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    RenderThread::post([=] { glBindBuffer(GL_UNIFORM_BUFFER, 0); });
+    _active = 0;
 #else
-	GLint bound;
-    glGetIntegerv(GL_UNIFORM_BUFFER_BINDING,&bound);
-    if (bound == _dataBuffer) {
-        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    if (isActive()) {
+        RenderThread::post([=] { glBindBuffer(GL_UNIFORM_BUFFER, 0); });
+        _active = 0;
     }
 #endif
 }
@@ -310,8 +334,9 @@ void UniformBuffer::deactivate() {
  * @return true if this uniform block is currently bound.
  */
 bool UniformBuffer::isBound() const {
-    GLint bound;
-    glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING,_bindpoint,&bound);
+    // This is a query, so it cannot be deferred
+    GLint bound = 0;
+    RenderThread::call([&] { glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING,_bindpoint,&bound); });
     return bound == _dataBuffer;
 }
     
@@ -329,6 +354,11 @@ bool UniformBuffer::isBound() const {
  * @return true if this uniform block is currently active.
  */
 bool UniformBuffer::isActive() const {
+    RenderThread* thread = RenderThread::get();
+    if (thread != nullptr && !thread->isRenderThread()) {
+        // Querying OpenGL would stall the render thread
+        return _active == _dataBuffer;
+    }
     GLint bound;
     glGetIntegerv(GL_UNIFORM_BUFFER_BINDING,&bound);
     return bound == _dataBuffer;
@@ -347,8 +377,13 @@ void UniformBuffer::setBlock(GLuint block) {
     CUAssertLog(isBound(), "Buffer is not bound.");
     if (_blockpntr != block) {
         _blockpntr = block;
-        glBindBufferRange(GL_UNIFORM_BUFFER,_bindpoint,_dataBuffer,
-                          block*_blockstride,_blocksize);
+        GLuint point  = _bindpoint;
+        GLuint buffer = _dataBuffer;
+        GLintptr offset = block*_blockstride;
+        GLsizeiptr size = _blocksize;
+        RenderThread::post([=] {
+            glBindBufferRange(GL_UNIFORM_BUFFER,point,buffer,offset,size);
+        });
     }
 }
 
@@ -362,12 +397,34 @@ void UniformBuffer::setBlock(GLuint block) {
  */
 void UniformBuffer::flush() {
     // CUAssertLog(isActive(), "Buffer is not active."); // Problems on android emulator for now
-    glBufferData(GL_UNIFORM_BUFFER,_blockstride*_blockcount,_bytebuffer,_drawtype);
+    // The command may run after the byte buffer changes again
+    std::vector<char> copy(_bytebuffer,_bytebuffer+_blockstride*_blockcount);
+    GLenum drawtype = _drawtype;
+    RenderThread::post([=] {
+        glBufferData(GL_UNIFORM_BUFFER,copy.size(),copy.data(),drawtype);
+    });
     _dirty = false;
 }
 
 
 
+/**
+ * Writes the given data to the active uniform buffer.
+ *
+ * The data is copied, as the write may be deferred to the {@link RenderThread}.
+ * This method assumes that this uniform buffer is active.
+ *
+ * @param position  The byte position in the buffer
+ * @param data      The data to write
+ * @param size      The number of bytes to write
+ */
+void UniformBuffer::upload(GLsizei position, const void* data, GLsizei size) {
+    std::vector<Uint8> copy((const Uint8*)data,(const Uint8*)data+size);
+    RenderThread::post([=] {
+        glBufferSubData(GL_UNIFORM_BUFFER, position, size, copy.data());
+    });
+}
+
 #pragma mark -
 #pragma mark Data Offsets
 /**
@@ -1237,7 +1294,7 @@ void UniformBuffer::setUniformfv(GLint block, GLsizei offset, GLsizei size, cons
         GLsizei position = block*_blockstride+offset;
         std::memcpy(_bytebuffer+position, values, size*sizeof(float));
         if (_autoflush && isActive()) {
-            glBufferSubData(GL_UNIFORM_BUFFER, position, size*sizeof(float), values);
+            upload(position, values, size*sizeof(float));
         } else {
             _dirty = true;
         }
@@ -1252,7 +1309,7 @@ void UniformBuffer::setUniformfv(GLint block, GLsizei offset, GLsizei size, cons
             GLsizei position = block*_blockstride+offset;
             std::memcpy(_bytebuffer+position, values, size*sizeof(float));
             if (active) {
-                glBufferSubData(GL_UNIFORM_BUFFER, position, size*sizeof(float), values);
+                upload(position, values, size*sizeof(float));
             }
         }
     }
@@ -1354,7 +1411,7 @@ void UniformBuffer::setUniformiv(GLint block, GLsizei offset, GLsizei size, cons
         GLsizei position = block*_blockstride+offset;
         std::memcpy(_bytebuffer+position, values, size*sizeof(GLint));
         if (_autoflush && isActive()) {
-            glBufferSubData(GL_UNIFORM_BUFFER, position, size*sizeof(GLint), values);
+            upload(position, values, size*sizeof(GLint));
         } else {
             _dirty = true;
         }
@@ -1369,7 +1426,7 @@ void UniformBuffer::setUniformiv(GLint block, GLsizei offset, GLsizei size, cons
             GLsizei position = block*_blockstride+offset;
             std::memcpy(_bytebuffer+position, values, size*sizeof(GLint));
             if (active) {
-                glBufferSubData(GL_UNIFORM_BUFFER, position, size*sizeof(GLint), values);
+                upload(position, values, size*sizeof(GLint));
             }
         }
     }
@@ -1471,7 +1528,7 @@ void UniformBuffer::setUniformuiv(GLint block, GLsizei offset, GLsizei size, con
         GLsizei position = block*_blockstride+offset;
         std::memcpy(_bytebuffer+position, values, size*sizeof(GLuint));
         if (_autoflush && isActive()) {
-            glBufferSubData(GL_UNIFORM_BUFFER, position, size*sizeof(GLuint), values);
+            upload(position, values, size*sizeof(GLuint));
         } else {
             _dirty = true;
         }
@@ -1486,7 +1543,7 @@ void UniformBuffer::setUniformuiv(GLint block, GLsizei offset, GLsizei size, con
             GLsizei position = block*_blockstride+offset;
             std::memcpy(_bytebuffer+position, values, size*sizeof(GLuint));
             if (active) {
-                glBufferSubData(GL_UNIFORM_BUFFER, position, size*sizeof(GLuint), values);
+                upload(position, values, size*sizeof(GLuint));
             }
         }
     }
@@ -33,9 +33,16 @@
 #include <cugl/render/CUVertexBuffer.h>
 #include <cugl/render/CUShader.h>
 #include <cugl/render/CUTexture.h>
+#include <cugl/render/CURenderThread.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
 
 using namespace cugl;
 
+/** The vertex array most recently bound by this class */
+GLuint VertexBuffer::_bound = 0;
+
 #pragma mark Constructors
 /**
  * Creates an uninitialized vertex buffer.
@@ -43,10 +50,14 @@ using namespace cugl;
  * You must initialize the vertex buffer to allocate buffer memory.
  */
 VertexBuffer::VertexBuffer() :
+_stride(0),
 _vertArray(0),
 _vertBuffer(0),
 _indxBuffer(0),
-_stride(0) {
+_ringVerts(0),
+_ringIndxs(0),
+_vertHead(0),
+_indxHead(0) {
     _shader = nullptr;
 }
 
@@ -74,32 +85,38 @@ VertexBuffer::~VertexBuffer() {
  */
 bool VertexBuffer::init(GLsizei stride) {
     _stride = stride;
-    glGenVertexArrays (1, &_vertArray);
-    if (!_vertArray) {
-        GLenum error = glGetError();
-        CULogError("Could not create vertex array. %s", gl_error_name(error).c_str());
-        return false;
-    }
-
-    // Generate the buffers
-    glGenBuffers(1, &_vertBuffer);
-    if (!_vertBuffer) {
-        GLenum error = glGetError();
-        glDeleteVertexArrays(1,&_vertArray);
-        CULogError("Could not create vertex buffer. %s", gl_error_name(error).c_str());
-        return false;
-    }
     
-    glGenBuffers(1, &_indxBuffer);
-    if (!_indxBuffer) {
-        GLenum error = glGetError();
-        CULogError("Could not create index buffer. %s", gl_error_name(error).c_str());
-        glDeleteVertexArrays(1,&_vertArray);
-        glDeleteBuffers(1,&_vertBuffer);
-        return false;
-    }
+    // Creating the buffers returns values, so it cannot be deferred
+    bool success = false;
+    RenderThread::call([&] {
+        glGenVertexArrays (1, &_vertArray);
+        if (!_vertArray) {
+            GLenum error = glGetError();
+            CULogError("Could not create vertex array. %s", gl_error_name(error).c_str());
+            return;
+        }
+
+        // Generate the buffers
+        glGenBuffers(1, &_vertBuffer);
+        if (!_vertBuffer) {
+            GLenum error = glGetError();
+            glDeleteVertexArrays(1,&_vertArray);
+            CULogError("Could not create vertex buffer. %s", gl_error_name(error).c_str());
+            return;
+        }
+        
+        glGenBuffers(1, &_indxBuffer);
+        if (!_indxBuffer) {
+            GLenum error = glGetError();
+            CULogError("Could not create index buffer. %s", gl_error_name(error).c_str());
+            glDeleteVertexArrays(1,&_vertArray);
+            glDeleteBuffers(1,&_vertBuffer);
+            return;
+        }
+        success = true;
+    });
     
-    return true;
+    return success;
 }
 
 /**
@@ -113,12 +130,24 @@ void VertexBuffer::dispose() {
     }
     _enabled.clear();
     _attributes.clear();
-    glDeleteBuffers(1,&_indxBuffer);
-    glDeleteBuffers(1,&_vertBuffer);
-    glDeleteVertexArrays(1,&_vertArray);
+    GLuint indxBuffer = _indxBuffer;
+    GLuint vertBuffer = _vertBuffer;
+    GLuint vertArray  = _vertArray;
+    RenderThread::post([=] {
+        glDeleteBuffers(1,&indxBuffer);
+        glDeleteBuffers(1,&vertBuffer);
+        glDeleteVertexArrays(1,&vertArray);
+    });
+    if (_bound == _vertArray) {
+        _bound = 0;
+    }
     _indxBuffer = 0;
     _vertBuffer = 0;
     _vertArray  = 0;
+    _ringVerts = 0;
+    _ringIndxs = 0;
+    _vertHead  = 0;
+    _indxHead  = 0;
     _shader = nullptr;
     _stride = 0;
 }
@@ -139,9 +168,15 @@ void VertexBuffer::dispose() {
  */
 void VertexBuffer::bind() {
     CUAssertLog(_vertBuffer, "VertexBuffer has not be initialized.");
-    glBindVertexArray(_vertArray);
-	glBindBuffer( GL_ARRAY_BUFFER, _vertBuffer );
-	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, _indxBuffer );
+    GLuint vertArray  = _vertArray;
+    GLuint vertBuffer = _vertBuffer;
+    GLuint indxBuffer = _indxBuffer;
+    RenderThread::post([=] {
+        glBindVertexArray(vertArray);
+        glBindBuffer( GL_ARRAY_BUFFER, vertBuffer );
+        glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, indxBuffer );
+    });
+    _bound = _vertArray;
     if (_shader != nullptr) {
         _shader->bind();
     }
@@ -160,9 +195,12 @@ void VertexBuffer::bind() {
  */
 void VertexBuffer::unbind() {
     if (isBound()) {
-        glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
-        glBindBuffer( GL_ARRAY_BUFFER, 0 );
-        glBindVertexArray(0);
+        RenderThread::post([=] {
+            glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+            glBindBuffer( GL_ARRAY_BUFFER, 0 );
+            glBindVertexArray(0);
+        });
+        _bound = 0;
     }
 }
 
@@ -182,24 +220,25 @@ void VertexBuffer::attach(const std::shared_ptr<Shader>& shader) {
         _shader = shader;
         bind();
         
-        // Link up attributes on the first time
-        for(auto it = _attributes.begin(); it != _attributes.end(); ++it) {
-            std::string name = it->first;
-			GLint pos = glGetAttribLocation(_shader->getProgram(), name.c_str());
-			if (pos == -1) {
-				CUWarn("Active shader has no attribute %s", name.c_str());
-			} else if (_enabled[name]) {
-				glEnableVertexAttribArray(pos);
-				glVertexAttribPointer(pos,it->second.size,it->second.type,
-									  it->second.norm,_stride,
-									  reinterpret_cast<void*>(it->second.offset));
-			} else {
-				glDisableVertexAttribArray(pos);
-			}
-        }
-
-        GLenum error = glGetError();
-        CUAssertLog(error == GL_NO_ERROR, "VertexBuffer: %s", gl_error_name(error).c_str());
+        // Link up attributes on the first time (this must query the shader)
+        RenderThread::call([&] {
+            for(auto it = _attributes.begin(); it != _attributes.end(); ++it) {
+                std::string name = it->first;
+                GLint pos = glGetAttribLocation(_shader->getProgram(), name.c_str());
+                if (pos == -1) {
+                    CUWarn("Active shader has no attribute %s", name.c_str());
+                } else if (_enabled[name]) {
+                    glEnableVertexAttribArray(pos);
+                    glVertexAttribPointer(pos,it->second.size,it->second.type,
+                                          it->second.norm,_stride,
+                                          reinterpret_cast<void*>(it->second.offset));
+                } else {
+                    glDisableVertexAttribArray(pos);
+                }
+            }
+            
+            CUAssertGLError("VertexBuffer");
+        });
     } else {
         bind();
     }
@@ -225,6 +264,11 @@ std::shared_ptr<Shader> VertexBuffer::detach() {
  * @return true if this vertex is currently bound.
  */
 bool VertexBuffer::isBound() const {
+    RenderThread* thread = RenderThread::get();
+    if (thread != nullptr && !thread->isRenderThread()) {
+        // Querying OpenGL would stall the render thread
+        return _bound == _vertArray;
+    }
     GLint vao;
     glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vao);
     return vao == _vertArray;
@@ -260,10 +304,18 @@ bool VertexBuffer::isBound() const {
  */
 void VertexBuffer::loadVertexData(const void * data, GLsizei size, GLenum usage) {
     //CUAssertLog(isBound(), "Vertex buffer is not bound"); // Problems on android emulator for now
-    glBufferData( GL_ARRAY_BUFFER, _stride * size, data, usage );
-    
-    GLenum error = glGetError();
-    CUAssertLog(error == GL_NO_ERROR, "VertexBuffer: %s", gl_error_name(error).c_str());
+    GLsizeiptr bytes = _stride * size;
+    std::vector<Uint8> copy;
+    if (data != nullptr) {
+        // The command may run after the caller reuses its data
+        copy.assign((const Uint8*)data, (const Uint8*)data+bytes);
+    }
+    RenderThread::post([=] {
+        glBufferData( GL_ARRAY_BUFFER, bytes, copy.empty() ? nullptr : copy.data(), usage );
+        CUAssertGLError("VertexBuffer");
+    });
+    _ringVerts = 0;
+    _vertHead  = 0;
 }
 
 /**
@@ -294,9 +346,134 @@ void VertexBuffer::loadVertexData(const void * data, GLsizei size, GLenum usage)
  */
 void VertexBuffer::loadIndexData(const void * data, GLsizei size, GLenum usage) {
     //CUAssertLog(isBound(), "Vertex buffer is not bound"); // Problems on android emulator for now
-    glBufferData( GL_ELEMENT_ARRAY_BUFFER, size * sizeof(GLuint), data, usage );
-    GLenum error = glGetError();
-    CUAssertLog(error == GL_NO_ERROR, "VertexBuffer: %s", gl_error_name(error).c_str());
+    std::vector<GLuint> copy;
+    if (data != nullptr) {
+        // The command may run after the caller reuses its data
+        copy.assign((const GLuint*)data, (const GLuint*)data+size);
+    }
+    RenderThread::post([=] {
+        glBufferData( GL_ELEMENT_ARRAY_BUFFER, size * sizeof(GLuint),
+                      copy.empty() ? nullptr : copy.data(), usage );
+        CUAssertGLError("VertexBuffer");
+    });
+    _ringIndxs = 0;
+    _indxHead  = 0;
+}
+
+/**
+ * Allocates a streaming ring of the given capacity for this buffer.
+ *
+ * A streaming ring is an alternative to {@link #loadVertexData} and
+ * {@link #loadIndexData} for data that changes every frame. Instead of
+ * reallocating the buffers on every load, {@link #streamData} writes
+ * each load after the previous one, using unsynchronized buffer maps.
+ * When the ring is full, the buffers are orphaned (so the driver can
+ * give us fresh memory without waiting on pending draws) and the ring
+ * starts again from the beginning.
+ *
+ * The capacity should be a small multiple (typically 3) of the largest
+ * expected load, so that orphaning happens infrequently. Calling either
+ * {@link #loadVertexData} or {@link #loadIndexData} replaces the buffer
+ * memory and so releases the ring.
+ *
+ * This method will only succeed if this buffer is actively bound.
+ *
+ * @param vertices  The vertex capacity of the ring
+ * @param indices   The index capacity of the ring
+ */
+void VertexBuffer::setStreamCapacity(GLsizei vertices, GLsizei indices) {
+    GLsizei stride = _stride;
+    RenderThread::post([=] {
+        glBufferData( GL_ARRAY_BUFFER, stride * vertices, NULL, GL_STREAM_DRAW );
+        glBufferData( GL_ELEMENT_ARRAY_BUFFER, indices * sizeof(GLuint), NULL, GL_STREAM_DRAW );
+        CUAssertGLError("VertexBuffer");
+    });
+    _ringVerts = vertices;
+    _ringIndxs = indices;
+    _vertHead  = 0;
+    _indxHead  = 0;
+}
+
+/**
+ * Streams the given vertices and indices into the ring of this buffer.
+ *
+ * The data is written to the next free region of the streaming ring.
+ * The indices are expected to refer to the given vertices (starting at
+ * 0), and are rebased as they are written. The value returned is the
+ * index offset of this data, which must be added to the offset of any
+ * call to {@link #draw} using it.
+ *
+ * If this buffer has no streaming ring, or the ring is too small for this
+ * data, the ring will be (re)allocated to fit it.
+ *
+ * This method will only succeed if this buffer is actively bound.
+ *
+ * @param vdata     The vertices to load
+ * @param vsize     The number of vertices to load
+ * @param idata     The indices to load
+ * @param isize     The number of indices to load
+ *
+ * @return the index offset of the data loaded
+ */
+GLsizei VertexBuffer::streamData(const void* vdata, GLsizei vsize, const GLuint* idata, GLsizei isize) {
+    bool orphan = false;
+    if (vsize == 0 || isize == 0) {
+        return 0;
+    } else if (vsize > _ringVerts || isize > _ringIndxs) {
+        setStreamCapacity(std::max(3*vsize,_ringVerts), std::max(3*isize,_ringIndxs));
+    } else if (_vertHead+vsize > _ringVerts || _indxHead+isize > _ringIndxs) {
+        // Orphan the buffers and start over
+        orphan = true;
+        _vertHead = 0;
+        _indxHead = 0;
+    }
+    
+    // The ring is tracked here, so the offset is known before the upload
+    GLuint base = (GLuint)_vertHead;
+    GLsizei offset = _indxHead;
+    GLsizei stride = _stride;
+    GLsizei ringVerts = _ringVerts;
+    GLsizei ringIndxs = _ringIndxs;
+    _vertHead += vsize;
+    _indxHead += isize;
+    
+    // The command may run after the caller reuses its arrays
+    std::vector<Uint8> verts((const Uint8*)vdata, (const Uint8*)vdata+vsize*stride);
+    std::vector<GLuint> indxs(isize);
+    for(GLsizei ii = 0; ii < isize; ii++) {
+        indxs[ii] = idata[ii]+base;
+    }
+    
+    RenderThread::post([=] {
+        if (orphan) {
+            glBufferData( GL_ARRAY_BUFFER, stride * ringVerts, NULL, GL_STREAM_DRAW );
+            glBufferData( GL_ELEMENT_ARRAY_BUFFER, ringIndxs * sizeof(GLuint), NULL, GL_STREAM_DRAW );
+        }
+        
+        // The ring guarantees these regions are not in use by earlier draws
+        const GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+        void* vdst = glMapBufferRange(GL_ARRAY_BUFFER, base*stride, vsize*stride, access);
+        if (vdst != nullptr) {
+            std::memcpy(vdst, verts.data(), vsize*stride);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            void* idst = glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, offset*sizeof(GLuint),
+                                          isize*sizeof(GLuint), access);
+            if (idst != nullptr) {
+                std::memcpy(idst, indxs.data(), isize*sizeof(GLuint));
+                glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+                CUAssertGLError("VertexBuffer");
+                return;
+            }
+        }
+        
+        // Mapping failed, so orphan and load at the same position
+        glBufferData( GL_ARRAY_BUFFER, stride * ringVerts, NULL, GL_STREAM_DRAW );
+        glBufferData( GL_ELEMENT_ARRAY_BUFFER, ringIndxs * sizeof(GLuint), NULL, GL_STREAM_DRAW );
+        glBufferSubData( GL_ARRAY_BUFFER, base*stride, stride * vsize, verts.data() );
+        glBufferSubData( GL_ELEMENT_ARRAY_BUFFER, offset*sizeof(GLuint), isize * sizeof(GLuint), indxs.data() );
+        CUAssertGLError("VertexBuffer");
+    });
+    return offset;
 }
 
 /**
@@ -322,7 +499,9 @@ void VertexBuffer::loadIndexData(const void * data, GLsizei size, GLenum usage)
  */
 void VertexBuffer::draw(GLenum mode, GLsizei count, GLsizei offset) {
     //CUAssertLog(isBound(), "Vertex buffer is not bound"); // Problems on android emulator for now
-    glDrawElements(mode, count, GL_UNSIGNED_INT, (void*)(offset * sizeof(GLuint)));
+    RenderThread::post([=] {
+        glDrawElements(mode, count, GL_UNSIGNED_INT, (void*)(offset * sizeof(GLuint)));
+    });
 }
 
 /**
@@ -356,7 +535,9 @@ void VertexBuffer::draw(GLenum mode, GLsizei count, GLsizei offset) {
  */
 void VertexBuffer::drawInstanced(GLenum mode, GLsizei count, GLsizei instance, GLsizei offset) {
     //CUAssertLog(isBound(), "Vertex buffer is not bound"); // Problems on android emulator for now
-    glDrawElementsInstanced(mode, count, GL_UNSIGNED_INT, (void*)(offset * sizeof(GLuint)), instance);
+    RenderThread::post([=] {
+        glDrawElementsInstanced(mode, count, GL_UNSIGNED_INT, (void*)(offset * sizeof(GLuint)), instance);
+    });
 }
 
 
@@ -392,17 +573,19 @@ void VertexBuffer::setupAttribute(const std::string name, GLint size, GLenum typ
     
     if (_shader != nullptr) {
         _shader->bind();
-        GLint pos = glGetAttribLocation(_shader->getProgram(), name.c_str());
-        if (pos == -1) {
-            CUWarn("Active shader has no attribute %s", name.c_str());
-        } else {
-            glEnableVertexAttribArray(pos);
-            glVertexAttribPointer(pos,data.size,data.type,data.norm,_stride,
-                                  reinterpret_cast<void*>(data.offset));
-        }
-        
-        GLenum error = glGetError();
-        CUAssertLog(error == GL_NO_ERROR, "VertexBuffer: %s", gl_error_name(error).c_str());
+        // This must query the shader, so it cannot be deferred
+        RenderThread::call([&] {
+            GLint pos = glGetAttribLocation(_shader->getProgram(), name.c_str());
+            if (pos == -1) {
+                CUWarn("Active shader has no attribute %s", name.c_str());
+            } else {
+                glEnableVertexAttribArray(pos);
+                glVertexAttribPointer(pos,data.size,data.type,data.norm,_stride,
+                                      reinterpret_cast<void*>(data.offset));
+            }
+            
+            CUAssertGLError("VertexBuffer");
+        });
     }
 }
 
@@ -423,7 +606,7 @@ void VertexBuffer::enableAttribute(const std::string name) {
 		_enabled[name] = true;
 		if (_shader != nullptr) {
 			GLint locale = _shader->getUniformLocation(name);
-			glEnableVertexAttribArray(locale);
+			RenderThread::post([=] { glEnableVertexAttribArray(locale); });
 		}
 	}
 }
@@ -445,7 +628,7 @@ void VertexBuffer::disableAttribute(const std::string name) {
 		_enabled[name] = false;
 		if (_shader != nullptr) {
 			GLint locale = _shader->getUniformLocation(name);
-			glDisableVertexAttribArray(locale);
+			RenderThread::post([=] { glDisableVertexAttribArray(locale); });
 		}
 	}    
 }
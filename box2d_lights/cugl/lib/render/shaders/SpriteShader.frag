@@ -40,8 +40,8 @@ uniform int  uType;
 // Blur offset for simple kernel blur
 uniform vec2 uBlur;
 
-// The texture for sampling
-uniform sampler2D uTexture;
+// The textures for sampling (size must agree with DEFAULT_TEXTURE_UNITS)
+uniform sampler2D uTextures[8];
 
 // The output color
 out vec4 frag_color;
@@ -50,6 +50,7 @@ out vec4 frag_color;
 in vec2 outPosition;
 in vec4 outColor;
 in vec2 outTexCoord;
+flat in int outTexSlot;
 
 // The stroke+gradient uniform block
 layout (std140) uniform uContext
@@ -101,6 +102,27 @@ float scissormask(vec2 pt) {
     return clamp(sc.x,0.0,1.0) * clamp(sc.y,0.0,1.0);
 }
 
+/**
+ * Returns the texture sample for the vertex texture unit
+ *
+ * GLSL ES 3.0 only allows sampler arrays to be indexed by
+ * constants, so we must branch on the texture unit.
+ *
+ * coord: The texture coordinate to sample
+ */
+vec4 texsample(vec2 coord) {
+    switch (outTexSlot) {
+        case 1: return texture(uTextures[1], coord);
+        case 2: return texture(uTextures[2], coord);
+        case 3: return texture(uTextures[3], coord);
+        case 4: return texture(uTextures[4], coord);
+        case 5: return texture(uTextures[5], coord);
+        case 6: return texture(uTextures[6], coord);
+        case 7: return texture(uTextures[7], coord);
+    }
+    return texture(uTextures[0], coord);
+}
+
 /**
  * Returns the result of a simple kernel blur
  *
@@ -138,7 +160,7 @@ vec4 blursample(vec2 coord) {
     // Sample from the texture and average
     vec4 result = vec4(0.0);
     for(int ii = 0; ii < 9; ii++) {
-        result += texture(uTexture, coord + off[ii])*kernel[ii];
+        result += texsample(coord + off[ii])*kernel[ii];
     }
 
     return result;
@@ -180,7 +202,7 @@ void main(void) {
         if (uType >= 8) {
             result *= blursample(outTexCoord);
         } else {
-            result *= texture(uTexture, outTexCoord);
+            result *= texsample(outTexCoord);
         }
     }
     
@@ -43,6 +43,10 @@ out vec4 outColor;
 in  vec2 aTexCoord;
 out vec2 outTexCoord;
 
+// Texture unit (for multitexture batching)
+in  float aTexSlot;
+flat out int outTexSlot;
+
 // Matrices
 uniform mat4 uPerspective;
 
@@ -52,6 +56,7 @@ void main(void) {
     outPosition = aPosition.xy; // Need untransformed for scissor
     outColor = aColor;
     outTexCoord = aTexCoord;
+    outTexSlot  = int(aTexSlot);
 }
 
 /////////// SHADER END //////////)"
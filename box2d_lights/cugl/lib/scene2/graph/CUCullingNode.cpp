@@ -0,0 +1,481 @@
+//
+//  CUCullingNode.cpp
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides a scene graph node that only renders the children
+//  that are visible in the current viewport. It maintains a uniform grid
+//  of its children, so that the cost of rendering is proportional to what
+//  is on screen and not the size of the level. This is the preferred root
+//  node for large, scrolling worlds.
+//
+//  Visibility is determined by the culling bounds of each child (which
+//  default to the content bounds). See SceneNode for more information.
+//
+//  This class uses our standard shared-pointer architecture.
+//
+//  1. The constructor does not perform any initialization; it just sets all
+//     attributes to their defaults.
+//
+//  2. All initialization takes place via init methods, which can fail if an
+//     object is initialized more than once.
+//
+//  3. All allocation takes place via static constructors which return a shared
+//     pointer.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Walker White
+//  Version: 5/12/21
+#include <cugl/scene2/graph/CUCullingNode.h>
+#include <cugl/render/CUScissor.h>
+#include <cugl/assets/CUJsonValue.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace cugl;
+using namespace cugl::scene2;
+
+#pragma mark Constructors
+/**
+ * Creates an uninitialized culling node.
+ *
+ * You must initialize this CullingNode before use.
+ *
+ * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate a CullingNode
+ * on the heap, use one of the static constructors instead.
+ */
+CullingNode::CullingNode() :
+_cellSize(CU_CULLING_CELL_SIZE),
+_culling(true),
+_stamp(0) {
+}
+
+/**
+ * Disposes all of the resources used by this node.
+ *
+ * A disposed CullingNode can be safely reinitialized. Any children owned by
+ * this node will be released. They will be deleted if no other object owns them.
+ *
+ * It is unsafe to call this on a CullingNode that is still currently inside
+ * of a scene graph.
+ */
+void CullingNode::dispose() {
+    SceneNode::dispose();
+    _entries.clear();
+    _cells.clear();
+    _globals.clear();
+    _pending.clear();
+    _visible.clear();
+    _cellSize = CU_CULLING_CELL_SIZE;
+    _culling = true;
+    _stamp = 0;
+}
+
+/**
+ * Initializes a culling node at the world origin with the given cell size.
+ *
+ * The node has both position and size (0,0).
+ *
+ * @param size  The size of a grid cell in node coordinates
+ *
+ * @return true if initialization was successful.
+ */
+bool CullingNode::initWithCellSize(float size) {
+    CUAssertLog(size > 0, "Cell size must be positive");
+    if (init()) {
+        _cellSize = size;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Initializes a culling node with the given bounds and cell size.
+ *
+ * The rectangle origin is the bottom left corner of the node in parent
+ * space, and corresponds to the origin of the Node space. The size defines
+ * its content width and height. The node is anchored in the center and has
+ * position origin-(width/2,height/2) in parent space.
+ *
+ * @param size  The size of a grid cell in node coordinates
+ * @param rect  The bounds of the node in parent space
+ *
+ * @return true if initialization was successful.
+ */
+bool CullingNode::initWithCellSize(float size, const Rect rect) {
+    CUAssertLog(size > 0, "Cell size must be positive");
+    if (initWithBounds(rect)) {
+        _cellSize = size;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Initializes a node with the given JSON specificaton.
+ *
+ * This initializer is designed to receive the "data" object from the
+ * JSON passed to {@link Scene2Loader}. This JSON format supports all
+ * of the attribute values of its parent class. In addition, it supports
+ * the following additional attributes:
+ *
+ *      "cell size":    A number for the size of a grid cell
+ *      "culling":      A boolean indicating whether culling is active
+ *
+ * All attributes are optional. There are no required attributes.
+ *
+ * @param loader    The scene loader passing this JSON file
+ * @param data      The JSON object specifying the node
+ *
+ * @return true if initialization was successful.
+ */
+bool CullingNode::initWithData(const Scene2Loader* loader, const std::shared_ptr<JsonValue>& data) {
+    if (!SceneNode::initWithData(loader,data)) {
+        return false;
+    } else if (!data) {
+        return true;
+    }
+    
+    _cellSize = data->getFloat("cell size",CU_CULLING_CELL_SIZE);
+    _culling  = data->getBool("culling",true);
+    CUAssertLog(_cellSize > 0, "'cell size' must be positive");
+    return true;
+}
+
+#pragma mark -
+#pragma mark Attributes
+/**
+ * Sets the size of a grid cell in node coordinates.
+ *
+ * Cells should be on the order of the size of a typical child. Cells that
+ * are too small force large children to be stored in many cells, while
+ * cells that are too large test too many off-screen children.
+ *
+ * Changing the cell size rebuilds the grid at the next render pass.
+ *
+ * @param size  The size of a grid cell in node coordinates.
+ */
+void CullingNode::setCellSize(float size) {
+    CUAssertLog(size > 0, "Cell size must be positive");
+    if (size == _cellSize) {
+        return;
+    }
+    _cellSize = size;
+    _cells.clear();
+    _globals.clear();
+    for(auto it = _entries.begin(); it != _entries.end(); ++it) {
+        it->second.placed = false;
+        if (!it->second.dirty) {
+            it->second.dirty = true;
+            _pending.push_back(it->first);
+        }
+    }
+}
+
+#pragma mark -
+#pragma mark Scene Graph
+/**
+ * Adds a child to this node with the given z-order.
+ *
+ * The child is inserted into the grid at the next render pass.
+ *
+ * @param child A child node.
+ * @param zval  The (new) child z-order.
+ */
+void CullingNode::addChild(const std::shared_ptr<SceneNode>& child, int zval) {
+    SceneNode::addChild(child,zval);
+    invalidateChild(child.get());
+}
+
+/**
+ * Removes the child at the given position from this node.
+ *
+ * Removing a child alters the position of every child after it. Hence
+ * it is unsafe to cache child positions.
+ *
+ * @param pos   The position of the child node which will be removed.
+ */
+void CullingNode::removeChild(unsigned int pos) {
+    CUAssertLog(pos < _children.size(), "Position index out of bounds");
+    forget(_children[pos].get());
+    SceneNode::removeChild(pos);
+}
+
+/**
+ * Removes all children from this node.
+ */
+void CullingNode::removeAllChildren() {
+    _entries.clear();
+    _cells.clear();
+    _globals.clear();
+    _pending.clear();
+    _visible.clear();
+    SceneNode::removeAllChildren();
+}
+
+#pragma mark -
+#pragma mark Spatial Index
+/**
+ * Notifies this node that the bounds of the given child may have changed.
+ *
+ * This marks the child to be reinserted into the grid at the next render
+ * pass. If the given node is no longer a child, it is removed from the
+ * index instead.
+ *
+ * @param child The child whose bounds may have changed
+ */
+void CullingNode::invalidateChild(SceneNode* child) {
+    if (child->_parent != this) {
+        forget(child);
+        return;
+    }
+    
+    auto it = _entries.find(child);
+    if (it == _entries.end()) {
+        Entry& entry = _entries[child];
+        entry.node = child;
+        entry.minx = entry.miny = 0;
+        entry.maxx = entry.maxy = -1;
+        entry.global = false;
+        entry.unbounded = false;
+        entry.placed = false;
+        entry.dirty  = true;
+        entry.stamp  = _stamp;
+        _pending.push_back(child);
+    } else if (!it->second.dirty) {
+        it->second.dirty = true;
+        _pending.push_back(child);
+    }
+}
+
+/**
+ * Inserts the given entry into the grid.
+ *
+ * This method recomputes the culling box of the child.
+ *
+ * @param entry The entry to insert
+ */
+void CullingNode::place(Entry* entry) {
+    SceneNode* node = entry->node;
+    entry->bounds = node->getCullingBox();
+    entry->unbounded = !node->_hasCullBounds && node->_contentSize.width == 0 && node->_contentSize.height == 0;
+    entry->minx = (int)std::floor(entry->bounds.getMinX()/_cellSize);
+    entry->miny = (int)std::floor(entry->bounds.getMinY()/_cellSize);
+    entry->maxx = (int)std::floor(entry->bounds.getMaxX()/_cellSize);
+    entry->maxy = (int)std::floor(entry->bounds.getMaxY()/_cellSize);
+    
+    Sint64 span = (Sint64)(entry->maxx-entry->minx+1)*(Sint64)(entry->maxy-entry->miny+1);
+    entry->global = entry->unbounded || span > CU_CULLING_CELL_LIMIT;
+    if (entry->global) {
+        _globals.push_back(entry);
+    } else {
+        for(int yy = entry->miny; yy <= entry->maxy; yy++) {
+            for(int xx = entry->minx; xx <= entry->maxx; xx++) {
+                _cells[cellKey(xx,yy)].push_back(entry);
+            }
+        }
+    }
+    entry->placed = true;
+}
+
+/**
+ * Removes the given entry from the grid.
+ *
+ * @param entry The entry to remove
+ */
+void CullingNode::unplace(Entry* entry) {
+    if (!entry->placed) {
+        return;
+    }
+    if (entry->global) {
+        auto it = std::find(_globals.begin(),_globals.end(),entry);
+        if (it != _globals.end()) {
+            *it = _globals.back();
+            _globals.pop_back();
+        }
+    } else {
+        for(int yy = entry->miny; yy <= entry->maxy; yy++) {
+            for(int xx = entry->minx; xx <= entry->maxx; xx++) {
+                auto cell = _cells.find(cellKey(xx,yy));
+                if (cell == _cells.end()) {
+                    continue;
+                }
+                std::vector<Entry*>& list = cell->second;
+                auto it = std::find(list.begin(),list.end(),entry);
+                if (it != list.end()) {
+                    *it = list.back();
+                    list.pop_back();
+                }
+                if (list.empty()) {
+                    _cells.erase(cell);
+                }
+            }
+        }
+    }
+    entry->placed = false;
+}
+
+/**
+ * Removes the given child from the index.
+ *
+ * @param child The child to remove
+ */
+void CullingNode::forget(SceneNode* child) {
+    auto it = _entries.find(child);
+    if (it != _entries.end()) {
+        unplace(&(it->second));
+        _entries.erase(it);
+    }
+}
+
+/**
+ * Reinserts all of the children that have changed since the last pass.
+ */
+void CullingNode::refresh() {
+    for(auto it = _pending.begin(); it != _pending.end(); ++it) {
+        auto jt = _entries.find(*it);
+        if (jt == _entries.end() || !jt->second.dirty) {
+            continue;
+        }
+        Entry* entry = &(jt->second);
+        unplace(entry);
+        place(entry);
+        entry->dirty = false;
+    }
+    _pending.clear();
+}
+
+/**
+ * Stores the visible children in the scratch buffer _visible.
+ *
+ * The children are stored in rendering order.
+ *
+ * @param transform     The global transform of this node
+ * @param perspective   The combined camera matrix
+ */
+void CullingNode::query(const Mat4& transform, const Mat4& perspective) {
+    refresh();
+    _visible.clear();
+    
+    Mat4 clip;
+    Mat4::multiply(transform,perspective,&clip);
+    if (!clip.isInvertible()) {
+        for(auto it = _children.begin(); it != _children.end(); ++it) {
+            _visible.push_back(it->get());
+        }
+        return;
+    }
+    
+    // Pull the clip box back into node space
+    Rect view;
+    clip.invert();
+    Mat4::transform(clip,Rect(-1.0f,-1.0f,2.0f,2.0f),&view);
+    
+    int minx = (int)std::floor(view.getMinX()/_cellSize);
+    int miny = (int)std::floor(view.getMinY()/_cellSize);
+    int maxx = (int)std::floor(view.getMaxX()/_cellSize);
+    int maxy = (int)std::floor(view.getMaxY()/_cellSize);
+    Sint64 span = (Sint64)(maxx-minx+1)*(Sint64)(maxy-miny+1);
+    
+    if (span > (Sint64)_cells.size()) {
+        // Zoomed out; cheaper to test every child
+        for(auto it = _entries.begin(); it != _entries.end(); ++it) {
+            Entry& entry = it->second;
+            if (entry.unbounded || entry.bounds.doesIntersect(view)) {
+                _visible.push_back(entry.node);
+            }
+        }
+    } else {
+        _stamp++;
+        for(auto it = _globals.begin(); it != _globals.end(); ++it) {
+            Entry* entry = *it;
+            if (entry->unbounded || entry->bounds.doesIntersect(view)) {
+                _visible.push_back(entry->node);
+            }
+        }
+        for(int yy = miny; yy <= maxy; yy++) {
+            for(int xx = minx; xx <= maxx; xx++) {
+                auto cell = _cells.find(cellKey(xx,yy));
+                if (cell == _cells.end()) {
+                    continue;
+                }
+                for(auto it = cell->second.begin(); it != cell->second.end(); ++it) {
+                    Entry* entry = *it;
+                    if (entry->stamp != _stamp) {
+                        entry->stamp = _stamp;
+                        if (entry->bounds.doesIntersect(view)) {
+                            _visible.push_back(entry->node);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    
+    // Restore the pre-order traversal
+    std::sort(_visible.begin(),_visible.end(),[](SceneNode* a, SceneNode* b) {
+        return a->_childOffset < b->_childOffset;
+    });
+}
+
+#pragma mark -
+#pragma mark Rendering
+/**
+ * Draws this node and all of its visible children with the given SpriteBatch.
+ *
+ * The viewport is determined by the perspective matrix of the sprite batch.
+ * Children whose culling boxes are outside of that viewport are skipped
+ * (together with all of their descendants).
+ *
+ * @param batch     The SpriteBatch to draw with.
+ * @param transform The global transformation matrix.
+ * @param tint      The tint to blend with the node color.
+ */
+void CullingNode::render(const std::shared_ptr<SpriteBatch>& batch, const Mat4& transform, Color4 tint) {
+    if (!_culling) {
+        SceneNode::render(batch,transform,tint);
+        return;
+    } else if (!_isVisible) {
+        return;
+    }
+    
+    const Mat4& matrix = updateWorldTransform(transform);
+    if (_hasCullBounds && isCulled(_cullBounds,matrix,batch->getPerspective())) {
+        return;
+    }
+    Color4 color = _tintColor;
+    if (_hasParentColor) {
+        color *= tint;
+    }
+    
+    if (_scissor) {
+        batch->pushScissor(*_scissor,matrix);
+    }
+    
+    draw(batch,matrix,color);
+    query(matrix,batch->getPerspective());
+    for(auto it = _visible.begin(); it != _visible.end(); ++it) {
+        (*it)->render(batch, matrix, color);
+    }
+    
+    if (_scissor) {
+        batch->popScissor();
+    }
+}
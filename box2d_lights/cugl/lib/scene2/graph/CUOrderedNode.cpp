@@ -45,10 +45,28 @@
 //  Version: 3/7/21
 #include <cugl/scene2/graph/CUOrderedNode.h>
 #include <cugl/render/CUScissor.h>
+#include <cstring>
 
 using namespace cugl;
 using namespace cugl::scene2;
 
+/**
+ * Returns an unsigned key with the same sort order as the given float
+ *
+ * Positive floats have their sign bit set, while negative floats are
+ * inverted. This gives an order on the bit patterns that agrees with
+ * the order on the floats.
+ *
+ * @param value The float to convert
+ *
+ * @return an unsigned key with the same sort order as the given float
+ */
+static Uint32 sortKey(float value) {
+    Uint32 bits;
+    std::memcpy(&bits, &value, sizeof(Uint32));
+    return (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+}
+
 #pragma mark Context
 /**
  * Creates a drawing context with the given parent object
@@ -57,8 +75,9 @@ using namespace cugl::scene2;
  */
 OrderedNode::Context::Context(OrderedNode* parent) :
 node(nullptr),
-scissor(nullptr),
-canonical(0) {
+scissor(-1),
+canonical(0),
+key(0) {
     this->parent = parent;
     tint = Color4::WHITE;
 }
@@ -73,6 +92,7 @@ OrderedNode::Context::Context(const Context& copy) {
     node = copy.node;
     scissor = copy.scissor;
     canonical = copy.canonical;
+    key = copy.key;
     transform = copy.transform;
     tint = copy.tint;
 }
@@ -82,7 +102,7 @@ OrderedNode::Context::Context(const Context& copy) {
  */
 OrderedNode::Context::~Context() {
     node = nullptr;
-    scissor = nullptr;
+    scissor = -1;
 }
 
 /**
@@ -128,6 +148,11 @@ bool OrderedNode::Context::sortCompare(Context* a, Context* b) {
                 return a->canonical < b->canonical;
             }
             return a->node->getPriority() > b->node->getPriority();
+        case TOP_DOWN:
+            if (a->key == b->key) {
+                return a->canonical < b->canonical;
+            }
+            return a->key < b->key;
     }
     return false;
 }
@@ -143,7 +168,9 @@ bool OrderedNode::Context::sortCompare(Context* a, Context* b) {
  * on the heap, use one of the static constructors instead.
  */
 OrderedNode::OrderedNode() :
-_viewport(nullptr),
+_entryCount(0),
+_maskCount(0),
+_viewport(-1),
 _order(PRE_ORDER) {
 }
 
@@ -162,7 +189,11 @@ void OrderedNode::dispose() {
         *it = nullptr;
     }
     _entries.clear();
-    _viewport = nullptr;
+    _scratch.clear();
+    _masks.clear();
+    _entryCount = 0;
+    _maskCount = 0;
+    _viewport = -1;
     SceneNode::dispose();
 }
 
@@ -267,6 +298,8 @@ bool OrderedNode::initWithData(const Scene2Loader* loader, const std::shared_ptr
                 _order = Order::POST_ASCEND;
             } else if (value == "post-descend") {
                 _order = Order::POST_DESCEND;
+            } else if (value == "top-down") {
+                _order = Order::TOP_DOWN;
             }
         }
         return true;
@@ -297,15 +330,19 @@ void OrderedNode::visit(const std::shared_ptr<SceneNode>& node, const Mat4& tran
     }
     
     // We need to capture the important sprite batch state
-    std::shared_ptr<Scissor> previous = _viewport;
-    std::shared_ptr<Scissor> current = nullptr;
-    if (node->getScissor()) {
-        current = Scissor::alloc(node->getScissor());
-        current->setTransform(matrix);
-        if (previous) {
-            current = previous->getIntersection(current, false);
+    Sint32 previous = _viewport;
+    const std::shared_ptr<Scissor> mask = node->getScissor();
+    if (mask) {
+        if (_maskCount == _masks.size()) {
+            _masks.emplace_back();
+        }
+        Scissor& current = _masks[_maskCount];
+        current = *mask;
+        current.setTransform(matrix);
+        if (previous >= 0) {
+            current = _masks[previous].getIntersection(current, false);
         }
-        _viewport = current;
+        _viewport = (Sint32)_maskCount++;
     }
     
     // Identify pre or post. Block at child ordered nodes
@@ -319,15 +356,40 @@ void OrderedNode::visit(const std::shared_ptr<SceneNode>& node, const Mat4& tran
     }
     
     // Capture pre or post order traversal
-    Uint32 canonical = (_entries.empty() ? 0 : _entries.back()->canonical+1);
+    Uint32 canonical = (Uint32)_entryCount;
     
-    Context* context = new Context(this);
-    _entries.push_back(context);
+    Context* context;
+    if (_entryCount < _entries.size()) {
+        context = _entries[_entryCount];
+    } else {
+        context = new Context(this);
+        _entries.push_back(context);
+    }
+    _entryCount++;
     context->node = node;
     context->transform = barrier ? transform : matrix;
     context->scissor = _viewport;
     context->tint = barrier ? tint : color;
     context->canonical = canonical;
+    switch (_order) {
+        case ASCEND:
+            context->key = sortKey(node->getPriority());
+            break;
+        case DESCEND:
+            context->key = ~sortKey(node->getPriority());
+            break;
+        case TOP_DOWN:
+        {
+            // The anchor of the node in world space
+            Vec2 pos = node->getPosition();
+            const float* m = transform.m;
+            context->key = ~sortKey(pos.x*m[1]+pos.y*m[5]+m[13]);
+        }
+            break;
+        default:
+            context->key = 0;
+            break;
+    }
     
     if (!ispost && !barrier) {
         auto children = node->getChildren();
@@ -360,34 +422,56 @@ void OrderedNode::render(const std::shared_ptr<SpriteBatch>& batch, const Mat4&
         // Drop to standard for efficiency
         SceneNode::render(batch,transform,tint);
     } else {
-        Mat4 matrix;
-        Mat4::multiply(_combined,transform,&matrix);
+        const Mat4& matrix = updateWorldTransform(transform);
         Color4 color = _tintColor;
         if (_hasParentColor) {
             color *= tint;
         }
         
-        // Capture sprite batch context
-        std::shared_ptr<Scissor> active = batch->getScissor();
-        _viewport = active;
+        // The batch intersects our masks with any active scissor
         if (_scissor) {
-            std::shared_ptr<Scissor> local = Scissor::alloc(_scissor);
-            local->setTransform(matrix);
-            if (active) {
-                local = active->getIntersection(local, false);
-            }
-            _viewport = local;
+            batch->pushScissor(*_scissor,matrix);
         }
+        _maskCount = 0;
+        _viewport = -1;
 
         // Build and sort
+        _entryCount = 0;
         for(auto it = _children.begin(); it != _children.end(); ++it) {
             visit(*it, matrix, color);
         }
 
-        std::sort(_entries.begin(), _entries.end(), Context::sortCompare);
-        for(auto it = _entries.begin(); it != _entries.end(); ++it) {
+        auto stop = _entries.begin()+_entryCount;
+        switch (_order) {
+            case ASCEND:
+            case DESCEND:
+            case TOP_DOWN:
+                radixSort();
+                break;
+            case PRE_ASCEND:
+            case PRE_DESCEND:
+            case POST_ASCEND:
+            case POST_DESCEND:
+                std::sort(_entries.begin(), stop, Context::sortCompare);
+                break;
+            default:
+                // The queue is built in canonical order
+                break;
+        }
+
+        Sint32 current = -1;
+        for(auto it = _entries.begin(); it != stop; ++it) {
             Context* context = *it;
-            batch->setScissor(context->scissor); // This is in render, so must be applied
+            if (context->scissor != current) {
+                // This is in render, so must be applied
+                if (current >= 0) {
+                    batch->popScissor();
+                }
+                current = context->scissor;
+                if (current >= 0) {
+                    batch->pushScissor(_masks[current]);
+                }
+            }
             if (context->node->getClassName() == getClassName()) {
                 // Render barrier at an ordered node
                 context->node->render(batch, context->transform, context->tint);
@@ -396,13 +480,65 @@ void OrderedNode::render(const std::shared_ptr<SpriteBatch>& batch, const Mat4&
             }
         }
 
-        // Clean up and restore state
-        for(auto it = _entries.begin(); it != _entries.end(); ++it) {
-            delete *it;
-            *it = nullptr;
+        // Release the nodes, but keep the contexts for the next pass
+        for(auto it = _entries.begin(); it != stop; ++it) {
+            (*it)->node = nullptr;
+            (*it)->scissor = -1;
+        }
+        _entryCount = 0;
+        _maskCount = 0;
+        _viewport = -1;
+        if (current >= 0) {
+            batch->popScissor();
         }
-        _entries.clear();
-        _viewport = nullptr;
-        batch->setScissor(active);
+        if (_scissor) {
+            batch->popScissor();
+        }
+    }
+}
+
+/**
+ * Sorts the render queue by the key of each context.
+ *
+ * This is a least significant digit radix sort on the 32-bit keys, using
+ * 8 bits per pass. Passes where every key has the same digit are skipped.
+ * As the sort is stable, and the queue is built in canonical order, all
+ * ties are broken by the canonical order.
+ */
+void OrderedNode::radixSort() {
+    size_t size = _entryCount;
+    if (size < 2) {
+        return;
+    } else if (_scratch.size() < size) {
+        _scratch.resize(_entries.size());
+    }
+    
+    Context** source = _entries.data();
+    Context** target = _scratch.data();
+    size_t counts[256];
+    for(int shift = 0; shift < 32; shift += 8) {
+        std::memset(counts, 0, sizeof(counts));
+        for(size_t ii = 0; ii < size; ii++) {
+            counts[(source[ii]->key >> shift) & 0xff]++;
+        }
+        if (counts[(source[0]->key >> shift) & 0xff] == size) {
+            continue;
+        }
+        
+        size_t offset = 0;
+        for(int ii = 0; ii < 256; ii++) {
+            size_t amt = counts[ii];
+            counts[ii] = offset;
+            offset += amt;
+        }
+        for(size_t ii = 0; ii < size; ii++) {
+            Context* context = source[ii];
+            target[counts[(context->key >> shift) & 0xff]++] = context;
+        }
+        std::swap(source, target);
+    }
+    
+    if (source != _entries.data()) {
+        std::memcpy(_entries.data(), source, size*sizeof(Context*));
     }
 }
@@ -442,11 +442,7 @@ void PathNode::draw(const std::shared_ptr<SpriteBatch>& batch, const Mat4& trans
     }
     batch->setBlendEquation(_blendEquation);
     batch->setBlendFunc(_srcFactor, _dstFactor);
-    if (_stroke > 0) {
-        batch->fill(_mesh, transform);
-    } else {
-        batch->outline(_mesh, transform);
-    }
+    drawRenderData(batch, transform, _stroke <= 0);
     batch->setGradient(nullptr);
 }
 
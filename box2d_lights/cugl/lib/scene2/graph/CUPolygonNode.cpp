@@ -133,7 +133,7 @@ void PolygonNode::draw(const std::shared_ptr<SpriteBatch>& batch, const Mat4& tr
     }
     batch->setBlendEquation(_blendEquation);
     batch->setBlendFunc(_srcFactor, _dstFactor);
-    batch->fill(_mesh, transform);
+    drawRenderData(batch, transform, false);
     batch->setGradient(nullptr);
 }
 
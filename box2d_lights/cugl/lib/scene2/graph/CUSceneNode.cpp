@@ -41,11 +41,28 @@
 #include <cugl/util/CUStrings.h>
 #include <cugl/assets/CUAssetManager.h>
 #include <sstream>
+#include <cstring>
 #include <algorithm>
 
 using namespace cugl;
 using namespace cugl::scene2;
 
+/**
+ * Returns true if the given matrix is a 2d affine transform.
+ *
+ * Such a matrix only has values in the x and y rows and columns (and the
+ * translation), so it can be represented exactly by an {@link Affine2}.
+ *
+ * @param mat   The matrix to test
+ *
+ * @return true if the given matrix is a 2d affine transform.
+ */
+static bool isAffine2D(const Mat4& mat) {
+    return (mat.m[2] == 0 && mat.m[3] == 0 && mat.m[6] == 0 && mat.m[7] == 0 &&
+            mat.m[8] == 0 && mat.m[9] == 0 && mat.m[10] == 1 && mat.m[11] == 0 &&
+            mat.m[14] == 0 && mat.m[15] == 1);
+}
+
 #pragma mark Constructors
 /**
  * Creates an uninitialized node.
@@ -63,9 +80,15 @@ _tintColor(Color4::WHITE),
 _hasParentColor(true),
 _isVisible(true),
 _anchor(Vec2::ANCHOR_BOTTOM_LEFT),
+_hasCullBounds(false),
 _scale(Vec2::ONE),
 _angle(0),
 _useTransform(false),
+_local2D(true),
+_world2D(true),
+_worldDirty(true),
+_worldVersion(0),
+_parentVersion(0),
 _parent(nullptr),
 _graph(nullptr),
 _zOrder(0),
@@ -261,11 +284,15 @@ void SceneNode::dispose() {
     _tintColor = Color4::WHITE;
     _hasParentColor = true;
     _isVisible = true;
+    _cullBounds = Rect::ZERO;
+    _hasCullBounds = false;
     _scale = Vec2::ONE;
     _angle = 0;
     _transform = Mat4::IDENTITY;
     _useTransform = false;
     _combined = Mat4::IDENTITY;
+    _local2D = true;
+    _worldDirty = true;
     _parent = nullptr;
     _graph = nullptr;
     _childOffset = -2;
@@ -295,11 +322,15 @@ SceneNode* SceneNode::copy(SceneNode* dst) {
     dst->_tintColor = _tintColor;
     dst->_hasParentColor = _hasParentColor;
     dst->_isVisible = _isVisible;
+    dst->_cullBounds = _cullBounds;
+    dst->_hasCullBounds = _hasCullBounds;
     dst->_scale = _scale;
     dst->_angle = _angle;
     dst->_transform = _transform;
     dst->_useTransform = _useTransform;
     dst->_combined = _combined;
+    dst->_local2D = _local2D;
+    dst->_worldDirty = true;
     dst->_tag = _tag;
     dst->_name = _name;
     dst->_hashOfName = _hashOfName;
@@ -327,6 +358,10 @@ void SceneNode::setPosition(float x, float y) {
     _combined.m[12] += (x-_position.x);
     _combined.m[13] += (y-_position.y);
     _position.set(x,y);
+    _worldDirty = true;
+    if (_parent) {
+        _parent->invalidateChild(this);
+    }
 }
 
 /**
@@ -345,7 +380,11 @@ void SceneNode::setPosition(float x, float y) {
 void SceneNode::setContentSize(const Size size) {
     _position += _anchor*(size-_contentSize);
     _contentSize.set(size);
-    if (!_useTransform) updateTransform();
+    if (!_useTransform) {
+        updateTransform();
+    } else if (_parent) {
+        _parent->invalidateChild(this);
+    }
     if (_layout) {
         doLayout();
     }
@@ -403,6 +442,42 @@ std::string SceneNode::toString(bool verbose) const {
     return ss.str();
 }
 
+/**
+ * Sets the culling bounds of this node.
+ *
+ * These bounds are specified in node space. They should contain
+ * everything drawn by this node and its descendants. When these
+ * bounds are outside of the viewport of the active {@link SpriteBatch},
+ * neither this node nor its descendants are drawn.
+ *
+ * Culling bounds are a promise by the programmer. If a descendant
+ * draws outside of these bounds, it may disappear prematurely as
+ * it approaches the edge of the screen.
+ *
+ * @param bounds    The culling bounds of this node.
+ */
+void SceneNode::setCullingBounds(const Rect& bounds) {
+    _cullBounds = bounds;
+    _hasCullBounds = true;
+    if (_parent) {
+        _parent->invalidateChild(this);
+    }
+}
+
+/**
+ * Removes any explicit culling bounds from this node.
+ *
+ * Once removed, this node will always be rendered by {@link #render},
+ * unless it is culled by a {@link CullingNode} parent.
+ */
+void SceneNode::clearCullingBounds() {
+    _cullBounds = Rect::ZERO;
+    _hasCullBounds = false;
+    if (_parent) {
+        _parent->invalidateChild(this);
+    }
+}
+
 #pragma mark -
 #pragma mark Transforms
 /**
@@ -502,6 +577,11 @@ void SceneNode::updateTransform() {
     }
     _combined.m[12] += _position.x-offset.x;
     _combined.m[13] += _position.y-offset.y;
+    _local2D = !_useTransform || isAffine2D(_transform);
+    _worldDirty = true;
+    if (_parent) {
+        _parent->invalidateChild(this);
+    }
 }
 
 
@@ -639,6 +719,8 @@ void SceneNode::swapChild(const std::shared_ptr<SceneNode>& child1,
     child1->setParent(nullptr);
     child2->pushScene(_graph);
     child1->pushScene(nullptr);
+    invalidateChild(child1.get());
+    invalidateChild(child2.get());
     
     // Check if we are dirty and/or inherit children
     bool childdirty = false;
@@ -863,10 +945,33 @@ bool SceneNode::compareNodeSibs(const std::shared_ptr<SceneNode>& a,
  * Sorting does not happen automatically (except within a {@link Scene}).
  * It is the responsibility of a user to call this method before rendering.
  * Otherwise, render order will be in the unsorted order.
+ *
+ * Children usually move only a few places between sorts (such as when
+ * moving characters change their z-value). So this method uses an
+ * insertion sort, which is linear time when the children are almost
+ * sorted. If the children are badly out of order, it finishes with
+ * std::sort instead.
  */
 void SceneNode::sortZOrder() {
     if (_zDirty) {
-        std::sort(_children.begin(),_children.end(),SceneNode::compareNodeSibs);
+        // Insertion sort with a budget of moves
+        size_t budget = 4*_children.size();
+        size_t moves = 0;
+        for(size_t ii = 1; ii < _children.size() && moves <= budget; ii++) {
+            if (!compareNodeSibs(_children[ii],_children[ii-1])) {
+                continue;
+            }
+            std::shared_ptr<SceneNode> node = std::move(_children[ii]);
+            size_t jj = ii;
+            for(; jj > 0 && compareNodeSibs(node,_children[jj-1]); jj--) {
+                _children[jj] = std::move(_children[jj-1]);
+            }
+            _children[jj] = std::move(node);
+            moves += ii-jj;
+        }
+        if (moves > budget) {
+            std::sort(_children.begin(),_children.end(),SceneNode::compareNodeSibs);
+        }
         // Fix the offsets
         int ii = 0;
         for(auto it = _children.begin(); it != _children.end(); ++it ) {
@@ -900,21 +1005,17 @@ void SceneNode::sortZOrder() {
 void SceneNode::render(const std::shared_ptr<SpriteBatch>& batch, const Mat4& transform, Color4 tint) {
     if (!_isVisible) { return; }
     
-    Mat4 matrix;
-    Mat4::multiply(_combined,transform,&matrix);
+    const Mat4& matrix = updateWorldTransform(transform);
+    if (_hasCullBounds && isCulled(_cullBounds,matrix,batch->getPerspective())) {
+        return;
+    }
     Color4 color = _tintColor;
     if (_hasParentColor) {
         color *= tint;
     }
     
-    std::shared_ptr<Scissor> active = batch->getScissor();
     if (_scissor) {
-        std::shared_ptr<Scissor> local = Scissor::alloc(_scissor);
-        local->setTransform(matrix);
-        if (active) {
-            local = active->getIntersection(local, false);
-        }
-        batch->setScissor(local);
+        batch->pushScissor(*_scissor,matrix);
     }
 
     draw(batch,matrix,color);
@@ -923,8 +1024,86 @@ void SceneNode::render(const std::shared_ptr<SpriteBatch>& batch, const Mat4& tr
     }
 
     if (_scissor) {
-        batch->setScissor(active);
+        batch->popScissor();
+    }
+}
+
+/**
+ * Returns true if the given bounds are outside of the viewport.
+ *
+ * The bounds are specified in the coordinate space defined by the
+ * given transform. The perspective is the combined camera matrix of
+ * the {@link SpriteBatch}. The test is conservative: rotated bounds
+ * are tested by their axis-aligned box in clip space.
+ *
+ * @param bounds        The bounds to test
+ * @param transform     The global transform of the bounds
+ * @param perspective   The combined camera matrix
+ *
+ * @return true if the given bounds are outside of the viewport.
+ */
+bool SceneNode::isCulled(const Rect& bounds, const Mat4& transform, const Mat4& perspective) {
+    Mat4 clip;
+    Mat4::multiply(transform,perspective,&clip);
+    Rect box;
+    Mat4::transform(clip,bounds,&box);
+    return !box.doesIntersect(Rect(-1.0f,-1.0f,2.0f,2.0f));
+}
+
+#pragma mark -
+#pragma mark Transform Caching
+/**
+ * Returns the node-to-world transform for the given parent transform.
+ *
+ * The result is cached. If transform is the cached world transform of
+ * the parent, this method only checks whether this node or its parent
+ * changed since the last call, making static subtrees free to traverse.
+ * Otherwise, the transform is compared against the one used in the
+ * last call. The transforms are composed as {@link Affine2} objects
+ * whenever both of them are 2d.
+ *
+ * The value returned is a reference to the cache, and may be passed
+ * to the children of this node as their parent transform.
+ *
+ * @param transform The parent-to-world transform
+ *
+ * @return the node-to-world transform for the given parent transform.
+ */
+const Mat4& SceneNode::updateWorldTransform(const Mat4& transform) {
+    bool inherited = (_parent != nullptr && &transform == &(_parent->_world));
+    if (!_worldDirty) {
+        if (inherited && _parentVersion == _parent->_worldVersion) {
+            return _world;
+        } else if (!inherited && std::memcmp(transform.m, _worldBase.m, sizeof(_worldBase.m)) == 0) {
+            return _world;
+        }
+    }
+    
+    // Version 0 is never used by a computed world transform
+    _parentVersion = inherited ? _parent->_worldVersion : 0;
+    _worldBase = transform;
+    
+    bool parent2D = inherited ? _parent->_world2D : isAffine2D(transform);
+    if (_local2D && parent2D) {
+        Affine2 local;
+        local.set(_combined);
+        if (inherited) {
+            Affine2::multiply(local, _parent->_worldAffine, &_worldAffine);
+        } else {
+            Affine2::multiply(local, transform, &_worldAffine);
+        }
+        _world.set(_worldAffine);
+        _world2D = true;
+    } else {
+        Mat4::multiply(_combined, transform, &_world);
+        _world2D = false;
+    }
+    
+    _worldDirty = false;
+    if (++_worldVersion == 0) {
+        _worldVersion = 1;
     }
+    return _world;
 }
 
 /**
@@ -37,6 +37,7 @@
 #include <cugl/assets/CUScene2Loader.h>
 #include <cugl/assets/CUAssetManager.h>
 #include <sstream>
+#include <cstring>
 
 using namespace cugl::scene2;
 
@@ -63,7 +64,10 @@ _srcFactor(GL_SRC_ALPHA),
 _dstFactor(GL_ONE_MINUS_SRC_ALPHA),
 _flipHorizontal(false),
 _flipVertical(false),
-_absolute(false) {
+_absolute(false),
+_cached(false),
+_cacheDepth(0),
+_cacheVersion(0) {
     _name = "TexturedNode";
 }
 
@@ -86,6 +90,11 @@ void TexturedNode::dispose() {
     _flipVertical = false;
     _polygon.clear();
     _mesh.clear();
+    _cacheMesh.clear();
+    _cacheBase = Mat4::IDENTITY;
+    _cacheDepth = 0;
+    _cacheVersion = 0;
+    _cached = false;
     SceneNode::dispose();
 }
 
@@ -386,6 +395,7 @@ void TexturedNode::shiftPolygon(float dx, float dy) {
         it->texcoord.x += dx/w;
         it->texcoord.y -= dy/h;
     }
+    _cached = false;
 }
 
 /**
@@ -504,7 +514,86 @@ void TexturedNode::generateRenderData() {
 void TexturedNode::clearRenderData() {
     _mesh.clear();
     _rendered = false;
+    _cached = false;
+}
+
+/**
+ * Returns true if the world space render data is ready for this transform.
+ *
+ * Most nodes do not move from frame to frame. So once a node has been
+ * drawn with the same transform and depth twice in a row, this method
+ * transforms the render data into world space and caches it. From that
+ * point on, the node can be drawn with the cached mesh, which the sprite
+ * batch copies without any per-vertex transform. The cache is rebuilt
+ * whenever the render data changes.
+ *
+ * If this method returns false, the node is moving, and it should be
+ * drawn with the node space render data instead.
+ *
+ * @param transform The global transformation matrix.
+ * @param depth     The sprite batch depth
+ *
+ * @return true if the world space render data is ready for this transform.
+ */
+bool TexturedNode::cacheRenderData(const Mat4& transform, float depth) {
+    // The world transform version makes the common case a single comparison
+    bool inherited = (&transform == &_world);
+    bool same = (depth == _cacheDepth);
+    if (same && inherited && _cacheVersion != 0) {
+        same = (_cacheVersion == _worldVersion);
+    } else if (same) {
+        same = std::memcmp(transform.m, _cacheBase.m, sizeof(_cacheBase.m)) == 0;
+    }
+    
+    if (!same) {
+        _cacheBase = transform;
+        _cacheDepth = depth;
+        _cacheVersion = inherited ? _worldVersion : 0;
+        _cached = false;
+        return false;
+    } else if (_cached) {
+        return true;
+    }
     
+    _cacheMesh.command = _mesh.command;
+    _cacheMesh.indices = _mesh.indices;
+    _cacheMesh.vertices.resize(_mesh.vertices.size());
+    for(size_t ii = 0; ii < _mesh.vertices.size(); ii++) {
+        const SpriteVertex2& src = _mesh.vertices[ii];
+        SpriteVertex3& dst = _cacheMesh.vertices[ii];
+        dst.position = Vec3(src.position,depth);
+        dst.position *= transform;
+        dst.color = src.color;
+        dst.texcoord = src.texcoord;
+        dst.texslot = 0;
+    }
+    _cached = true;
+    return true;
+}
+
+/**
+ * Draws the render data with the given SpriteBatch.
+ *
+ * This method uses the world space render data whenever it is ready (see
+ * {@link #cacheRenderData}). All other sprite batch state must be set
+ * before calling this method.
+ *
+ * @param batch     The SpriteBatch to draw with.
+ * @param transform The global transformation matrix.
+ * @param outline   Whether to outline the mesh instead of filling it
+ */
+void TexturedNode::drawRenderData(const std::shared_ptr<SpriteBatch>& batch, const Mat4& transform, bool outline) {
+    if (cacheRenderData(transform, batch->getDepth())) {
+        if (outline) {
+            batch->outline(_cacheMesh);
+        } else {
+            batch->fill(_cacheMesh);
+        }
+    } else if (outline) {
+        batch->outline(_mesh, transform);
+    } else {
+        batch->fill(_mesh, transform);
+    }
 }
 
 /**
@@ -531,5 +620,6 @@ void TexturedNode::updateTextureCoords() {
         _mesh.vertices[ii].texcoord.x = s*_texture->getMaxS()+(1-s)*_texture->getMinS();
         _mesh.vertices[ii].texcoord.y = t*_texture->getMaxT()+(1-t)*_texture->getMinT();
     }
+    _cached = false;
 }
 
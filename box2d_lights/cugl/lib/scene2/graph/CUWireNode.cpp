@@ -387,7 +387,7 @@ void WireNode::draw(const std::shared_ptr<SpriteBatch>& batch, const Mat4& trans
     }
     batch->setBlendEquation(_blendEquation);
     batch->setBlendFunc(_srcFactor, _dstFactor);
-    batch->outline(_mesh, transform);
+    drawRenderData(batch, transform, true);
     batch->setGradient(nullptr);
 
 }
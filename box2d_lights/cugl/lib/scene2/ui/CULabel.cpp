@@ -41,6 +41,7 @@
 #include <cugl/scene2/ui/CULabel.h>
 #include <cugl/assets/CUScene2Loader.h>
 #include <cugl/assets/CUAssetManager.h>
+#include <utf8/utf8.h>
 
 using namespace cugl::scene2;
 
@@ -64,7 +65,9 @@ _valign(VAlign::BOTTOM),
 _rendered(false),
 _blendEquation(GL_FUNC_ADD),
 _srcFactor(GL_SRC_ALPHA),
-_dstFactor(GL_ONE_MINUS_SRC_ALPHA)
+_dstFactor(GL_ONE_MINUS_SRC_ALPHA),
+_atlasVersion(0),
+_validGlyphs(0)
 {}
 
 /**
@@ -86,6 +89,8 @@ void Label::dispose() {
     _valign = VAlign::BOTTOM;
     _padding = Vec2::ZERO;
     _rendered = false;
+    _glyphs.clear();
+    _layout.clear();
     SceneNode::dispose();
 }
 
@@ -290,23 +295,28 @@ bool Label::initWithData(const Scene2Loader* loader, const std::shared_ptr<JsonV
  */
 void Label::setText(const std::string& text, bool resize) {
     // Let's strip the non-printable characters first
-    _text.clear();
-    _text.reserve(text.size());
+    std::string stripped;
+    stripped.reserve(text.size());
     for(auto it = text.begin(); it != text.end(); ++it) {
         if (((Uint32)*it) > 32 && *it != 127) {
-            _text.push_back(*it);
+            stripped.push_back(*it);
         } else {
-            _text.push_back(' ');
+            stripped.push_back(' ');
         }
     }
+    if (_rendered && !resize && stripped == _text) {
+        return;
+    }
     
+    _text.swap(stripped);
+    layoutText();
     computeSize();
     setHorizontalAlignment(_halign);
     setVerticalAlignment(_valign);
     if (resize) {
         setContentSize(_textbounds.size);
     }
-    clearRenderData();
+    _rendered = false;
 }
 
 /**
@@ -355,7 +365,7 @@ void Label::setPadding(float padx, float pady) {
     }
     
     _padding.set(padx,pady);
-    clearRenderData();
+    _rendered = false;
 }
 
 /**
@@ -392,7 +402,7 @@ void Label::setHorizontalAlignment(HAlign halign) {
     
     
     _halign = halign;
-    clearRenderData();
+    _rendered = false;
 }
 
 /**
@@ -428,7 +438,7 @@ void Label::setVerticalAlignment(VAlign valign) {
     }
 
     _valign = valign;
-    clearRenderData();
+    _rendered = false;
 }
 
 /**
@@ -515,7 +525,14 @@ void Label::setBackground(Color4 color) {
  * @param tint      The tint to blend with the Node color.
  */
 void Label::draw(const std::shared_ptr<SpriteBatch>& batch, const Mat4& transform, Color4 tint) {
-    if (!_rendered) {
+    // Protect our glyphs from eviction until this batch is drawn
+    if (_font->hasDynamicAtlas()) {
+        _font->setFrameStamp(batch->getFrameStamp());
+        if (_rendered) {
+            _font->reserveGlyphs(_glyphs);
+        }
+    }
+    if (!_rendered || _atlasVersion != _font->getAtlasVersion()) {
         generateRenderData();
     }
 
@@ -545,27 +562,145 @@ void Label::draw(const std::shared_ptr<SpriteBatch>& batch, const Mat4& transfor
  * done manually.
  */
 void Label::computeSize() {
-    _textbounds.size = _font->getSize(_text);
-    _truebounds = _font->getInternalBounds(_text);
+    if (!_font->hasAtlas()) {
+        _textbounds.size = _font->getSize(_text);
+        _truebounds = _font->getInternalBounds(_text);
+    } else {
+        // Measure from the layout. This agrees with the font atlas measurements.
+        _textbounds.size = Size(0,(float)_font->getHeight());
+        _truebounds = Rect::ZERO;
+        if (!_layout.empty()) {
+            const GlyphLayout& first = _layout.front();
+            const GlyphLayout& last  = _layout.back();
+            int maxy = 0;
+            int miny = 0;
+            for(auto it = _layout.begin(); it != _layout.end(); ++it) {
+                maxy = (it->metrics.maxy > maxy ? it->metrics.maxy : maxy);
+                miny = (it->metrics.miny < miny ? it->metrics.miny : miny);
+            }
+            
+            _textbounds.size.width = last.pen+last.metrics.advance;
+            _truebounds.origin.x = (float)first.metrics.minx;
+            _truebounds.size.width = _textbounds.size.width-first.metrics.minx;
+            if (_glyphs.back() != 32) {
+                _truebounds.size.width -= last.metrics.advance-last.metrics.maxx;
+                _truebounds.origin.y = (float)(-_font->getDescent()+miny);
+                _truebounds.size.height = (float)(maxy-miny);
+            }
+        }
+    }
     
     // This will fix the offsets
     setHorizontalAlignment(_halign);
     setVerticalAlignment(_valign);
 }
 
+/**
+ * Lays out the glyphs of the current text, reusing the previous layout.
+ *
+ * The layout of every glyph before the first change is preserved, as
+ * are the quads for those glyphs. The quads for all other glyphs are
+ * removed from the mesh.
+ */
+void Label::layoutText() {
+    std::string::iterator end_it = utf8::find_invalid(_text.begin(), _text.end());
+    CUAssertLog(end_it == _text.end(), "String '%s' has an invalid UTF-8 encoding",_text.c_str());
+    std::vector<Uint32> utf32;
+    utf8::utf8to32(_text.begin(), end_it, back_inserter(utf32));
+    
+    // Missing glyphs are dropped, just as in the font
+    std::vector<Uint32> glyphs;
+    glyphs.reserve(utf32.size());
+    for(auto it = utf32.begin(); it != utf32.end(); ++it) {
+        if (_font->hasGlyph(*it)) {
+            glyphs.push_back(*it);
+        }
+    }
+    
+    // Everything before the first change is still valid
+    size_t keep = 0;
+    while (keep < glyphs.size() && keep < _glyphs.size() && glyphs[keep] == _glyphs[keep]) {
+        keep++;
+    }
+    if (keep < _validGlyphs) {
+        GLuint cut = _layout[keep].vertex;
+        _mesh.vertices.resize(cut);
+        _mesh.indices.resize(cut/4*6);
+        _validGlyphs = keep;
+    }
+    
+    _glyphs.swap(glyphs);
+    _layout.resize(_glyphs.size());
+    for(size_t ii = keep; ii < _glyphs.size(); ii++) {
+        GlyphLayout& layout = _layout[ii];
+        layout.metrics = _font->getMetrics(_glyphs[ii]);
+        layout.vertex = 0;
+        layout.pen = 0;
+        if (ii > 0) {
+            const GlyphLayout& prev = _layout[ii-1];
+            layout.pen  = prev.pen+prev.metrics.advance;
+            layout.pen -= (int)_font->getKerning(_glyphs[ii-1],_glyphs[ii]);
+        }
+    }
+}
+
 /**
  * Allocate the render data necessary to render this node.
+ *
+ * If the font has an atlas, this method only generates quads for the
+ * glyphs that have changed. The quads of the other glyphs are shifted
+ * if the text origin has changed.
  */
 void Label::generateRenderData() {
     // Make the backdrop
     _bounds = Rect(Vec2::ZERO,getContentSize());
+    
+    // Without an atlas, the text is a single rendered texture
+    if (!_font->hasAtlas()) {
+        _mesh.clear();
+        _mesh.command = GL_TRIANGLES;
+        _texture = _font->getMesh(_text, _textbounds.origin, _mesh);
+        for(auto it = _mesh.vertices.begin(); it != _mesh.vertices.end(); ++it) {
+            it->color = _foreground;
+        }
+        _atlasVersion = _font->getAtlasVersion();
+        _validGlyphs = 0;
+        _rendered = true;
+        return;
+    }
+
+    // A dynamic atlas may move glyphs to make room for ours
+    _font->reserveGlyphs(_glyphs);
+    if (_atlasVersion != _font->getAtlasVersion()) {
+        _validGlyphs = 0;
+    }
+    if (_validGlyphs == 0) {
+        _mesh.clear();
+        _mesh.command = GL_TRIANGLES;
+    } else if (_meshOrigin != _textbounds.origin) {
+        Vec2 delta = _textbounds.origin-_meshOrigin;
+        for(auto it = _mesh.vertices.begin(); it != _mesh.vertices.end(); ++it) {
+            it->position += delta;
+        }
+    }
+    _meshOrigin = _textbounds.origin;
 
     // Glyphs are defined by _textbounds, regardless of alignment
-    _texture = _font->getMesh(_text, _textbounds.origin, _mesh);
+    _texture = _font->getAtlas();
+    Rect rect(_textbounds.origin,_textbounds.size);
+    for(size_t ii = _validGlyphs; ii < _glyphs.size(); ii++) {
+        GlyphLayout& layout = _layout[ii];
+        layout.vertex = (GLuint)_mesh.vertices.size();
+        Vec2 offset(_meshOrigin.x+layout.pen,_meshOrigin.y);
+        _font->getQuad(_glyphs[ii], offset, rect, _mesh);
+    }
+    // Reused quads may predate a foreground change, so recolor all of them
     for(auto it = _mesh.vertices.begin(); it != _mesh.vertices.end(); ++it) {
         it->color = _foreground;
     }
 
+    _validGlyphs  = _glyphs.size();
+    _atlasVersion = _font->getAtlasVersion();
     _rendered = true;
 }
 
@@ -575,6 +710,7 @@ void Label::generateRenderData() {
 void Label::clearRenderData() {
     _mesh.clear();
     _mesh.command = GL_TRIANGLES;
+    _validGlyphs = 0;
     _rendered = false;
 }
 
@@ -0,0 +1,422 @@
+//
+//  TCUAudioTest.cpp
+//  Cornell University Game Library (CUGL)
+//
+//  This module is a unit test and benchmark suite for the audio graph and the
+//  DSP filters. It renders every graph with an AudioRenderer, so it does not
+//  need an audio device, a window, or a running application. This allows it
+//  to run headless on a build server.
+//
+//  The benchmarks time each node type and filter at several block sizes. A
+//  graph that cannot render in real time at a block size fails its assert.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Walker White
+//  Version: 5/12/21
+
+#include "TCUAudioTest.h"
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <cugl/cugl.h>
+
+using namespace cugl;
+using namespace cugl::audio;
+using namespace cugl::dsp;
+
+/** The number of seconds rendered by each benchmark */
+#define BENCH_SECONDS   2.0
+/** The sample rate of each benchmark */
+#define BENCH_RATE      48000
+/** The number of channels of each benchmark */
+#define BENCH_CHANNELS  2
+/** The number of inputs of the mixing benchmarks */
+#define BENCH_WIDTH     8
+/** The number of lanes of the biquad bank benchmark */
+#define BENCH_LANES     8
+
+/** The block sizes for each benchmark */
+static const Uint32 BLOCK_SIZES[] = { 64, 128, 256, 512, 1024, 2048 };
+/** The number of block sizes */
+#define BLOCK_COUNT     6
+
+/** A function to build an audio graph for a benchmark */
+typedef std::function<std::shared_ptr<AudioNode>()> GraphBuilder;
+
+/**
+ * Returns an in-memory sample with a sine tone on every channel
+ *
+ * @param channels  The number of audio channels
+ * @param rate      The sample rate (frequency) in HZ
+ * @param seconds   The duration of the sample
+ *
+ * @return an in-memory sample with a sine tone on every channel
+ */
+static std::shared_ptr<AudioSample> toneSample(Uint8 channels, Uint32 rate, double seconds) {
+    Uint32 frames = (Uint32)(seconds*rate);
+    std::shared_ptr<AudioSample> result = AudioSample::alloc(channels,rate,frames);
+    CUAssertAlwaysLog(result != nullptr, "Could not allocate a tone sample");
+    float* buffer = result->getBuffer();
+    for(Uint32 ii = 0; ii < frames; ii++) {
+        for(Uint32 ch = 0; ch < channels; ch++) {
+            buffer[ii*channels+ch] = 0.5f*sinf(2*M_PI*440.0f*ii/rate+ch);
+        }
+    }
+    return result;
+}
+
+/**
+ * Fills the given buffer with a sine tone
+ *
+ * @param buffer    The buffer to fill
+ * @param size      The number of samples in the buffer
+ */
+static void toneBuffer(float* buffer, size_t size) {
+    for(size_t ii = 0; ii < size; ii++) {
+        buffer[ii] = 0.5f*sinf(ii * M_PI / 10.0f);
+    }
+}
+
+#pragma mark -
+#pragma mark Renderer
+/**
+ * Unit test for the offline audio renderer
+ *
+ * This verifies that a graph renders without an audio device.
+ */
+void cugl::testRenderer() {
+    CULog("Running tests for AudioRenderer.\n");
+
+#pragma mark Headless Test
+    std::shared_ptr<AudioRenderer> renderer = AudioRenderer::alloc(BENCH_CHANNELS,BENCH_RATE,256);
+    CUAssertAlwaysLog(renderer != nullptr, "Renderer could not be allocated headless");
+    CUAssertAlwaysLog(AudioNode::getDefaultReadSize() == 256, "Renderer did not set the default read size");
+
+    std::shared_ptr<AudioSample> sample = toneSample(BENCH_CHANNELS,BENCH_RATE,0.5);
+    std::shared_ptr<AudioPlayer> player = AudioPlayer::alloc(sample);
+    CUAssertAlwaysLog(player != nullptr, "Player could not be allocated headless");
+    CUAssertAlwaysLog(renderer->attach(player), "Player could not be attached to renderer");
+
+#pragma mark Render Test
+    std::shared_ptr<AudioSample> result = renderer->render(1.0);
+    CUAssertAlwaysLog(result != nullptr, "Renderer did not produce a sample");
+    CUAssertAlwaysLog(result->getLength() == BENCH_RATE, "Renderer produced %lld frames",
+                      result->getLength());
+    CUAssertAlwaysLog(renderer->completed(), "Renderer did not complete with its graph");
+
+    int same = -1;
+    float* expect = sample->getBuffer();
+    float* actual = result->getBuffer();
+    Sint64 size = sample->getLength()*BENCH_CHANNELS;
+    for(Sint64 ii = 0; same == -1 && ii < size; ii++) {
+        if (fabsf(expect[ii]-actual[ii]) >= CU_MATH_EPSILON) {
+            same = (int)ii;
+        }
+    }
+    CUAssertAlwaysLog(same == -1, "Render failed at position %d [%f vs %f]",
+                      same,expect[same],actual[same]);
+
+    same = -1;
+    for(Sint64 ii = size; same == -1 && ii < result->getLength()*BENCH_CHANNELS; ii++) {
+        if (actual[ii] != 0) {
+            same = (int)ii;
+        }
+    }
+    CUAssertAlwaysLog(same == -1, "Render is not silent at position %d",same);
+
+#pragma mark Statistics Test
+    CUAssertAlwaysLog(renderer->getFrames() == BENCH_RATE, "Renderer counted %llu frames",
+                      renderer->getFrames());
+    CUAssertAlwaysLog(renderer->getBlocks() == (BENCH_RATE+255)/256, "Renderer counted %llu blocks",
+                      renderer->getBlocks());
+    renderer->resetStatistics();
+    CUAssertAlwaysLog(renderer->getFrames() == 0, "Statistics reset failed");
+
+#pragma mark Complete
+    renderer->detach();
+    CULog("AudioRenderer tests complete.\n");
+}
+
+#pragma mark -
+#pragma mark Node Benchmarks
+/**
+ * Times the graph from the given builder at the given block size
+ *
+ * The graph is built after the renderer is allocated, so that its nodes
+ * are sized to the block. The graph must render in real time.
+ *
+ * @param ident     The benchmark name
+ * @param builder   The function to build the graph
+ * @param block     The block size
+ */
+static void benchGraph(const char* ident, const GraphBuilder& builder, Uint32 block) {
+    std::shared_ptr<AudioRenderer> renderer = AudioRenderer::alloc(BENCH_CHANNELS,BENCH_RATE,block);
+    std::shared_ptr<AudioNode> graph = builder();
+    CUAssertAlwaysLog(graph != nullptr, "%s could not be built headless",ident);
+    CUAssertAlwaysLog(renderer->attach(graph), "%s could not be attached to renderer",ident);
+
+    std::shared_ptr<AudioSample> result = renderer->render(BENCH_SECONDS);
+    CUAssertAlwaysLog(result != nullptr, "%s did not render",ident);
+
+    bool silent = true;
+    float* buffer = result->getBuffer();
+    for(Sint64 ii = 0; silent && ii < result->getLength()*BENCH_CHANNELS; ii++) {
+        silent = (buffer[ii] == 0);
+    }
+    CUAssertAlwaysLog(!silent, "%s rendered silence",ident);
+
+    double factor = renderer->getRealtimeFactor();
+    CULog("%s [%d]: %.1fx real time, %llu micros max block, %llu overruns",ident,block,
+          factor,renderer->getMaxBlockMicros(),renderer->getOverruns());
+    CUAssertAlwaysLog(factor > 1.0, "%s cannot render in real time at block size %d",ident,block);
+    renderer->detach();
+}
+
+/**
+ * Benchmark for each audio graph node type at several block sizes
+ */
+void cugl::benchNodes() {
+    CULog("Running benchmarks for audio nodes.\n");
+
+    std::shared_ptr<AudioSample> sample = toneSample(BENCH_CHANNELS,BENCH_RATE,BENCH_SECONDS);
+    std::shared_ptr<AudioSample> offrate = toneSample(BENCH_CHANNELS,44100,BENCH_SECONDS);
+
+    for(int ii = 0; ii < BLOCK_COUNT; ii++) {
+        Uint32 block = BLOCK_SIZES[ii];
+
+#pragma mark Player Benchmark
+        benchGraph("player", [=] {
+            return AudioPlayer::alloc(sample);
+        }, block);
+
+#pragma mark Mixer Benchmark
+        benchGraph("mixer", [=] {
+            std::shared_ptr<AudioMixer> mixer = AudioMixer::alloc(BENCH_WIDTH,BENCH_CHANNELS,BENCH_RATE);
+            for(Uint8 slot = 0; slot < BENCH_WIDTH; slot++) {
+                mixer->attach(slot,AudioPlayer::alloc(sample));
+            }
+            return mixer;
+        }, block);
+
+#pragma mark Panner Benchmark
+        benchGraph("panner", [=] {
+            std::shared_ptr<AudioPanner> panner = AudioPanner::alloc(BENCH_CHANNELS,BENCH_RATE);
+            panner->attach(AudioPlayer::alloc(sample));
+            panner->setPan(0,1,0.5f);
+            return panner;
+        }, block);
+
+#pragma mark Spinner Benchmark
+        benchGraph("spinner", [=] {
+            std::shared_ptr<AudioSpinner> spinner = AudioSpinner::alloc(BENCH_CHANNELS,BENCH_RATE);
+            spinner->attach(AudioPlayer::alloc(sample));
+            spinner->setAngle(M_PI/4);
+            return spinner;
+        }, block);
+
+#pragma mark Spatializer Benchmark
+        benchGraph("spatializer", [=] {
+            std::shared_ptr<AudioSpatializer> spatial = AudioSpatializer::alloc(BENCH_WIDTH,BENCH_CHANNELS,BENCH_RATE);
+            for(Uint8 slot = 0; slot < BENCH_WIDTH; slot++) {
+                spatial->attach(slot,AudioPlayer::alloc(sample));
+                spatial->setEmitter(slot,Vec2(slot-BENCH_WIDTH/2.0f,1.0f));
+            }
+            return spatial;
+        }, block);
+
+#pragma mark Resampler Benchmark
+        benchGraph("resampler", [=] {
+            std::shared_ptr<AudioResampler> resampler = AudioResampler::alloc(BENCH_CHANNELS,BENCH_RATE);
+            resampler->attach(AudioPlayer::alloc(offrate));
+            return resampler;
+        }, block);
+
+#pragma mark Scheduler Benchmark
+        benchGraph("scheduler", [=] {
+            std::shared_ptr<AudioScheduler> scheduler = AudioScheduler::alloc(BENCH_CHANNELS,BENCH_RATE);
+            scheduler->play(AudioPlayer::alloc(sample),-1);
+            return scheduler;
+        }, block);
+
+#pragma mark Fader Benchmark
+        benchGraph("fader", [=] {
+            std::shared_ptr<AudioFader> fader = AudioFader::alloc(AudioPlayer::alloc(sample));
+            fader->fadeIn(BENCH_SECONDS);
+            return fader;
+        }, block);
+    }
+
+#pragma mark Complete
+    CULog("Audio node benchmarks complete.\n");
+}
+
+#pragma mark -
+#pragma mark Filter Benchmarks
+/**
+ * Times the given filter at the given block size
+ *
+ * The filter processes {@link BENCH_SECONDS} of audio, one block at a time,
+ * exactly as an audio node would.
+ *
+ * @param filter    The filter to time
+ * @param ident     The benchmark name
+ * @param input     The input buffer
+ * @param output    The output buffer
+ * @param stride    The number of interleaved channels
+ * @param block     The block size
+ */
+template<class T> static void benchFilter(T& filter, const char* ident, float* input, float* output,
+                                          unsigned stride, Uint32 block) {
+    Uint32 total = (Uint32)(BENCH_SECONDS*BENCH_RATE);
+    filter.clear();
+
+    Timestamp start;
+    for(Uint32 pos = 0; pos+block <= total; pos += block) {
+        filter.calculate(1.0f, input+pos*stride, output+pos*stride, block);
+    }
+    Timestamp end;
+
+    Uint64 micros = Timestamp::ellapsedMicros(start,end);
+    double factor = micros ? BENCH_SECONDS*1000000.0/micros : INFINITY;
+    CULog("%s [%d]: %llu micros, %.1fx real time",ident,block,micros,factor);
+    CUAssertAlwaysLog(factor > 1.0, "%s cannot filter in real time at block size %d",ident,block);
+}
+
+/**
+ * Times a sample rate conversion at the given block size
+ *
+ * The converter produces {@link BENCH_SECONDS} of audio, one block at a time,
+ * exactly as {@link AudioResampler} would.
+ *
+ * @param filter    The converter to time
+ * @param input     The input buffer
+ * @param output    The output buffer
+ * @param block     The block size
+ */
+static void benchPolyphase(PolyphaseFilter& filter, float* input, float* output, Uint32 block) {
+    Uint32 total = (Uint32)(BENCH_SECONDS*BENCH_RATE);
+    unsigned stride = filter.getChannels();
+    filter.clear();
+
+    Timestamp start;
+    size_t read = 0;
+    for(Uint32 pos = 0; pos+block <= total; pos += block) {
+        size_t needed = filter.getInputNeeded(block);
+        std::memcpy(filter.getInputBuffer(),input+read*stride,needed*stride*sizeof(float));
+        filter.appendInput(needed);
+        read += needed;
+        filter.calculate(output+pos*stride, block);
+    }
+    Timestamp end;
+
+    Uint64 micros = Timestamp::ellapsedMicros(start,end);
+    double factor = micros ? BENCH_SECONDS*1000000.0/micros : INFINITY;
+    CULog("%s [%d]: %llu micros, %.1fx real time","polyphase",block,micros,factor);
+    CUAssertAlwaysLog(factor > 1.0, "%s cannot filter in real time at block size %d","polyphase",block);
+}
+
+/**
+ * Benchmark for each DSP filter at several block sizes
+ */
+void cugl::benchFilters() {
+    CULog("Running benchmarks for DSP filters.\n");
+
+#pragma mark Coefficient Bootstrap
+    std::vector<float> bs;
+    std::vector<float> as;
+    bs.push_back(0.9f);
+    bs.push_back(0.3f);
+    bs.push_back(0.1f);
+    bs.push_back(0.1f);
+    bs.push_back(0.1f);
+
+    as.push_back(1.0f);
+    as.push_back(0.3f);
+    as.push_back(0.1f);
+    as.push_back(0.1f);
+    as.push_back(0.2f);
+
+    std::vector<float> taps;
+    for(int ii = 0; ii < 32; ii++) {
+        taps.push_back(1.0f/32);
+    }
+
+    size_t size = (size_t)(BENCH_SECONDS*BENCH_RATE)*BENCH_LANES;
+    std::vector<float> input(size);
+    std::vector<float> output(size);
+    toneBuffer(input.data(),size);
+
+    OnePoleIIR onepole(BENCH_CHANNELS,0.7f,0.3f);
+    TwoPoleIIR twopole(BENCH_CHANNELS,1.0f,0.3f,0.1f);
+    OneZeroFIR onezero(BENCH_CHANNELS,0.9f,0.3f);
+    TwoZeroFIR twozero(BENCH_CHANNELS,0.9f,0.3f,0.1f);
+    PoleZeroFIR polezero(BENCH_CHANNELS,0.9f,0.3f,0.3f);
+    BiquadIIR biquad(BENCH_CHANNELS,BiquadIIR::Type::LOWPASS,0.1f,0.0f);
+    FIRFilter fir(BENCH_CHANNELS,taps);
+    IIRFilter iir(BENCH_CHANNELS,bs,as);
+
+    BiquadBank bank(BENCH_LANES);
+    for(unsigned lane = 0; lane < BENCH_LANES; lane++) {
+        bank.setType(lane,BiquadIIR::Type::PEAK,0.01f*(lane+1),3.0f);
+    }
+
+    PolyphaseFilter polyphase;
+
+    for(int ii = 0; ii < BLOCK_COUNT; ii++) {
+        Uint32 block = BLOCK_SIZES[ii];
+
+#pragma mark Simple Filters
+        benchFilter<OnePoleIIR>(onepole,"1 pole",input.data(),output.data(),BENCH_CHANNELS,block);
+        benchFilter<TwoPoleIIR>(twopole,"2 pole",input.data(),output.data(),BENCH_CHANNELS,block);
+        benchFilter<OneZeroFIR>(onezero,"1 zero",input.data(),output.data(),BENCH_CHANNELS,block);
+        benchFilter<TwoZeroFIR>(twozero,"2 zero",input.data(),output.data(),BENCH_CHANNELS,block);
+        benchFilter<PoleZeroFIR>(polezero,"pole 0",input.data(),output.data(),BENCH_CHANNELS,block);
+        benchFilter<BiquadIIR>(biquad,"biquad",input.data(),output.data(),BENCH_CHANNELS,block);
+
+#pragma mark General Filters
+        benchFilter<FIRFilter>(fir,"32-tap FIR",input.data(),output.data(),BENCH_CHANNELS,block);
+        benchFilter<IIRFilter>(iir,"a-IIR",input.data(),output.data(),BENCH_CHANNELS,block);
+
+#pragma mark Biquad Bank
+        benchFilter<BiquadBank>(bank,"biquad bank",input.data(),output.data(),BENCH_LANES,block);
+
+#pragma mark Polyphase Filter
+        polyphase.reset(BENCH_CHANNELS,44100,BENCH_RATE,block);
+        benchPolyphase(polyphase,input.data(),output.data(),block);
+    }
+
+#pragma mark Complete
+    CULog("DSP filter benchmarks complete.\n");
+}
+
+#pragma mark -
+#pragma mark Main
+
+/**
+ * Master unit test that invokes all others in this module.
+ */
+void cugl::audioUnitTest() {
+    testRenderer();
+    benchNodes();
+    benchFilters();
+}
@@ -0,0 +1,64 @@
+//
+//  TCUAudioTest.h
+//  Cornell University Game Library (CUGL)
+//
+//  This module is a unit test and benchmark suite for the audio graph and the
+//  DSP filters. It renders every graph with an AudioRenderer, so it does not
+//  need an audio device, a window, or a running application. This allows it
+//  to run headless on a build server.
+//
+//  The benchmarks time each node type and filter at several block sizes. A
+//  graph that cannot render in real time at a block size fails its assert.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Walker White
+//  Version: 5/12/21
+
+#ifndef __T_CU_AUDIO_TEST_H__
+#define __T_CU_AUDIO_TEST_H__
+
+namespace cugl {
+
+/**
+ * Unit test for the offline audio renderer
+ *
+ * This verifies that a graph renders without an audio device.
+ */
+void testRenderer();
+
+/**
+ * Benchmark for each audio graph node type at several block sizes
+ */
+void benchNodes();
+
+/**
+ * Benchmark for each DSP filter at several block sizes
+ */
+void benchFilters();
+
+/**
+ * Master unit test that invokes all others in this module.
+ */
+void audioUnitTest();
+
+}
+
+#endif /* __T_CU_AUDIO_TEST_H__ */
@@ -14,6 +14,7 @@
 
 #include "TCUMathTest.h"
 #include "TCU2DTest.h"
+#include "TCUAudioTest.h"
 
 #include <Accelerate/Accelerate.h>
 
@@ -172,6 +173,12 @@ void testThread() {
 
 
 int main(int argc, char * argv[]) {
+    // The audio suite is headless, so it needs no window or audio device
+    if (argc > 1 && std::string(argv[1]) == "--audio") {
+        cugl::audioUnitTest();
+        return 0;
+    }
+    
     cugl::Application app;
     app.setName("Unit Test");
     app.setOrganization("GDIAC");
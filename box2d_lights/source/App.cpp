@@ -21,6 +21,8 @@ using namespace cugl;
 
 void App::onStartup() {
     srand((unsigned) time(0));
+    // Replay each frame on a GL thread while the next one updates
+    RenderThread::start();
     _assets = AssetManager::alloc();
     _batch  = SpriteBatch::alloc();
     auto cam = OrthographicCamera::alloc(getDisplaySize());
@@ -37,8 +39,15 @@ void App::onStartup() {
 #endif
 
     _assets->attach<Font>(FontLoader::alloc()->getHook());
-    _assets->attach<Texture>(TextureLoader::alloc()->getHook());
-    _assets->attach<Sound>(SoundLoader::alloc()->getHook());
+    std::shared_ptr<TextureLoader> textures = TextureLoader::alloc();
+    textures->setAtlasPacking(true);
+    _assets->attach<Texture>(textures->getHook());
+    // Convert in-memory sounds to the device rate once, at load time
+    std::shared_ptr<SoundLoader> sounds = SoundLoader::alloc();
+    if (AudioEngine::start()) {
+        sounds->setSampleRate(AudioEngine::get()->getSampleRate());
+    }
+    _assets->attach<Sound>(sounds->getHook());
     _assets->attach<scene2::SceneNode>(Scene2Loader::alloc()->getHook());
     _assets->attach<World>(GenericLoader<World>::alloc()->getHook());
 
@@ -53,7 +62,6 @@ void App::onStartup() {
     _assets->loadAsync<World>(GRASS_MAP3_KEY, GRASS_MAP3_JSON, nullptr);
     _assets->loadAsync<World>(GRASS_MAP4_KEY, GRASS_MAP4_JSON, nullptr);
 
-    AudioEngine::start();
     SoundController::init(_assets);
 
     Application::onStartup(); // YOU MUST END with call to parent
@@ -132,6 +140,7 @@ void App::onResume() {
              } else {
                  _loading.dispose(); // Disables the input listeners in this mode
                  _menu.init(_assets);
+                 SoundController::loadSounds();
                  _currentScene = SceneSelect::Menu;
                  _menu.setActive(true);
              }
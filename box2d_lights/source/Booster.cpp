@@ -29,6 +29,7 @@ void Booster::setTextures(const std::shared_ptr<Texture>& boostText) {
 //    _animationNode->setFrame(0);
     _animationNode->setPosition(0,0);
     _sceneNode->addChild(_animationNode);
+    _sceneNode->setCullingBounds(_animationNode->getBoundingBox());
     _texture = boostText;
     _body->SetUserData(this);
 }
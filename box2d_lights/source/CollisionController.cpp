@@ -50,7 +50,7 @@ void CollisionController::hostBeginContact(b2Contact* contact){
             o->setCollected(true);
             p->setOrbScore(p->getOrbScore() + 1);
             world->setOrbCount(world->getCurrOrbCount() - 1);
-            SoundController::playSound(SoundController::Type::ORB, o->getPosition() - localPlayer->getPosition());
+            SoundController::playSound(SoundController::Type::ORB, o->getPosition());
             NetworkController::sendOrbCaptured(o->getID(), p->getID());
         }
     }
@@ -65,18 +65,18 @@ void CollisionController::hostBeginContact(b2Contact* contact){
                 s->setLastUsed(time(NULL));
                 p->setElement(p->getPreyElement());
                 s->setActive(false);
-                SoundController::playSound(SoundController::Type::SWAP, s->getPosition() - localPlayer->getPosition());
+                SoundController::playSound(SoundController::Type::SWAP, s->getPosition());
                 NetworkController::sendPlayerColorSwap(p->getID(), p->getCurrElement(), s->getID());
             }
         } 
         else if (p->getIsInvisible() && s->getActive()) {
             p->setElement(p->getPreyElement());
-            SoundController::playSound(SoundController::Type::SWAP, s->getPosition() - localPlayer->getPosition());
+            SoundController::playSound(SoundController::Type::SWAP, s->getPosition());
         }*/
 
         if (p->getCurrElement() != Element::None && p->getCurrElement() != Element::Aether && s->getActive()) {
             p->setElement(p->getPreyElement());
-            SoundController::playSound(SoundController::Type::SWAP, s->getPosition() - localPlayer->getPosition());
+            SoundController::playSound(SoundController::Type::SWAP, s->getPosition());
             if (!p->getIsInvisible()) {
                 s->setLastUsed(time(NULL));
                 s->setActive(false);
@@ -85,7 +85,7 @@ void CollisionController::hostBeginContact(b2Contact* contact){
         }
         if ((p->getIsIntangible() || p->getIsInvisible()) && p->canSwap()) {
             p->setElement(p->getPreyElement());
-            SoundController::playSound(SoundController::Type::SWAP, s->getPosition() - localPlayer->getPosition());
+            SoundController::playSound(SoundController::Type::SWAP, s->getPosition());
             NetworkController::sendPlayerColorSwap(p->getID(), p->getCurrElement(), s->getID());
         }
     }
@@ -100,7 +100,7 @@ void CollisionController::hostBeginContact(b2Contact* contact){
             e->setPID(p->getID());
             p->setEggId(e->getID());
             p->setHoldingEgg(true);
-            SoundController::playSound(SoundController::Type::EGG, e->getPosition() - localPlayer->getPosition());
+            SoundController::playSound(SoundController::Type::EGG, e->getPosition());
             NetworkController::sendEggCollected(p->getID(), e->getID());
         }
     }
@@ -189,7 +189,7 @@ void CollisionController::helperTag(Player* tagged, Player* tagger, std::shared_
     tagged->setTimeLastTagged(timestamp);
     tagger->incScore(globals::TAG_SCORE);
     tagger->animateTag();
-    SoundController::playSound(SoundController::Type::TAG, tagger->getPosition() - localPlayer->getPosition());
+    SoundController::playSound(SoundController::Type::TAG, tagger->getPosition());
     NetworkController::sendTag(tagged->getID(), tagger->getID(), timestamp, dropEgg);
     if (tagged->getCurrElement() == Element::None) {
         auto egg = world->getEgg(tagged->getEggId());
@@ -16,6 +16,7 @@
 #include "CollisionController.h"
 #include "AbilityController.h"
 #include "MapConstants.h"
+#include "SoundController.h"
 
 #include <cugl/cugl.h>
 #include <iostream>
@@ -354,6 +355,7 @@ void GameScene::update(float timestep) {
     _world->getPhysicsWorld()->update(timestep);
     
     _world->getRayHandler()->update(timestep);
+    SoundController::setListener(_player->getPosition());
 
     auto playPos = _player->getSceneNode()->getPosition();
     playPos += _player->getLinearVelocity().scale(40.0 / pow(max(_player->getLinearVelocity().length(), .000001f), .35));
@@ -157,11 +157,10 @@ struct GameHandler {
     void operator()(NetworkData::Tag & t) const {
         auto tagged = world->getPlayer(t.taggedId);
         auto tagger = world->getPlayer(t.taggerId);
-        auto self = world->getPlayer(network->getPlayerID().value());
         tagged->setIsTagged(true);
         tagged->setTimeLastTagged(t.timestamp);
         tagger->incScore(globals::TAG_SCORE);
-        SoundController::playSound(SoundController::Type::TAG, tagger->getPosition() - self->getPosition());
+        SoundController::playSound(SoundController::Type::TAG, tagger->getPosition());
         if (tagged->getCurrElement() == Element::None && !t.dropEgg) {
             auto egg = world->getEgg(tagged->getEggId());
             egg->setPID(tagger->getID());
@@ -195,8 +194,7 @@ struct GameHandler {
         auto e = world->getEgg(data.eggId);
         e->setCollected(true);
         e->setPID(data.playerId);
-        auto self = world->getPlayer(network->getPlayerID().value());
-        SoundController::playSound(SoundController::Type::EGG, e->getPosition() - self->getPosition());
+        SoundController::playSound(SoundController::Type::EGG, e->getPosition());
     }
     void operator()(NetworkData::EggHatch & data) const {
         auto p = world->getPlayer(data.playerId);
@@ -213,16 +211,14 @@ struct GameHandler {
         o->setCollected(true);
         auto p = world->getPlayer(data.playerId);
         p->setOrbScore(p->getOrbScore() + 1);
-        auto self = world->getPlayer(network->getPlayerID().value());
-        SoundController::playSound(SoundController::Type::ORB, o->getPosition() - self->getPosition());
+        SoundController::playSound(SoundController::Type::ORB, o->getPosition());
     }
     void operator()(NetworkData::Swap & data) const {
         world->getPlayer(data.playerId)->setElement(data.newElement);
         auto s = world->getSwapStation(data.swapId);
         s->setLastUsed(clock());
         s->setActive(false);
-        auto self = world->getPlayer(network->getPlayerID().value());
-        SoundController::playSound(SoundController::Type::SWAP, s->getPosition() - self->getPosition());
+        SoundController::playSound(SoundController::Type::SWAP, s->getPosition());
     }
     void operator()(NetworkData::Position & data) const {
         auto p = world->getPlayer(data.playerId);
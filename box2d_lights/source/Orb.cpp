@@ -28,6 +28,7 @@ void Orb::setTextures(const std::shared_ptr<Texture>& orb) {
 //        _animationNode->setFrame(0);
     _animationNode->setPosition(0,0);
     _sceneNode->addChild(_animationNode);
+    _sceneNode->setCullingBounds(_animationNode->getBoundingBox());
 //    _sceneNode->setAnchor(Vec2::ANCHOR_CENTER);
     _texture = orb;
     _body->SetUserData(this);
@@ -155,6 +155,13 @@ void Player::setTextures(const std::shared_ptr<AssetManager>& assets) {
     _sceneNode->addChild(staffTagNode);
     _sceneNode->addChild(ringNode);
     
+    // The parts are centered on the origin, so the player node has no size
+    Rect bounds = skinNode->getBoundingBox();
+    for (auto it = _animNodes.begin(); it !=  _animNodes.end(); ++it) {
+        bounds.merge((*it).second->getBoundingBox());
+    }
+    _sceneNode->setCullingBounds(bounds);
+    
     _animNodes[_staffTagKey]->setVisible(false);
     
     
@@ -298,6 +305,8 @@ void Player::allocUsernameNode(const std::shared_ptr<cugl::Font>& font) {
     _usernameNode->setScale(10.0f);
     _usernameNode->setForeground(Color4::WHITE);
     _usernameNode->setVisible(true);
+    Rect bounds = _sceneNode->getCullingBounds();
+    _sceneNode->setCullingBounds(bounds.merge(_usernameNode->getBoundingBox()));
     CULog("username is %s", _username.c_str());
 }
 
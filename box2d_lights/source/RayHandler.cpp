@@ -83,6 +83,7 @@ void RayHandler::dispose() {
     _world = nullptr;
     _vbo = nullptr;
     _shader = nullptr;
+    _uPerspective = UniformHandle<Mat4>();
 }
 
 /**
@@ -113,6 +114,8 @@ bool RayHandler::init() {
     _vbo->setupAttribute("aFrac", 1, GL_FLOAT, GL_FALSE, offsetof(LightVert,frac));
     
     _vbo->attach(_shader);
+    _uPerspective = _shader->getUniformHandle<Mat4>("uPerspective");
+    _vbo->setStreamCapacity(3*_maxVertices, 3*_maxIndices);
     
     return true;
 }
@@ -291,16 +294,14 @@ void RayHandler::draw(const std::shared_ptr<SpriteBatch> &batch, const Mat4 &tra
     
     _vbo->bind();
     
-    _vbo->loadVertexData(_vertData, _vertSize, GL_STREAM_DRAW);
-    _vbo->loadIndexData(_indxData, _indxSize, GL_STREAM_DRAW);
+    GLuint index = _vbo->streamData(_vertData, _vertSize, _indxData, _indxSize);
     
     _indxSize = 0;
     _vertSize = 0;
     
     //TODO: Fix, multiply by transform possibly
-    _shader->setUniformMat4("uPerspective", getScene()->getCamera()->getCombined());
+    _uPerspective.set(getScene()->getCamera()->getCombined());
     
-    GLuint index = 0;
     GLuint size = 0;
     
     for (int i = 0; i < _lights.size(); i++) {
@@ -80,6 +80,8 @@ protected:
     
     /** The shader used to render the lights */
     std::shared_ptr<cugl::Shader> _shader;
+    /** The shader perspective matrix */
+    cugl::UniformHandle<cugl::Mat4> _uPerspective;
     /** The vertex buffer used to pass light vertex data to the shader */
     std::shared_ptr<cugl::VertexBuffer> _vbo;
     
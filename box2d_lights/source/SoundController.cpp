@@ -12,12 +12,58 @@
 
 #define NUM_ORB_SOUNDS 4
 #define NUM_TAG_SOUNDS 3
+//total number of sound handles in SOUND_KEYS
+#define NUM_SOUNDS 9
+//number of sound effects that can play at once
+#define NUM_VOICES 8
+//distance from the listener at which sound effects begin to fade
+#define SPATIAL_REFERENCE 12.5f
+//the engine key for the spatializer that plays every sound effect
+#define SPATIAL_KEY "sfx"
 
 namespace SoundController{
 std::shared_ptr<cugl::AssetManager> _assets;
 bool spatialAudioEnabled = true;
 float soundVolume = 0.5;
 
+//asset key for each sound handle
+const char* SOUND_KEYS[NUM_SOUNDS] = {
+    "orb1", "orb2", "orb3", "orb4", "egg", "tag1", "tag2", "tag3", "swap"
+};
+
+//the sound handles for a type, and its priority for voice stealing
+struct SoundGroup {
+    int first;
+    int count;
+    int priority;
+};
+
+//indexed by Type
+const SoundGroup GROUPS[] = {
+    {0, NUM_ORB_SOUNDS, 0}, // ORB
+    {4, 1, 1},              // EGG
+    {5, NUM_TAG_SOUNDS, 2}, // TAG
+    {8, 1, 1}               // SWAP
+};
+
+//a voice is a spatializer slot, and owns a player for every sound handle,
+//so playing never allocates
+//the players are double buffered, as a stolen voice may not have released
+//its old player yet
+struct Voice {
+    std::vector<std::shared_ptr<cugl::audio::AudioNode>> players[2];
+    int flip = 0;
+    int priority = -1;
+    Uint64 started = 0;
+};
+
+std::vector<Voice> voices;
+//places every voice relative to the listener on the audio thread
+std::shared_ptr<cugl::audio::AudioSpatializer> spatializer;
+float volumes[NUM_SOUNDS];
+Uint64 playCount = 0;
+bool loaded = false;
+
 
 void useSpatialAudio(bool useSpatialAudio){
     spatialAudioEnabled = useSpatialAudio;
@@ -25,57 +71,117 @@ void useSpatialAudio(bool useSpatialAudio){
 
 void init(std::shared_ptr<cugl::AssetManager> assets){
     _assets = assets;
+    voices.clear();
+    spatializer = nullptr;
+    loaded = false;
+}
+
+void loadSounds(){
+    voices.clear();
+    voices.resize(NUM_VOICES);
+    for(int ii = 0; ii < NUM_SOUNDS; ii++){
+        std::shared_ptr<cugl::Sound> sample = _assets->get<cugl::Sound>(SOUND_KEYS[ii]);
+        volumes[ii] = sample == nullptr ? 1 : sample->getVolume();
+    }
+    //the loader converts the sound effects to the device rate, so the spatializer matches it
+    cugl::AudioEngine* engine = cugl::AudioEngine::get();
+    Uint32 rate = engine == nullptr ? 0 : engine->getSampleRate();
+    spatializer = cugl::audio::AudioSpatializer::alloc(NUM_VOICES, 2, rate == 0 ? 48000 : rate);
+    spatializer->setReference(SPATIAL_REFERENCE);
+    for(int ii = 0; ii < NUM_VOICES; ii++){
+        Voice& voice = voices[ii];
+        for(int jj = 0; jj < 2; jj++){
+            voice.players[jj].resize(NUM_SOUNDS);
+            for(int kk = 0; kk < NUM_SOUNDS; kk++){
+                std::shared_ptr<cugl::Sound> sample = _assets->get<cugl::Sound>(SOUND_KEYS[kk]);
+                std::shared_ptr<cugl::audio::AudioNode> node = sample == nullptr ? nullptr : sample->createNode();
+                //any sample the loader did not convert (e.g. a streamed one) is resampled here
+                if(node != nullptr && node->getRate() != spatializer->getRate()){
+                    auto resampler = cugl::audio::AudioResampler::alloc(node->getChannels(), spatializer->getRate());
+                    if(resampler != nullptr && resampler->attach(node)){
+                        node = resampler;
+                    }
+                }
+                voice.players[jj][kk] = node;
+            }
+        }
+    }
+    loaded = true;
 }
 
 void playSound(Type s, cugl::Vec2 pos){
-    std::shared_ptr<cugl::Sound> sample;
-    switch(s){
-        case Type::EGG:
-            sample = _assets->get<cugl::Sound>("egg");
-            break;
-        case Type::ORB:
-        {
-            int soundnum = (rand() % NUM_ORB_SOUNDS) + 1;
-            sample = _assets->get<cugl::Sound>("orb"+std::to_string(soundnum));
+    if(!loaded){
+        loadSounds();
+    }
+    const SoundGroup& group = GROUPS[static_cast<int>(s)];
+    int handle = group.first;
+    if(group.count > 1){
+        handle += rand() % group.count;
+    }
+    
+    //the engine may have cleared the spatializer between scenes
+    cugl::AudioEngine* engine = cugl::AudioEngine::get();
+    if(!engine->isActive(SPATIAL_KEY)){
+        engine->play(SPATIAL_KEY, spatializer, false, soundVolume, true);
+    }
+    
+    //take a free voice, or else steal the oldest voice of the lowest priority
+    int slot = -1;
+    for(int ii = 0; ii < NUM_VOICES; ii++){
+        const Voice& other = voices[ii];
+        if(!spatializer->isActive(ii)){
+            slot = ii;
             break;
         }
-        case Type::TAG:
-        {
-            int soundnum = (rand() % NUM_TAG_SOUNDS) + 1;
-            sample = _assets->get<cugl::Sound>("tag"+std::to_string(soundnum));
-            break;
+        if(other.priority > group.priority){
+            continue;
         }
-        case Type::SWAP:
-            sample = _assets->get<cugl::Sound>("swap");
-            break;
-        default:
-            return;
+        if(slot == -1 || other.priority < voices[slot].priority ||
+           (other.priority == voices[slot].priority && other.started < voices[slot].started)){
+            slot = ii;
+        }
+    }
+    if(slot == -1){
+        //every voice is playing something more important
+        return;
+    }
+    
+    Voice* voice = &voices[slot];
+    voice->flip = 1-voice->flip;
+    const std::shared_ptr<cugl::audio::AudioNode>& node = voice->players[voice->flip][handle];
+    if(node == nullptr){
+        return;
     }
-    std::shared_ptr<cugl::audio::AudioNode> node = sample->createNode();
+    node->reset();
     
+    //attenuation and panning happen in the spatializer, once per audio buffer
     if(spatialAudioEnabled){
-        std::shared_ptr<cugl::audio::AudioSpinner> spatial = cugl::audio::AudioSpinner::alloc();
-//        spatial->setChannelPlan(cugl::audio::AudioSpinner::Plan::SIDE_STEREO);
-        spatial->attach(node);
-//        spatial->setAngle(pos.getAngle());
-        float gain = pos.length() * (4.0/50.0);
-//        float gain = std::pos(pos.length() * (4.0/50.0), 2.0);
-        if(gain <= 1){
-            node->setGain(1);
-        }else{
-            node->setGain(1/gain);
-        }
-        //TODO: replace with key
-        cugl::AudioEngine::get()->play(std::to_string(rand()), spatial, false, soundVolume);
+        node->setGain(1);
+        spatializer->setEmitter(slot, pos);
     }else{
-        //TODO: replace with key
-        cugl::AudioEngine::get()->play(std::to_string(rand()), node, false, soundVolume);
+        node->setGain(volumes[handle]);
+        spatializer->setEmitter(slot, cugl::Vec2::ZERO, true);
+    }
+    if(!spatializer->attach(slot, node)){
+        //the spatializer logged the mismatch, so skip this sound
+        return;
+    }
+    voice->priority = group.priority;
+    voice->started = ++playCount;
+}
+
+void setListener(cugl::Vec2 pos){
+    if(spatializer != nullptr){
+        spatializer->setListener(pos);
     }
-    
 }
 
 void setSoundVolume(float volume){
     soundVolume = volume;
+    cugl::AudioEngine* engine = cugl::AudioEngine::get();
+    if(engine != nullptr && engine->isActive(SPATIAL_KEY)){
+        engine->setVolume(SPATIAL_KEY, volume);
+    }
 }
 
 }
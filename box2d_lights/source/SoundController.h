@@ -20,10 +20,18 @@ enum class Type {
 //call this before calling any other SoundController method
 void init(std::shared_ptr<cugl::AssetManager> assets);
 
+//call this once the sound assets are loaded
+//preallocates the voices so that playing a sound does not allocate
+void loadSounds();
+
 //play a sound at given position
-//pos is relative to the player, with (0,0) being on the player
+//pos is in world coordinates, and is heard relative to the listener
 void playSound(Type s, cugl::Vec2 pos);
 
+//call this every frame with the world position of the local player
+//sounds already playing are re-panned as the listener moves
+void setListener(cugl::Vec2 pos);
+
 //void playMusic();
 
 //void pauseMusic();
@@ -46,7 +46,7 @@ void World::setRootNode(const std::shared_ptr<scene2::SceneNode>& root, float sc
     CULog("scale x: %f ", _scale);
     
     // Create, but transfer ownership to root
-    _worldNode = scene2::SceneNode::alloc();
+    _worldNode = scene2::CullingNode::alloc();
     _worldNode->setAnchor(Vec2::ANCHOR_BOTTOM_LEFT);
     _worldNode->setPosition(Vec2::ZERO);
     